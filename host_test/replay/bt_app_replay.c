@@ -0,0 +1,595 @@
+/*
+ * Replays an A2DP arrival pattern through the audio pipeline on the host.
+ *
+ * The replayer stands in for Bluedroid: it connects a source through bt_app_a2d_cb, hands every packet to
+ * bt_app_a2d_data_cb and disconnects at the end of the stream. Everything else is the firmware itself, the work
+ * task, write_ringbuf and the I2S task with the ASRC, the PLC, the EQ and the DRC, writing into the file backend.
+ * With --bypass a copy from the FIFO to the output replaces the I2S task, to check the data path up to the FIFO.
+ * It all runs on the virtual clock: arrivals are an esp_timer and the tasks run one at a time, so a run is
+ * deterministic and takes far less than its playing time.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <getopt.h>
+#include <math.h>
+
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "host_clock.h"
+#include "bt_app_core.h"
+#include "bt_app_av.h"
+#include "bt_app_mem.h"
+#include "bt_app_pcm.h"
+
+#define BT_APP_REPLAY_TAG "BT_APP_REPLAY"
+
+/* defaults of a generated stream: 20 ms packets of a 1 kHz tone at -6 dBFS */
+#define REPLAY_PACKET_MS (20)
+#define REPLAY_TONE_HZ (1000)
+#define REPLAY_TONE_AMPLITUDE (16384)
+#define REPLAY_SECONDS (10)
+/* size of the canonical PCM WAV header */
+#define REPLAY_WAV_HEADER_BYTES (44)
+/* SBC information element of the stream, its first octet carries the sample rate and the channel mode */
+#define REPLAY_SBC_16000 (0x80)
+#define REPLAY_SBC_32000 (0x40)
+#define REPLAY_SBC_44100 (0x20)
+#define REPLAY_SBC_48000 (0x10)
+#define REPLAY_SBC_MONO (0x08)
+#define REPLAY_SBC_JOINT_STEREO (0x01)
+/* the rest of the element, block length 16, 8 subbands, loudness, bitpool 2 to 53 */
+#define REPLAY_SBC_OCTETS_1_3 0x15, 0x02, 0x35
+
+/**
+ * @brief One packet of the replayed stream.
+ */
+typedef struct
+{
+    int64_t arrival_us; /*!< time the packet reaches write_ringbuf */
+    size_t offset;      /*!< start of the packet in the source PCM */
+    size_t len;         /*!< length in bytes, 0 for a lost packet */
+} replay_packet_t;
+
+/**
+ * @brief Options of a run.
+ */
+typedef struct
+{
+    const char *in_path;       /*!< 16-bit PCM WAV source, NULL for a generated tone */
+    const char *arrivals_path; /*!< text trace of "arrival_us bytes" lines, NULL to generate arrivals */
+    const char *out_path;      /*!< WAV file written by the file backend */
+    uint32_t sample_rate;      /*!< sample rate of a generated tone */
+    uint8_t ch_count;          /*!< channels of a generated tone */
+    uint32_t seconds;          /*!< length of a generated tone */
+    uint32_t packet_ms;        /*!< length of a generated packet */
+    uint32_t jitter_ms;        /*!< largest random delay added to a generated arrival */
+    uint32_t loss_pct;         /*!< percentage of generated packets that never arrive */
+    int32_t drift_ppm;         /*!< clock offset of the source against the output */
+    uint32_t seed;             /*!< seed of the random jitter and loss */
+    uint8_t volume;            /*!< volume applied by the DRC, 0 to PCM_VOLUME_MAX */
+    bool bypass;               /*!< the I2S task copies the FIFO to the output, no processing */
+    bool dump_trace;           /*!< dump the trace buffer at the end */
+} replay_opts_t;
+
+static replay_opts_t s_opts = {
+    .ch_count = 2,
+    .sample_rate = 44100,
+    .seconds = REPLAY_SECONDS,
+    .packet_ms = REPLAY_PACKET_MS,
+    .seed = 1,
+    .volume = PCM_VOLUME_MAX,
+};
+static uint8_t *s_src = NULL;             /* source PCM */
+static size_t s_src_len = 0;              /* bytes of source PCM */
+static replay_packet_t *s_packets = NULL; /* the stream in arrival order */
+static size_t s_packet_num = 0;           /* number of packets */
+static size_t s_packet_next = 0;          /* next packet to arrive */
+static esp_timer_handle_t s_arrival_timer = NULL;
+
+static const esp_bd_addr_t s_source_bda = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01}; /* locally administered */
+static uint64_t s_latency_sum_us = 0; /* FIFO and output depth seen by every packet handed over */
+static uint32_t s_latency_num = 0;
+
+static uint32_t replay_rand(uint32_t *seed)
+{
+    /* same LCG as the dither of bt_app_pcm.c, so runs are reproducible across hosts */
+    *seed = *seed * 1664525u + 1013904223u;
+    return *seed >> 8;
+}
+
+static uint32_t replay_get_le(const uint8_t *p, size_t bytes)
+{
+    uint32_t v = 0;
+
+    for (size_t i = 0; i < bytes; i++)
+    {
+        v |= (uint32_t)p[i] << (8 * i);
+    }
+    return v;
+}
+
+/* loads a canonical 16-bit PCM WAV file, the kind written by the file backend */
+static bool replay_load_wav(const char *path)
+{
+    uint8_t hdr[REPLAY_WAV_HEADER_BYTES];
+    FILE *f = fopen(path, "rb");
+    bool ok = false;
+
+    if (f == NULL)
+    {
+        ESP_LOGE(BT_APP_REPLAY_TAG, "cannot open %s", path);
+        return false;
+    }
+    if (fread(hdr, 1, sizeof(hdr), f) != sizeof(hdr) || memcmp(hdr, "RIFF", 4) || memcmp(hdr + 8, "WAVEfmt ", 8) ||
+        replay_get_le(hdr + 20, 2) != 1 || replay_get_le(hdr + 34, 2) != 16 || memcmp(hdr + 36, "data", 4))
+    {
+        ESP_LOGE(BT_APP_REPLAY_TAG, "%s is not a canonical 16-bit PCM WAV file", path);
+    }
+    else
+    {
+        s_opts.ch_count = (uint8_t)replay_get_le(hdr + 22, 2);
+        s_opts.sample_rate = replay_get_le(hdr + 24, 4);
+        s_src_len = replay_get_le(hdr + 40, 4);
+        s_src_len -= s_src_len % (s_opts.ch_count * sizeof(int16_t));
+        s_src = malloc(s_src_len ? s_src_len : 1);
+        ok = s_src && fread(s_src, 1, s_src_len, f) == s_src_len && s_opts.ch_count >= 1 && s_opts.ch_count <= 2;
+        if (!ok)
+        {
+            ESP_LOGE(BT_APP_REPLAY_TAG, "%s is truncated or has %u channels", path, s_opts.ch_count);
+        }
+    }
+    fclose(f);
+    return ok;
+}
+
+static bool replay_make_tone(void)
+{
+    size_t frames = (size_t)s_opts.sample_rate * s_opts.seconds;
+    int16_t *pcm = NULL;
+
+    s_src_len = frames * s_opts.ch_count * sizeof(int16_t);
+    if ((s_src = malloc(s_src_len ? s_src_len : 1)) == NULL)
+    {
+        return false;
+    }
+    pcm = (int16_t *)s_src;
+    for (size_t i = 0; i < frames; i++)
+    {
+        int16_t v = (int16_t)lrint(REPLAY_TONE_AMPLITUDE * sin(2 * M_PI * REPLAY_TONE_HZ * i / s_opts.sample_rate));
+        for (uint8_t ch = 0; ch < s_opts.ch_count; ch++)
+        {
+            pcm[i * s_opts.ch_count + ch] = v;
+        }
+    }
+    return true;
+}
+
+static bool replay_add_packet(int64_t arrival_us, size_t offset, size_t len)
+{
+    static size_t cap = 0;
+
+    if (s_packet_num == cap)
+    {
+        replay_packet_t *grown = realloc(s_packets, (cap ? cap * 2 : 256) * sizeof(*grown));
+        if (grown == NULL)
+        {
+            return false;
+        }
+        s_packets = grown;
+        cap = cap ? cap * 2 : 256;
+    }
+    s_packets[s_packet_num++] = (replay_packet_t){.arrival_us = arrival_us, .offset = offset, .len = len};
+    return true;
+}
+
+/* cuts the source into packets arriving on a drifting clock, with random delay and loss */
+static bool replay_make_arrivals(void)
+{
+    size_t frame_size = s_opts.ch_count * sizeof(int16_t);
+    size_t packet_bytes = (size_t)s_opts.sample_rate * s_opts.packet_ms / 1000 * frame_size;
+    double us_per_byte = 1e6 / ((double)s_opts.sample_rate * frame_size * (1.0 + s_opts.drift_ppm / 1e6));
+    uint32_t seed = s_opts.seed;
+    int64_t last_us = 0;
+
+    if (packet_bytes == 0)
+    {
+        return false;
+    }
+    for (size_t offset = 0; offset < s_src_len; offset += packet_bytes)
+    {
+        size_t len = s_src_len - offset < packet_bytes ? s_src_len - offset : packet_bytes;
+        int64_t arrival_us = (int64_t)(offset * us_per_byte);
+        bool lost = replay_rand(&seed) % 100 < s_opts.loss_pct;
+
+        if (s_opts.jitter_ms)
+        {
+            arrival_us += replay_rand(&seed) % (s_opts.jitter_ms * 1000 + 1);
+        }
+        /* the stack delivers packets in order, a late packet holds back the ones behind it */
+        if (arrival_us < last_us)
+        {
+            arrival_us = last_us;
+        }
+        last_us = arrival_us;
+        if (!replay_add_packet(arrival_us, offset, lost ? 0 : len))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* reads "arrival_us bytes" lines, the source is consumed in order and a line with 0 bytes is a lost packet of the
+ * size of the previous one */
+static bool replay_load_arrivals(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    char line[128];
+    size_t offset = 0;
+    size_t last_len = 0;
+    unsigned line_no = 0;
+
+    if (f == NULL)
+    {
+        ESP_LOGE(BT_APP_REPLAY_TAG, "cannot open %s", path);
+        return false;
+    }
+    while (fgets(line, sizeof(line), f) && offset < s_src_len)
+    {
+        long long arrival_us = 0;
+        unsigned long len = 0;
+
+        line_no++;
+        if (line[0] == '#' || line[0] == '\n')
+        {
+            continue;
+        }
+        if (sscanf(line, "%lld %lu", &arrival_us, &len) != 2)
+        {
+            ESP_LOGE(BT_APP_REPLAY_TAG, "%s:%u: expected \"arrival_us bytes\"", path, line_no);
+            fclose(f);
+            return false;
+        }
+        bool lost = len == 0;
+        len = lost ? last_len : len;
+        if (len > s_src_len - offset)
+        {
+            len = s_src_len - offset;
+        }
+        if (!replay_add_packet(arrival_us, offset, lost ? 0 : len))
+        {
+            fclose(f);
+            return false;
+        }
+        offset += len;
+        last_len = len;
+    }
+    fclose(f);
+    return true;
+}
+
+static void replay_arm_arrival(void)
+{
+    if (s_packet_next < s_packet_num)
+    {
+        int64_t delay_us = s_packets[s_packet_next].arrival_us - esp_timer_get_time();
+        esp_timer_start_once(s_arrival_timer, delay_us > 0 ? (uint64_t)delay_us : 0);
+    }
+}
+
+static void replay_on_arrival(void *arg)
+{
+    /* several packets may be due at the same time after a stall of the source */
+    while (s_packet_next < s_packet_num && s_packets[s_packet_next].arrival_us <= esp_timer_get_time())
+    {
+        const replay_packet_t *pkt = &s_packets[s_packet_next++];
+        if (pkt->len == 0)
+        {
+            continue;
+        }
+        bt_app_a2d_data_cb(s_src + pkt->offset, pkt->len);
+        s_latency_sum_us += (uint64_t)audio_fifo_fill(bt_i2s_get_fifo()) * 1000000 /
+                                (s_opts.sample_rate * s_opts.ch_count * sizeof(int16_t)) +
+                            output_get_headroom_us();
+        s_latency_num++;
+    }
+    replay_arm_arrival();
+}
+
+static bool replay_input_done(void)
+{
+    return s_packet_next >= s_packet_num;
+}
+
+/* takes the place of the I2S task with the FIFO straight to the output, so that the output is the source byte for
+ * byte and any difference comes from the data callback or write_ringbuf */
+static void replay_bypass_task(void *arg)
+{
+    audio_fifo_t *fifo = bt_i2s_get_fifo();
+    size_t chunk_bytes = output_get_backend()->chunk_samples * sizeof(int16_t);
+    audio_fifo_span_t spans[2];
+    size_t chunk_size = 0;
+
+    chunk_bytes -= chunk_bytes % (s_opts.ch_count * sizeof(int16_t));
+    for (;;)
+    {
+        if ((chunk_size = audio_fifo_read_spans(fifo, spans, chunk_bytes)) == 0)
+        {
+            vTaskDelay(1);
+            continue;
+        }
+        output_write(spans[0].data, spans[0].len);
+        if (spans[1].len)
+        {
+            output_write(spans[1].data, spans[1].len);
+        }
+        audio_fifo_consume(fifo, chunk_size);
+    }
+}
+
+/* posts an A2DP event the way Bluedroid does and lets the work task handle it */
+static void replay_post_a2d(esp_a2d_cb_event_t event, esp_a2d_cb_param_t *param)
+{
+    bt_app_a2d_cb(event, param);
+    host_clock_advance_us(0);
+}
+
+static void replay_connect(void)
+{
+    esp_a2d_cb_param_t param;
+    uint8_t oct0 = s_opts.ch_count == 1 ? REPLAY_SBC_MONO : REPLAY_SBC_JOINT_STEREO;
+
+    switch (s_opts.sample_rate)
+    {
+    case 16000:
+        oct0 |= REPLAY_SBC_16000;
+        break;
+    case 32000:
+        oct0 |= REPLAY_SBC_32000;
+        break;
+    case 44100:
+        oct0 |= REPLAY_SBC_44100;
+        break;
+    default:
+        oct0 |= REPLAY_SBC_48000;
+        break;
+    }
+
+    /* the order of a source connecting to the sink: paging, codec configuration, connection, stream start */
+    memset(&param, 0, sizeof(param));
+    param.conn_stat.state = ESP_A2D_CONNECTION_STATE_CONNECTING;
+    memcpy(param.conn_stat.remote_bda, s_source_bda, sizeof(esp_bd_addr_t));
+    replay_post_a2d(ESP_A2D_CONNECTION_STATE_EVT, &param);
+
+    memset(&param, 0, sizeof(param));
+    memcpy(param.audio_cfg.remote_bda, s_source_bda, sizeof(esp_bd_addr_t));
+    param.audio_cfg.mcc.type = ESP_A2D_MCT_SBC;
+    memcpy(param.audio_cfg.mcc.cie.sbc, (const uint8_t[]){oct0, REPLAY_SBC_OCTETS_1_3}, ESP_A2D_CIE_LEN_SBC);
+    replay_post_a2d(ESP_A2D_AUDIO_CFG_EVT, &param);
+
+    memset(&param, 0, sizeof(param));
+    param.conn_stat.state = ESP_A2D_CONNECTION_STATE_CONNECTED;
+    memcpy(param.conn_stat.remote_bda, s_source_bda, sizeof(esp_bd_addr_t));
+    replay_post_a2d(ESP_A2D_CONNECTION_STATE_EVT, &param);
+
+    memset(&param, 0, sizeof(param));
+    param.audio_stat.state = ESP_A2D_AUDIO_STATE_STARTED;
+    memcpy(param.audio_stat.remote_bda, s_source_bda, sizeof(esp_bd_addr_t));
+    replay_post_a2d(ESP_A2D_AUDIO_STATE_EVT, &param);
+
+    volume_set_by_controller(s_opts.volume);
+}
+
+static void replay_disconnect(void)
+{
+    esp_a2d_cb_param_t param;
+
+    memset(&param, 0, sizeof(param));
+    param.audio_stat.state = ESP_A2D_AUDIO_STATE_SUSPEND;
+    memcpy(param.audio_stat.remote_bda, s_source_bda, sizeof(esp_bd_addr_t));
+    replay_post_a2d(ESP_A2D_AUDIO_STATE_EVT, &param);
+
+    memset(&param, 0, sizeof(param));
+    param.conn_stat.state = ESP_A2D_CONNECTION_STATE_DISCONNECTED;
+    memcpy(param.conn_stat.remote_bda, s_source_bda, sizeof(esp_bd_addr_t));
+    replay_post_a2d(ESP_A2D_CONNECTION_STATE_EVT, &param);
+}
+
+/* plays the stream through the firmware, until the I2S task has taken the last packet out of the FIFO */
+static void replay_run(void)
+{
+    /* the FIFO never holds more than this plays for, so a stream left prefetching at its end is cut there */
+    int64_t drain_us = (int64_t)RINGBUF_MAX_BYTES_BUFFER * 1000000 /
+                       (s_opts.sample_rate * s_opts.ch_count * sizeof(int16_t));
+    int64_t end_us = INT64_MAX;
+
+    replay_connect();
+    if (s_opts.bypass)
+    {
+        /* same slot of the memory table, so the disconnection stops the stand-in like the task it replaces */
+        bt_app_mem_task_delete(MEM_TASK_I2S);
+        bt_app_mem_task_create(MEM_TASK_I2S, replay_bypass_task, configMAX_PRIORITIES - 3, BT_I2S_TASK_CORE);
+    }
+    replay_arm_arrival();
+    for (;;)
+    {
+        if (replay_input_done() && end_us == INT64_MAX)
+        {
+            end_us = esp_timer_get_time() + drain_us;
+        }
+        /* the end of the stream is not a gap, stop before the I2S task waits out its headroom */
+        if (replay_input_done() && (audio_fifo_fill(bt_i2s_get_fifo()) == 0 || esp_timer_get_time() >= end_us))
+        {
+            break;
+        }
+        vTaskDelay(1);
+    }
+    if (s_opts.dump_trace)
+    {
+        /* the disconnection dumps the trace at info level */
+        host_log_set_level(ESP_LOG_INFO);
+    }
+    replay_disconnect();
+}
+
+static void replay_report(void)
+{
+    bt_app_stats_snapshot_t snap;
+
+    bt_app_stats_take_snapshot(&snap, false);
+    printf("packets %" PRIu32 ", drops %" PRIu32 ", overflows %" PRIu32 ", underflows %" PRIu32
+           ", rebuffers %" PRIu32 "\n",
+           snap.counters[STATS_CNT_PACKETS], snap.counters[STATS_CNT_DROPS], snap.counters[STATS_CNT_OVERFLOWS],
+           snap.counters[STATS_CNT_UNDERFLOWS], snap.counters[STATS_CNT_REBUFFERS]);
+    if (!s_opts.bypass)
+    {
+        const plc_stats_t *plc = bt_i2s_get_plc_stats();
+        printf("concealed gaps %" PRIu32 " (%" PRIu32 " frames, longest %" PRIu32 "), jitter target %" PRIu32
+               " us, mean latency %" PRIu64 " us\n",
+               plc->gaps, plc->concealed_frames, plc->longest_gap_frames, (uint32_t)bt_i2s_get_delay_value() * 100,
+               s_latency_num ? s_latency_sum_us / s_latency_num : 0);
+    }
+}
+
+static bool replay_sbc_rate(uint32_t sample_rate)
+{
+    return sample_rate == 16000 || sample_rate == 32000 || sample_rate == 44100 || sample_rate == 48000;
+}
+
+static void replay_usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [options] OUT.wav\n"
+            "  --in FILE.wav       16-bit PCM source, a 1 kHz tone if omitted\n"
+            "  --rate HZ           sample rate of the tone, one of SBC: 16000, 32000, 44100, 48000 (44100)\n"
+            "  --channels N        channels of the tone (2)\n"
+            "  --seconds N         length of the tone (%d)\n"
+            "  --arrivals FILE     \"arrival_us bytes\" per line, 0 bytes for a lost packet\n"
+            "  --packet-ms N       length of a generated packet (%d)\n"
+            "  --jitter-ms N       largest random delay of a generated arrival (0)\n"
+            "  --loss PCT          percentage of generated packets lost (0)\n"
+            "  --drift-ppm N       source clock offset against the output (0)\n"
+            "  --seed N            seed of jitter and loss (1)\n"
+            "  --volume N          volume 0..%d (%d)\n"
+            "  --bypass            the FIFO straight to the output, in place of the I2S task; the output equals\n"
+            "                      the source\n"
+            "  --dump-trace        dump the trace buffer for tools/bt_app_trace_to_json.py\n",
+            prog, REPLAY_SECONDS, REPLAY_PACKET_MS, PCM_VOLUME_MAX, PCM_VOLUME_MAX);
+}
+
+static bool replay_parse_args(int argc, char **argv)
+{
+    static const struct option options[] = {
+        {"in", required_argument, NULL, 'i'},      {"rate", required_argument, NULL, 'r'},
+        {"channels", required_argument, NULL, 'c'}, {"seconds", required_argument, NULL, 's'},
+        {"arrivals", required_argument, NULL, 'a'}, {"packet-ms", required_argument, NULL, 'p'},
+        {"jitter-ms", required_argument, NULL, 'j'}, {"loss", required_argument, NULL, 'l'},
+        {"drift-ppm", required_argument, NULL, 'd'}, {"seed", required_argument, NULL, 'S'},
+        {"volume", required_argument, NULL, 'v'},   {"bypass", no_argument, NULL, 'b'},
+        {"dump-trace", no_argument, NULL, 't'},     {NULL, 0, NULL, 0},
+    };
+    int opt = 0;
+
+    while ((opt = getopt_long(argc, argv, "", options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 'i':
+            s_opts.in_path = optarg;
+            break;
+        case 'r':
+            s_opts.sample_rate = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'c':
+            s_opts.ch_count = (uint8_t)strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            s_opts.seconds = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'a':
+            s_opts.arrivals_path = optarg;
+            break;
+        case 'p':
+            s_opts.packet_ms = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'j':
+            s_opts.jitter_ms = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'l':
+            s_opts.loss_pct = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'd':
+            s_opts.drift_ppm = (int32_t)strtol(optarg, NULL, 0);
+            break;
+        case 'S':
+            s_opts.seed = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'v':
+            s_opts.volume = (uint8_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'b':
+            s_opts.bypass = true;
+            break;
+        case 't':
+            s_opts.dump_trace = true;
+            break;
+        default:
+            return false;
+        }
+    }
+    if (optind != argc - 1 || s_opts.ch_count < 1 || s_opts.ch_count > 2 || !replay_sbc_rate(s_opts.sample_rate) ||
+        s_opts.volume > PCM_VOLUME_MAX)
+    {
+        return false;
+    }
+    s_opts.out_path = argv[optind];
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    const esp_timer_create_args_t timer_args = {
+        .callback = replay_on_arrival,
+        .name = "arrival",
+    };
+
+    if (!replay_parse_args(argc, argv))
+    {
+        replay_usage(argv[0]);
+        return 2;
+    }
+    host_log_set_level(ESP_LOG_WARN);
+    host_clock_set_virtual(true);
+
+    if (!(s_opts.in_path ? replay_load_wav(s_opts.in_path) : replay_make_tone()) ||
+        !(s_opts.arrivals_path ? replay_load_arrivals(s_opts.arrivals_path) : replay_make_arrivals()))
+    {
+        return 1;
+    }
+
+    if (!replay_sbc_rate(s_opts.sample_rate))
+    {
+        ESP_LOGE(BT_APP_REPLAY_TAG, "%" PRIu32 " Hz is not a sample rate of SBC", s_opts.sample_rate);
+        return 1;
+    }
+
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &s_arrival_timer));
+    bt_app_task_start_up();
+    replay_run();
+    bt_app_task_shut_down();
+    esp_timer_stop(s_arrival_timer);
+
+    replay_report();
+    if (strcmp(s_opts.out_path, OUTPUT_FILE_PATH) != 0 && rename(OUTPUT_FILE_PATH, s_opts.out_path) != 0)
+    {
+        ESP_LOGE(BT_APP_REPLAY_TAG, "cannot move %s to %s", OUTPUT_FILE_PATH, s_opts.out_path);
+        return 1;
+    }
+    free(s_packets);
+    free(s_src);
+    return 0;
+}
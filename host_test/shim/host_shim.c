@@ -0,0 +1,857 @@
+#define _GNU_SOURCE /* PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_a2dp_api.h"
+#include "esp_avrc_api.h"
+#include "esp_gap_bt_api.h"
+#include "esp_heap_caps.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "sys/lock.h"
+
+#include "host_clock.h"
+
+/* most timers alive at once, the firmware creates a handful */
+#define HOST_TIMER_MAX (16)
+/* most tasks alive at once, the firmware creates three */
+#define HOST_TASK_MAX (4)
+/* NVS namespaces and keys, and the largest blob, the firmware stores one list of sources */
+#define HOST_NVS_NAMESPACES (4)
+#define HOST_NVS_KEYS (8)
+#define HOST_NVS_NAME_LEN (16)
+#define HOST_NVS_BLOB_MAX (256)
+
+struct host_queue;
+
+struct host_task
+{
+    uint32_t notify;                 /* notification value */
+    bool created;                    /* made by xTaskCreateStaticPinnedToCore, not a thread seen as a task */
+    pthread_t thread;                /* thread running the task */
+    TaskFunction_t fn;               /* task function */
+    void *arg;                       /* argument of the task function */
+    uint32_t stack_bytes;            /* size of the unused static stack */
+    void *tls;                       /* local storage pointer */
+    TlsDeleteCallbackFunction_t tls_cb; /* called with tls once the task is deleted */
+    bool blocked;                    /* waits for the clock owner on the virtual clock */
+    bool notify_wait;                /* waits for a notification */
+    struct host_queue *queue_wait;   /* waits for an item of this queue, NULL if not */
+    int64_t wake_us;                 /* time the wait ends, INT64_MAX for no limit */
+};
+
+_Static_assert(sizeof(struct host_task) <= sizeof(StaticTask_t), "StaticTask_t must hold a task");
+
+struct host_queue
+{
+    uint8_t *storage;    /* len items of item_size bytes */
+    uint32_t len;        /* capacity in items */
+    uint32_t item_size;  /* size of one item, 0 for a semaphore */
+    uint32_t head;       /* index of the oldest item */
+    uint32_t count;      /* items in the queue */
+};
+
+_Static_assert(sizeof(struct host_queue) <= sizeof(StaticQueue_t), "StaticQueue_t must hold a queue");
+
+struct host_timer
+{
+    esp_timer_cb_t callback; /* function called when the timer expires */
+    void *arg;               /* argument of the callback */
+    bool used;               /* the slot holds a timer */
+    bool active;             /* the timer is armed */
+    int64_t due_us;          /* virtual time of the next expiry */
+    uint64_t period_us;      /* period, 0 for a one-shot timer */
+};
+
+struct host_nvs_blob
+{
+    uint8_t ns;                    /* index of the namespace plus one, 0 for a free slot */
+    char key[HOST_NVS_NAME_LEN];   /* key */
+    uint8_t value[HOST_NVS_BLOB_MAX];
+    size_t length;                 /* bytes of value */
+};
+
+static pthread_mutex_t s_critical = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP; /* every critical section and lock */
+static struct host_timer s_timers[HOST_TIMER_MAX];
+static bool s_virtual = false;                  /* time comes from s_virtual_us instead of the monotonic clock */
+static int64_t s_virtual_us = 0;                /* virtual time */
+static esp_log_level_t s_log_level = ESP_LOG_INFO;
+static pthread_cond_t s_wake_cond = PTHREAD_COND_INITIALIZER;  /* signalled on every notification and queued item */
+static pthread_cond_t s_sched_cond = PTHREAD_COND_INITIALIZER; /* signalled whenever s_running changes */
+static struct host_task *s_tasks[HOST_TASK_MAX]; /* tasks alive, in the order they run on the virtual clock */
+static struct host_task *s_running = NULL;      /* task running on the virtual clock, NULL while the owner runs */
+static __thread struct host_task s_thread_task; /* a thread that is not a task seen as one */
+static __thread struct host_task *s_self = NULL; /* the calling task, its address is the handle */
+static char s_nvs_ns[HOST_NVS_NAMESPACES][HOST_NVS_NAME_LEN]; /* namespaces written to, "" for a free slot */
+static struct host_nvs_blob s_nvs_blobs[HOST_NVS_KEYS];
+
+void host_enter_critical(portMUX_TYPE *mux)
+{
+    (void)mux;
+    pthread_mutex_lock(&s_critical);
+}
+
+void host_exit_critical(portMUX_TYPE *mux)
+{
+    (void)mux;
+    pthread_mutex_unlock(&s_critical);
+}
+
+void _lock_acquire(_lock_t *lock)
+{
+    (void)lock;
+    pthread_mutex_lock(&s_critical);
+}
+
+void _lock_release(_lock_t *lock)
+{
+    (void)lock;
+    pthread_mutex_unlock(&s_critical);
+}
+
+BaseType_t xPortGetCoreID(void)
+{
+    return 0;
+}
+
+static int64_t host_monotonic_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void host_clock_set_virtual(bool enable)
+{
+    s_virtual = enable;
+    s_virtual_us = 0;
+}
+
+static struct host_task *host_self(void)
+{
+    return s_self ? s_self : &s_thread_task;
+}
+
+static void host_unlock_critical(void *arg)
+{
+    pthread_mutex_unlock(&s_critical);
+}
+
+static bool host_task_can_run(const struct host_task *task)
+{
+    return (task->notify_wait && task->notify > 0) || (task->queue_wait && task->queue_wait->count > 0) ||
+           s_virtual_us >= task->wake_us;
+}
+
+/* hands the virtual clock back to its owner until the owner runs the task again, with s_critical held */
+static void host_task_block(struct host_task *task, int64_t wake_us)
+{
+    task->wake_us = wake_us;
+    task->blocked = true;
+    s_running = NULL;
+    pthread_cond_broadcast(&s_sched_cond);
+    pthread_cleanup_push(host_unlock_critical, NULL);
+    while (s_running != task)
+    {
+        pthread_cond_wait(&s_sched_cond, &s_critical);
+    }
+    pthread_cleanup_pop(0);
+}
+
+/* runs the tasks whose wait is over one at a time, in the order of s_tasks, until all of them wait again; called by
+ * the clock owner with s_critical held */
+static void host_run_tasks(void)
+{
+    for (;;)
+    {
+        struct host_task *next = NULL;
+
+        for (int i = 0; i < HOST_TASK_MAX && next == NULL; i++)
+        {
+            if (s_tasks[i] && s_tasks[i]->blocked && host_task_can_run(s_tasks[i]))
+            {
+                next = s_tasks[i];
+            }
+        }
+        if (next == NULL)
+        {
+            return;
+        }
+        next->blocked = false;
+        s_running = next;
+        pthread_cond_broadcast(&s_sched_cond);
+        while (s_running != NULL)
+        {
+            pthread_cond_wait(&s_sched_cond, &s_critical);
+        }
+    }
+}
+
+void host_clock_advance_us(int64_t delta_us)
+{
+    int64_t target_us = s_virtual_us + delta_us;
+
+    pthread_mutex_lock(&s_critical);
+    /* fire due timers and end due waits in order of time, each at its own time, so that callbacks re-arming
+     * themselves run again and a task sees the timers that fired before it woke */
+    for (;;)
+    {
+        struct host_timer *next = NULL;
+        int64_t wake_us = INT64_MAX;
+
+        host_run_tasks();
+        for (int i = 0; i < HOST_TIMER_MAX; i++)
+        {
+            struct host_timer *t = &s_timers[i];
+            if (t->used && t->active && t->due_us <= target_us && (next == NULL || t->due_us < next->due_us))
+            {
+                next = t;
+            }
+        }
+        for (int i = 0; i < HOST_TASK_MAX; i++)
+        {
+            if (s_tasks[i] && s_tasks[i]->blocked && s_tasks[i]->wake_us < wake_us)
+            {
+                wake_us = s_tasks[i]->wake_us;
+            }
+        }
+        if (wake_us <= target_us && (next == NULL || wake_us <= next->due_us))
+        {
+            s_virtual_us = wake_us > s_virtual_us ? wake_us : s_virtual_us;
+            continue;
+        }
+        if (next == NULL)
+        {
+            break;
+        }
+        if (next->due_us > s_virtual_us)
+        {
+            s_virtual_us = next->due_us;
+        }
+        if (next->period_us)
+        {
+            next->due_us += next->period_us;
+        }
+        else
+        {
+            next->active = false;
+        }
+        pthread_mutex_unlock(&s_critical);
+        next->callback(next->arg);
+        pthread_mutex_lock(&s_critical);
+    }
+    s_virtual_us = target_us;
+    host_run_tasks();
+    pthread_mutex_unlock(&s_critical);
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return s_virtual ? s_virtual_us : host_monotonic_us();
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle)
+{
+    if (args == NULL || args->callback == NULL || out_handle == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < HOST_TIMER_MAX; i++)
+    {
+        if (!s_timers[i].used)
+        {
+            s_timers[i] = (struct host_timer){.callback = args->callback, .arg = args->arg, .used = true};
+            *out_handle = &s_timers[i];
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+static esp_err_t host_timer_start(esp_timer_handle_t timer, uint64_t timeout_us, uint64_t period_us)
+{
+    if (timer == NULL || !timer->used)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (timer->active)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->active = true;
+    timer->due_us = esp_timer_get_time() + (int64_t)timeout_us;
+    timer->period_us = period_us;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    return host_timer_start(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us)
+{
+    return host_timer_start(timer, period_us, period_us);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (timer == NULL || !timer->used)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!timer->active)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->active = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    if (timer == NULL || !timer->used)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (timer->active)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->used = false;
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    return timer && timer->used && timer->active;
+}
+
+static void *host_task_main(void *arg)
+{
+    struct host_task *task = arg;
+
+    s_self = task;
+    if (s_virtual)
+    {
+        /* created waiting, it starts once the clock owner runs it */
+        pthread_mutex_lock(&s_critical);
+        pthread_cleanup_push(host_unlock_critical, NULL);
+        while (s_running != task)
+        {
+            pthread_cond_wait(&s_sched_cond, &s_critical);
+        }
+        pthread_cleanup_pop(1);
+    }
+    task->fn(task->arg);
+    return NULL;
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_bytes, void *arg,
+                                           UBaseType_t prio, StackType_t *stack, StaticTask_t *tcb, BaseType_t core)
+{
+    struct host_task *task = (struct host_task *)tcb;
+    int slot = -1;
+
+    pthread_mutex_lock(&s_critical);
+    for (int i = 0; i < HOST_TASK_MAX && slot < 0; i++)
+    {
+        slot = s_tasks[i] == NULL ? i : -1;
+    }
+    if (slot < 0)
+    {
+        pthread_mutex_unlock(&s_critical);
+        return NULL;
+    }
+    *task = (struct host_task){
+        .created = true,
+        .fn = fn,
+        .arg = arg,
+        .stack_bytes = stack_bytes,
+        .blocked = true,
+        .wake_us = INT64_MIN,
+    };
+    if (pthread_create(&task->thread, NULL, host_task_main, task) != 0)
+    {
+        pthread_mutex_unlock(&s_critical);
+        return NULL;
+    }
+    s_tasks[slot] = task;
+    pthread_mutex_unlock(&s_critical);
+    return task;
+}
+
+void vTaskDelete(TaskHandle_t handle)
+{
+    struct host_task *task = handle;
+
+    pthread_mutex_lock(&s_critical);
+    for (int i = 0; i < HOST_TASK_MAX; i++)
+    {
+        if (s_tasks[i] == task)
+        {
+            s_tasks[i] = NULL;
+        }
+    }
+    pthread_mutex_unlock(&s_critical);
+    pthread_cancel(task->thread);
+    pthread_join(task->thread, NULL);
+    if (task->tls_cb)
+    {
+        task->tls_cb(0, task->tls);
+    }
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t handle)
+{
+    return ((struct host_task *)handle)->stack_bytes;
+}
+
+void vTaskSetThreadLocalStoragePointerAndDelCallback(TaskHandle_t handle, BaseType_t index, void *value,
+                                                     TlsDeleteCallbackFunction_t cb)
+{
+    struct host_task *task = handle;
+
+    task->tls = value;
+    task->tls_cb = cb;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    struct host_task *self = host_self();
+
+    if (s_virtual && self->created)
+    {
+        if (ticks)
+        {
+            pthread_mutex_lock(&s_critical);
+            host_task_block(self, s_virtual_us + (int64_t)ticks * portTICK_PERIOD_MS * 1000);
+            pthread_mutex_unlock(&s_critical);
+        }
+        return;
+    }
+    if (s_virtual)
+    {
+        host_clock_advance_us((int64_t)ticks * portTICK_PERIOD_MS * 1000);
+        return;
+    }
+    struct timespec ts = {
+        .tv_sec = ticks * portTICK_PERIOD_MS / 1000,
+        .tv_nsec = (long)(ticks * portTICK_PERIOD_MS % 1000) * 1000000,
+    };
+    nanosleep(&ts, NULL);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(esp_timer_get_time() / (1000 * portTICK_PERIOD_MS));
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return host_self();
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    pthread_mutex_lock(&s_critical);
+    ((struct host_task *)task)->notify++;
+    pthread_cond_broadcast(&s_wake_cond);
+    pthread_mutex_unlock(&s_critical);
+    return pdPASS;
+}
+
+/* waits until the wait set up in task is over or the ticks pass, with s_critical held; on the virtual clock only a
+ * task waits, for any other thread the wait is over at once */
+static void host_wait(struct host_task *task, TickType_t ticks)
+{
+    struct timespec deadline;
+    int err = 0;
+
+    if (ticks == 0 || host_task_can_run(task))
+    {
+        return;
+    }
+    if (s_virtual)
+    {
+        if (task->created)
+        {
+            host_task_block(task, ticks == portMAX_DELAY ? INT64_MAX
+                                                         : s_virtual_us + (int64_t)ticks * portTICK_PERIOD_MS * 1000);
+        }
+        return;
+    }
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += ticks / configTICK_RATE_HZ;
+    deadline.tv_nsec += (long)(ticks % configTICK_RATE_HZ) * (1000000000L / configTICK_RATE_HZ);
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    pthread_cleanup_push(host_unlock_critical, NULL);
+    while (!host_task_can_run(task) && err == 0)
+    {
+        err = ticks == portMAX_DELAY ? pthread_cond_wait(&s_wake_cond, &s_critical)
+                                     : pthread_cond_timedwait(&s_wake_cond, &s_critical, &deadline);
+    }
+    pthread_cleanup_pop(0);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+    struct host_task *self = host_self();
+    uint32_t value = 0;
+
+    pthread_mutex_lock(&s_critical);
+    self->notify_wait = true;
+    self->wake_us = INT64_MAX;
+    host_wait(self, ticks);
+    self->notify_wait = false;
+    value = self->notify;
+    if (value)
+    {
+        self->notify = clear ? 0 : value - 1;
+    }
+    pthread_mutex_unlock(&s_critical);
+    return value;
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t len, UBaseType_t item_size, uint8_t *storage, StaticQueue_t *buffer)
+{
+    struct host_queue *queue = (struct host_queue *)buffer;
+
+    *queue = (struct host_queue){.storage = storage, .len = len, .item_size = item_size};
+    return queue;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buffer)
+{
+    return xQueueCreateStatic(1, 0, NULL, buffer);
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks)
+{
+    BaseType_t sent = pdFALSE;
+
+    pthread_mutex_lock(&s_critical);
+    if (queue->count < queue->len)
+    {
+        if (queue->item_size)
+        {
+            memcpy(queue->storage + (queue->head + queue->count) % queue->len * queue->item_size, item,
+                   queue->item_size);
+        }
+        queue->count++;
+        pthread_cond_broadcast(&s_wake_cond);
+        sent = pdTRUE;
+    }
+    pthread_mutex_unlock(&s_critical);
+    return sent;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks)
+{
+    struct host_task *self = host_self();
+    BaseType_t received = pdFALSE;
+
+    pthread_mutex_lock(&s_critical);
+    self->queue_wait = queue;
+    self->wake_us = INT64_MAX;
+    host_wait(self, ticks);
+    self->queue_wait = NULL;
+    if (queue->count > 0)
+    {
+        if (queue->item_size)
+        {
+            memcpy(item, queue->storage + queue->head * queue->item_size, queue->item_size);
+        }
+        queue->head = (queue->head + 1) % queue->len;
+        queue->count--;
+        received = pdTRUE;
+    }
+    pthread_mutex_unlock(&s_critical);
+    return received;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    UBaseType_t count = 0;
+
+    pthread_mutex_lock(&s_critical);
+    count = queue->count;
+    pthread_mutex_unlock(&s_critical);
+    return count;
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+    queue->len = 0;
+    queue->count = 0;
+}
+
+uint32_t esp_get_free_heap_size(void)
+{
+    return HOST_FREE_HEAP_BYTES;
+}
+
+uint32_t esp_get_minimum_free_heap_size(void)
+{
+    return HOST_FREE_HEAP_BYTES;
+}
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    return HOST_FREE_HEAP_BYTES;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+    return HOST_FREE_HEAP_BYTES;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t mode, nvs_handle_t *out_handle)
+{
+    int free_ns = -1;
+
+    if (strlen(name) >= HOST_NVS_NAME_LEN)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < HOST_NVS_NAMESPACES; i++)
+    {
+        if (strcmp(s_nvs_ns[i], name) == 0)
+        {
+            *out_handle = i + 1;
+            return ESP_OK;
+        }
+        if (s_nvs_ns[i][0] == 0 && free_ns < 0)
+        {
+            free_ns = i;
+        }
+    }
+    if (mode == NVS_READONLY)
+    {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (free_ns < 0)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    strcpy(s_nvs_ns[free_ns], name);
+    *out_handle = free_ns + 1;
+    return ESP_OK;
+}
+
+static struct host_nvs_blob *host_nvs_find(nvs_handle_t handle, const char *key)
+{
+    for (int i = 0; i < HOST_NVS_KEYS; i++)
+    {
+        if (s_nvs_blobs[i].ns == handle && strcmp(s_nvs_blobs[i].key, key) == 0)
+        {
+            return &s_nvs_blobs[i];
+        }
+    }
+    return NULL;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    struct host_nvs_blob *blob = host_nvs_find(handle, key);
+
+    if (length > HOST_NVS_BLOB_MAX || strlen(key) >= HOST_NVS_NAME_LEN)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    for (int i = 0; i < HOST_NVS_KEYS && blob == NULL; i++)
+    {
+        blob = s_nvs_blobs[i].ns == 0 ? &s_nvs_blobs[i] : NULL;
+    }
+    if (blob == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    blob->ns = (uint8_t)handle;
+    strcpy(blob->key, key);
+    memcpy(blob->value, value, length);
+    blob->length = length;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *value, size_t *length)
+{
+    const struct host_nvs_blob *blob = host_nvs_find(handle, key);
+
+    if (blob == NULL)
+    {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (*length < blob->length)
+    {
+        *length = blob->length;
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(value, blob->value, blob->length);
+    *length = blob->length;
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code)
+    {
+    case ESP_OK:
+        return "ESP_OK";
+    case ESP_FAIL:
+        return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:
+        return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:
+        return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:
+        return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:
+        return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:
+        return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED:
+        return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:
+        return "ESP_ERR_TIMEOUT";
+    default:
+        return "UNKNOWN ERROR";
+    }
+}
+
+void host_log_set_level(esp_log_level_t level)
+{
+    s_log_level = level;
+}
+
+void host_log_write(esp_log_level_t level, const char *tag, const char *fmt, ...)
+{
+    static const char letters[] = "NEWIDV";
+    va_list ap;
+
+    if (level > s_log_level)
+    {
+        return;
+    }
+    fprintf(stderr, "%c (%lld) %s: ", letters[level], (long long)(esp_timer_get_time() / 1000), tag);
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *fmt, ...)
+{
+    va_list ap;
+
+    if (level > s_log_level)
+    {
+        return;
+    }
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+}
+
+__attribute__((weak)) esp_err_t esp_avrc_ct_send_get_rn_capabilities_cmd(uint8_t tl)
+{
+    (void)tl;
+    return ESP_OK;
+}
+
+__attribute__((weak)) esp_err_t esp_avrc_ct_send_metadata_cmd(uint8_t tl, uint8_t attr_mask)
+{
+    (void)tl;
+    (void)attr_mask;
+    return ESP_OK;
+}
+
+__attribute__((weak)) esp_err_t esp_avrc_ct_send_register_notification_cmd(uint8_t tl, uint8_t event_id,
+                                                                            uint32_t event_parameter)
+{
+    (void)tl;
+    (void)event_id;
+    (void)event_parameter;
+    return ESP_OK;
+}
+
+__attribute__((weak)) esp_err_t esp_avrc_tg_send_rn_rsp(uint8_t event_id, esp_avrc_rn_rsp_t rsp,
+                                                         esp_avrc_rn_param_t *param)
+{
+    (void)event_id;
+    (void)rsp;
+    (void)param;
+    return ESP_OK;
+}
+
+bool esp_avrc_rn_evt_bit_mask_operation(esp_avrc_bit_mask_op_t op, esp_avrc_rn_evt_cap_mask_t *events,
+                                        uint8_t event_id)
+{
+    uint16_t bit = (uint16_t)(1u << event_id);
+
+    switch (op)
+    {
+    case ESP_AVRC_BIT_MASK_OP_TEST:
+        return (events->bits & bit) != 0;
+    case ESP_AVRC_BIT_MASK_OP_SET:
+        events->bits |= bit;
+        return true;
+    case ESP_AVRC_BIT_MASK_OP_CLEAR:
+        events->bits &= (uint16_t)~bit;
+        return true;
+    }
+    return false;
+}
+
+__attribute__((weak)) esp_err_t esp_a2d_sink_connect(esp_bd_addr_t remote_bda)
+{
+    (void)remote_bda;
+    return ESP_OK;
+}
+
+__attribute__((weak)) esp_err_t esp_a2d_sink_set_delay_value(uint16_t delay_value)
+{
+    (void)delay_value;
+    return ESP_OK;
+}
+
+__attribute__((weak)) esp_err_t esp_bt_gap_set_scan_mode(esp_bt_connection_mode_t c_mode,
+                                                          esp_bt_discovery_mode_t d_mode)
+{
+    (void)c_mode;
+    (void)d_mode;
+    return ESP_OK;
+}
+
+__attribute__((weak)) esp_err_t esp_bt_gap_get_bond_device_list(int *dev_num, esp_bd_addr_t *dev_list)
+{
+    (void)dev_list;
+    *dev_num = 0;
+    return ESP_OK;
+}
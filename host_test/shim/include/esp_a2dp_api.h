@@ -0,0 +1,107 @@
+#ifndef __HOST_ESP_A2DP_API_H__
+#define __HOST_ESP_A2DP_API_H__
+
+/* the A2DP sink types and calls of ESP-IDF that the application uses; the callbacks of the application are called
+ * by the test in place of Bluedroid */
+
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_bt_defs.h"
+
+#define ESP_A2D_MCT_SBC (0)
+#define ESP_A2D_CIE_LEN_SBC (4)
+#define ESP_A2D_PSC_DELAY_RPT (1 << 0)
+
+typedef uint8_t esp_a2d_mct_t;
+typedef uint16_t esp_a2d_psc_t;
+
+typedef enum
+{
+    ESP_A2D_CONNECTION_STATE_EVT = 0,
+    ESP_A2D_AUDIO_STATE_EVT,
+    ESP_A2D_AUDIO_CFG_EVT,
+    ESP_A2D_MEDIA_CTRL_ACK_EVT,
+    ESP_A2D_PROF_STATE_EVT,
+    ESP_A2D_SNK_PSC_CFG_EVT,
+    ESP_A2D_SNK_SET_DELAY_VALUE_EVT,
+    ESP_A2D_SNK_GET_DELAY_VALUE_EVT,
+} esp_a2d_cb_event_t;
+
+typedef enum
+{
+    ESP_A2D_CONNECTION_STATE_DISCONNECTED = 0,
+    ESP_A2D_CONNECTION_STATE_CONNECTING,
+    ESP_A2D_CONNECTION_STATE_CONNECTED,
+    ESP_A2D_CONNECTION_STATE_DISCONNECTING,
+} esp_a2d_connection_state_t;
+
+typedef enum
+{
+    ESP_A2D_AUDIO_STATE_SUSPEND = 0,
+    ESP_A2D_AUDIO_STATE_STOPPED,
+    ESP_A2D_AUDIO_STATE_STARTED,
+} esp_a2d_audio_state_t;
+
+typedef enum
+{
+    ESP_A2D_DEINIT_SUCCESS = 0,
+    ESP_A2D_INIT_SUCCESS,
+} esp_a2d_init_state_t;
+
+typedef enum
+{
+    ESP_A2D_SET_SUCCESS = 0,
+    ESP_A2D_SET_INVALID_PARAMS,
+} esp_a2d_set_delay_value_state_t;
+
+typedef struct
+{
+    esp_a2d_mct_t type; /*!< codec type */
+    union
+    {
+        uint8_t sbc[ESP_A2D_CIE_LEN_SBC]; /*!< SBC codec information element */
+    } cie;
+} esp_a2d_mcc_t;
+
+typedef union
+{
+    struct
+    {
+        esp_a2d_connection_state_t state;
+        esp_bd_addr_t remote_bda;
+    } conn_stat;
+    struct
+    {
+        esp_a2d_audio_state_t state;
+        esp_bd_addr_t remote_bda;
+    } audio_stat;
+    struct
+    {
+        esp_bd_addr_t remote_bda;
+        esp_a2d_mcc_t mcc;
+    } audio_cfg;
+    struct
+    {
+        esp_a2d_init_state_t init_state;
+    } a2d_prof_stat;
+    struct
+    {
+        esp_a2d_psc_t psc_mask;
+    } a2d_psc_cfg_stat;
+    struct
+    {
+        esp_a2d_set_delay_value_state_t set_state;
+        uint16_t delay_value;
+    } a2d_set_delay_value_stat;
+    struct
+    {
+        uint16_t delay_value;
+    } a2d_get_delay_value_stat;
+} esp_a2d_cb_param_t;
+
+/* default to succeeding without a peer, a test may replace them */
+esp_err_t esp_a2d_sink_connect(esp_bd_addr_t remote_bda);
+esp_err_t esp_a2d_sink_set_delay_value(uint16_t delay_value);
+
+#endif /* __HOST_ESP_A2DP_API_H__ */
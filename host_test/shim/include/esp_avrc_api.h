@@ -0,0 +1,157 @@
+#ifndef __HOST_ESP_AVRC_API_H__
+#define __HOST_ESP_AVRC_API_H__
+
+/* the AVRCP types and calls of ESP-IDF that the application uses, with the members it reads */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp_err.h"
+#include "esp_bt_defs.h"
+
+#define ESP_AVRC_MD_ATTR_TITLE 0x1
+#define ESP_AVRC_MD_ATTR_ARTIST 0x2
+#define ESP_AVRC_MD_ATTR_ALBUM 0x4
+#define ESP_AVRC_MD_ATTR_TRACK_NUM 0x8
+#define ESP_AVRC_MD_ATTR_NUM_TRACKS 0x10
+#define ESP_AVRC_MD_ATTR_GENRE 0x20
+#define ESP_AVRC_MD_ATTR_PLAYING_TIME 0x40
+
+#define ESP_AVRC_RN_PLAY_STATUS_CHANGE 0x01
+#define ESP_AVRC_RN_TRACK_CHANGE 0x02
+#define ESP_AVRC_RN_PLAY_POS_CHANGED 0x05
+#define ESP_AVRC_RN_VOLUME_CHANGE 0x0d
+
+typedef enum
+{
+    ESP_AVRC_CT_CONNECTION_STATE_EVT = 0,
+    ESP_AVRC_CT_PASSTHROUGH_RSP_EVT = 1,
+    ESP_AVRC_CT_METADATA_RSP_EVT = 2,
+    ESP_AVRC_CT_PLAY_STATUS_RSP_EVT = 3,
+    ESP_AVRC_CT_CHANGE_NOTIFY_EVT = 4,
+    ESP_AVRC_CT_REMOTE_FEATURES_EVT = 5,
+    ESP_AVRC_CT_GET_RN_CAPABILITIES_RSP_EVT = 6,
+    ESP_AVRC_CT_SET_ABSOLUTE_VOLUME_RSP_EVT = 7,
+} esp_avrc_ct_cb_event_t;
+
+typedef enum
+{
+    ESP_AVRC_TG_CONNECTION_STATE_EVT = 0,
+    ESP_AVRC_TG_REMOTE_FEATURES_EVT = 1,
+    ESP_AVRC_TG_PASSTHROUGH_CMD_EVT = 2,
+    ESP_AVRC_TG_SET_ABSOLUTE_VOLUME_CMD_EVT = 4,
+    ESP_AVRC_TG_REGISTER_NOTIFICATION_EVT = 5,
+    ESP_AVRC_TG_SET_PLAYER_APP_VALUE_EVT = 6,
+} esp_avrc_tg_cb_event_t;
+
+typedef enum
+{
+    ESP_AVRC_BIT_MASK_OP_TEST = 0,
+    ESP_AVRC_BIT_MASK_OP_SET = 1,
+    ESP_AVRC_BIT_MASK_OP_CLEAR = 2,
+} esp_avrc_bit_mask_op_t;
+
+typedef enum
+{
+    ESP_AVRC_RN_RSP_INTERIM = 13,
+    ESP_AVRC_RN_RSP_CHANGED = 15,
+} esp_avrc_rn_rsp_t;
+
+typedef struct
+{
+    uint16_t bits; /*!< one bit per notification event */
+} esp_avrc_rn_evt_cap_mask_t;
+
+typedef union
+{
+    uint8_t volume;    /*!< absolute volume */
+    uint8_t playback;  /*!< playback status */
+    uint8_t elm_id[8]; /*!< identifier of the track */
+    uint32_t play_pos; /*!< position in ms */
+} esp_avrc_rn_param_t;
+
+typedef union
+{
+    struct
+    {
+        bool connected;
+        esp_bd_addr_t remote_bda;
+    } conn_stat;
+    struct
+    {
+        uint8_t tl;
+        uint8_t key_code;
+        uint8_t key_state;
+        uint8_t rsp_code;
+    } psth_rsp;
+    struct
+    {
+        uint8_t attr_id;
+        uint8_t *attr_text;
+        int attr_length;
+    } meta_rsp;
+    struct
+    {
+        uint8_t event_id;
+        esp_avrc_rn_param_t event_parameter;
+    } change_ntf;
+    struct
+    {
+        uint32_t feat_mask;
+        uint16_t tg_feat_flag;
+        esp_bd_addr_t remote_bda;
+    } rmt_feats;
+    struct
+    {
+        uint8_t cap_count;
+        esp_avrc_rn_evt_cap_mask_t evt_set;
+    } get_rn_caps_rsp;
+} esp_avrc_ct_cb_param_t;
+
+typedef union
+{
+    struct
+    {
+        bool connected;
+        esp_bd_addr_t remote_bda;
+    } conn_stat;
+    struct
+    {
+        uint32_t feat_mask;
+        uint16_t ct_feat_flag;
+        esp_bd_addr_t remote_bda;
+    } rmt_feats;
+    struct
+    {
+        uint8_t key_code;
+        uint8_t key_state;
+    } psth_cmd;
+    struct
+    {
+        uint8_t volume;
+    } set_abs_vol;
+    struct
+    {
+        uint8_t event_id;
+        uint32_t event_parameter;
+    } reg_ntf;
+} esp_avrc_tg_cb_param_t;
+
+/* the controller and target calls default to succeeding without sending anything, a test may replace them */
+esp_err_t esp_avrc_ct_send_get_rn_capabilities_cmd(uint8_t tl);
+esp_err_t esp_avrc_ct_send_metadata_cmd(uint8_t tl, uint8_t attr_mask);
+esp_err_t esp_avrc_ct_send_register_notification_cmd(uint8_t tl, uint8_t event_id, uint32_t event_parameter);
+esp_err_t esp_avrc_tg_send_rn_rsp(uint8_t event_id, esp_avrc_rn_rsp_t rsp, esp_avrc_rn_param_t *param);
+
+/**
+ * @brief Tests, sets or clears the bit of a notification event in a capability mask.
+ *
+ * @param op The operation.
+ * @param events The mask.
+ * @param event_id The event.
+ * @return For a test whether the bit is set, otherwise true.
+ */
+bool esp_avrc_rn_evt_bit_mask_operation(esp_avrc_bit_mask_op_t op, esp_avrc_rn_evt_cap_mask_t *events,
+                                        uint8_t event_id);
+
+#endif /* __HOST_ESP_AVRC_API_H__ */
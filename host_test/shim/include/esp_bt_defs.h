@@ -0,0 +1,10 @@
+#ifndef __HOST_ESP_BT_DEFS_H__
+#define __HOST_ESP_BT_DEFS_H__
+
+#include <stdint.h>
+
+#define ESP_BD_ADDR_LEN 6
+
+typedef uint8_t esp_bd_addr_t[ESP_BD_ADDR_LEN];
+
+#endif /* __HOST_ESP_BT_DEFS_H__ */
@@ -0,0 +1,8 @@
+#ifndef __HOST_ESP_BT_DEVICE_H__
+#define __HOST_ESP_BT_DEVICE_H__
+
+/* empty, the host has no controller to name */
+
+#include "esp_bt_defs.h"
+
+#endif /* __HOST_ESP_BT_DEVICE_H__ */
@@ -0,0 +1,8 @@
+#ifndef __HOST_ESP_BT_MAIN_H__
+#define __HOST_ESP_BT_MAIN_H__
+
+/* empty, the host has no Bluedroid to enable */
+
+#include "esp_err.h"
+
+#endif /* __HOST_ESP_BT_MAIN_H__ */
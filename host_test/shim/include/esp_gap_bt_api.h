@@ -0,0 +1,33 @@
+#ifndef __HOST_ESP_GAP_BT_API_H__
+#define __HOST_ESP_GAP_BT_API_H__
+
+/* the GAP types and calls of ESP-IDF that the application uses */
+
+#include "esp_err.h"
+#include "esp_bt_defs.h"
+
+typedef int esp_bt_gap_cb_event_t;
+
+typedef union
+{
+    esp_bd_addr_t bda;
+} esp_bt_gap_cb_param_t;
+
+typedef enum
+{
+    ESP_BT_NON_CONNECTABLE = 0,
+    ESP_BT_CONNECTABLE,
+} esp_bt_connection_mode_t;
+
+typedef enum
+{
+    ESP_BT_NON_DISCOVERABLE = 0,
+    ESP_BT_LIMITED_DISCOVERABLE,
+    ESP_BT_GENERAL_DISCOVERABLE,
+} esp_bt_discovery_mode_t;
+
+/* default to succeeding with nothing bonded, a test may replace them */
+esp_err_t esp_bt_gap_set_scan_mode(esp_bt_connection_mode_t c_mode, esp_bt_discovery_mode_t d_mode);
+esp_err_t esp_bt_gap_get_bond_device_list(int *dev_num, esp_bd_addr_t *dev_list);
+
+#endif /* __HOST_ESP_GAP_BT_API_H__ */
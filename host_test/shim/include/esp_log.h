@@ -0,0 +1,39 @@
+#ifndef __HOST_ESP_LOG_H__
+#define __HOST_ESP_LOG_H__
+
+#include <stdint.h>
+
+typedef enum
+{
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE,
+} esp_log_level_t;
+
+/**
+ * @brief Prints one log line to stderr in the format of the ESP-IDF console, if the level is enabled.
+ */
+void host_log_write(esp_log_level_t level, const char *tag, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+
+/**
+ * @brief Prints raw text to stderr, with no prefix or newline, if the level is enabled; as esp_log_write does.
+ */
+void esp_log_write(esp_log_level_t level, const char *tag, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+
+/**
+ * @brief Sets the most verbose level printed, ESP_LOG_INFO by default.
+ *
+ * @param level The level.
+ */
+void host_log_set_level(esp_log_level_t level);
+
+#define ESP_LOGE(tag, fmt, ...) host_log_write(ESP_LOG_ERROR, tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) host_log_write(ESP_LOG_WARN, tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) host_log_write(ESP_LOG_INFO, tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) host_log_write(ESP_LOG_DEBUG, tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGV(tag, fmt, ...) host_log_write(ESP_LOG_VERBOSE, tag, fmt, ##__VA_ARGS__)
+
+#endif /* __HOST_ESP_LOG_H__ */
@@ -0,0 +1,8 @@
+#ifndef __HOST_ESP_PM_H__
+#define __HOST_ESP_PM_H__
+
+/* empty, CONFIG_PM_ENABLE is off on the host and the clock stays fixed */
+
+#include "esp_err.h"
+
+#endif /* __HOST_ESP_PM_H__ */
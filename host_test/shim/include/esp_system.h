@@ -0,0 +1,14 @@
+#ifndef __HOST_ESP_SYSTEM_H__
+#define __HOST_ESP_SYSTEM_H__
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/* the host has no fixed heap, both report HOST_FREE_HEAP_BYTES */
+#define HOST_FREE_HEAP_BYTES (160 * 1024)
+
+uint32_t esp_get_free_heap_size(void);
+uint32_t esp_get_minimum_free_heap_size(void);
+
+#endif /* __HOST_ESP_SYSTEM_H__ */
@@ -0,0 +1,42 @@
+#ifndef __HOST_ESP_TIMER_H__
+#define __HOST_ESP_TIMER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp_err.h"
+
+typedef struct host_timer *esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void *arg);
+
+typedef enum
+{
+    ESP_TIMER_TASK,
+} esp_timer_dispatch_t;
+
+typedef struct
+{
+    esp_timer_cb_t callback;              /*!< function called when the timer expires */
+    void *arg;                            /*!< argument of the callback */
+    esp_timer_dispatch_t dispatch_method; /*!< only ESP_TIMER_TASK exists on the host */
+    const char *name;                     /*!< name of the timer */
+    bool skip_unhandled_events;           /*!< ignored on the host */
+} esp_timer_create_args_t;
+
+/**
+ * @brief Gets the time since the clock started in microseconds, from the monotonic clock or the virtual clock.
+ */
+int64_t esp_timer_get_time(void);
+
+/*
+ * Timers only fire on the virtual clock, from host_clock_advance_us and vTaskDelay, on the calling thread. On the
+ * monotonic clock they are accepted but never expire.
+ */
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle);
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us);
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+esp_err_t esp_timer_delete(esp_timer_handle_t timer);
+bool esp_timer_is_active(esp_timer_handle_t timer);
+
+#endif /* __HOST_ESP_TIMER_H__ */
@@ -0,0 +1,54 @@
+#ifndef __HOST_FREERTOS_H__
+#define __HOST_FREERTOS_H__
+
+/* the part of the FreeRTOS API the host build of the pipeline modules uses, implemented in host_shim.c */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <assert.h>
+
+#include "sdkconfig.h"
+
+typedef int32_t BaseType_t;
+typedef uint32_t UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint8_t StackType_t;
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE ((BaseType_t)1)
+#define pdFAIL pdFALSE
+#define pdPASS pdTRUE
+
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portNUM_PROCESSORS (1)
+#define configMAX_PRIORITIES (25)
+#define configTICK_RATE_HZ (1000)
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+#define configNUM_THREAD_LOCAL_STORAGE_POINTERS (1)
+
+/* every spinlock maps to one process-wide recursive mutex, enough for the modules that only guard short sections */
+typedef struct
+{
+    int unused;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {0}
+
+void host_enter_critical(portMUX_TYPE *mux);
+void host_exit_critical(portMUX_TYPE *mux);
+
+#define portENTER_CRITICAL(mux) host_enter_critical(mux)
+#define portEXIT_CRITICAL(mux) host_exit_critical(mux)
+#define portENTER_CRITICAL_ISR(mux) host_enter_critical(mux)
+#define portEXIT_CRITICAL_ISR(mux) host_exit_critical(mux)
+#define portENTER_CRITICAL_SAFE(mux) host_enter_critical(mux)
+#define portEXIT_CRITICAL_SAFE(mux) host_exit_critical(mux)
+/* masking interrupts keeps other tasks of the core out, which the critical section does too */
+#define portSET_INTERRUPT_MASK_FROM_ISR() (host_enter_critical(NULL), (UBaseType_t)0)
+#define portCLEAR_INTERRUPT_MASK_FROM_ISR(mask) ((void)(mask), host_exit_critical(NULL))
+
+BaseType_t xPortGetCoreID(void);
+
+#endif /* __HOST_FREERTOS_H__ */
@@ -0,0 +1,63 @@
+#ifndef __HOST_FREERTOS_QUEUE_H__
+#define __HOST_FREERTOS_QUEUE_H__
+
+/* statically allocated queues of fixed-size items, serialized by the process-wide critical section; sends never
+ * block, which is all the work queue needs, receives wait like on FreeRTOS so that semaphores can be built on them */
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct host_queue *QueueHandle_t;
+
+typedef struct
+{
+    uint8_t opaque[96];
+} __attribute__((aligned(8))) StaticQueue_t;
+
+/**
+ * @brief Creates a queue in caller-provided memory.
+ *
+ * @param len The number of items the queue holds.
+ * @param item_size The size of one item in bytes.
+ * @param storage The storage of len * item_size bytes.
+ * @param buffer The control block, which becomes the queue.
+ * @return The handle of the queue.
+ */
+QueueHandle_t xQueueCreateStatic(UBaseType_t len, UBaseType_t item_size, uint8_t *storage, StaticQueue_t *buffer);
+
+/**
+ * @brief Copies an item to the back of the queue.
+ *
+ * @param queue The queue.
+ * @param item The item.
+ * @param ticks Ignored, the call never waits.
+ * @return pdTRUE if the item was queued, pdFALSE if the queue was full.
+ */
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks);
+
+/**
+ * @brief Takes the item at the front of the queue.
+ *
+ * @param queue The queue.
+ * @param item The buffer that receives the item.
+ * @param ticks The longest wait for an item, portMAX_DELAY for no limit. On the virtual clock only a task made by
+ *              xTaskCreateStaticPinnedToCore waits, see task.h.
+ * @return pdTRUE if an item was taken, pdFALSE if the queue stayed empty.
+ */
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks);
+
+/**
+ * @brief Gets the number of items in the queue.
+ *
+ * @param queue The queue.
+ * @return The number of items.
+ */
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+
+/**
+ * @brief Deletes a queue. Its memory belongs to the caller and is left alone.
+ *
+ * @param queue The queue.
+ */
+void vQueueDelete(QueueHandle_t queue);
+
+#endif /* __HOST_FREERTOS_QUEUE_H__ */
@@ -0,0 +1,23 @@
+#ifndef __HOST_FREERTOS_SEMPHR_H__
+#define __HOST_FREERTOS_SEMPHR_H__
+
+/* binary semaphores, which are queues of one empty item as on FreeRTOS */
+
+#include "freertos/queue.h"
+
+typedef QueueHandle_t SemaphoreHandle_t;
+typedef StaticQueue_t StaticSemaphore_t;
+
+/**
+ * @brief Creates a binary semaphore in caller-provided memory, initially taken.
+ *
+ * @param buffer The control block, which becomes the semaphore.
+ * @return The handle of the semaphore.
+ */
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buffer);
+
+#define xSemaphoreTake(sem, ticks) xQueueReceive((sem), NULL, (ticks))
+#define xSemaphoreGive(sem) xQueueSend((sem), NULL, 0)
+#define vSemaphoreDelete(sem) vQueueDelete(sem)
+
+#endif /* __HOST_FREERTOS_SEMPHR_H__ */
@@ -0,0 +1,111 @@
+#ifndef __HOST_FREERTOS_TASK_H__
+#define __HOST_FREERTOS_TASK_H__
+
+#include "freertos/FreeRTOS.h"
+
+/*
+ * Tasks are threads. On the virtual clock of host_clock.h the tasks made by xTaskCreateStaticPinnedToCore run one at
+ * a time: the thread that moves the clock, the clock owner, waits while one of them runs, and a task that waits in
+ * vTaskDelay, ulTaskNotifyTake or xQueueReceive hands control back until the clock owner wakes it. A run is then the
+ * same on every host. Any other thread, the clock owner included, never waits on the virtual clock.
+ */
+
+#define tskIDLE_PRIORITY ((UBaseType_t)0)
+#define tskNO_AFFINITY ((BaseType_t)0x7fffffff)
+
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *arg);
+typedef void (*TlsDeleteCallbackFunction_t)(int index, void *value);
+
+/* control block of a static task, which holds the state of the thread running it */
+typedef struct
+{
+    uint8_t opaque[352];
+} __attribute__((aligned(8))) StaticTask_t;
+
+/**
+ * @brief Starts a task on a thread of its own. The stack is not used, the thread has the stack of the host.
+ *
+ * @param fn The task function.
+ * @param name The task name.
+ * @param stack_bytes The size of the stack in bytes.
+ * @param arg The argument of the task function.
+ * @param prio Ignored, tasks of the virtual clock run in the order they were created.
+ * @param stack The stack.
+ * @param tcb The control block, which becomes the task.
+ * @param core Ignored.
+ * @return The handle of the task.
+ */
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_bytes, void *arg,
+                                           UBaseType_t prio, StackType_t *stack, StaticTask_t *tcb, BaseType_t core);
+
+/**
+ * @brief Stops a task made by xTaskCreateStaticPinnedToCore, which must be waiting, and calls its local storage
+ *        deletion callback once its thread is gone.
+ *
+ * @param task The task, not the calling one.
+ */
+void vTaskDelete(TaskHandle_t task);
+
+/**
+ * @brief Gets the stack a task never used.
+ *
+ * @param task The task.
+ * @return The whole stack in bytes, the thread of the task runs on the stack of the host.
+ */
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+
+/**
+ * @brief Sets the local storage pointer of a task and the callback vTaskDelete calls with it.
+ *
+ * @param task The task.
+ * @param index The slot, below configNUM_THREAD_LOCAL_STORAGE_POINTERS.
+ * @param value The pointer.
+ * @param cb The callback.
+ */
+void vTaskSetThreadLocalStoragePointerAndDelCallback(TaskHandle_t task, BaseType_t index, void *value,
+                                                     TlsDeleteCallbackFunction_t cb);
+
+/**
+ * @brief Sleeps for a number of ticks. On the virtual clock a task waits for the clock to pass, and the clock owner
+ *        advances the clock instead, firing due timers and running the tasks that wake on the way.
+ *
+ * @param ticks The number of ticks of 1 ms.
+ */
+void vTaskDelay(TickType_t ticks);
+
+/**
+ * @brief Gets the tick count, derived from esp_timer_get_time.
+ *
+ * @return Milliseconds since the clock started.
+ */
+TickType_t xTaskGetTickCount(void);
+
+/**
+ * @brief Gets a handle for the calling thread, unique per thread.
+ *
+ * @return The handle.
+ */
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+
+/**
+ * @brief Increments the notification value of a task, waking it if it waits in ulTaskNotifyTake.
+ *
+ * @param task The task, a handle returned by xTaskGetCurrentTaskHandle on its thread.
+ * @return pdPASS.
+ */
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+
+/**
+ * @brief Waits for the notification value of the calling task to be non-zero, then decrements or clears it.
+ *
+ * The wait is on the monotonic clock, or on the virtual clock for a task. A thread cancelled while waiting leaves
+ * the critical section unlocked.
+ *
+ * @param clear pdTRUE to clear the value, pdFALSE to decrement it.
+ * @param ticks The longest wait, portMAX_DELAY for no limit.
+ * @return The value before it was cleared or decremented, 0 on timeout.
+ */
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
+
+#endif /* __HOST_FREERTOS_TASK_H__ */
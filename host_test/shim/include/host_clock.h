@@ -0,0 +1,26 @@
+#ifndef __HOST_CLOCK_H__
+#define __HOST_CLOCK_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Switches esp_timer_get_time between the monotonic clock and a virtual clock starting at 0.
+ *
+ * On the virtual clock time only moves in host_clock_advance_us and in vTaskDelay of the thread that owns the clock,
+ * and tasks run one at a time, see freertos/task.h, so a run is deterministic and as fast as the host can compute it.
+ *
+ * @param enable True for the virtual clock.
+ */
+void host_clock_set_virtual(bool enable);
+
+/**
+ * @brief Moves the virtual clock forward, calling the callbacks of the timers that expire on the way and running
+ *        the tasks whose wait ends on the way, each at its own time.
+ *
+ * @param delta_us The time to advance in microseconds, 0 to only run the tasks that are ready, e.g. after the
+ *                 caller notified one.
+ */
+void host_clock_advance_us(int64_t delta_us);
+
+#endif /* __HOST_CLOCK_H__ */
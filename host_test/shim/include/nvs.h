@@ -0,0 +1,50 @@
+#ifndef __HOST_NVS_H__
+#define __HOST_NVS_H__
+
+/* NVS blobs kept in memory for the life of the process, one namespace open at a time is enough for the application */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#define ESP_ERR_NVS_BASE 0x1100
+#define ESP_ERR_NVS_NOT_FOUND (ESP_ERR_NVS_BASE + 0x02)
+
+typedef uint32_t nvs_handle_t;
+
+typedef enum
+{
+    NVS_READONLY,
+    NVS_READWRITE,
+} nvs_open_mode_t;
+
+/**
+ * @brief Opens a namespace.
+ *
+ * @param name The namespace.
+ * @param mode NVS_READONLY fails with ESP_ERR_NVS_NOT_FOUND for a namespace nothing was written to.
+ * @param out_handle The handle.
+ * @return ESP_OK, ESP_ERR_NVS_NOT_FOUND or ESP_ERR_NO_MEM.
+ */
+esp_err_t nvs_open(const char *name, nvs_open_mode_t mode, nvs_handle_t *out_handle);
+
+/**
+ * @brief Stores a blob, replacing the one of the same key.
+ *
+ * @return ESP_OK or ESP_ERR_NO_MEM.
+ */
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length);
+
+/**
+ * @brief Reads a blob.
+ *
+ * @param length In the size of value, out the size of the blob.
+ * @return ESP_OK, ESP_ERR_NVS_NOT_FOUND or ESP_ERR_INVALID_SIZE if value is too small.
+ */
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *value, size_t *length);
+
+esp_err_t nvs_commit(nvs_handle_t handle);
+void nvs_close(nvs_handle_t handle);
+
+#endif /* __HOST_NVS_H__ */
@@ -0,0 +1,12 @@
+#ifndef __HOST_SDKCONFIG_H__
+#define __HOST_SDKCONFIG_H__
+
+/* the options of the ESP-IDF linux target that the pipeline modules look at */
+
+#define CONFIG_IDF_TARGET_LINUX 1
+#define CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ 240
+#define CONFIG_BT_BLUEDROID_PINNED_TO_CORE 0
+#define CONFIG_FREERTOS_UNICORE 1
+#define CONFIG_FREERTOS_TLSP_DELETION_CALLBACKS 1
+
+#endif /* __HOST_SDKCONFIG_H__ */
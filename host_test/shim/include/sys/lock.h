@@ -0,0 +1,11 @@
+#ifndef __HOST_SYS_LOCK_H__
+#define __HOST_SYS_LOCK_H__
+
+/* newlib locks, mapped to the same process-wide recursive mutex as the critical sections */
+
+typedef int _lock_t;
+
+void _lock_acquire(_lock_t *lock);
+void _lock_release(_lock_t *lock);
+
+#endif /* __HOST_SYS_LOCK_H__ */
@@ -0,0 +1,165 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "bt_app_asrc.h"
+#include "test_util.h"
+
+#define TEST_RATE (44100)
+/* frames per chunk of the I2S task with the file backend, 1024 samples of stereo */
+#define TEST_CHUNK_FRAMES (512)
+#define TEST_FRAME_BYTES (4)
+
+static int16_t s_in[TEST_CHUNK_FRAMES * 2];
+static int16_t s_out[(TEST_CHUNK_FRAMES + 16) * 2];
+
+static int16_t test_tone(double pos)
+{
+    return (int16_t)lrint(16384 * sin(2 * M_PI * 1000 * pos / TEST_RATE));
+}
+
+static void test_unity_ratio_is_a_delay(void)
+{
+    asrc_t asrc;
+    size_t out_frames = 0;
+    bool exact = true;
+
+    asrc_init(&asrc, 2);
+    for (int i = 0; i < TEST_CHUNK_FRAMES; i++)
+    {
+        s_in[2 * i] = test_tone(i);
+        s_in[2 * i + 1] = (int16_t)-s_in[2 * i];
+    }
+    out_frames = asrc_process(&asrc, s_in, TEST_CHUNK_FRAMES, s_out, TEST_CHUNK_FRAMES + 16);
+    CHECK(out_frames == TEST_CHUNK_FRAMES);
+    /* the output sits on hist[1], two frames behind the newest input */
+    for (int i = 2; i < TEST_CHUNK_FRAMES; i++)
+    {
+        exact &= s_out[2 * i] == s_in[2 * (i - 2)] && s_out[2 * i + 1] == s_in[2 * (i - 2) + 1];
+    }
+    CHECK(exact);
+}
+
+/* steers once with a fill error that the proportional term alone turns into the given correction */
+static void test_set_ppm(asrc_t *asrc, int32_t ppm)
+{
+    asrc_steer(asrc, (size_t)(8192 + ppm * ASRC_KP_BYTES), 8192);
+}
+
+static void test_fixed_ratio_output_count(void)
+{
+    static const int32_t ppms[] = {-200, 200, ASRC_MAX_PPM};
+    asrc_t asrc;
+
+    for (size_t k = 0; k < sizeof(ppms) / sizeof(ppms[0]); k++)
+    {
+        size_t total = 0;
+
+        asrc_init(&asrc, 2);
+        test_set_ppm(&asrc, ppms[k]);
+        CHECK(asrc_get_ppm(&asrc) == ppms[k]);
+        for (int n = 0; n < 1000; n++)
+        {
+            total += asrc_process(&asrc, s_in, TEST_CHUNK_FRAMES, s_out, TEST_CHUNK_FRAMES + 16);
+        }
+        CHECK_NEAR(total, 1000.0 * TEST_CHUNK_FRAMES / (1 + ppms[k] / 1e6), 2);
+    }
+}
+
+static void test_resampled_tone_accuracy(void)
+{
+    asrc_t asrc;
+    double step = 0;
+    double pos = 0;
+    double err_sq = 0;
+    size_t count = 0;
+
+    asrc_init(&asrc, 1);
+    test_set_ppm(&asrc, 300);
+    step = 1 + 300 / 1e6;
+    for (int n = 0; n < 40; n++)
+    {
+        size_t out_frames = 0;
+
+        for (int i = 0; i < TEST_CHUNK_FRAMES; i++)
+        {
+            s_in[i] = test_tone(n * TEST_CHUNK_FRAMES + i);
+        }
+        out_frames = asrc_process(&asrc, s_in, TEST_CHUNK_FRAMES, s_out, TEST_CHUNK_FRAMES + 16);
+        for (size_t i = 0; i < out_frames; i++, pos += step)
+        {
+            /* compare with the tone sampled at the exact position, two frames behind as at unity */
+            if (n > 0)
+            {
+                double e = s_out[i] - 16384 * sin(2 * M_PI * 1000 * (pos - 2) / TEST_RATE);
+                err_sq += e * e;
+                count++;
+            }
+        }
+    }
+    /* the error of the cubic at 1 kHz stays 70 dB below the tone */
+    CHECK(count > 0);
+    CHECK(20 * log10(sqrt(err_sq / count) / (16384 / sqrt(2))) < -70);
+}
+
+/* feeds chunks from a FIFO filled by a source whose clock is off by drift_ppm, and returns the final correction */
+static int32_t test_closed_loop(int32_t drift_ppm, double seconds, double *settle_s, double *max_err_bytes)
+{
+    const double target = 8192;
+    asrc_t asrc;
+    double fill = target;
+    double now_s = 0;
+
+    *settle_s = 0;
+    *max_err_bytes = 0;
+    asrc_init(&asrc, 2);
+    while (now_s < seconds)
+    {
+        size_t out_frames = TEST_CHUNK_FRAMES;
+
+        if (fill >= TEST_CHUNK_FRAMES * TEST_FRAME_BYTES)
+        {
+            asrc_steer(&asrc, (size_t)fill, (size_t)target);
+            out_frames = asrc_process(&asrc, s_in, TEST_CHUNK_FRAMES, s_out, TEST_CHUNK_FRAMES + 16);
+            fill -= TEST_CHUNK_FRAMES * TEST_FRAME_BYTES;
+        }
+        /* the output plays what was produced at its own rate while the source keeps writing at its rate */
+        now_s += (double)out_frames / TEST_RATE;
+        fill += out_frames * TEST_FRAME_BYTES * (1 + drift_ppm / 1e6);
+        if (fabs(fill - target) > *max_err_bytes)
+        {
+            *max_err_bytes = fabs(fill - target);
+        }
+        if (abs(asrc_get_ppm(&asrc) - drift_ppm) > 10)
+        {
+            *settle_s = now_s;
+        }
+    }
+    return asrc_get_ppm(&asrc);
+}
+
+static void test_converges_on_drift(void)
+{
+    static const int32_t drifts[] = {-200, 0, 200};
+    double settle_s = 0;
+    double max_err = 0;
+
+    for (size_t k = 0; k < sizeof(drifts) / sizeof(drifts[0]); k++)
+    {
+        CHECK_NEAR(test_closed_loop(drifts[k], 600, &settle_s, &max_err), drifts[k], 10);
+        /* within 10 ppm for good after about 7 minutes */
+        CHECK(settle_s < 450);
+        /* the proportional term stops the FIFO from drifting further than a 200 ppm error at ASRC_KP_BYTES */
+        CHECK(max_err < 200 * ASRC_KP_BYTES + TEST_CHUNK_FRAMES * TEST_FRAME_BYTES);
+    }
+}
+
+int main(void)
+{
+    TEST_RUN(test_unity_ratio_is_a_delay);
+    TEST_RUN(test_fixed_ratio_output_count);
+    TEST_RUN(test_resampled_tone_accuracy);
+    TEST_RUN(test_converges_on_drift);
+    return TEST_EXIT();
+}
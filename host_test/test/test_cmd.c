@@ -0,0 +1,274 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "esp_avrc_api.h"
+#include "host_clock.h"
+#include "bt_app_core.h"
+#include "bt_app_cmd.h"
+#include "bt_app_stats.h"
+#include "test_util.h"
+
+#define TEST_MS (1000)
+
+/* a command as the stack saw it */
+typedef struct
+{
+    uint8_t type;
+    uint8_t tl;
+    uint8_t arg;
+} test_sent_t;
+
+static test_sent_t s_sent[64];
+static int s_sent_num = 0;
+static esp_err_t s_send_err = ESP_OK; /* returned by the next sends */
+static int s_dispatch_fails = 0;      /* dispatches refused before the next one is accepted */
+static bt_app_cmd_stats_t s_base;     /* counters at the start of the running test */
+static bt_app_stats_snapshot_t s_snap;
+
+/* the application task is the test itself, a dispatched handler runs at once */
+bool bt_app_work_dispatch(bt_app_cb_t p_cback, uint16_t event, void *p_params, int param_len, bt_app_copy_cb_t p_copy_cback)
+{
+    if (s_dispatch_fails > 0)
+    {
+        s_dispatch_fails--;
+        return false;
+    }
+    p_cback(event, p_params);
+    return true;
+}
+
+static esp_err_t test_record(bt_app_cmd_type_t type, uint8_t tl, uint8_t arg)
+{
+    if (s_send_err == ESP_OK && s_sent_num < (int)(sizeof(s_sent) / sizeof(s_sent[0])))
+    {
+        s_sent[s_sent_num++] = (test_sent_t){.type = type, .tl = tl, .arg = arg};
+    }
+    return s_send_err;
+}
+
+esp_err_t esp_avrc_ct_send_get_rn_capabilities_cmd(uint8_t tl)
+{
+    return test_record(BT_APP_CMD_GET_CAPS, tl, 0);
+}
+
+esp_err_t esp_avrc_ct_send_metadata_cmd(uint8_t tl, uint8_t attr_mask)
+{
+    return test_record(BT_APP_CMD_GET_METADATA, tl, attr_mask);
+}
+
+esp_err_t esp_avrc_ct_send_register_notification_cmd(uint8_t tl, uint8_t event_id, uint32_t event_parameter)
+{
+    return test_record(BT_APP_CMD_REGISTER_NOTIFICATION, tl, event_id);
+}
+
+/* starts every test with nothing in flight, a fresh send log and the current counters as the base */
+static void test_begin(void)
+{
+    bt_app_cmd_reset();
+    s_base = *bt_app_cmd_get_stats();
+    s_sent_num = 0;
+    s_send_err = ESP_OK;
+    s_dispatch_fails = 0;
+    bt_app_stats_take_snapshot(&s_snap, true);
+}
+
+#define STAT(field) (bt_app_cmd_get_stats()->field - s_base.field)
+
+static void test_response_and_timeout(void)
+{
+    const bt_app_stats_hist_snap_t *rtt = &s_snap.hist[STATS_HIST_RC_RTT_US];
+    const bt_app_stats_hist_snap_t *meta = &s_snap.hist[STATS_HIST_RC_META_US];
+
+    test_begin();
+
+    /* all attributes answered: one round trip at the first, the whole command at the last */
+    CHECK(bt_app_cmd_post(BT_APP_CMD_GET_METADATA, ESP_AVRC_MD_ATTR_TITLE | ESP_AVRC_MD_ATTR_ARTIST, 0));
+    CHECK(s_sent_num == 1 && s_sent[0].type == BT_APP_CMD_GET_METADATA && s_sent[0].arg == 0x3);
+    host_clock_advance_us(30 * TEST_MS);
+    bt_app_cmd_on_response(BT_APP_CMD_GET_METADATA, ESP_AVRC_MD_ATTR_ARTIST);
+    CHECK(STAT(completed) == 0);
+    host_clock_advance_us(10 * TEST_MS);
+    bt_app_cmd_on_response(BT_APP_CMD_GET_METADATA, ESP_AVRC_MD_ATTR_TITLE);
+    CHECK(STAT(completed) == 1);
+    bt_app_stats_take_snapshot(&s_snap, true);
+    CHECK(rtt->count == 1 && rtt->max == 30 * TEST_MS);
+    CHECK(meta->count == 1 && meta->max == 40 * TEST_MS);
+
+    /* no response at all times out exactly after BT_APP_CMD_TIMEOUT_MS */
+    CHECK(bt_app_cmd_post(BT_APP_CMD_GET_CAPS, 0, 0));
+    host_clock_advance_us(BT_APP_CMD_TIMEOUT_MS * TEST_MS - 1);
+    CHECK(STAT(timeouts) == 0);
+    host_clock_advance_us(1);
+    CHECK(STAT(timeouts) == 1);
+    /* a late response finds its label freed */
+    bt_app_cmd_on_response(BT_APP_CMD_GET_CAPS, 0);
+    CHECK(STAT(unmatched) == 1 && STAT(completed) == 1);
+
+    /* some attributes answered, the others left out by the target */
+    CHECK(bt_app_cmd_post(BT_APP_CMD_GET_METADATA, ESP_AVRC_MD_ATTR_TITLE | ESP_AVRC_MD_ATTR_GENRE, 0));
+    bt_app_cmd_on_response(BT_APP_CMD_GET_METADATA, ESP_AVRC_MD_ATTR_TITLE);
+    host_clock_advance_us(BT_APP_CMD_TIMEOUT_MS * TEST_MS);
+    CHECK(STAT(partial) == 1 && STAT(timeouts) == 1);
+    CHECK(STAT(sent) == 3);
+}
+
+static void test_labels_and_in_flight_limit(void)
+{
+    bool used[BT_APP_CMD_LABELS] = {false};
+
+    test_begin();
+
+    /* registrations hold their labels until the change, so ten of them fill the labels allowed in flight */
+    for (uint8_t evt = 1; evt <= 10; evt++)
+    {
+        CHECK(bt_app_cmd_post(BT_APP_CMD_REGISTER_NOTIFICATION, evt, 0));
+    }
+    CHECK(s_sent_num == BT_APP_CMD_MAX_IN_FLIGHT);
+    CHECK(bt_app_cmd_get_stats()->max_in_flight == BT_APP_CMD_MAX_IN_FLIGHT);
+    for (int i = 0; i < s_sent_num; i++)
+    {
+        CHECK(!used[s_sent[i].tl]);
+        used[s_sent[i].tl] = true;
+        CHECK(s_sent[i].arg == i + 1);
+    }
+
+    /* a registration already in flight is not sent twice */
+    CHECK(!bt_app_cmd_post(BT_APP_CMD_REGISTER_NOTIFICATION, 3, 0));
+    CHECK(STAT(coalesced) == 1);
+
+    /* a change frees a label for the oldest waiting command, which takes the next label round robin rather than
+     * the one just freed, so a late response to the old command cannot be mistaken for the new one */
+    bt_app_cmd_on_response(BT_APP_CMD_REGISTER_NOTIFICATION, 3);
+    CHECK(s_sent_num == BT_APP_CMD_MAX_IN_FLIGHT + 1);
+    CHECK(s_sent[BT_APP_CMD_MAX_IN_FLIGHT].arg == 9);
+    CHECK(s_sent[BT_APP_CMD_MAX_IN_FLIGHT].tl != s_sent[2].tl);
+    CHECK(!used[s_sent[BT_APP_CMD_MAX_IN_FLIGHT].tl]);
+
+    /* every label still comes around */
+    for (int round = 0; round < 2 * BT_APP_CMD_LABELS; round++)
+    {
+        uint8_t evt = s_sent[s_sent_num - 1].arg;
+
+        bt_app_cmd_on_response(BT_APP_CMD_REGISTER_NOTIFICATION, evt);
+        CHECK(bt_app_cmd_post(BT_APP_CMD_REGISTER_NOTIFICATION, evt, 0));
+        used[s_sent[s_sent_num - 1].tl] = true;
+    }
+    for (int tl = 0; tl < BT_APP_CMD_LABELS; tl++)
+    {
+        CHECK(used[tl]);
+    }
+    CHECK(bt_app_cmd_get_stats()->max_in_flight == BT_APP_CMD_MAX_IN_FLIGHT);
+
+    /* waiting commands fill the queue up to its length */
+    for (uint8_t evt = 11; evt < 11 + BT_APP_CMD_QUEUE_LEN - 1; evt++)
+    {
+        CHECK(bt_app_cmd_post(BT_APP_CMD_REGISTER_NOTIFICATION, evt, 0));
+    }
+    CHECK(!bt_app_cmd_post(BT_APP_CMD_GET_CAPS, 0, 0));
+    CHECK(STAT(refused) == 1);
+}
+
+static void test_registration_renewal(void)
+{
+    test_begin();
+
+    CHECK(bt_app_cmd_post(BT_APP_CMD_REGISTER_NOTIFICATION, ESP_AVRC_RN_TRACK_CHANGE, 0));
+    host_clock_advance_us(BT_APP_CMD_REG_TIMEOUT_MS * TEST_MS - 1);
+    CHECK(s_sent_num == 1 && STAT(renewed) == 0);
+
+    /* no change within the registration timeout: the label is reclaimed and the registration sent again */
+    host_clock_advance_us(1);
+    CHECK(STAT(renewed) == 1 && STAT(timeouts) == 0);
+    CHECK(s_sent_num == 2 && s_sent[1].arg == ESP_AVRC_RN_TRACK_CHANGE && s_sent[1].tl != s_sent[0].tl);
+
+    /* and again a timeout later, as long as the target stays quiet */
+    host_clock_advance_us(BT_APP_CMD_REG_TIMEOUT_MS * TEST_MS);
+    CHECK(STAT(renewed) == 2 && s_sent_num == 3);
+    bt_app_cmd_on_response(BT_APP_CMD_REGISTER_NOTIFICATION, ESP_AVRC_RN_TRACK_CHANGE);
+    CHECK(STAT(completed) == 1);
+    host_clock_advance_us(BT_APP_CMD_REG_TIMEOUT_MS * TEST_MS);
+    CHECK(STAT(renewed) == 2 && s_sent_num == 3);
+}
+
+static void test_throttle(void)
+{
+    test_begin();
+    bt_app_cmd_set_min_period(ESP_AVRC_RN_PLAY_POS_CHANGED, 1000);
+
+    CHECK(bt_app_cmd_post(BT_APP_CMD_REGISTER_NOTIFICATION, ESP_AVRC_RN_PLAY_POS_CHANGED, 1));
+    host_clock_advance_us(100 * TEST_MS);
+    bt_app_cmd_on_response(BT_APP_CMD_REGISTER_NOTIFICATION, ESP_AVRC_RN_PLAY_POS_CHANGED);
+
+    /* the next registration waits for the period since the last one, other commands do not */
+    CHECK(bt_app_cmd_post(BT_APP_CMD_REGISTER_NOTIFICATION, ESP_AVRC_RN_PLAY_POS_CHANGED, 1));
+    CHECK(bt_app_cmd_post(BT_APP_CMD_GET_CAPS, 0, 0));
+    CHECK(STAT(throttled) == 1);
+    CHECK(s_sent_num == 2 && s_sent[1].type == BT_APP_CMD_GET_CAPS);
+    host_clock_advance_us(900 * TEST_MS - 1);
+    CHECK(s_sent_num == 2);
+    host_clock_advance_us(1);
+    CHECK(s_sent_num == 3 && s_sent[2].arg == ESP_AVRC_RN_PLAY_POS_CHANGED);
+
+    /* a waiting registration takes the newest parameter */
+    bt_app_cmd_on_response(BT_APP_CMD_REGISTER_NOTIFICATION, ESP_AVRC_RN_PLAY_POS_CHANGED);
+    CHECK(bt_app_cmd_post(BT_APP_CMD_REGISTER_NOTIFICATION, ESP_AVRC_RN_PLAY_POS_CHANGED, 1));
+    CHECK(bt_app_cmd_post(BT_APP_CMD_REGISTER_NOTIFICATION, ESP_AVRC_RN_PLAY_POS_CHANGED, 2));
+    CHECK(STAT(coalesced) == 1);
+    host_clock_advance_us(1000 * TEST_MS);
+    CHECK(s_sent_num == 4);
+    bt_app_cmd_set_min_period(ESP_AVRC_RN_PLAY_POS_CHANGED, 0);
+}
+
+static void test_dispatch_and_send_failures(void)
+{
+    test_begin();
+
+    /* the timer keeps trying when the work queue is full, so the command still times out, only later */
+    CHECK(bt_app_cmd_post(BT_APP_CMD_GET_CAPS, 0, 0));
+    s_dispatch_fails = 3;
+    host_clock_advance_us((BT_APP_CMD_TIMEOUT_MS + 3 * BT_APP_CMD_RETRY_MS) * TEST_MS - 1);
+    CHECK(STAT(timeouts) == 0 && s_dispatch_fails == 0);
+    host_clock_advance_us(1);
+    CHECK(STAT(timeouts) == 1);
+
+    /* a command the stack refuses is dropped without holding a label */
+    s_send_err = ESP_FAIL;
+    CHECK(bt_app_cmd_post(BT_APP_CMD_GET_METADATA, ESP_AVRC_MD_ATTR_TITLE, 0));
+    CHECK(STAT(refused) == 1 && STAT(sent) == 1);
+    s_send_err = ESP_OK;
+    bt_app_cmd_on_response(BT_APP_CMD_GET_METADATA, ESP_AVRC_MD_ATTR_TITLE);
+    CHECK(STAT(unmatched) == 1);
+    host_clock_advance_us(BT_APP_CMD_TIMEOUT_MS * TEST_MS);
+    CHECK(STAT(timeouts) == 1);
+}
+
+static void test_reset(void)
+{
+    test_begin();
+
+    CHECK(bt_app_cmd_post(BT_APP_CMD_REGISTER_NOTIFICATION, ESP_AVRC_RN_VOLUME_CHANGE, 0));
+    bt_app_cmd_reset();
+    /* nothing is in flight any more, so neither a response nor the timer finds anything */
+    bt_app_cmd_on_response(BT_APP_CMD_REGISTER_NOTIFICATION, ESP_AVRC_RN_VOLUME_CHANGE);
+    CHECK(STAT(unmatched) == 1);
+    host_clock_advance_us(BT_APP_CMD_REG_TIMEOUT_MS * TEST_MS);
+    CHECK(STAT(renewed) == 0 && s_sent_num == 1);
+    /* and the same registration is sent again right away */
+    CHECK(bt_app_cmd_post(BT_APP_CMD_REGISTER_NOTIFICATION, ESP_AVRC_RN_VOLUME_CHANGE, 0));
+    CHECK(s_sent_num == 2);
+}
+
+int main(void)
+{
+    host_clock_set_virtual(true);
+    /* the scheduler reads a registration time of 0 as never registered */
+    host_clock_advance_us(1000 * TEST_MS);
+    TEST_RUN(test_response_and_timeout);
+    TEST_RUN(test_labels_and_in_flight_limit);
+    TEST_RUN(test_registration_renewal);
+    TEST_RUN(test_throttle);
+    TEST_RUN(test_dispatch_and_send_failures);
+    TEST_RUN(test_reset);
+    return TEST_EXIT();
+}
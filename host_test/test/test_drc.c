@@ -0,0 +1,201 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "bt_app_drc.h"
+#include "test_util.h"
+
+#define TEST_RATE (44100)
+#define TEST_FRAMES (TEST_RATE)
+
+static int16_t s_pcm[TEST_FRAMES * 2];
+static drc_t s_drc;
+
+static const int32_t s_ceiling = 30935; /* 32768 at DRC_CEILING_DB, rounded up */
+
+/* 20 ms packets, as the sink task hands them over */
+static void test_process(int16_t *pcm, size_t frames, uint8_t volume)
+{
+    for (size_t done = 0; done < frames; done += 882)
+    {
+        size_t n = frames - done < 882 ? frames - done : 882;
+
+        drc_process(&s_drc, pcm + done * 2, n, volume);
+    }
+}
+
+/* the gain starts at zero and fades in with the release time, so a second of silence brings it to its target */
+static void test_init(float max_makeup_db, uint8_t volume)
+{
+    drc_init(&s_drc, 2, TEST_RATE, max_makeup_db);
+    for (size_t i = 0; i < TEST_FRAMES * 2; i++)
+    {
+        s_pcm[i] = 0;
+    }
+    test_process(s_pcm, TEST_FRAMES, volume);
+    s_drc.limited_blocks = 0;
+}
+
+static int32_t test_peak(const int16_t *pcm, size_t from, size_t to)
+{
+    int32_t peak = 0;
+
+    for (size_t i = from * 2; i < to * 2; i++)
+    {
+        peak = abs(pcm[i]) > peak ? abs(pcm[i]) : peak;
+    }
+    return peak;
+}
+
+static void test_tone(size_t from, size_t to, double amplitude)
+{
+    for (size_t i = from; i < to; i++)
+    {
+        s_pcm[2 * i] = (int16_t)lrint(amplitude * sin(2 * M_PI * 1000 * i / TEST_RATE));
+        s_pcm[2 * i + 1] = (int16_t)-s_pcm[2 * i];
+    }
+}
+
+static void test_gain_curve(void)
+{
+    const float vol_half = 64 * 258.0f / 32768.0f;
+    bool limited = true;
+
+    /* volume 0 mutes, whatever the make-up */
+    CHECK(drc_compute_gain(1000, 0, DRC_MAX_MAKEUP_DB, NULL) == 0.0f);
+
+    /* without make-up a quiet signal gets the plain volume */
+    CHECK_NEAR(drc_compute_gain(1000, 64, 0, &limited), vol_half, 1e-6);
+    CHECK(!limited);
+
+    /* half volume lifts silence by half of the attenuation, 3 dB */
+    CHECK_NEAR(20 * log10f(drc_compute_gain(0, 64, DRC_MAX_MAKEUP_DB, NULL) / vol_half), 3.0, 0.05);
+
+    /* the make-up gain stops at its limit */
+    CHECK_NEAR(20 * log10f(drc_compute_gain(0, 1, DRC_MAX_MAKEUP_DB, NULL) / (258.0f / 32768.0f)),
+               DRC_MAX_MAKEUP_DB, 0.01);
+
+    /* a loud signal is compressed but never pushed below the plain volume */
+    CHECK(drc_compute_gain(20000, 64, DRC_MAX_MAKEUP_DB, &limited) >= vol_half * 0.9999f);
+    CHECK(!limited);
+
+    /* 6 dB over the threshold after make-up comes out 2 dB over at ratio 3, at a volume low enough for the
+     * make-up, 9 dB, to cover the reduction */
+    {
+        const float vol_low = 16 * 258.0f / 32768.0f;
+        const float makeup_db = -20 * log10f(vol_low) * DRC_MAKEUP_PER_DB;
+        float peak = 32768.0f * powf(10.0f, (DRC_THRESHOLD_DB + 6.0f - makeup_db) / 20.0f) / vol_low;
+        float out_db = 20 * log10f(peak * drc_compute_gain((int32_t)peak, 16, DRC_MAX_MAKEUP_DB, NULL) / 32768.0f);
+
+        CHECK_NEAR(out_db, DRC_THRESHOLD_DB + 6.0f / DRC_RATIO, 0.01);
+    }
+
+    /* full scale at full volume is limited to the ceiling */
+    CHECK_NEAR(32767 * drc_compute_gain(32767, 127, 0, &limited), 32768 * powf(10.0f, DRC_CEILING_DB / 20.0f), 1);
+    CHECK(limited);
+}
+
+static void test_delay(void)
+{
+    test_init(0, 127);
+    s_pcm[0] = 1000;
+    s_pcm[1] = -1000;
+    test_process(s_pcm, 128, 127);
+    CHECK(test_peak(s_pcm, 0, DRC_DELAY_FRAMES) == 0);
+    CHECK_NEAR(s_pcm[DRC_DELAY_FRAMES * 2], 1000, 1);
+    CHECK_NEAR(s_pcm[DRC_DELAY_FRAMES * 2 + 1], -1000, 1);
+    CHECK(test_peak(s_pcm, DRC_DELAY_FRAMES + 1, 128) == 0);
+}
+
+static void test_attack_never_overshoots(void)
+{
+    static const uint8_t volumes[] = {127, 90, 40};
+
+    for (size_t v = 0; v < sizeof(volumes); v++)
+    {
+        for (int makeup = 0; makeup < 2; makeup++)
+        {
+            test_init(makeup ? DRC_MAX_MAKEUP_DB : 0, volumes[v]);
+            /* a quiet passage lets the gain rise to its top, then a full-scale burst lands at once */
+            test_tone(0, TEST_FRAMES / 2, 300);
+            test_tone(TEST_FRAMES / 2, TEST_FRAMES, 32767);
+            test_process(s_pcm, TEST_FRAMES, volumes[v]);
+            CHECK(test_peak(s_pcm, 0, TEST_FRAMES) <= s_ceiling);
+            /* lower volumes are brought below the ceiling by the compressor alone */
+            CHECK((s_drc.limited_blocks > 0) == (volumes[v] == 127));
+        }
+    }
+
+    /* the very first block after an edge to full scale, a square wave, is also held */
+    test_init(DRC_MAX_MAKEUP_DB, 127);
+    for (size_t i = 0; i < TEST_FRAMES * 2; i++)
+    {
+        s_pcm[i] = i < TEST_FRAMES ? 0 : ((i / 2 / 20) & 1 ? INT16_MAX : INT16_MIN);
+    }
+    test_process(s_pcm, TEST_FRAMES, 127);
+    CHECK(test_peak(s_pcm, 0, TEST_FRAMES) <= s_ceiling);
+    CHECK(test_peak(s_pcm, TEST_FRAMES / 2 + DRC_DELAY_FRAMES, TEST_FRAMES) >= s_ceiling - 40);
+}
+
+static void test_release(void)
+{
+    const size_t quiet = TEST_FRAMES / 4 + DRC_DELAY_FRAMES;
+    const size_t ms = TEST_RATE / 1000;
+    double settled = 0;
+    double after_20ms = 0;
+    double after_release = 0;
+    double after_3_release = 0;
+
+    /* at volume 40 the make-up lifts a quiet tone by 5 dB and the compressor takes all of it back on a loud one */
+    test_init(DRC_MAX_MAKEUP_DB, 40);
+    test_tone(0, TEST_FRAMES / 4, 32767);
+    test_tone(TEST_FRAMES / 4, TEST_FRAMES, 300);
+    test_process(s_pcm, TEST_FRAMES, 40);
+
+    settled = 20 * log10(test_peak(s_pcm, TEST_FRAMES - 20 * ms, TEST_FRAMES));
+    after_20ms = 20 * log10(test_peak(s_pcm, quiet + 20 * ms, quiet + 21 * ms)) - settled;
+    after_release = 20 * log10(test_peak(s_pcm, quiet + DRC_RELEASE_MS * ms, quiet + (DRC_RELEASE_MS + 1) * ms)) - settled;
+    after_3_release = 20 * log10(test_peak(s_pcm, quiet + 3 * DRC_RELEASE_MS * ms, quiet + (3 * DRC_RELEASE_MS + 1) * ms)) - settled;
+
+    /* the linear gain closes 1 - 1/e of the distance per release time: -4.2 dB left after 20 ms, -1.5 dB after
+     * one time constant and -0.2 dB after three */
+    CHECK_NEAR(settled, 20 * log10(300 * drc_compute_gain(300, 40, DRC_MAX_MAKEUP_DB, NULL)), 0.1);
+    CHECK_NEAR(after_20ms, -4.2, 0.3);
+    CHECK_NEAR(after_release, -1.5, 0.3);
+    CHECK_NEAR(after_3_release, -0.2, 0.15);
+}
+
+static void test_benchmark(void)
+{
+    const size_t packets = TEST_FRAMES / 882;
+    struct timespec t0;
+    struct timespec t1;
+    double ns = 0;
+
+    /* make-up, compression and limiting all active: a loud tone at a low volume */
+    test_init(DRC_MAX_MAKEUP_DB, 40);
+    test_tone(0, TEST_FRAMES, 30000);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int n = 0; n < 10; n++)
+    {
+        test_process(s_pcm, TEST_FRAMES, 40);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / (10.0 * packets);
+    /* informational, the host says nothing about the cycles on the target */
+    printf("drc_process: %.2f us per 882-frame stereo packet, %.3f%% of real time on the host\n", ns / 1000,
+           ns / 20e6 * 100);
+}
+
+int main(void)
+{
+    TEST_RUN(test_gain_curve);
+    TEST_RUN(test_delay);
+    TEST_RUN(test_attack_never_overshoots);
+    TEST_RUN(test_release);
+    TEST_RUN(test_benchmark);
+    return TEST_EXIT();
+}
@@ -0,0 +1,228 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <math.h>
+#include <complex.h>
+#include <time.h>
+
+#include "bt_app_eq.h"
+#include "test_util.h"
+
+/**
+ * @brief A band and its coefficients in Q28, worked out from the RBJ cookbook in double precision off line.
+ */
+typedef struct
+{
+    eq_band_t band;
+    uint32_t sample_rate;
+    int32_t ref[5]; /* b0, b1, b2, a1, a2 */
+} test_case_t;
+
+static const test_case_t s_cases[] = {
+    {{EQ_PEAKING, 1000, 60, 100}, 48000, {280234023, -508771283, 232927427, -508771283, 244725994}},
+    {{EQ_PEAKING, 1000, 60, 100}, 44100, {281221044, -505998486, 229956968, -505998486, 242742556}},
+    {{EQ_HIGH_PASS, 80, 0, 71}, 44100, {266289330, -532578661, 266289330, -532561363, 264160503}},
+    {{EQ_HIGH_PASS, 80, 0, 71}, 48000, {266463066, -532926132, 266463066, -532911521, 264505287}},
+    {{EQ_LOW_SHELF, 100, -45, 100}, 44100, {267733896, -530728646, 263036327, -530714534, 262348878}},
+    {{EQ_HIGH_SHELF, 8000, 30, 50}, 48000, {334110276, -205158330, 30983970, -121885996, 13386456}},
+    {{EQ_LOW_PASS, 12000, 0, 71}, 44100, {90019323, 180038647, 90019323, 43794874, 47846964}},
+};
+
+#define TEST_CASES (sizeof(s_cases) / sizeof(s_cases[0]))
+#define TEST_AMPLITUDE (8000)
+
+static int16_t s_pcm[4096 * 2];
+
+/* gain in dB of the reference coefficients at a frequency */
+static double test_ref_gain_db(const int32_t ref[5], double freq_hz, uint32_t sample_rate)
+{
+    double complex z1 = cexp(-I * 2 * M_PI * freq_hz / sample_rate);
+    double complex num = ref[0] + ref[1] * z1 + ref[2] * z1 * z1;
+    double complex den = (double)(1 << EQ_COEF_SHIFT) + ref[3] * z1 + ref[4] * z1 * z1;
+
+    return 20 * log10(cabs(num / den));
+}
+
+/* runs a stereo tone through the equalizer and returns the gain in dB of the left channel once settled */
+static double test_measure_gain_db(eq_t *eq, double freq_hz, uint32_t sample_rate)
+{
+    const size_t block = sizeof(s_pcm) / sizeof(s_pcm[0]) / 2;
+    double pos = 0;
+    double sum_in = 0;
+    double sum_out = 0;
+
+    /* a second of audio settles the 80 Hz high-pass, the last half is measured */
+    for (size_t n = 0; n * block < sample_rate; n++)
+    {
+        for (size_t i = 0; i < block; i++)
+        {
+            s_pcm[2 * i] = (int16_t)lrint(TEST_AMPLITUDE * sin(2 * M_PI * freq_hz * (pos + i) / sample_rate));
+            s_pcm[2 * i + 1] = s_pcm[2 * i];
+            if ((n + 1) * block * 2 > sample_rate)
+            {
+                sum_in += (double)s_pcm[2 * i] * s_pcm[2 * i];
+            }
+        }
+        eq_process(eq, s_pcm, block);
+        for (size_t i = 0; i < block && (n + 1) * block * 2 > sample_rate; i++)
+        {
+            sum_out += (double)s_pcm[2 * i] * s_pcm[2 * i];
+        }
+        pos += block;
+    }
+    return 10 * log10(sum_out / sum_in);
+}
+
+static void test_coefficients_match_reference(void)
+{
+    for (size_t k = 0; k < TEST_CASES; k++)
+    {
+        eq_biquad_t bq;
+
+        CHECK(eq_design(&s_cases[k].band, s_cases[k].sample_rate, &bq));
+        /* the math library may round the last bit differently */
+        CHECK_NEAR(bq.b0, s_cases[k].ref[0], 2);
+        CHECK_NEAR(bq.b1, s_cases[k].ref[1], 2);
+        CHECK_NEAR(bq.b2, s_cases[k].ref[2], 2);
+        CHECK_NEAR(bq.a1, s_cases[k].ref[3], 2);
+        CHECK_NEAR(bq.a2, s_cases[k].ref[4], 2);
+    }
+}
+
+static void test_reference_shapes(void)
+{
+    /* the cookbook properties of the reference itself: peak gain at f0, shelves at DC and Nyquist, -3 dB corners */
+    CHECK_NEAR(test_ref_gain_db(s_cases[0].ref, 1000, 48000), 6.0, 0.01);
+    CHECK_NEAR(test_ref_gain_db(s_cases[0].ref, 0, 48000), 0.0, 0.01);
+    CHECK_NEAR(test_ref_gain_db(s_cases[2].ref, 80, 44100), -3.0, 0.05);
+    CHECK_NEAR(test_ref_gain_db(s_cases[4].ref, 0, 44100), -4.5, 0.01);
+    CHECK_NEAR(test_ref_gain_db(s_cases[5].ref, 24000, 48000), 3.0, 0.01);
+    CHECK_NEAR(test_ref_gain_db(s_cases[6].ref, 12000, 44100), -3.0, 0.05);
+}
+
+static void test_filter_response(void)
+{
+    static eq_t eq = EQ_INITIALIZER;
+    static const double freqs[] = {50, 80, 200, 1000, 5000, 12000};
+
+    for (size_t k = 0; k < TEST_CASES; k++)
+    {
+        eq_set_bands(&eq, &s_cases[k].band, 1);
+        eq_init(&eq, 2, s_cases[k].sample_rate);
+        for (size_t f = 0; f < sizeof(freqs) / sizeof(freqs[0]); f++)
+        {
+            double expected = test_ref_gain_db(s_cases[k].ref, freqs[f], s_cases[k].sample_rate);
+
+            /* the integer filter follows the design until the response drops into the 16-bit noise */
+            if (expected > -40)
+            {
+                CHECK_NEAR(test_measure_gain_db(&eq, freqs[f], s_cases[k].sample_rate), expected, 0.05);
+            }
+        }
+    }
+}
+
+static void test_rejects_unrealizable_bands(void)
+{
+    eq_biquad_t bq;
+    const eq_band_t at_nyquist = {EQ_PEAKING, 22050, 30, 100};
+    const eq_band_t no_q = {EQ_PEAKING, 1000, 30, 0};
+    const eq_band_t huge = {EQ_PEAKING, 1000, 400, 100};
+    const eq_band_t clamped = {EQ_PEAKING, 1000, EQ_MAX_GAIN_DB10, 100};
+    eq_biquad_t ref;
+
+    CHECK(!eq_design(&at_nyquist, 44100, &bq));
+    CHECK(!eq_design(&no_q, 44100, &bq));
+    /* boosts beyond the limit are clamped to it, not refused */
+    CHECK(eq_design(&huge, 44100, &bq) && eq_design(&clamped, 44100, &ref));
+    CHECK(bq.b0 == ref.b0 && bq.a2 == ref.a2);
+}
+
+static void test_band_change_does_not_click(void)
+{
+    static eq_t eq = EQ_INITIALIZER;
+    const eq_band_t cut = {EQ_PEAKING, 1000, -120, 100};
+    const size_t block = 512;
+    int16_t prev = 0;
+    int max_step = 0;
+
+    eq_set_bands(&eq, &s_cases[1].band, 1);
+    eq_init(&eq, 2, 44100);
+    for (size_t n = 0; n < 40; n++)
+    {
+        if (n == 20)
+        {
+            /* +6 dB to -12 dB at the tone frequency, applied at the next block */
+            eq_set_bands(&eq, &cut, 1);
+        }
+        for (size_t i = 0; i < block; i++)
+        {
+            s_pcm[2 * i] = (int16_t)lrint(TEST_AMPLITUDE * sin(2 * M_PI * 1000 * (double)(n * block + i) / 44100));
+            s_pcm[2 * i + 1] = s_pcm[2 * i];
+        }
+        eq_process(&eq, s_pcm, block);
+        for (size_t i = 0; i < block; i++)
+        {
+            if (n >= 10)
+            {
+                int step = abs(s_pcm[2 * i] - prev);
+                max_step = step > max_step ? step : max_step;
+            }
+            prev = s_pcm[2 * i];
+        }
+    }
+    /* never steeper than the boosted tone itself */
+    CHECK(max_step <= (int)(2 * TEST_AMPLITUDE * M_PI * 1000 / 44100 * 2.0) + 2);
+}
+
+static void test_benchmark(void)
+{
+    /* the worst case: every band in use, stereo, 20 ms packets */
+    static const uint32_t rates[] = {44100, 48000};
+    static eq_t eq = EQ_INITIALIZER;
+    eq_band_t bands[EQ_MAX_BANDS];
+
+    for (size_t b = 0; b < EQ_MAX_BANDS; b++)
+    {
+        bands[b] = (eq_band_t){EQ_PEAKING, 100u << b, 30, 100};
+    }
+    eq_set_bands(&eq, bands, EQ_MAX_BANDS);
+    for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++)
+    {
+        const size_t frames = rates[r] / 50;
+        const size_t packets = 500;
+        struct timespec t0;
+        struct timespec t1;
+        double ns = 0;
+
+        eq_init(&eq, 2, rates[r]);
+        for (size_t i = 0; i < frames; i++)
+        {
+            s_pcm[2 * i] = (int16_t)lrint(TEST_AMPLITUDE * sin(2 * M_PI * 1000 * (double)i / rates[r]));
+            s_pcm[2 * i + 1] = s_pcm[2 * i];
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for (size_t n = 0; n < packets; n++)
+        {
+            eq_process(&eq, s_pcm, frames);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / (packets * frames * 2.0);
+        /* informational, the host says nothing about the cycles on the target */
+        printf("eq_process: %d bands, stereo, %" PRIu32 " Hz: %.2f ns per sample, %.3f%% of real time on the host\n",
+               EQ_MAX_BANDS, rates[r], ns, ns * 2 * rates[r] / 1e7);
+    }
+}
+
+int main(void)
+{
+    TEST_RUN(test_coefficients_match_reference);
+    TEST_RUN(test_reference_shapes);
+    TEST_RUN(test_filter_response);
+    TEST_RUN(test_rejects_unrealizable_bands);
+    TEST_RUN(test_band_change_does_not_click);
+    TEST_RUN(test_benchmark);
+    return TEST_EXIT();
+}
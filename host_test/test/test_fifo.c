@@ -0,0 +1,276 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "freertos/FreeRTOS.h"
+
+#include "bt_app_fifo.h"
+#include "test_util.h"
+
+#define TEST_FIFO_SIZE (256)
+/* bytes pushed through the FIFO by the two threads of the stress test */
+#define TEST_STRESS_BYTES (4 * 1024 * 1024)
+/* bytes pushed through each buffer by the benchmark, in 20 ms 44.1 kHz stereo packets and 1 KiB reads */
+#define TEST_BENCH_BYTES (64 * 1024 * 1024)
+#define TEST_BENCH_PACKET (3528)
+#define TEST_BENCH_READ (1024)
+
+static uint8_t s_storage[TEST_FIFO_SIZE];
+
+static void test_init_rejects_bad_size(void)
+{
+    audio_fifo_t fifo;
+
+    CHECK(!audio_fifo_init(&fifo, s_storage, 0));
+    CHECK(!audio_fifo_init(&fifo, s_storage, 100));
+    CHECK(!audio_fifo_init(&fifo, NULL, TEST_FIFO_SIZE));
+    CHECK(audio_fifo_init(&fifo, s_storage, TEST_FIFO_SIZE));
+    CHECK(audio_fifo_fill(&fifo) == 0);
+    CHECK(audio_fifo_space(&fifo) == TEST_FIFO_SIZE);
+}
+
+static void test_write_is_all_or_nothing(void)
+{
+    audio_fifo_t fifo;
+    uint8_t block[TEST_FIFO_SIZE] = {0};
+
+    audio_fifo_init(&fifo, s_storage, TEST_FIFO_SIZE);
+    CHECK(audio_fifo_write(&fifo, block, 200));
+    CHECK(!audio_fifo_write(&fifo, block, 57));
+    CHECK(audio_fifo_fill(&fifo) == 200);
+    CHECK(audio_fifo_write(&fifo, block, 56));
+    CHECK(audio_fifo_space(&fifo) == 0);
+    CHECK(!audio_fifo_write(&fifo, block, 1));
+}
+
+static void test_wrap_splits_spans(void)
+{
+    audio_fifo_t fifo;
+    audio_fifo_span_t spans[2];
+    uint8_t in[100];
+    uint8_t out[100];
+
+    for (size_t i = 0; i < sizeof(in); i++)
+    {
+        in[i] = (uint8_t)i;
+    }
+    audio_fifo_init(&fifo, s_storage, TEST_FIFO_SIZE);
+
+    /* move both counters to 200, so a 100-byte block wraps after 56 bytes */
+    CHECK(audio_fifo_write(&fifo, s_storage, 200));
+    CHECK(audio_fifo_read_spans(&fifo, spans, 200) == 200);
+    audio_fifo_consume(&fifo, 200);
+    CHECK(audio_fifo_write(&fifo, in, sizeof(in)));
+
+    CHECK(audio_fifo_read_spans(&fifo, spans, sizeof(out)) == sizeof(in));
+    CHECK(spans[0].data == s_storage + 200 && spans[0].len == 56);
+    CHECK(spans[1].data == s_storage && spans[1].len == 44);
+    memcpy(out, spans[0].data, spans[0].len);
+    memcpy(out + spans[0].len, spans[1].data, spans[1].len);
+    CHECK(memcmp(in, out, sizeof(in)) == 0);
+
+    /* a shorter request stops in the first span */
+    CHECK(audio_fifo_read_spans(&fifo, spans, 10) == 10);
+    CHECK(spans[0].len == 10 && spans[1].len == 0);
+}
+
+static void test_consume_releases_space(void)
+{
+    audio_fifo_t fifo;
+    audio_fifo_span_t spans[2];
+    uint8_t block[64] = {0};
+
+    audio_fifo_init(&fifo, s_storage, TEST_FIFO_SIZE);
+    CHECK(audio_fifo_write(&fifo, block, sizeof(block)));
+
+    /* reading without consuming exposes the same bytes again and frees nothing */
+    CHECK(audio_fifo_read_spans(&fifo, spans, sizeof(block)) == sizeof(block));
+    CHECK(audio_fifo_read_spans(&fifo, spans, sizeof(block)) == sizeof(block));
+    CHECK(audio_fifo_space(&fifo) == TEST_FIFO_SIZE - sizeof(block));
+
+    audio_fifo_consume(&fifo, 24);
+    CHECK(audio_fifo_fill(&fifo) == 40);
+    CHECK(audio_fifo_read_spans(&fifo, spans, TEST_FIFO_SIZE) == 40);
+    CHECK(spans[0].data == s_storage + 24);
+
+    audio_fifo_reset(&fifo);
+    CHECK(audio_fifo_fill(&fifo) == 0);
+    CHECK(audio_fifo_read_spans(&fifo, spans, TEST_FIFO_SIZE) == 0);
+}
+
+static void *test_stress_producer(void *arg)
+{
+    audio_fifo_t *fifo = arg;
+    uint8_t block[97];
+    uint32_t seq = 0;
+
+    /* odd block sizes so that the writes land on every offset of the storage */
+    while (seq < TEST_STRESS_BYTES)
+    {
+        size_t len = 1 + seq % sizeof(block);
+        if (len > TEST_STRESS_BYTES - seq)
+        {
+            len = TEST_STRESS_BYTES - seq;
+        }
+        for (size_t i = 0; i < len; i++)
+        {
+            block[i] = (uint8_t)((seq + i) * 31);
+        }
+        while (!audio_fifo_write(fifo, block, len))
+        {
+            sched_yield();
+        }
+        seq += len;
+    }
+    return NULL;
+}
+
+static void test_spsc_stress(void)
+{
+    static uint8_t storage[1024];
+    audio_fifo_t fifo;
+    audio_fifo_span_t spans[2];
+    pthread_t producer;
+    uint32_t seq = 0;
+    bool intact = true;
+
+    audio_fifo_init(&fifo, storage, sizeof(storage));
+    pthread_create(&producer, NULL, test_stress_producer, &fifo);
+    while (seq < TEST_STRESS_BYTES)
+    {
+        size_t len = audio_fifo_read_spans(&fifo, spans, 1 + seq % 300);
+        if (len == 0)
+        {
+            sched_yield();
+            continue;
+        }
+        for (int s = 0; s < 2; s++)
+        {
+            for (size_t i = 0; i < spans[s].len; i++)
+            {
+                intact &= spans[s].data[i] == (uint8_t)(seq++ * 31);
+            }
+        }
+        audio_fifo_consume(&fifo, len);
+    }
+    pthread_join(producer, NULL);
+    CHECK(intact);
+    CHECK(audio_fifo_fill(&fifo) == 0);
+}
+
+/**
+ * @brief Byte ring with the data path of a FreeRTOS byte-mode ringbuffer: a critical section around every send,
+ * receive and return, a copy on send and a pointer into the storage on receive.
+ */
+typedef struct
+{
+    uint8_t *storage;
+    size_t size;
+    size_t head;
+    size_t tail;
+    size_t fill;
+    portMUX_TYPE lock;
+} test_locked_ring_t;
+
+static bool test_locked_ring_send(test_locked_ring_t *ring, const uint8_t *data, size_t len)
+{
+    portENTER_CRITICAL(&ring->lock);
+    if (ring->size - ring->fill < len)
+    {
+        portEXIT_CRITICAL(&ring->lock);
+        return false;
+    }
+    size_t first = ring->size - ring->head < len ? ring->size - ring->head : len;
+    memcpy(ring->storage + ring->head, data, first);
+    memcpy(ring->storage, data + first, len - first);
+    ring->head = (ring->head + len) % ring->size;
+    ring->fill += len;
+    portEXIT_CRITICAL(&ring->lock);
+    return true;
+}
+
+static uint8_t *test_locked_ring_receive_up_to(test_locked_ring_t *ring, size_t max_len, size_t *len)
+{
+    portENTER_CRITICAL(&ring->lock);
+    size_t avail = ring->size - ring->tail < ring->fill ? ring->size - ring->tail : ring->fill;
+    *len = avail < max_len ? avail : max_len;
+    portEXIT_CRITICAL(&ring->lock);
+    return *len ? ring->storage + ring->tail : NULL;
+}
+
+static void test_locked_ring_return(test_locked_ring_t *ring, size_t len)
+{
+    portENTER_CRITICAL(&ring->lock);
+    ring->tail = (ring->tail + len) % ring->size;
+    ring->fill -= len;
+    portEXIT_CRITICAL(&ring->lock);
+}
+
+static double test_elapsed_s(const struct timespec *t0)
+{
+    struct timespec t1;
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (t1.tv_sec - t0->tv_sec) + (t1.tv_nsec - t0->tv_nsec) / 1e9;
+}
+
+static void test_benchmark(void)
+{
+    static uint8_t storage[32 * 1024];
+    static uint8_t packet[TEST_BENCH_PACKET];
+    static uint8_t out[TEST_BENCH_READ];
+    audio_fifo_t fifo;
+    audio_fifo_span_t spans[2];
+    test_locked_ring_t ring = {storage, sizeof(storage), 0, 0, 0, portMUX_INITIALIZER_UNLOCKED};
+    struct timespec t0;
+    size_t moved = 0;
+    double fifo_s = 0;
+    double ring_s = 0;
+
+    /* one thread alternates between writing a packet and reading it back, so only the buffers are timed */
+    audio_fifo_init(&fifo, storage, sizeof(storage));
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (moved = 0; moved < TEST_BENCH_BYTES;)
+    {
+        CHECK(audio_fifo_write(&fifo, packet, sizeof(packet)));
+        for (size_t len; (len = audio_fifo_read_spans(&fifo, spans, sizeof(out))) > 0; moved += len)
+        {
+            memcpy(out, spans[0].data, spans[0].len);
+            memcpy(out + spans[0].len, spans[1].data, spans[1].len);
+            audio_fifo_consume(&fifo, len);
+        }
+    }
+    fifo_s = test_elapsed_s(&t0);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (moved = 0; moved < TEST_BENCH_BYTES;)
+    {
+        CHECK(test_locked_ring_send(&ring, packet, sizeof(packet)));
+        for (size_t len; ring.fill > 0; moved += len)
+        {
+            uint8_t *data = test_locked_ring_receive_up_to(&ring, sizeof(out), &len);
+            memcpy(out, data, len);
+            test_locked_ring_return(&ring, len);
+        }
+    }
+    ring_s = test_elapsed_s(&t0);
+
+    /* informational, the host has neither the target's memory nor its critical sections */
+    printf("fifo: %.0f MB/s, locked ring: %.0f MB/s on the host\n", TEST_BENCH_BYTES / fifo_s / 1e6,
+           TEST_BENCH_BYTES / ring_s / 1e6);
+}
+
+int main(void)
+{
+    TEST_RUN(test_init_rejects_bad_size);
+    TEST_RUN(test_write_is_all_or_nothing);
+    TEST_RUN(test_wrap_splits_spans);
+    TEST_RUN(test_consume_releases_space);
+    TEST_RUN(test_spsc_stress);
+    TEST_RUN(test_benchmark);
+    return TEST_EXIT();
+}
@@ -0,0 +1,156 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "bt_app_jitter.h"
+#include "test_util.h"
+
+/* 20 ms packets of 44.1 kHz stereo */
+#define TEST_RATE (44100 * 2 * 2)
+#define TEST_PACKET_BYTES (3528)
+#define TEST_PACKET_US (20000)
+
+static void test_steady_stream_keeps_minimum(void)
+{
+    jitter_buf_t jb;
+
+    jitter_init(&jb, 4096, 24576, TEST_RATE);
+    for (int n = 0; n < 500; n++)
+    {
+        jitter_on_packet(&jb, 1 + (int64_t)n * TEST_PACKET_US, TEST_PACKET_BYTES);
+    }
+    CHECK(jb.jitter_us == 0);
+    CHECK(jitter_target_bytes(&jb) == 4096);
+}
+
+static void test_estimate_follows_reference(void)
+{
+    jitter_buf_t jb;
+    double ref_j = 0.0;
+    int64_t prev_us = 0;
+
+    /* every other packet is 3 ms late, so every gap deviates from the play-out time by 3 ms */
+    jitter_init(&jb, 0, 1 << 20, TEST_RATE);
+    for (int n = 0; n < 400; n++)
+    {
+        int64_t now_us = 1 + (int64_t)n * TEST_PACKET_US + (n & 1) * 3000;
+        jitter_on_packet(&jb, now_us, TEST_PACKET_BYTES);
+        if (n > 0)
+        {
+            /* RFC 3550 6.4.1 in floating point */
+            ref_j += (llabs(now_us - prev_us - TEST_PACKET_US) - ref_j) / 16.0;
+        }
+        prev_us = now_us;
+        /* the integer update truncates, so it may trail the reference by less than one step */
+        CHECK_NEAR(jb.jitter_us, ref_j, 16);
+    }
+    CHECK_NEAR(jb.jitter_us, 3000, 16);
+    /* four times the mean deviation, above the 3 ms peak */
+    CHECK_NEAR(jitter_target_us(&jb), 12000, 100);
+    CHECK(jitter_target_bytes(&jb) % 4 == 0);
+}
+
+static void test_burst_sets_peak_that_decays(void)
+{
+    jitter_buf_t jb;
+    int64_t now_us = 1;
+    uint32_t after_burst_us = 0;
+
+    jitter_init(&jb, 0, 1 << 20, TEST_RATE);
+    for (int n = 0; n < 10; n++, now_us += TEST_PACKET_US)
+    {
+        jitter_on_packet(&jb, now_us, TEST_PACKET_BYTES);
+    }
+    /* one packet held back 60 ms, then the backlog arrives at once */
+    now_us += 60000;
+    jitter_on_packet(&jb, now_us, TEST_PACKET_BYTES);
+    CHECK(jb.peak_us == 60000);
+    after_burst_us = jitter_target_us(&jb);
+    CHECK_NEAR(after_burst_us, 60000, 100);
+
+    for (int n = 0; n < 256; n++)
+    {
+        now_us += TEST_PACKET_US;
+        jitter_on_packet(&jb, now_us, TEST_PACKET_BYTES);
+    }
+    /* about 1/256 per packet, i.e. to 1/e after 256 packets */
+    CHECK_NEAR(jb.peak_us, 60000 * 0.368, 1500);
+    CHECK(jitter_target_us(&jb) < after_burst_us / 2);
+}
+
+static void test_long_gap_is_not_jitter(void)
+{
+    jitter_buf_t jb;
+
+    jitter_init(&jb, 4096, 24576, TEST_RATE);
+    jitter_on_packet(&jb, 1, TEST_PACKET_BYTES);
+    jitter_on_packet(&jb, 1 + JITTER_GAP_RESET_US, TEST_PACKET_BYTES);
+    CHECK(jb.jitter_us == 0 && jb.peak_us == 0);
+    CHECK(jitter_target_bytes(&jb) == 4096);
+}
+
+static void test_target_is_clamped(void)
+{
+    jitter_buf_t jb;
+
+    jitter_init(&jb, 4096, 24576, TEST_RATE);
+    jitter_on_packet(&jb, 1, TEST_PACKET_BYTES);
+    jitter_on_packet(&jb, 1 + 400000, TEST_PACKET_BYTES);
+    CHECK(jitter_target_bytes(&jb) == 24576);
+}
+
+static void test_underflow_boost(void)
+{
+    jitter_buf_t jb;
+
+    jitter_init(&jb, 0, 1 << 20, TEST_RATE);
+    jitter_on_underflow(&jb);
+    CHECK_NEAR(jitter_target_us(&jb), JITTER_UNDERFLOW_BOOST_US, 100);
+    for (int n = 0; n < 20; n++)
+    {
+        jitter_on_underflow(&jb);
+    }
+    /* the boost stops growing at eight times the step */
+    CHECK(jb.boost_us <= JITTER_UNDERFLOW_BOOST_US * 9);
+}
+
+static void test_report_hysteresis(void)
+{
+    jitter_buf_t jb;
+    int64_t now_us = 1;
+
+    jitter_init(&jb, 0, 1 << 20, TEST_RATE);
+    CHECK(!jitter_on_packet(&jb, now_us, TEST_PACKET_BYTES));
+    /* 15 ms late: the target jumps to 15 ms, beyond the hysteresis from the 0 ms reported so far */
+    now_us += TEST_PACKET_US + 15000;
+    CHECK(jitter_on_packet(&jb, now_us, TEST_PACKET_BYTES));
+    jitter_mark_reported(&jb);
+    now_us += TEST_PACKET_US;
+    CHECK(!jitter_on_packet(&jb, now_us, TEST_PACKET_BYTES));
+}
+
+static void test_rate_change_restarts_measurement(void)
+{
+    jitter_buf_t jb;
+
+    jitter_init(&jb, 0, 1 << 20, TEST_RATE);
+    jitter_on_packet(&jb, 1, TEST_PACKET_BYTES);
+    jitter_on_underflow(&jb);
+    jitter_set_rate(&jb, 48000 * 2 * 2);
+    CHECK(jb.last_arrival_us == 0);
+    /* the depth in time is kept, so the bytes follow the new rate */
+    CHECK_NEAR(jitter_target_us(&jb), JITTER_UNDERFLOW_BOOST_US, 100);
+}
+
+int main(void)
+{
+    TEST_RUN(test_steady_stream_keeps_minimum);
+    TEST_RUN(test_estimate_follows_reference);
+    TEST_RUN(test_burst_sets_peak_that_decays);
+    TEST_RUN(test_long_gap_is_not_jitter);
+    TEST_RUN(test_target_is_clamped);
+    TEST_RUN(test_underflow_boost);
+    TEST_RUN(test_report_hysteresis);
+    TEST_RUN(test_rate_change_restarts_measurement);
+    return TEST_EXIT();
+}
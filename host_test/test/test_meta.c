@@ -0,0 +1,231 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "esp_avrc_api.h"
+#include "bt_app_meta.h"
+#include "test_util.h"
+
+#define TEST_TRACKS (2000)
+
+/* what the cache should hold, current track first, "" for unknown */
+static char s_model[BT_APP_META_TRACKS][META_ATTR_NUM][BT_APP_META_MAX_TEXT];
+static char s_text[2 * BT_APP_META_MAX_TEXT];
+static uint32_t s_rand = 1;
+static atomic_bool s_reader_run;
+
+static uint32_t test_rand(void)
+{
+    s_rand = s_rand * 1103515245u + 12345u;
+    return s_rand >> 8;
+}
+
+/* a text of one repeated letter, so a reader can tell a torn copy from a whole one */
+static size_t test_make_text(char c, size_t len)
+{
+    memset(s_text, c, len);
+    s_text[len] = 0;
+    return len;
+}
+
+static bool test_matches_model(void)
+{
+    char buf[BT_APP_META_MAX_TEXT];
+    bool ok = true;
+
+    for (int t = 0; t < BT_APP_META_TRACKS; t++)
+    {
+        for (int a = 0; a < META_ATTR_NUM; a++)
+        {
+            bool found = bt_app_meta_get(t, a, buf, sizeof(buf));
+
+            ok &= found == (s_model[t][a][0] != 0) && strcmp(buf, s_model[t][a]) == 0;
+        }
+    }
+    return ok;
+}
+
+static void test_next_track(uint64_t uid)
+{
+    bt_app_meta_begin_track(uid);
+    memcpy(s_model[1], s_model[0], sizeof(s_model[0]));
+    memset(s_model[0], 0, sizeof(s_model[0]));
+}
+
+static void test_set(bt_app_meta_attr_t attr, const char *text, size_t len)
+{
+    size_t kept = len < BT_APP_META_MAX_TEXT - 1 ? len : BT_APP_META_MAX_TEXT - 1;
+
+    bt_app_meta_set(attr, text, len);
+    memcpy(s_model[0][attr], text, kept);
+    s_model[0][attr][kept] = 0;
+}
+
+static void test_ids(void)
+{
+    const uint8_t elm[8] = {0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef};
+
+    CHECK(bt_app_meta_attr_from_id(ESP_AVRC_MD_ATTR_TITLE) == META_ATTR_TITLE);
+    CHECK(bt_app_meta_attr_from_id(ESP_AVRC_MD_ATTR_ARTIST) == META_ATTR_ARTIST);
+    CHECK(bt_app_meta_attr_from_id(ESP_AVRC_MD_ATTR_ALBUM) == META_ATTR_ALBUM);
+    CHECK(bt_app_meta_attr_from_id(ESP_AVRC_MD_ATTR_GENRE) == META_ATTR_GENRE);
+    CHECK(bt_app_meta_attr_from_id(ESP_AVRC_MD_ATTR_PLAYING_TIME) == META_ATTR_NUM);
+    CHECK(bt_app_meta_uid_from_elm(elm) == 0x0123456789abcdefULL);
+}
+
+static void test_track_changes(void)
+{
+    char buf[8];
+
+    bt_app_meta_clear();
+    memset(s_model, 0, sizeof(s_model));
+    CHECK(bt_app_meta_get_uid(0) == BT_APP_META_UID_NONE);
+
+    /* a new track is requested, and again while it has no attributes yet */
+    CHECK(bt_app_meta_begin_track(7));
+    CHECK(bt_app_meta_begin_track(7));
+    CHECK(bt_app_meta_get_uid(0) == 7);
+    test_set(META_ATTR_TITLE, "Intro", 5);
+
+    /* once it has some, the same track is not requested again */
+    CHECK(!bt_app_meta_begin_track(7));
+    CHECK(bt_app_meta_get_stats()->skipped == 1);
+
+    /* players without identifiers report every change as UID 0, which is always requested */
+    CHECK(bt_app_meta_begin_track(BT_APP_META_UID_UNKNOWN));
+    test_set(META_ATTR_TITLE, "Song", 4);
+    CHECK(bt_app_meta_begin_track(BT_APP_META_UID_UNKNOWN));
+    CHECK(bt_app_meta_get_uid(1) == BT_APP_META_UID_UNKNOWN);
+    CHECK(bt_app_meta_get(1, META_ATTR_TITLE, buf, sizeof(buf)) && strcmp(buf, "Song") == 0);
+
+    /* no track selected is not requested */
+    CHECK(!bt_app_meta_begin_track(BT_APP_META_UID_NONE));
+    CHECK(!bt_app_meta_begin_track(BT_APP_META_UID_NONE));
+
+    /* out of range and unknown reads give an empty string, short buffers a truncated one */
+    CHECK(!bt_app_meta_get(0, META_ATTR_TITLE, buf, sizeof(buf)) && buf[0] == 0);
+    CHECK(!bt_app_meta_get(BT_APP_META_TRACKS, META_ATTR_TITLE, buf, sizeof(buf)) && buf[0] == 0);
+    CHECK(!bt_app_meta_get(0, META_ATTR_NUM, buf, sizeof(buf)) && buf[0] == 0);
+    CHECK(bt_app_meta_get_uid(BT_APP_META_TRACKS) == BT_APP_META_UID_NONE);
+    CHECK(bt_app_meta_begin_track(8));
+    test_set(META_ATTR_ALBUM, "A long album name", 17);
+    CHECK(bt_app_meta_get(0, META_ATTR_ALBUM, buf, 5) && strcmp(buf, "A lo") == 0);
+
+    bt_app_meta_clear();
+    CHECK(bt_app_meta_get_uid(0) == BT_APP_META_UID_NONE && bt_app_meta_get_uid(1) == BT_APP_META_UID_NONE);
+    CHECK(!bt_app_meta_get(0, META_ATTR_ALBUM, buf, sizeof(buf)));
+    CHECK(bt_app_meta_get_stats()->arena_used == 0);
+}
+
+static void test_dedup_and_truncation(void)
+{
+    bt_app_meta_stats_t before;
+    const bt_app_meta_stats_t *stats = bt_app_meta_get_stats();
+
+    bt_app_meta_clear();
+    memset(s_model, 0, sizeof(s_model));
+    before = *stats;
+
+    /* the artist and album of consecutive tracks are stored once */
+    test_next_track(1);
+    test_set(META_ATTR_TITLE, "One", 3);
+    test_set(META_ATTR_ARTIST, "Band", 4);
+    test_set(META_ATTR_ALBUM, "Record", 6);
+    test_next_track(2);
+    test_set(META_ATTR_TITLE, "Two", 3);
+    test_set(META_ATTR_ARTIST, "Band", 4);
+    test_set(META_ATTR_ALBUM, "Record", 6);
+    CHECK(stats->stored - before.stored == 4);
+    CHECK(stats->deduped - before.deduped == 2);
+    CHECK(stats->arena_used == 4 + 5 + 7 + 4);
+    CHECK(test_matches_model());
+
+    /* a shared string outlives the track that brought it in */
+    test_next_track(3);
+    test_set(META_ATTR_ARTIST, "Band", 4);
+    test_next_track(4);
+    CHECK(test_matches_model());
+
+    /* text of the same length but different content is not shared */
+    test_set(META_ATTR_ARTIST, "Bend", 4);
+    CHECK(stats->stored - before.stored == 5);
+
+    /* texts are cut to what fits a terminated buffer of BT_APP_META_MAX_TEXT */
+    test_set(META_ATTR_TITLE, s_text, test_make_text('x', sizeof(s_text) - 1));
+    CHECK(stats->truncated - before.truncated == 1);
+    CHECK(strlen(s_model[0][META_ATTR_TITLE]) == BT_APP_META_MAX_TEXT - 1);
+    CHECK(test_matches_model());
+}
+
+static void *test_reader(void *arg)
+{
+    char buf[BT_APP_META_MAX_TEXT];
+    int *torn = calloc(1, sizeof(int));
+
+    while (atomic_load(&s_reader_run))
+    {
+        for (int t = 0; t < BT_APP_META_TRACKS; t++)
+        {
+            for (int a = 0; a < META_ATTR_NUM; a++)
+            {
+                bt_app_meta_get(t, a, buf, sizeof(buf));
+                for (size_t i = 0; buf[i]; i++)
+                {
+                    *torn += buf[i] != buf[0];
+                }
+            }
+        }
+    }
+    return torn;
+}
+
+static void test_arena_churn(void)
+{
+    const bt_app_meta_stats_t *stats = bt_app_meta_get_stats();
+    uint32_t compactions = stats->compactions;
+    pthread_t reader;
+    int *torn = NULL;
+    bool ok = true;
+
+    bt_app_meta_clear();
+    memset(s_model, 0, sizeof(s_model));
+    atomic_store(&s_reader_run, true);
+    pthread_create(&reader, NULL, test_reader, NULL);
+
+    /* random lengths up to the limit, some attributes missing, some texts repeated; after every change each
+     * attribute of both tracks reads back whole, however often the arena was compacted meanwhile */
+    for (uint64_t uid = 1; uid <= TEST_TRACKS; uid++)
+    {
+        test_next_track(uid);
+        for (int a = 0; a < META_ATTR_NUM; a++)
+        {
+            uint32_t r = test_rand();
+
+            if (r % 5 == 0)
+            {
+                continue;
+            }
+            test_set(a, s_text, test_make_text((char)('a' + r % 8), 1 + (r >> 3) % (BT_APP_META_MAX_TEXT + 20)));
+            ok &= test_matches_model();
+            ok &= stats->arena_used <= BT_APP_META_ARENA_BYTES;
+        }
+    }
+    atomic_store(&s_reader_run, false);
+    pthread_join(reader, (void **)&torn);
+
+    CHECK(ok);
+    CHECK(stats->compactions - compactions > 100);
+    CHECK(*torn == 0);
+    free(torn);
+}
+
+int main(void)
+{
+    TEST_RUN(test_ids);
+    TEST_RUN(test_track_changes);
+    TEST_RUN(test_dedup_and_truncation);
+    TEST_RUN(test_arena_churn);
+    return TEST_EXIT();
+}
@@ -0,0 +1,197 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "bt_app_pcm.h"
+#include "test_util.h"
+
+#define TEST_SAMPLES (1 << 16)
+
+static int16_t s_src[TEST_SAMPLES];
+static uint16_t s_dst[TEST_SAMPLES + 2];
+
+static void test_fill(int16_t value)
+{
+    for (size_t i = 0; i < TEST_SAMPLES; i++)
+    {
+        s_src[i] = value;
+    }
+}
+
+static void test_dither_mean_and_range(void)
+{
+    /* levels on, between and halfway between the 8-bit codes, and near both rails */
+    static const int16_t levels[] = {0, 64, 128, -200, 1000, -12345, 30000, -30000};
+
+    for (size_t k = 0; k < sizeof(levels) / sizeof(levels[0]); k++)
+    {
+        double exact = levels[k] / 256.0 + 128;
+        double sum = 0;
+        int lo = 255;
+        int hi = 0;
+        uint32_t seed = 1;
+
+        test_fill(levels[k]);
+        pcm_s16_to_dac(s_src, s_dst, TEST_SAMPLES, PCM_VOLUME_MAX, &seed);
+        for (size_t i = 0; i < TEST_SAMPLES; i++)
+        {
+            int code = s_dst[i] >> 8;
+
+            sum += code;
+            lo = code < lo ? code : lo;
+            hi = code > hi ? code : hi;
+        }
+        /* unbiased: the mean code is the level at 8-bit resolution, to within the 32766/32768 unity gain */
+        CHECK_NEAR(sum / TEST_SAMPLES, exact, 0.02);
+        /* +/-1 LSB of TPDF spreads a level over the codes next to it and no further */
+        CHECK(lo >= (int)floor(exact) - 1 && hi <= (int)ceil(exact) + 1);
+        CHECK(hi - lo <= 2);
+    }
+}
+
+static void test_dither_is_triangular(void)
+{
+    uint32_t seed = 7;
+    double sum_sq = 0;
+
+    /* at the centre of a code the error is the dither itself after quantization */
+    test_fill(0);
+    pcm_s16_to_dac(s_src, s_dst, TEST_SAMPLES, PCM_VOLUME_MAX, &seed);
+    for (size_t i = 0; i < TEST_SAMPLES; i++)
+    {
+        sum_sq += ((s_dst[i] >> 8) - 128.0) * ((s_dst[i] >> 8) - 128.0);
+    }
+    /* P(|d| >= 128) for the triangle on +/-256 is 1/4, so a quarter of the samples leave the centre code */
+    CHECK_NEAR(sum_sq / TEST_SAMPLES, 0.25, 0.01);
+}
+
+static void test_volume_and_rails(void)
+{
+    uint32_t seed = 1;
+    bool ok = true;
+
+    test_fill(INT16_MAX);
+    pcm_s16_to_dac(s_src, s_dst, TEST_SAMPLES, PCM_VOLUME_MAX, &seed);
+    for (size_t i = 0; i < TEST_SAMPLES; i++)
+    {
+        ok &= s_dst[i] == 255 << 8;
+    }
+    test_fill(INT16_MIN);
+    pcm_s16_to_dac(s_src, s_dst, TEST_SAMPLES, PCM_VOLUME_MAX, &seed);
+    for (size_t i = 0; i < TEST_SAMPLES; i++)
+    {
+        ok &= s_dst[i] <= 1 << 8;
+    }
+    /* silence at volume 0 whatever the input, only the dither moves */
+    pcm_s16_to_dac(s_src, s_dst, TEST_SAMPLES, 0, &seed);
+    for (size_t i = 0; i < TEST_SAMPLES; i++)
+    {
+        ok &= s_dst[i] >= 127 << 8 && s_dst[i] <= 129 << 8;
+    }
+    CHECK(ok);
+}
+
+static void test_paths_agree(void)
+{
+    static uint16_t unaligned[TEST_SAMPLES + 2];
+    static int16_t in_place[TEST_SAMPLES];
+    uint32_t seed_a = 3;
+    uint32_t seed_b = 3;
+    uint32_t seed_c = 3;
+    uint32_t seed = 11;
+
+    for (size_t i = 0; i < TEST_SAMPLES; i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        s_src[i] = (int16_t)(seed >> 16);
+    }
+    memcpy(in_place, s_src, sizeof(in_place));
+
+    /* the packed path, the scalar path and an in-place conversion give the same codes and the same seed */
+    pcm_s16_to_dac(s_src, s_dst, TEST_SAMPLES - 3, 100, &seed_a);
+    pcm_s16_to_dac(s_src, unaligned + 1, TEST_SAMPLES - 3, 100, &seed_b);
+    pcm_s16_to_dac(in_place, (uint16_t *)in_place, TEST_SAMPLES - 3, 100, &seed_c);
+    CHECK(memcmp(s_dst, unaligned + 1, (TEST_SAMPLES - 3) * sizeof(uint16_t)) == 0);
+    CHECK(memcmp(s_dst, in_place, (TEST_SAMPLES - 3) * sizeof(uint16_t)) == 0);
+    CHECK(seed_a == seed_b && seed_a == seed_c);
+}
+
+/* the conversion written out sample by sample, without the packing */
+static uint8_t test_reference_code(int16_t sample, uint8_t volume, uint32_t *rnd)
+{
+    int32_t dither = 0;
+    int32_t v = 0;
+
+    *rnd = *rnd * 1664525u + 1013904223u;
+    dither = (int32_t)((*rnd >> 16) & 0xff) - (int32_t)((*rnd >> 24) & 0xff);
+    v = ((sample * (volume * 258)) >> 15) + dither + 128;
+    v = v > INT16_MAX ? INT16_MAX : v < INT16_MIN ? INT16_MIN : v;
+    return (uint8_t)((v >> 8) + 128);
+}
+
+static void test_packed_layout_matches_reference(void)
+{
+    const uint8_t *bytes = (const uint8_t *)s_dst;
+    uint32_t seed = 5;
+    uint32_t rnd = 5;
+    bool ok = true;
+
+    for (size_t i = 0; i < TEST_SAMPLES; i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        s_src[i] = (int16_t)(seed >> 16);
+    }
+    seed = 5;
+    pcm_s16_to_dac(s_src, s_dst, TEST_SAMPLES, 100, &seed);
+
+    /* the DMA takes one 16-bit slot per sample in memory order and converts its high byte */
+    for (size_t i = 0; i < TEST_SAMPLES; i++)
+    {
+        ok &= bytes[2 * i] == 0;
+        ok &= bytes[2 * i + 1] == test_reference_code(s_src[i], 100, &rnd);
+    }
+    CHECK(ok);
+    CHECK(seed == rnd);
+}
+
+static void test_s32_is_left_justified(void)
+{
+    static const int16_t in[] = {0, 1, -1, INT16_MAX, INT16_MIN};
+    int32_t out[5];
+
+    pcm_s16_to_s32(in, out, 5);
+    CHECK(out[0] == 0 && out[1] == 0x10000 && out[2] == -0x10000);
+    CHECK(out[3] == 0x7fff0000 && out[4] == INT32_MIN);
+}
+
+static void test_benchmark(void)
+{
+    struct timespec t0;
+    struct timespec t1;
+    uint32_t seed = 1;
+    double ns = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int n = 0; n < 64; n++)
+    {
+        pcm_s16_to_dac(s_src, s_dst, TEST_SAMPLES, 100, &seed);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / (64.0 * TEST_SAMPLES);
+    /* informational, the host says nothing about the cycles on the target */
+    printf("pcm_s16_to_dac: %.2f ns per sample on the host\n", ns);
+}
+
+int main(void)
+{
+    TEST_RUN(test_dither_mean_and_range);
+    TEST_RUN(test_dither_is_triangular);
+    TEST_RUN(test_volume_and_rails);
+    TEST_RUN(test_paths_agree);
+    TEST_RUN(test_packed_layout_matches_reference);
+    TEST_RUN(test_s32_is_left_justified);
+    TEST_RUN(test_benchmark);
+    return TEST_EXIT();
+}
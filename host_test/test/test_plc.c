@@ -0,0 +1,176 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "bt_app_plc.h"
+#include "test_util.h"
+
+#define TEST_RATE (44100)
+/* 210 Hz repeats every 210 frames exactly, inside the 2.5 to 15 ms search range */
+#define TEST_PERIOD (210)
+#define TEST_AMPLITUDE (12000)
+#define TEST_GAP_FRAMES (256)
+#define TEST_MAX_FRAMES (TEST_RATE * PLC_MAX_CONCEAL_MS / 1000)
+
+static int16_t s_buf[8192 * 2];
+
+static int16_t test_tone(int64_t n)
+{
+    return (int16_t)lrint(TEST_AMPLITUDE * sin(2 * M_PI * (double)n / TEST_PERIOD));
+}
+
+/* feeds frames [from, from + frames) of the stereo tone, the right channel at half the level */
+static void test_feed_tone(plc_t *plc, int64_t from, size_t frames)
+{
+    for (size_t i = 0; i < frames; i++)
+    {
+        s_buf[2 * i] = test_tone(from + (int64_t)i);
+        s_buf[2 * i + 1] = (int16_t)(s_buf[2 * i] / 2);
+    }
+    plc_feed(plc, s_buf, frames);
+}
+
+/* largest change between neighbouring left samples */
+static int test_max_step(const int16_t *pcm, size_t frames, int16_t before)
+{
+    int max_step = abs(pcm[0] - before);
+
+    for (size_t i = 1; i < frames; i++)
+    {
+        int step = abs(pcm[2 * i] - pcm[2 * (i - 1)]);
+        max_step = step > max_step ? step : max_step;
+    }
+    return max_step;
+}
+
+/* the steepest slope of the tone, with rounding */
+static int test_tone_step(void)
+{
+    return (int)ceil(TEST_AMPLITUDE * 2 * M_PI / TEST_PERIOD) + 1;
+}
+
+static void test_needs_full_history(void)
+{
+    static plc_t plc;
+
+    plc_init(&plc, 2, TEST_RATE);
+    test_feed_tone(&plc, 0, PLC_HIST_FRAMES - 1);
+    CHECK(plc_conceal(&plc, s_buf, 64) == 0);
+    CHECK(plc_get_stats(&plc)->gaps == 0);
+}
+
+static void test_gap_continues_the_waveform(void)
+{
+    static plc_t plc;
+    int max_err = 0;
+
+    plc_init(&plc, 2, TEST_RATE);
+    test_feed_tone(&plc, 0, 2048);
+    CHECK(plc_conceal(&plc, s_buf, TEST_GAP_FRAMES) == TEST_GAP_FRAMES);
+    CHECK(plc.period == TEST_PERIOD);
+
+    /* before the fade starts, the gap is the tone itself, so entering it is seamless */
+    for (int i = 0; i < TEST_GAP_FRAMES; i++)
+    {
+        int err = abs(s_buf[2 * i] - test_tone(2048 + i));
+        max_err = err > max_err ? err : max_err;
+        CHECK(s_buf[2 * i + 1] == s_buf[2 * i] / 2);
+    }
+    CHECK(max_err <= 1);
+    CHECK(test_max_step(s_buf, TEST_GAP_FRAMES, test_tone(2047)) <= test_tone_step());
+}
+
+static void test_resume_in_phase_is_seamless(void)
+{
+    static plc_t plc;
+    int16_t last = 0;
+
+    plc_init(&plc, 2, TEST_RATE);
+    test_feed_tone(&plc, 0, 2048);
+    plc_conceal(&plc, s_buf, TEST_GAP_FRAMES);
+    last = s_buf[2 * (TEST_GAP_FRAMES - 1)];
+
+    /* the late packet is the audio that follows the gap */
+    test_feed_tone(&plc, 2048 + TEST_GAP_FRAMES, 512);
+    CHECK(test_max_step(s_buf, 512, last) <= test_tone_step());
+    CHECK(plc_get_stats(&plc)->gaps == 1);
+    CHECK(plc_get_stats(&plc)->concealed_frames == TEST_GAP_FRAMES);
+}
+
+static void test_resume_out_of_phase_is_crossfaded(void)
+{
+    static plc_t plc;
+    int16_t last = 0;
+
+    plc_init(&plc, 2, TEST_RATE);
+    test_feed_tone(&plc, 0, 2048);
+    plc_conceal(&plc, s_buf, TEST_GAP_FRAMES);
+    last = s_buf[2 * (TEST_GAP_FRAMES - 1)];
+
+    /* half a period off: spliced directly the first sample would jump by up to twice the amplitude */
+    test_feed_tone(&plc, 2048 + TEST_GAP_FRAMES + TEST_PERIOD / 2, 512);
+    /* the fade spreads the difference over PLC_FADE_FRAMES */
+    CHECK(test_max_step(s_buf, 512, last) <= 2 * TEST_AMPLITUDE / PLC_FADE_FRAMES + 2 * test_tone_step());
+    /* past the fade the real audio comes through untouched */
+    CHECK(s_buf[2 * PLC_FADE_FRAMES] == test_tone(2048 + TEST_GAP_FRAMES + TEST_PERIOD / 2 + PLC_FADE_FRAMES));
+}
+
+static void test_long_gap_fades_out_and_gives_up(void)
+{
+    static plc_t plc;
+    size_t total = 0;
+    size_t got = 0;
+    int peak_tail = 0;
+
+    plc_init(&plc, 2, TEST_RATE);
+    test_feed_tone(&plc, 0, 2048);
+    while ((got = plc_conceal(&plc, s_buf, TEST_GAP_FRAMES)) != 0)
+    {
+        total += got;
+        if (total >= TEST_MAX_FRAMES)
+        {
+            /* the last block reaches the end of the fade */
+            for (size_t i = 0; i < got; i++)
+            {
+                int v = abs(s_buf[2 * i]);
+                peak_tail = (total - got + i >= TEST_MAX_FRAMES - 8 && v > peak_tail) ? v : peak_tail;
+            }
+        }
+    }
+    /* whole blocks until the limit is passed */
+    CHECK(total >= TEST_MAX_FRAMES && total < TEST_MAX_FRAMES + TEST_GAP_FRAMES);
+    CHECK(peak_tail <= TEST_AMPLITUDE / 100);
+    CHECK(plc_get_stats(&plc)->exhausted == 1);
+    CHECK(plc_get_stats(&plc)->longest_gap_frames == total);
+    /* the history is stale, the next gap needs fresh audio first */
+    CHECK(plc_conceal(&plc, s_buf, 64) == 0);
+}
+
+static void test_noise_period_stays_in_range(void)
+{
+    static plc_t plc;
+    uint32_t seed = 1;
+
+    plc_init(&plc, 1, TEST_RATE);
+    for (int i = 0; i < 2048; i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        s_buf[i] = (int16_t)(seed >> 16);
+    }
+    plc_feed(&plc, s_buf, 2048);
+    CHECK(plc_conceal(&plc, s_buf, 64) == 64);
+    /* an unrelated lag may win on noise, but it stays inside the search range */
+    CHECK(plc.period >= TEST_RATE / 400 && plc.period <= TEST_RATE / 66);
+}
+
+int main(void)
+{
+    TEST_RUN(test_needs_full_history);
+    TEST_RUN(test_gap_continues_the_waveform);
+    TEST_RUN(test_resume_in_phase_is_seamless);
+    TEST_RUN(test_resume_out_of_phase_is_crossfaded);
+    TEST_RUN(test_long_gap_fades_out_and_gives_up);
+    TEST_RUN(test_noise_period_stays_in_range);
+    return TEST_EXIT();
+}
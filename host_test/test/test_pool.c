@@ -0,0 +1,180 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "bt_app_pool.h"
+#include "test_util.h"
+
+#define TEST_THREADS (4)
+#define TEST_ROUNDS (20000)
+#define TEST_HELD (4) /* blocks held by each thread, together more than the pool */
+#define TEST_BENCH_ROUNDS (200000)
+
+static void *s_blocks[BT_APP_POOL_BLOCKS];
+
+static void test_exhaust_and_refill(void)
+{
+    bt_app_pool_stats_t stats;
+
+    for (int i = 0; i < BT_APP_POOL_BLOCKS; i++)
+    {
+        s_blocks[i] = bt_app_pool_alloc();
+        CHECK(s_blocks[i] != NULL);
+        CHECK(((uintptr_t)s_blocks[i] & 3) == 0);
+        memset(s_blocks[i], i, BT_APP_POOL_BLOCK_SIZE);
+    }
+    /* every block is whole and apart from the others */
+    for (int i = 0; i < BT_APP_POOL_BLOCKS; i++)
+    {
+        for (int j = 0; j < BT_APP_POOL_BLOCK_SIZE; j++)
+        {
+            CHECK(((uint8_t *)s_blocks[i])[j] == i);
+        }
+    }
+
+    CHECK(bt_app_pool_alloc() == NULL);
+    CHECK(bt_app_pool_alloc() == NULL);
+    bt_app_pool_get_stats(&stats);
+    CHECK(stats.in_use == BT_APP_POOL_BLOCKS);
+    CHECK(stats.high_water == BT_APP_POOL_BLOCKS);
+    CHECK(stats.allocs == BT_APP_POOL_BLOCKS);
+    CHECK(stats.failures == 2);
+
+    /* a freed block is the next one handed out, NULL is ignored */
+    bt_app_pool_free(s_blocks[5]);
+    bt_app_pool_free(NULL);
+    CHECK(bt_app_pool_alloc() == s_blocks[5]);
+    CHECK(bt_app_pool_alloc() == NULL);
+
+    for (int i = 0; i < BT_APP_POOL_BLOCKS; i++)
+    {
+        bt_app_pool_free(s_blocks[i]);
+    }
+    bt_app_pool_get_stats(&stats);
+    CHECK(stats.in_use == 0);
+    CHECK(stats.high_water == BT_APP_POOL_BLOCKS);
+    CHECK(stats.allocs == BT_APP_POOL_BLOCKS + 1);
+    CHECK(stats.failures == 3);
+}
+
+static void *test_churn(void *arg)
+{
+    uint8_t tag = (uint8_t)(uintptr_t)arg;
+    void *held[TEST_HELD] = {NULL};
+    int *errors = calloc(1, sizeof(int));
+
+    for (int r = 0; r < TEST_ROUNDS; r++)
+    {
+        int slot = r % TEST_HELD;
+
+        if (held[slot])
+        {
+            /* nobody else wrote into a block while this thread held it */
+            for (int j = 0; j < BT_APP_POOL_BLOCK_SIZE; j += 16)
+            {
+                *errors += ((uint8_t *)held[slot])[j] != (uint8_t)(tag + r);
+            }
+            bt_app_pool_free(held[slot]);
+            held[slot] = NULL;
+        }
+        if ((held[slot] = bt_app_pool_alloc()) != NULL)
+        {
+            memset(held[slot], (uint8_t)(tag + r + TEST_HELD), BT_APP_POOL_BLOCK_SIZE);
+        }
+        sched_yield();
+    }
+    for (int slot = 0; slot < TEST_HELD; slot++)
+    {
+        bt_app_pool_free(held[slot]);
+    }
+    return errors;
+}
+
+static void test_concurrent_churn(void)
+{
+    pthread_t threads[TEST_THREADS];
+    bt_app_pool_stats_t before;
+    bt_app_pool_stats_t after;
+
+    /* the threads together want more blocks than the pool has, so allocations fail and are retried */
+    bt_app_pool_get_stats(&before);
+    for (uintptr_t t = 0; t < TEST_THREADS; t++)
+    {
+        pthread_create(&threads[t], NULL, test_churn, (void *)(t * 64));
+    }
+    for (int t = 0; t < TEST_THREADS; t++)
+    {
+        int *errors = NULL;
+
+        pthread_join(threads[t], (void **)&errors);
+        CHECK(*errors == 0);
+        free(errors);
+    }
+    bt_app_pool_get_stats(&after);
+    CHECK(after.in_use == 0);
+    CHECK(after.high_water == BT_APP_POOL_BLOCKS);
+    CHECK(after.allocs + after.failures - before.allocs - before.failures == TEST_THREADS * TEST_ROUNDS);
+
+    /* and every block came back */
+    for (int i = 0; i < BT_APP_POOL_BLOCKS; i++)
+    {
+        CHECK((s_blocks[i] = bt_app_pool_alloc()) != NULL);
+    }
+    CHECK(bt_app_pool_alloc() == NULL);
+    for (int i = 0; i < BT_APP_POOL_BLOCKS; i++)
+    {
+        bt_app_pool_free(s_blocks[i]);
+    }
+}
+
+static double test_pairs_ns(void *(*alloc)(void), void (*release)(void *))
+{
+    struct timespec t0;
+    struct timespec t1;
+
+    /* a full NORMAL queue worth of metadata responses taken and returned in posting order */
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int n = 0; n < TEST_BENCH_ROUNDS; n++)
+    {
+        for (int i = 0; i < BT_APP_POOL_BLOCKS; i++)
+        {
+            s_blocks[i] = alloc();
+            *(volatile uint8_t *)s_blocks[i] = (uint8_t)n;
+        }
+        for (int i = 0; i < BT_APP_POOL_BLOCKS; i++)
+        {
+            release(s_blocks[i]);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / ((double)TEST_BENCH_ROUNDS * BT_APP_POOL_BLOCKS);
+}
+
+static void *test_malloc_block(void)
+{
+    return malloc(BT_APP_POOL_BLOCK_SIZE);
+}
+
+static void test_benchmark(void)
+{
+    double pool_ns = test_pairs_ns(bt_app_pool_alloc, bt_app_pool_free);
+    double malloc_ns = test_pairs_ns(test_malloc_block, free);
+
+    /* informational, glibc malloc is not the heap of the target */
+    printf("pool: %.1f ns, malloc: %.1f ns per alloc and free of a %d-byte block on the host\n", pool_ns, malloc_ns,
+           BT_APP_POOL_BLOCK_SIZE);
+}
+
+int main(void)
+{
+    TEST_RUN(test_exhaust_and_refill);
+    TEST_RUN(test_concurrent_churn);
+    TEST_RUN(test_benchmark);
+    bt_app_pool_report();
+    return TEST_EXIT();
+}
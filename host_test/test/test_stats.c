@@ -0,0 +1,170 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#include "host_clock.h"
+#include "bt_app_stats.h"
+#include "test_util.h"
+
+#define TEST_THREADS (4)
+#define TEST_RECORDS (100000)
+
+static bt_app_stats_snapshot_t s_snap;
+
+static void test_buckets(void)
+{
+    CHECK(bt_app_stats_bucket(0) == 0);
+    CHECK(bt_app_stats_bucket(1) == 1);
+    CHECK(bt_app_stats_bucket(2) == 2);
+    CHECK(bt_app_stats_bucket(3) == 2);
+    CHECK(bt_app_stats_bucket(4) == 3);
+    CHECK(bt_app_stats_bucket(1000) == 10);
+    CHECK(bt_app_stats_bucket(1024) == 11);
+    CHECK(bt_app_stats_bucket((1u << (BT_APP_STATS_BUCKETS - 1)) - 1) == BT_APP_STATS_BUCKETS - 1);
+    CHECK(bt_app_stats_bucket(1u << (BT_APP_STATS_BUCKETS - 1)) == BT_APP_STATS_BUCKETS - 1);
+    CHECK(bt_app_stats_bucket(UINT32_MAX) == BT_APP_STATS_BUCKETS - 1);
+}
+
+static void test_snapshot_layout(void)
+{
+    /* the snapshot is decoded off target, so its layout must not depend on the compiler's padding */
+    CHECK(sizeof(bt_app_stats_hist_snap_t) == (5 + BT_APP_STATS_BUCKETS) * 4);
+    CHECK(offsetof(bt_app_stats_snapshot_t, time_ms) == 8);
+    CHECK(offsetof(bt_app_stats_snapshot_t, counters) == 16);
+    CHECK(offsetof(bt_app_stats_snapshot_t, hist) == 16 + STATS_CNT_NUM * 4);
+    CHECK(sizeof(bt_app_stats_snapshot_t) == 16 + STATS_CNT_NUM * 4 + STATS_HIST_NUM * sizeof(bt_app_stats_hist_snap_t));
+
+    bt_app_stats_take_snapshot(&s_snap, false);
+    CHECK(s_snap.magic == BT_APP_STATS_SNAPSHOT_MAGIC);
+    CHECK(s_snap.version == BT_APP_STATS_SNAPSHOT_VERSION);
+    CHECK(s_snap.cnt_num == STATS_CNT_NUM);
+    CHECK(s_snap.hist_num == STATS_HIST_NUM);
+}
+
+static void test_aggregation(void)
+{
+    const bt_app_stats_hist_snap_t *h = &s_snap.hist[STATS_HIST_ARRIVAL_US];
+
+    bt_app_stats_reset();
+    bt_app_stats_add(STATS_CNT_PACKETS, 3);
+    bt_app_stats_add(STATS_CNT_BYTES, 1000);
+    bt_app_stats_add(STATS_CNT_BYTES, 24);
+    bt_app_stats_set_budget(STATS_HIST_ARRIVAL_US, 25000);
+    bt_app_stats_record(STATS_HIST_ARRIVAL_US, 20000);
+    bt_app_stats_record(STATS_HIST_ARRIVAL_US, 0);
+    bt_app_stats_record(STATS_HIST_ARRIVAL_US, 30000);
+    bt_app_stats_record(STATS_HIST_ARRIVAL_US, 25000);
+    host_clock_advance_us(2500 * 1000);
+
+    bt_app_stats_take_snapshot(&s_snap, false);
+    CHECK(s_snap.counters[STATS_CNT_PACKETS] == 3);
+    CHECK(s_snap.counters[STATS_CNT_BYTES] == 1024);
+    CHECK(s_snap.counters[STATS_CNT_DROPS] == 0);
+    CHECK(h->count == 4);
+    CHECK(h->sum == 75000);
+    CHECK(h->max == 30000);
+    CHECK(h->budget == 25000);
+    /* the budget itself is within budget */
+    CHECK(h->over_budget == 1);
+    CHECK(h->buckets[0] == 1);
+    CHECK(h->buckets[15] == 3);
+    CHECK(s_snap.interval_ms == 2500);
+    CHECK(s_snap.hist[STATS_HIST_FIFO_FILL].count == 0);
+
+    /* a snapshot with reset starts the histograms over but keeps the counters and the budget */
+    bt_app_stats_take_snapshot(&s_snap, true);
+    CHECK(h->count == 4);
+    host_clock_advance_us(1000 * 1000);
+    bt_app_stats_record(STATS_HIST_ARRIVAL_US, 10);
+    bt_app_stats_take_snapshot(&s_snap, false);
+    CHECK(s_snap.counters[STATS_CNT_BYTES] == 1024);
+    CHECK(h->count == 1 && h->sum == 10 && h->max == 10 && h->over_budget == 0);
+    CHECK(h->buckets[4] == 1 && h->buckets[15] == 0);
+    CHECK(h->budget == 25000);
+    CHECK(s_snap.interval_ms == 1000);
+
+    /* a full reset clears the counters too */
+    bt_app_stats_reset();
+    bt_app_stats_take_snapshot(&s_snap, false);
+    CHECK(s_snap.counters[STATS_CNT_BYTES] == 0 && h->count == 0 && h->budget == 25000);
+    bt_app_stats_set_budget(STATS_HIST_ARRIVAL_US, 0);
+}
+
+static void *test_writer(void *arg)
+{
+    uint32_t base = (uint32_t)(uintptr_t)arg;
+
+    for (uint32_t i = 0; i < TEST_RECORDS; i++)
+    {
+        bt_app_stats_add(STATS_CNT_PACKETS, 1);
+        bt_app_stats_record(STATS_HIST_CYC_EQ, base + i % 1000);
+    }
+    return NULL;
+}
+
+static void test_concurrent_recording(void)
+{
+    pthread_t threads[TEST_THREADS];
+    const bt_app_stats_hist_snap_t *h = &s_snap.hist[STATS_HIST_CYC_EQ];
+    uint32_t in_buckets = 0;
+
+    bt_app_stats_reset();
+    for (uintptr_t t = 0; t < TEST_THREADS; t++)
+    {
+        pthread_create(&threads[t], NULL, test_writer, (void *)(t * 1000));
+    }
+    for (int t = 0; t < TEST_THREADS; t++)
+    {
+        pthread_join(threads[t], NULL);
+    }
+
+    /* no update is lost between the tasks that record and the max ends up at the largest value of all */
+    bt_app_stats_take_snapshot(&s_snap, true);
+    CHECK(s_snap.counters[STATS_CNT_PACKETS] == TEST_THREADS * TEST_RECORDS);
+    CHECK(h->count == TEST_THREADS * TEST_RECORDS);
+    CHECK(h->max == TEST_THREADS * 1000 - 1);
+    CHECK(h->sum == (uint32_t)((uint64_t)TEST_RECORDS * (TEST_THREADS * 1000 - 1) / 2 * TEST_THREADS));
+    for (int b = 0; b < BT_APP_STATS_BUCKETS; b++)
+    {
+        in_buckets += h->buckets[b];
+    }
+    CHECK(in_buckets == h->count);
+}
+
+static void test_periodic_dump(void)
+{
+    bt_app_stats_reset();
+    bt_app_stats_record(STATS_HIST_CYC_PLC, 5);
+
+    /* a period below the minimum is raised to it, and every dump starts the histograms over */
+    CHECK(bt_app_stats_start(10) == ESP_OK);
+    host_clock_advance_us(BT_APP_STATS_DUMP_MIN_MS * 1000 - 1);
+    bt_app_stats_take_snapshot(&s_snap, false);
+    CHECK(s_snap.hist[STATS_HIST_CYC_PLC].count == 1);
+    host_clock_advance_us(1);
+    bt_app_stats_take_snapshot(&s_snap, false);
+    CHECK(s_snap.hist[STATS_HIST_CYC_PLC].count == 0);
+
+    /* restarting replaces the period instead of failing on the running timer */
+    CHECK(bt_app_stats_start(BT_APP_STATS_DUMP_PERIOD_MS) == ESP_OK);
+    bt_app_stats_record(STATS_HIST_CYC_PLC, 5);
+    host_clock_advance_us(BT_APP_STATS_DUMP_MIN_MS * 1000);
+    bt_app_stats_take_snapshot(&s_snap, false);
+    CHECK(s_snap.hist[STATS_HIST_CYC_PLC].count == 1);
+    bt_app_stats_stop();
+    host_clock_advance_us(BT_APP_STATS_DUMP_PERIOD_MS * 1000);
+    bt_app_stats_take_snapshot(&s_snap, false);
+    CHECK(s_snap.hist[STATS_HIST_CYC_PLC].count == 1);
+}
+
+int main(void)
+{
+    host_clock_set_virtual(true);
+    TEST_RUN(test_buckets);
+    TEST_RUN(test_snapshot_layout);
+    TEST_RUN(test_aggregation);
+    TEST_RUN(test_concurrent_recording);
+    TEST_RUN(test_periodic_dump);
+    return TEST_EXIT();
+}
@@ -0,0 +1,44 @@
+#ifndef __TEST_UTIL_H__
+#define __TEST_UTIL_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* number of failed checks of the running test program */
+static int s_test_failures = 0;
+
+/* records a failure and keeps going, so one run reports every broken property */
+#define CHECK(cond)                                                             \
+    do                                                                          \
+    {                                                                           \
+        if (!(cond))                                                            \
+        {                                                                       \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            s_test_failures++;                                                  \
+        }                                                                       \
+    } while (0)
+
+/* like CHECK, with the values printed on failure */
+#define CHECK_NEAR(actual, expected, tolerance)                                                         \
+    do                                                                                                  \
+    {                                                                                                   \
+        double a_ = (double)(actual), e_ = (double)(expected);                                          \
+        if (!(a_ >= e_ - (tolerance) && a_ <= e_ + (tolerance)))                                        \
+        {                                                                                               \
+            fprintf(stderr, "%s:%d: check failed: %s = %g, expected %g +/- %g\n", __FILE__, __LINE__, \
+                    #actual, a_, e_, (double)(tolerance));                                              \
+            s_test_failures++;                                                                          \
+        }                                                                                               \
+    } while (0)
+
+#define TEST_RUN(fn)                                   \
+    do                                                 \
+    {                                                  \
+        int before_ = s_test_failures;                 \
+        fn();                                          \
+        printf("%s %s\n", s_test_failures == before_ ? "PASS" : "FAIL", #fn); \
+    } while (0)
+
+#define TEST_EXIT() (s_test_failures ? EXIT_FAILURE : EXIT_SUCCESS)
+
+#endif /* __TEST_UTIL_H__ */
@@ -0,0 +1,461 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include "bt_app_core.h"
+#include "bt_app_mem.h"
+#include "test_util.h"
+
+#define TEST_EVT_BLOCK (0xfff)   /* the handler holds the task until the gate opens */
+#define TEST_PRODUCERS (4)
+#define TEST_POSTS (20000)
+#define TEST_POOL_PARAM (48)     /* parameter too large to travel inline */
+#define TEST_LOG_LEN (64)
+
+/* parameter of the stress messages */
+typedef struct
+{
+    uint32_t producer;
+    uint32_t seq;
+    uint32_t check; /* producer ^ seq, tells a torn parameter */
+    uint8_t fill[TEST_POOL_PARAM - 12];
+} test_param_t;
+
+/* the queues and their control blocks live in the memory table on target, which the host build leaves out */
+static uint8_t s_queue_storage[BT_APP_QUEUE_LEN_TOTAL * sizeof(bt_app_msg_t)] __attribute__((aligned(8)));
+static StaticQueue_t s_queue_cbs[BT_APP_PRIO_NUM];
+static pthread_t s_task_thread;
+static pthread_mutex_t s_task_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_task_started = PTHREAD_COND_INITIALIZER;
+static TaskHandle_t s_task_handle = NULL;
+static TaskFunction_t s_task_fn = NULL;
+static atomic_uint s_log_records;
+
+static atomic_bool s_gate_open = true;
+static atomic_bool s_blocked = false;
+static atomic_uint s_handled;
+static uint16_t s_log[TEST_LOG_LEN];        /* events in the order handled, written by the task only */
+static uint32_t s_log_value[TEST_LOG_LEN];  /* first word of their parameter */
+static uint32_t s_last_seq[TEST_PRODUCERS][BT_APP_PRIO_NUM];
+static atomic_uint s_stress_handled;
+static atomic_uint s_stress_errors;
+
+void *bt_app_mem_get(bt_app_mem_buf_t id)
+{
+    switch (id)
+    {
+    case MEM_BUF_APP_QUEUES:
+        return s_queue_storage;
+    case MEM_BUF_APP_QUEUE_CBS:
+        return s_queue_cbs;
+    default:
+        return NULL;
+    }
+}
+
+static void *test_task_main(void *arg)
+{
+    pthread_mutex_lock(&s_task_lock);
+    s_task_handle = xTaskGetCurrentTaskHandle();
+    pthread_cond_signal(&s_task_started);
+    pthread_mutex_unlock(&s_task_lock);
+    s_task_fn(NULL);
+    return NULL;
+}
+
+TaskHandle_t bt_app_mem_task_create(bt_app_mem_task_t id, TaskFunction_t fn, UBaseType_t prio, BaseType_t core)
+{
+    s_task_fn = fn;
+    s_task_handle = NULL;
+    pthread_create(&s_task_thread, NULL, test_task_main, NULL);
+    pthread_mutex_lock(&s_task_lock);
+    while (s_task_handle == NULL)
+    {
+        pthread_cond_wait(&s_task_started, &s_task_lock);
+    }
+    pthread_mutex_unlock(&s_task_lock);
+    return s_task_handle;
+}
+
+void bt_app_mem_task_delete(bt_app_mem_task_t id)
+{
+    pthread_cancel(s_task_thread);
+    pthread_join(s_task_thread, NULL);
+}
+
+void bt_app_log_record(bt_app_log_id_t id, size_t nargs, const uint32_t *args)
+{
+    atomic_fetch_add(&s_log_records, 1);
+}
+
+static int64_t test_now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void test_sleep_ms(int ms)
+{
+    struct timespec ts = {.tv_sec = 0, .tv_nsec = ms * 1000000L};
+
+    nanosleep(&ts, NULL);
+}
+
+static bool test_wait(atomic_uint *counter, uint32_t value)
+{
+    int64_t deadline_us = test_now_us() + 5000000;
+
+    while (atomic_load(counter) < value && test_now_us() < deadline_us)
+    {
+        sched_yield();
+    }
+    return atomic_load(counter) >= value;
+}
+
+static void test_log_cb(uint16_t event, void *param)
+{
+    uint32_t n = atomic_load(&s_handled);
+
+    if (event == TEST_EVT_BLOCK)
+    {
+        atomic_store(&s_blocked, true);
+        while (!atomic_load(&s_gate_open))
+        {
+            sched_yield();
+        }
+        atomic_store(&s_blocked, false);
+    }
+    if (n < TEST_LOG_LEN)
+    {
+        s_log[n] = event;
+        s_log_value[n] = 0;
+        if (param)
+        {
+            memcpy(&s_log_value[n], param, sizeof(uint32_t));
+        }
+    }
+    atomic_fetch_add(&s_handled, 1);
+}
+
+/* closes the gate and parks the task in a handler, so that what is posted next stays queued */
+static void test_block_task(void)
+{
+    atomic_store(&s_gate_open, false);
+    atomic_store(&s_handled, 0);
+    CHECK(bt_app_work_dispatch_prio(test_log_cb, TEST_EVT_BLOCK, NULL, 0, NULL, BT_APP_PRIO_HIGH));
+    while (!atomic_load(&s_blocked))
+    {
+        sched_yield();
+    }
+}
+
+static bool test_post(bt_app_prio_t prio, uint16_t event, uint32_t value)
+{
+    return bt_app_work_dispatch_prio(test_log_cb, event, &value, sizeof(value), NULL, prio);
+}
+
+static void test_priority_order(void)
+{
+    static const uint16_t expected[] = {TEST_EVT_BLOCK, 0x100, 0x101, 0x102, 0x200, 0x201, 0x202, 0x300, 0x301, 0x302};
+
+    test_block_task();
+    for (uint16_t i = 0; i < 3; i++)
+    {
+        CHECK(test_post(BT_APP_PRIO_LOW, 0x300 + i, i));
+        CHECK(test_post(BT_APP_PRIO_NORMAL, 0x200 + i, i));
+        CHECK(test_post(BT_APP_PRIO_HIGH, 0x100 + i, i));
+    }
+    atomic_store(&s_gate_open, true);
+    CHECK(test_wait(&s_handled, 10));
+
+    /* every high priority message first, then normal, then low, each queue in posting order */
+    for (int i = 0; i < 10; i++)
+    {
+        CHECK(s_log[i] == expected[i]);
+        CHECK(i == 0 || s_log_value[i] == (uint32_t)(expected[i] & 0xff));
+    }
+}
+
+static void test_full_queue_never_blocks(void)
+{
+    bt_app_queue_stats_t before;
+    bt_app_queue_stats_t after;
+    bt_app_pool_stats_t pool;
+    uint8_t big[TEST_POOL_PARAM] = {0};
+    uint32_t in_use = 0;
+    uint32_t log_records = atomic_load(&s_log_records);
+    int64_t start_us = 0;
+    int64_t worst_us = 0;
+    int accepted = 0;
+
+    bt_app_work_get_stats(BT_APP_PRIO_NORMAL, &before);
+    test_block_task();
+
+    for (int i = 0; i < BT_APP_QUEUE_LEN_NORMAL + 5; i++)
+    {
+        start_us = test_now_us();
+        accepted += test_post(BT_APP_PRIO_NORMAL, 0x200, (uint32_t)i);
+        worst_us = test_now_us() - start_us > worst_us ? test_now_us() - start_us : worst_us;
+    }
+    /* a full queue drops at once instead of holding the Bluedroid task, whose callbacks post these */
+    CHECK(accepted == BT_APP_QUEUE_LEN_NORMAL);
+    CHECK(worst_us < 5000);
+    CHECK(atomic_load(&s_log_records) - log_records == 5);
+
+    /* a dropped message gives its pool block back */
+    bt_app_pool_get_stats(&pool);
+    in_use = pool.in_use;
+    CHECK(!bt_app_work_dispatch_prio(test_log_cb, 0x201, big, sizeof(big), NULL, BT_APP_PRIO_NORMAL));
+    bt_app_pool_get_stats(&pool);
+    CHECK(pool.in_use == in_use);
+
+    /* the other queues still take messages */
+    CHECK(test_post(BT_APP_PRIO_HIGH, 0x100, 0));
+
+    test_sleep_ms(20);
+    atomic_store(&s_gate_open, true);
+    CHECK(test_wait(&s_handled, 2 + BT_APP_QUEUE_LEN_NORMAL));
+
+    bt_app_work_get_stats(BT_APP_PRIO_NORMAL, &after);
+    CHECK(after.posted - before.posted == BT_APP_QUEUE_LEN_NORMAL);
+    CHECK(after.dropped - before.dropped == 6);
+    CHECK(after.max_depth == BT_APP_QUEUE_LEN_NORMAL);
+    CHECK(after.handled - before.handled == BT_APP_QUEUE_LEN_NORMAL);
+    /* the first message waited for the gate */
+    CHECK(after.max_latency_us >= 20000);
+    for (int i = 0; i < BT_APP_QUEUE_LEN_NORMAL; i++)
+    {
+        CHECK(s_log[2 + i] == 0x200 && s_log_value[2 + i] == (uint32_t)i);
+    }
+}
+
+static void test_pool_copy_cb(void *p_dest, void *p_src, int len)
+{
+    /* a deep copy may use the bytes of the block after the parameter */
+    ((uint8_t *)p_dest)[len] = 0xa5;
+}
+
+static atomic_uint s_pool_ok;
+
+static void test_pool_cb(uint16_t event, void *param)
+{
+    const uint8_t *p = param;
+    bool ok = p[TEST_POOL_PARAM] == 0xa5;
+
+    for (int i = 0; i < TEST_POOL_PARAM; i++)
+    {
+        ok &= p[i] == (uint8_t)(event + i);
+    }
+    atomic_fetch_add(&s_pool_ok, ok);
+    atomic_fetch_add(&s_handled, 1);
+}
+
+static void test_pool_parameters(void)
+{
+    uint8_t big[TEST_POOL_PARAM];
+    bt_app_pool_stats_t pool;
+
+    atomic_store(&s_handled, 0);
+    atomic_store(&s_pool_ok, 0);
+    for (uint16_t evt = 0; evt < 8; evt++)
+    {
+        for (int i = 0; i < TEST_POOL_PARAM; i++)
+        {
+            big[i] = (uint8_t)(evt + i);
+        }
+        CHECK(bt_app_work_dispatch_prio(test_pool_cb, evt, big, sizeof(big), test_pool_copy_cb, BT_APP_PRIO_NORMAL));
+    }
+    CHECK(test_wait(&s_handled, 8));
+    CHECK(atomic_load(&s_pool_ok) == 8);
+    /* every block goes back once its message has been handled */
+    bt_app_pool_get_stats(&pool);
+    CHECK(pool.in_use == 0);
+
+    /* larger than a block is refused */
+    {
+        uint8_t huge[BT_APP_POOL_BLOCK_SIZE + 1] = {0};
+
+        CHECK(!bt_app_work_dispatch_prio(test_pool_cb, 0, huge, sizeof(huge), NULL, BT_APP_PRIO_NORMAL));
+    }
+}
+
+static void test_coalescing(void)
+{
+    bt_app_queue_stats_t before;
+    bt_app_queue_stats_t after;
+    uint32_t value = 0;
+    int pos_seen = 0;
+
+    bt_app_work_get_stats(BT_APP_PRIO_LOW, &before);
+    test_block_task();
+
+    /* fifty position updates while the task is busy turn into one, carrying the latest position */
+    for (value = 0; value < 50; value++)
+    {
+        CHECK(bt_app_work_dispatch_coalesced(test_log_cb, 0x500, &value, sizeof(value), BT_APP_COALESCE_KEY_PLAY_POS));
+    }
+    value = 7;
+    CHECK(bt_app_work_dispatch_coalesced(test_log_cb, 0x501, &value, sizeof(value), BT_APP_COALESCE_KEY_DELAY_REPORT));
+    /* with every slot taken, further keys fall back to plain low priority messages */
+    for (uint32_t key = 10; key < 10 + BT_APP_COALESCE_SLOTS; key++)
+    {
+        CHECK(bt_app_work_dispatch_coalesced(test_log_cb, (uint16_t)(0x500 + key), &key, sizeof(key), key));
+    }
+    CHECK(!bt_app_work_dispatch_coalesced(test_log_cb, 0x5ff, &value, sizeof(value), 0));
+
+    atomic_store(&s_gate_open, true);
+    CHECK(test_wait(&s_handled, 3 + BT_APP_COALESCE_SLOTS));
+    test_sleep_ms(10);
+    CHECK(atomic_load(&s_handled) == 3 + BT_APP_COALESCE_SLOTS);
+
+    for (uint32_t i = 1; i < atomic_load(&s_handled); i++)
+    {
+        if (s_log[i] == 0x500)
+        {
+            pos_seen++;
+            CHECK(s_log_value[i] == 49);
+        }
+    }
+    CHECK(pos_seen == 1);
+    bt_app_work_get_stats(BT_APP_PRIO_LOW, &after);
+    CHECK(after.coalesced - before.coalesced == 49);
+    CHECK(after.posted - before.posted == 2 + BT_APP_COALESCE_SLOTS);
+
+    /* once handled, the key starts a new message */
+    atomic_store(&s_handled, 0);
+    CHECK(bt_app_work_dispatch_coalesced(test_log_cb, 0x500, &value, sizeof(value), BT_APP_COALESCE_KEY_PLAY_POS));
+    CHECK(test_wait(&s_handled, 1));
+}
+
+static void test_stress_cb(uint16_t event, void *param)
+{
+    test_param_t p;
+    uint32_t prio = event >> 8;
+
+    memcpy(&p, param, sizeof(p));
+    if (p.check != (p.producer ^ p.seq) || p.producer >= TEST_PRODUCERS || prio >= BT_APP_PRIO_NUM)
+    {
+        atomic_fetch_add(&s_stress_errors, 1);
+    }
+    else if (prio < BT_APP_PRIO_LOW)
+    {
+        /* each queue keeps the order of every producer */
+        if (p.seq <= s_last_seq[p.producer][prio] && s_last_seq[p.producer][prio] != 0)
+        {
+            atomic_fetch_add(&s_stress_errors, 1);
+        }
+        s_last_seq[p.producer][prio] = p.seq;
+    }
+    atomic_fetch_add(&s_stress_handled, 1);
+}
+
+static void *test_producer(void *arg)
+{
+    uint32_t producer = (uint32_t)(uintptr_t)arg;
+    uint32_t rand = producer * 2654435761u + 1;
+    uint32_t *accepted = calloc(1, sizeof(uint32_t));
+
+    for (uint32_t seq = 1; seq <= TEST_POSTS; seq++)
+    {
+        test_param_t p = {.producer = producer, .seq = seq, .check = producer ^ seq};
+        bt_app_prio_t prio = BT_APP_PRIO_NORMAL;
+
+        rand ^= rand << 13;
+        rand ^= rand >> 17;
+        rand ^= rand << 5;
+        prio = (bt_app_prio_t)(rand % BT_APP_PRIO_NUM);
+        if (prio == BT_APP_PRIO_LOW)
+        {
+            /* low priority traffic is coalesced, so only what ends up handled is counted */
+            bt_app_work_dispatch_coalesced(test_stress_cb, (uint16_t)(prio << 8), &p, 12, BT_APP_COALESCE_KEY_PLAY_POS);
+        }
+        else if (bt_app_work_dispatch_prio(test_stress_cb, (uint16_t)(prio << 8), &p,
+                                           (rand & 0x100) ? sizeof(p) : 12, NULL, prio))
+        {
+            (*accepted)++;
+        }
+        if ((seq & 7) == 0)
+        {
+            sched_yield();
+        }
+    }
+    return accepted;
+}
+
+static void test_stress(void)
+{
+    pthread_t threads[TEST_PRODUCERS];
+    bt_app_queue_stats_t before[BT_APP_PRIO_NUM];
+    bt_app_queue_stats_t after[BT_APP_PRIO_NUM];
+    bt_app_pool_stats_t pool;
+    uint32_t accepted = 0;
+    uint32_t handled = 0;
+    uint32_t posted = 0;
+
+    for (int i = 0; i < BT_APP_PRIO_NUM; i++)
+    {
+        bt_app_work_get_stats((bt_app_prio_t)i, &before[i]);
+    }
+    for (uintptr_t t = 0; t < TEST_PRODUCERS; t++)
+    {
+        pthread_create(&threads[t], NULL, test_producer, (void *)t);
+    }
+    for (int t = 0; t < TEST_PRODUCERS; t++)
+    {
+        uint32_t *n = NULL;
+
+        pthread_join(threads[t], (void **)&n);
+        accepted += *n;
+        free(n);
+    }
+
+    /* wait for the task to drain what is still queued */
+    for (int64_t deadline_us = test_now_us() + 5000000; test_now_us() < deadline_us;)
+    {
+        handled = 0;
+        posted = 0;
+        for (int i = 0; i < BT_APP_PRIO_NUM; i++)
+        {
+            bt_app_work_get_stats((bt_app_prio_t)i, &after[i]);
+            handled += after[i].handled - before[i].handled;
+            posted += after[i].posted - before[i].posted;
+        }
+        if (handled == posted)
+        {
+            break;
+        }
+        sched_yield();
+    }
+
+    /* nothing accepted is lost, nothing is handled twice, and no parameter is torn or reordered */
+    CHECK(handled == posted);
+    CHECK(atomic_load(&s_stress_handled) == handled);
+    CHECK(after[BT_APP_PRIO_HIGH].posted - before[BT_APP_PRIO_HIGH].posted +
+          after[BT_APP_PRIO_NORMAL].posted - before[BT_APP_PRIO_NORMAL].posted == accepted);
+    CHECK(atomic_load(&s_stress_errors) == 0);
+    bt_app_pool_get_stats(&pool);
+    CHECK(pool.in_use == 0);
+    printf("stress: %" PRIu32 " handled, %" PRIu32 " dropped, %" PRIu32 " coalesced, normal latency max %" PRIu32 " us\n",
+           handled,
+           after[0].dropped + after[1].dropped + after[2].dropped - before[0].dropped - before[1].dropped - before[2].dropped,
+           after[BT_APP_PRIO_LOW].coalesced - before[BT_APP_PRIO_LOW].coalesced, after[BT_APP_PRIO_NORMAL].max_latency_us);
+}
+
+int main(void)
+{
+    bt_app_task_start_up();
+    TEST_RUN(test_priority_order);
+    TEST_RUN(test_full_queue_never_blocks);
+    TEST_RUN(test_pool_parameters);
+    TEST_RUN(test_coalescing);
+    TEST_RUN(test_stress);
+    bt_app_work_report_stats();
+    bt_app_task_shut_down();
+    return TEST_EXIT();
+}
@@ -0,0 +1,130 @@
+#include <string.h>
+
+#include "bt_app_asrc.h"
+
+#define ASRC_ONE ((uint64_t)1 << 32)
+
+static inline int16_t asrc_sat16(int32_t v)
+{
+    if (v > INT16_MAX)
+    {
+        return INT16_MAX;
+    }
+    if (v < INT16_MIN)
+    {
+        return INT16_MIN;
+    }
+    return (int16_t)v;
+}
+
+/* Catmull-Rom interpolation between x1 and x2, mu is the Q15 fraction */
+static inline int16_t asrc_hermite(int32_t x0, int32_t x1, int32_t x2, int32_t x3, int32_t mu)
+{
+    /* coefficients are kept at twice their value to stay integer */
+    int64_t c1 = x2 - x0;
+    int64_t c2 = 2 * x0 - 5 * x1 + 4 * x2 - x3;
+    int64_t c3 = x3 - x0 + 3 * (x1 - x2);
+    int64_t acc = ((c3 * mu) >> 15) + c2;
+
+    acc = ((acc * mu) >> 15) + c1;
+    acc = (acc * mu) >> 16;
+    return asrc_sat16((int32_t)(x1 + acc));
+}
+
+void asrc_init(asrc_t *asrc, uint8_t channels)
+{
+    asrc->channels = (channels == 1) ? 1 : ASRC_MAX_CHANNELS;
+    asrc_reset(asrc);
+}
+
+void asrc_reset(asrc_t *asrc)
+{
+    memset(asrc->hist, 0, sizeof(asrc->hist));
+    asrc->phase = 0;
+    asrc->step = ASRC_ONE;
+    asrc->fill_avg = -1;
+    asrc->integ = 0;
+    asrc->ppm = 0;
+}
+
+void asrc_steer(asrc_t *asrc, size_t fill, size_t target)
+{
+    const int64_t integ_max = (int64_t)ASRC_MAX_PPM * ASRC_KI_BYTES;
+    int32_t err = 0;
+    int32_t ppm = 0;
+
+    /* smooth the fill level over about 64 chunks, the packets arrive in bursts */
+    if (asrc->fill_avg < 0)
+    {
+        asrc->fill_avg = (int32_t)fill << 8;
+    }
+    asrc->fill_avg += (((int32_t)fill << 8) - asrc->fill_avg) >> 6;
+    err = (asrc->fill_avg >> 8) - (int32_t)target;
+
+    /* PI controller with anti-windup, a fuller FIFO makes the converter consume faster */
+    asrc->integ += err;
+    if (asrc->integ > integ_max)
+    {
+        asrc->integ = integ_max;
+    }
+    else if (asrc->integ < -integ_max)
+    {
+        asrc->integ = -integ_max;
+    }
+    ppm = err / ASRC_KP_BYTES + (int32_t)(asrc->integ / ASRC_KI_BYTES);
+    if (ppm > ASRC_MAX_PPM)
+    {
+        ppm = ASRC_MAX_PPM;
+    }
+    else if (ppm < -ASRC_MAX_PPM)
+    {
+        ppm = -ASRC_MAX_PPM;
+    }
+
+    asrc->ppm = ppm;
+    /* 2^32 / 10^6 = 4294.967 */
+    asrc->step = ASRC_ONE + (int64_t)ppm * 4295;
+}
+
+size_t asrc_process(asrc_t *asrc, const int16_t *in, size_t in_frames, int16_t *out, size_t out_cap)
+{
+    const uint8_t ch = asrc->channels;
+    size_t out_frames = 0;
+
+    for (size_t i = 0; i < in_frames; i++)
+    {
+        /* shift the new frame into the history */
+        for (uint8_t c = 0; c < ch; c++)
+        {
+            asrc->hist[0][c] = asrc->hist[1][c];
+            asrc->hist[1][c] = asrc->hist[2][c];
+            asrc->hist[2][c] = asrc->hist[3][c];
+            asrc->hist[3][c] = in[i * ch + c];
+        }
+
+        /* emit every output frame whose position falls between hist[1] and hist[2] */
+        while (asrc->phase < ASRC_ONE)
+        {
+            int32_t mu = (int32_t)(asrc->phase >> 17);
+
+            if (out_frames < out_cap)
+            {
+                for (uint8_t c = 0; c < ch; c++)
+                {
+                    out[out_frames * ch + c] = asrc_hermite(asrc->hist[0][c], asrc->hist[1][c],
+                                                            asrc->hist[2][c], asrc->hist[3][c], mu);
+                }
+                out_frames++;
+            }
+            asrc->phase += asrc->step;
+        }
+        asrc->phase -= ASRC_ONE;
+    }
+
+    return out_frames;
+}
+
+int32_t asrc_get_ppm(const asrc_t *asrc)
+{
+    return asrc->ppm;
+}
@@ -0,0 +1,84 @@
+#ifndef __BT_APP_ASRC_H__
+#define __BT_APP_ASRC_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define ASRC_MAX_CHANNELS (2)
+/* limit of the ratio correction, well above the crystal tolerance of source and sink */
+#define ASRC_MAX_PPM (500)
+/* the two gains settle a 200 ppm drift in about 7 minutes with one small overshoot, see host_test/test/test_asrc.c;
+ * a stronger proportional gain passes the arrival jitter on to the ratio, a stronger integral gain rings */
+/* proportional gain: 1 ppm per ASRC_KP_BYTES bytes of fill error */
+#define ASRC_KP_BYTES (16)
+/* integral gain: 1 ppm per ASRC_KI_BYTES accumulated byte-updates of fill error */
+#define ASRC_KI_BYTES (128 * 1024)
+
+/**
+ * @brief Asynchronous sample-rate converter state.
+ *
+ * The converter resamples interleaved 16-bit PCM by a ratio close to 1 with 4-point cubic Hermite
+ * interpolation. The read position advances by `step` input frames per output frame, in Q32 fixed point,
+ * so a step above 1.0 consumes the input faster than the DAC plays it. A PI controller on the FIFO fill
+ * level steers the step by a few hundred ppm at most to absorb the clock drift between source and DAC.
+ * Only integer arithmetic is used, so the converter may also run in interrupt context.
+ */
+typedef struct
+{
+    uint8_t channels;                        /*!< number of interleaved channels */
+    int16_t hist[4][ASRC_MAX_CHANNELS];      /*!< last four input frames, hist[3] is the newest */
+    uint64_t phase;                          /*!< position between hist[1] and hist[2], Q32 */
+    uint64_t step;                           /*!< input frames per output frame, Q32 */
+    int32_t fill_avg;                        /*!< smoothed FIFO fill level in bytes, Q8 */
+    int64_t integ;                           /*!< integral of the fill error */
+    int32_t ppm;                             /*!< current ratio correction in ppm */
+} asrc_t;
+
+/**
+ * @brief Initializes the converter with unity ratio and cleared history.
+ *
+ * @param asrc Pointer to the converter.
+ * @param channels The number of interleaved channels, 1 or 2.
+ */
+void asrc_init(asrc_t *asrc, uint8_t channels);
+
+/**
+ * @brief Resets the controller and the interpolation history, e.g. after an underflow. The channel count is kept.
+ *
+ * @param asrc Pointer to the converter.
+ */
+void asrc_reset(asrc_t *asrc);
+
+/**
+ * @brief Updates the ratio from the FIFO fill level. Call once per processed chunk.
+ *
+ * @param asrc Pointer to the converter.
+ * @param fill Current FIFO fill level in bytes.
+ * @param target Fill level to keep the FIFO centred on, in bytes.
+ */
+void asrc_steer(asrc_t *asrc, size_t fill, size_t target);
+
+/**
+ * @brief Resamples a block of interleaved frames.
+ *
+ * All input frames are consumed. The output holds about `in_frames * 1e6 / (1e6 + ppm)` frames, so
+ * `out_cap` should exceed `in_frames` by a few frames; output beyond `out_cap` is discarded.
+ *
+ * @param asrc Pointer to the converter.
+ * @param in Pointer to the input frames.
+ * @param in_frames The number of input frames.
+ * @param out Pointer to the output buffer.
+ * @param out_cap The capacity of the output buffer in frames.
+ * @return The number of frames written to the output buffer.
+ */
+size_t asrc_process(asrc_t *asrc, const int16_t *in, size_t in_frames, int16_t *out, size_t out_cap);
+
+/**
+ * @brief Returns the current ratio correction.
+ *
+ * @param asrc Pointer to the converter.
+ * @return The correction in ppm; positive values consume the input faster.
+ */
+int32_t asrc_get_ppm(const asrc_t *asrc);
+
+#endif /* __BT_APP_ASRC_H__ */
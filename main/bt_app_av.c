@@ -1,7 +1,7 @@
 #include "bt_app_core.h"
 #include "bt_app_av.h"
+#include "bt_app_mem.h"
 
-static uint32_t s_pkt_cnt = 0; /* count for audio packet */
 static esp_a2d_audio_state_t s_audio_state = ESP_A2D_AUDIO_STATE_STOPPED;
 /* audio stream datapath state */
 static const char *s_a2d_conn_state_str[] = {"Disconnected", "Connecting", "Connected", "Disconnecting"};
@@ -11,18 +11,40 @@ static const char *s_a2d_audio_state_str[] = {"Suspended", "Stopped", "Started"}
 static esp_avrc_rn_evt_cap_mask_t s_avrc_peer_rn_cap;
 /* AVRC target notification capability bit mask */
 static _lock_t s_volume_lock; /* volume lock */
-static uint8_t s_volume = 0;  /* local volume value */
+static uint8_t s_volume = 0x7f; /* local volume value, unity until the controller sets it */
 static bool s_volume_notify;  /* notify volume change or not */
-dac_continuous_handle_t tx_chan;
+static uint16_t s_delay_base = 0; /* delay value of the stack itself, in 1/10 ms */
 
-void bt_app_alloc_meta_buffer(esp_avrc_ct_cb_param_t *param)
+/* every callback parameter travels inline in bt_app_msg_t, only metadata text needs a pool block */
+_Static_assert(sizeof(esp_a2d_cb_param_t) <= BT_APP_MSG_INLINE_SIZE, "A2DP parameter does not fit inline");
+_Static_assert(sizeof(esp_avrc_ct_cb_param_t) <= BT_APP_MSG_INLINE_SIZE, "AVRC CT parameter does not fit inline");
+_Static_assert(sizeof(esp_avrc_tg_cb_param_t) <= BT_APP_MSG_INLINE_SIZE, "AVRC TG parameter does not fit inline");
+
+void bt_app_copy_meta_buffer(void *p_dest, void *p_src, int len)
 {
-    esp_avrc_ct_cb_param_t *rc = (esp_avrc_ct_cb_param_t *)(param);
-    uint8_t *attr_text = (uint8_t *)malloc(rc->meta_rsp.attr_length + 1);
+    esp_avrc_ct_cb_param_t *rc = (esp_avrc_ct_cb_param_t *)(p_dest);
+    uint8_t *attr_text = (uint8_t *)p_dest + len;
+    int attr_length = rc->meta_rsp.attr_length;
 
-    memcpy(attr_text, rc->meta_rsp.attr_text, rc->meta_rsp.attr_length);
-    attr_text[rc->meta_rsp.attr_length] = 0;
+    /* the text follows the parameter in the same pool block, truncated if the block is too small */
+    if (attr_length > BT_APP_POOL_BLOCK_SIZE - len - 1)
+    {
+        attr_length = BT_APP_POOL_BLOCK_SIZE - len - 1;
+    }
+    memcpy(attr_text, rc->meta_rsp.attr_text, attr_length);
+    attr_text[attr_length] = 0;
     rc->meta_rsp.attr_text = attr_text;
+    rc->meta_rsp.attr_length = attr_length;
+}
+
+static void bt_av_register_track_change(void)
+{
+    /* register notification if peer support the event_id */
+    if (esp_avrc_rn_evt_bit_mask_operation(ESP_AVRC_BIT_MASK_OP_TEST, &s_avrc_peer_rn_cap,
+                                           ESP_AVRC_RN_TRACK_CHANGE))
+    {
+        bt_app_cmd_post(BT_APP_CMD_REGISTER_NOTIFICATION, ESP_AVRC_RN_TRACK_CHANGE, 0);
+    }
 }
 
 void bt_av_new_track(void)
@@ -32,15 +54,9 @@ void bt_av_new_track(void)
                         ESP_AVRC_MD_ATTR_ARTIST |
                         ESP_AVRC_MD_ATTR_ALBUM |
                         ESP_AVRC_MD_ATTR_GENRE;
-    esp_avrc_ct_send_metadata_cmd(APP_RC_CT_TL_GET_META_DATA, attr_mask);
+    bt_app_cmd_post(BT_APP_CMD_GET_METADATA, attr_mask, 0);
 
-    /* register notification if peer support the event_id */
-    if (esp_avrc_rn_evt_bit_mask_operation(ESP_AVRC_BIT_MASK_OP_TEST, &s_avrc_peer_rn_cap,
-                                           ESP_AVRC_RN_TRACK_CHANGE))
-    {
-        esp_avrc_ct_send_register_notification_cmd(APP_RC_CT_TL_RN_TRACK_CHANGE,
-                                                   ESP_AVRC_RN_TRACK_CHANGE, 0);
-    }
+    bt_av_register_track_change();
 }
 
 void bt_av_playback_changed(void)
@@ -49,8 +65,7 @@ void bt_av_playback_changed(void)
     if (esp_avrc_rn_evt_bit_mask_operation(ESP_AVRC_BIT_MASK_OP_TEST, &s_avrc_peer_rn_cap,
                                            ESP_AVRC_RN_PLAY_STATUS_CHANGE))
     {
-        esp_avrc_ct_send_register_notification_cmd(APP_RC_CT_TL_RN_PLAYBACK_CHANGE,
-                                                   ESP_AVRC_RN_PLAY_STATUS_CHANGE, 0);
+        bt_app_cmd_post(BT_APP_CMD_REGISTER_NOTIFICATION, ESP_AVRC_RN_PLAY_STATUS_CHANGE, 0);
     }
 }
 
@@ -60,8 +75,9 @@ void bt_av_play_pos_changed(void)
     if (esp_avrc_rn_evt_bit_mask_operation(ESP_AVRC_BIT_MASK_OP_TEST, &s_avrc_peer_rn_cap,
                                            ESP_AVRC_RN_PLAY_POS_CHANGED))
     {
-        esp_avrc_ct_send_register_notification_cmd(APP_RC_CT_TL_RN_PLAY_POS_CHANGE,
-                                                   ESP_AVRC_RN_PLAY_POS_CHANGED, 10);
+        /* the interval is in seconds, the scheduler also holds back registrations that come sooner */
+        bt_app_cmd_post(BT_APP_CMD_REGISTER_NOTIFICATION, ESP_AVRC_RN_PLAY_POS_CHANGED,
+                        APP_RC_CT_PLAY_POS_PERIOD_MS < 1000 ? 1 : APP_RC_CT_PLAY_POS_PERIOD_MS / 1000);
     }
 }
 
@@ -71,7 +87,15 @@ void bt_av_notify_evt_handler(uint8_t event_id, esp_avrc_rn_param_t *event_param
     {
     /* when new track is loaded, this event comes */
     case ESP_AVRC_RN_TRACK_CHANGE:
-        bt_av_new_track();
+        /* players announce the same track again, e.g. after a seek, its metadata is cached already */
+        if (bt_app_meta_begin_track(bt_app_meta_uid_from_elm(event_parameter->elm_id)))
+        {
+            bt_av_new_track();
+        }
+        else
+        {
+            bt_av_register_track_change();
+        }
         break;
     /* when track status changed, this event comes */
     case ESP_AVRC_RN_PLAY_STATUS_CHANGE:
@@ -90,27 +114,40 @@ void bt_av_notify_evt_handler(uint8_t event_id, esp_avrc_rn_param_t *event_param
     }
 }
 
+void bt_av_sbc_format(const uint8_t *cie, int *sample_rate, int *ch_count)
+{
+    char oct0 = cie[0];
+
+    *sample_rate = 16000;
+    *ch_count = 2;
+    if (oct0 & (0x01 << 6))
+    {
+        *sample_rate = 32000;
+    }
+    else if (oct0 & (0x01 << 5))
+    {
+        *sample_rate = 44100;
+    }
+    else if (oct0 & (0x01 << 4))
+    {
+        *sample_rate = 48000;
+    }
+
+    if (oct0 & (0x01 << 3))
+    {
+        *ch_count = 1;
+    }
+}
+
 void bt_i2s_driver_install(void)
 {
-    dac_continuous_config_t cont_cfg = {
-        .chan_mask = DAC_CHANNEL_MASK_ALL,
-        .desc_num = 8,
-        .buf_size = 2048,
-        .freq_hz = 44100,
-        .offset = 127,
-        .clk_src = DAC_DIGI_CLK_SRC_DEFAULT, // Using APLL as clock source to get a wider frequency range
-        .chan_mode = DAC_CHANNEL_MODE_ALTER,
-    };
-    /* Allocate continuous channels */
-    ESP_ERROR_CHECK(dac_continuous_new_channels(&cont_cfg, &tx_chan));
-    /* Enable the continuous channels */
-    ESP_ERROR_CHECK(dac_continuous_enable(tx_chan));
+    /* the channels are allocated on the first connection and kept afterwards */
+    ESP_ERROR_CHECK(output_init());
 }
 
 void bt_i2s_driver_uninstall(void)
 {
-    ESP_ERROR_CHECK(dac_continuous_disable(tx_chan));
-    ESP_ERROR_CHECK(dac_continuous_del_channels(tx_chan));
+    output_pause();
 }
 
 void volume_set_by_controller(uint8_t volume)
@@ -122,6 +159,12 @@ void volume_set_by_controller(uint8_t volume)
     _lock_release(&s_volume_lock);
 }
 
+uint8_t volume_get_current(void)
+{
+    /* single byte read, no lock needed on the audio path */
+    return s_volume;
+}
+
 void volume_set_by_local_host(uint8_t volume)
 {
     ESP_LOGI(BT_RC_TG_TAG, "Volume is set locally to: %" PRIu32 "%%", (uint32_t)volume * 100 / 0x7f);
@@ -158,16 +201,38 @@ void bt_av_hdl_a2d_evt(uint16_t event, void *p_param)
         if (a2d->conn_stat.state == ESP_A2D_CONNECTION_STATE_DISCONNECTED)
         {
             esp_bt_gap_set_scan_mode(ESP_BT_CONNECTABLE, ESP_BT_GENERAL_DISCOVERABLE);
-            bt_i2s_driver_uninstall();
             bt_i2s_task_shut_down();
+            bt_i2s_driver_uninstall();
+            bt_app_work_report_stats();
+            bt_app_pool_report();
+            bt_app_power_set_state(BT_APP_POWER_IDLE);
+            bt_app_power_report();
+            bt_app_mem_report();
+            bt_app_trace_dump();
+            bt_app_peer_on_connection(bda, false);
         }
         else if (a2d->conn_stat.state == ESP_A2D_CONNECTION_STATE_CONNECTED)
         {
             esp_bt_gap_set_scan_mode(ESP_BT_NON_CONNECTABLE, ESP_BT_NON_DISCOVERABLE);
             bt_i2s_task_start_up();
+            bt_app_power_set_state(BT_APP_POWER_CONNECTED);
+            bt_app_peer_on_connection(bda, true);
         }
         else if (a2d->conn_stat.state == ESP_A2D_CONNECTION_STATE_CONNECTING)
         {
+            bt_app_peer_t peer;
+
+            /* a known source most likely negotiates what it did last time, open the output with it */
+            if (bt_app_peer_find(bda, &peer) && peer.codec_type == ESP_A2D_MCT_SBC)
+            {
+                int sample_rate = 0;
+                int ch_count = 0;
+
+                bt_av_sbc_format(peer.cie, &sample_rate, &ch_count);
+                bt_i2s_set_stream_format(sample_rate, ch_count);
+                output_configure(sample_rate, ch_count);
+                ESP_LOGI(BT_AV_TAG, "known source, output preconfigured for %d Hz/%d ch", sample_rate, ch_count);
+            }
             bt_i2s_driver_install();
         }
         break;
@@ -178,10 +243,9 @@ void bt_av_hdl_a2d_evt(uint16_t event, void *p_param)
         a2d = (esp_a2d_cb_param_t *)(p_param);
         ESP_LOGI(BT_AV_TAG, "A2DP audio state: %s", s_a2d_audio_state_str[a2d->audio_stat.state]);
         s_audio_state = a2d->audio_stat.state;
-        if (ESP_A2D_AUDIO_STATE_STARTED == a2d->audio_stat.state)
-        {
-            s_pkt_cnt = 0;
-        }
+        /* run at full speed only while audio flows, the writer stops the DMA on its own once it runs dry */
+        bt_app_power_set_state(s_audio_state == ESP_A2D_AUDIO_STATE_STARTED ? BT_APP_POWER_STREAMING
+                                                                             : BT_APP_POWER_CONNECTED);
         break;
     }
     /* when audio codec is configured, this event comes */
@@ -192,42 +256,14 @@ void bt_av_hdl_a2d_evt(uint16_t event, void *p_param)
         /* for now only SBC stream is supported */
         if (a2d->audio_cfg.mcc.type == ESP_A2D_MCT_SBC)
         {
-            int sample_rate = 16000;
-            int ch_count = 2;
-            char oct0 = a2d->audio_cfg.mcc.cie.sbc[0];
-            if (oct0 & (0x01 << 6))
-            {
-                sample_rate = 32000;
-            }
-            else if (oct0 & (0x01 << 5))
-            {
-                sample_rate = 44100;
-            }
-            else if (oct0 & (0x01 << 4))
-            {
-                sample_rate = 48000;
-            }
-
-            if (oct0 & (0x01 << 3))
-            {
-                ch_count = 1;
-            }
+            int sample_rate = 0;
+            int ch_count = 0;
 
-            dac_continuous_disable(tx_chan);
-            dac_continuous_del_channels(tx_chan);
-            dac_continuous_config_t cont_cfg = {
-                .chan_mask = DAC_CHANNEL_MASK_ALL,
-                .desc_num = 8,
-                .buf_size = 2048,
-                .freq_hz = sample_rate,
-                .offset = 127,
-                .clk_src = DAC_DIGI_CLK_SRC_DEFAULT, // Using APLL as clock source to get a wider frequency range
-                .chan_mode = (ch_count == 1) ? DAC_CHANNEL_MODE_SIMUL : DAC_CHANNEL_MODE_ALTER,
-            };
-            /* Allocate continuous channels */
-            dac_continuous_new_channels(&cont_cfg, &tx_chan);
-            /* Enable the continuous channels */
-            dac_continuous_enable(tx_chan);
+            bt_av_sbc_format(a2d->audio_cfg.mcc.cie.sbc, &sample_rate, &ch_count);
+            bt_i2s_set_stream_format(sample_rate, ch_count);
+            /* retune the output only if the format actually changed, i.e. the preconfiguration missed */
+            output_configure(sample_rate, ch_count);
+            bt_app_peer_remember(a2d->audio_cfg.remote_bda, a2d->audio_cfg.mcc.type, a2d->audio_cfg.mcc.cie.sbc);
 
             ESP_LOGI(BT_AV_TAG, "Configure audio player: %x-%x-%x-%x",
                      a2d->audio_cfg.mcc.cie.sbc[0],
@@ -286,8 +322,9 @@ void bt_av_hdl_a2d_evt(uint16_t event, void *p_param)
     {
         a2d = (esp_a2d_cb_param_t *)(p_param);
         ESP_LOGI(BT_AV_TAG, "Get delay report value: delay_value: %u * 1/10 ms", a2d->a2d_get_delay_value_stat.delay_value);
-        /* Default delay value plus delay caused by application layer */
-        esp_a2d_sink_set_delay_value(a2d->a2d_get_delay_value_stat.delay_value + APP_DELAY_VALUE);
+        /* Default delay value plus the current depth of the jitter buffer */
+        s_delay_base = a2d->a2d_get_delay_value_stat.delay_value;
+        esp_a2d_sink_set_delay_value(s_delay_base + bt_i2s_get_delay_value());
         break;
     }
     /* others */
@@ -297,6 +334,14 @@ void bt_av_hdl_a2d_evt(uint16_t event, void *p_param)
     }
 }
 
+void bt_av_hdl_delay_report(uint16_t event, void *p_param)
+{
+    uint16_t delay_value = s_delay_base + bt_i2s_get_delay_value();
+
+    ESP_LOGI(BT_AV_TAG, "Jitter buffer target changed, report delay_value: %u * 1/10 ms", delay_value);
+    esp_a2d_sink_set_delay_value(delay_value);
+}
+
 void bt_av_hdl_avrc_ct_evt(uint16_t event, void *p_param)
 {
     ESP_LOGD(BT_RC_CT_TAG, "%s event: %d", __func__, event);
@@ -315,12 +360,20 @@ void bt_av_hdl_avrc_ct_evt(uint16_t event, void *p_param)
         if (rc->conn_stat.connected)
         {
             /* get remote supported event_ids of peer AVRCP Target */
-            esp_avrc_ct_send_get_rn_capabilities_cmd(APP_RC_CT_TL_GET_CAPS);
+            bt_app_cmd_set_min_period(ESP_AVRC_RN_PLAY_POS_CHANGED, APP_RC_CT_PLAY_POS_PERIOD_MS);
+            bt_app_cmd_post(BT_APP_CMD_GET_CAPS, 0, 0);
         }
         else
         {
+            const bt_app_meta_stats_t *meta_stats = bt_app_meta_get_stats();
+
             /* clear peer notification capability record */
             s_avrc_peer_rn_cap.bits = 0;
+            ESP_LOGI(BT_RC_CT_TAG, "metadata: %" PRIu32 " texts stored, %" PRIu32 " shared, %" PRIu32 " truncated, "
+                     "%" PRIu32 " compactions, %" PRIu32 " requests skipped", meta_stats->stored, meta_stats->deduped,
+                     meta_stats->truncated, meta_stats->compactions, meta_stats->skipped);
+            bt_app_meta_clear();
+            bt_app_cmd_reset();
         }
         break;
     }
@@ -334,14 +387,22 @@ void bt_av_hdl_avrc_ct_evt(uint16_t event, void *p_param)
     /* when metadata responsed, this event comes */
     case ESP_AVRC_CT_METADATA_RSP_EVT:
     {
+        bt_app_meta_attr_t attr = bt_app_meta_attr_from_id(rc->meta_rsp.attr_id);
+
         ESP_LOGI(BT_RC_CT_TAG, "AVRC metadata rsp: attribute id 0x%x, %s", rc->meta_rsp.attr_id, rc->meta_rsp.attr_text);
-        free(rc->meta_rsp.attr_text);
+        bt_app_cmd_on_response(BT_APP_CMD_GET_METADATA, rc->meta_rsp.attr_id);
+        if (attr != META_ATTR_NUM)
+        {
+            bt_app_meta_set(attr, (const char *)rc->meta_rsp.attr_text, rc->meta_rsp.attr_length);
+        }
         break;
     }
     /* when notified, this event comes */
     case ESP_AVRC_CT_CHANGE_NOTIFY_EVT:
     {
         ESP_LOGI(BT_RC_CT_TAG, "AVRC event notification: %d", rc->change_ntf.event_id);
+        /* the registration ended, so the handler may register again */
+        bt_app_cmd_on_response(BT_APP_CMD_REGISTER_NOTIFICATION, rc->change_ntf.event_id);
         bt_av_notify_evt_handler(rc->change_ntf.event_id, &rc->change_ntf.event_parameter);
         break;
     }
@@ -357,6 +418,9 @@ void bt_av_hdl_avrc_ct_evt(uint16_t event, void *p_param)
         ESP_LOGI(BT_RC_CT_TAG, "remote rn_cap: count %d, bitmask 0x%x", rc->get_rn_caps_rsp.cap_count,
                  rc->get_rn_caps_rsp.evt_set.bits);
         s_avrc_peer_rn_cap.bits = rc->get_rn_caps_rsp.evt_set.bits;
+        bt_app_cmd_on_response(BT_APP_CMD_GET_CAPS, 0);
+        /* the playing track is not known yet, so its metadata is always requested */
+        bt_app_meta_begin_track(BT_APP_META_UID_UNKNOWN);
         bt_av_new_track();
         bt_av_playback_changed();
         bt_av_play_pos_changed();
@@ -423,6 +487,11 @@ void bt_app_a2d_cb(esp_a2d_cb_event_t event, esp_a2d_cb_param_t *param)
     case ESP_A2D_CONNECTION_STATE_EVT:
     case ESP_A2D_AUDIO_STATE_EVT:
     case ESP_A2D_AUDIO_CFG_EVT:
+    {
+        /* connection and codec configuration go ahead of everything else */
+        bt_app_work_dispatch_prio(bt_av_hdl_a2d_evt, event, param, sizeof(esp_a2d_cb_param_t), NULL, BT_APP_PRIO_HIGH);
+        break;
+    }
     case ESP_A2D_PROF_STATE_EVT:
     case ESP_A2D_SNK_PSC_CFG_EVT:
     case ESP_A2D_SNK_SET_DELAY_VALUE_EVT:
@@ -437,16 +506,36 @@ void bt_app_a2d_cb(esp_a2d_cb_event_t event, esp_a2d_cb_param_t *param)
     }
 }
 
+void bt_app_a2d_data_cb(const uint8_t *data, uint32_t len)
+{
+    uint32_t cycles = BT_APP_STATS_CYCLES();
+
+    /* packets are counted by the statistics module, nothing is logged from here */
+    write_ringbuf(data, len);
+    BT_APP_STATS_RECORD(STATS_HIST_CYC_INGEST, BT_APP_STATS_CYCLES() - cycles);
+}
+
 void bt_app_rc_ct_cb(esp_avrc_ct_cb_event_t event, esp_avrc_ct_cb_param_t *param)
 {
     switch (event)
     {
     case ESP_AVRC_CT_METADATA_RSP_EVT:
-        bt_app_alloc_meta_buffer(param);
-        /* fall through */
+        bt_app_work_dispatch(bt_av_hdl_avrc_ct_evt, event, param, sizeof(esp_avrc_ct_cb_param_t), bt_app_copy_meta_buffer);
+        break;
+    case ESP_AVRC_CT_CHANGE_NOTIFY_EVT:
+        /* position updates are chatty, only the latest one matters */
+        if (param->change_ntf.event_id == ESP_AVRC_RN_PLAY_POS_CHANGED)
+        {
+            bt_app_work_dispatch_coalesced(bt_av_hdl_avrc_ct_evt, event, param, sizeof(esp_avrc_ct_cb_param_t),
+                                           BT_APP_COALESCE_KEY_PLAY_POS);
+        }
+        else
+        {
+            bt_app_work_dispatch(bt_av_hdl_avrc_ct_evt, event, param, sizeof(esp_avrc_ct_cb_param_t), NULL);
+        }
+        break;
     case ESP_AVRC_CT_CONNECTION_STATE_EVT:
     case ESP_AVRC_CT_PASSTHROUGH_RSP_EVT:
-    case ESP_AVRC_CT_CHANGE_NOTIFY_EVT:
     case ESP_AVRC_CT_REMOTE_FEATURES_EVT:
     case ESP_AVRC_CT_GET_RN_CAPABILITIES_RSP_EVT:
     {
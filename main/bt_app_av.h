@@ -17,7 +17,9 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
-#include "driver/dac_continuous.h"
+#include "bt_app_output.h"
+#include "bt_app_cmd.h"
+#include "bt_app_meta.h"
 
 #include "sys/lock.h"
 
@@ -26,32 +28,28 @@
 #define BT_RC_TG_TAG "RC_TG"
 #define BT_RC_CT_TAG "RC_CT"
 
-/* AVRCP used transaction labels */
-#define APP_RC_CT_TL_GET_CAPS (0)
-#define APP_RC_CT_TL_GET_META_DATA (1)
-#define APP_RC_CT_TL_RN_TRACK_CHANGE (2)
-#define APP_RC_CT_TL_RN_PLAYBACK_CHANGE (3)
-#define APP_RC_CT_TL_RN_PLAY_POS_CHANGE (4)
-
-/* Application layer causes delay value */
-#define APP_DELAY_VALUE 50 // 5ms
+/* period of playback position notifications, also the shortest time between two registrations for them */
+#define APP_RC_CT_PLAY_POS_PERIOD_MS (10000)
 
 /**
- * @brief Allocates a buffer for metadata and copies the metadata into it.
+ * @brief Copies the metadata text of an AVRCP metadata response into the message's pool block.
  *
- * This function allocates a buffer of size equal to the length of the metadata plus one,
- * then copies the metadata into this buffer. The last byte of the buffer is set to 0.
- * The metadata pointer is then updated to point to this new buffer.
+ * This function is used as the deep-copy callback of bt_app_work_dispatch. The text is placed right after
+ * the parameter structure in the same pool block and terminated with 0, truncated if it does not fit.
+ * The metadata pointer of the copied parameter is then updated to point to it. No heap memory is used.
  *
- * @param param Pointer to the metadata parameter. This should point to a variable of type esp_avrc_ct_cb_param_t.
+ * @param p_dest Pointer to the copied parameter, at the start of a pool block. It points to a variable of type esp_avrc_ct_cb_param_t.
+ * @param p_src Pointer to the original parameter.
+ * @param len The length of the parameter structure in bytes.
  */
-void bt_app_alloc_meta_buffer(esp_avrc_ct_cb_param_t *param);
+void bt_app_copy_meta_buffer(void *p_dest, void *p_src, int len);
 
 /**
  * @brief Handles a new track event in the Bluetooth Audio Video Remote Control (AVRC) profile.
  *
- * This function requests metadata for the new track, including title, artist, album, and genre.
- * If the peer device supports track change notifications, it also registers for such notifications.
+ * This function requests metadata for the new track, including title, artist, album, and genre, which is
+ * kept by the metadata cache as it arrives. If the peer device supports track change notifications, it also
+ * registers for such notifications. A track change to the track already cached does not come here.
  */
 void bt_av_new_track(void);
 
@@ -85,19 +83,27 @@ void bt_av_play_pos_changed(void);
  */
 void bt_av_notify_evt_handler(uint8_t event_id, esp_avrc_rn_param_t *event_parameter);
 
+/**
+ * @brief Decodes the sample rate and channel count from an SBC codec information element.
+ *
+ * @param cie Pointer to the codec information element, 4 bytes.
+ * @param sample_rate Set to the sample rate in Hz.
+ * @param ch_count Set to the number of channels.
+ */
+void bt_av_sbc_format(const uint8_t *cie, int *sample_rate, int *ch_count);
+
 /**
  * @brief Installs the I2S driver for the Bluetooth application.
  *
- * This function configures the DAC for continuous operation with a specific configuration.
- * It allocates continuous channels with the given configuration and enables them. The configuration includes parameters
- * such as the channel mask, descriptor number, buffer size, frequency, offset, clock source, and channel mode.
+ * This function brings up the persistent output device. The DAC continuous channels and their DMA descriptors
+ * are allocated on the first call only and kept for the life of the process; later calls just re-enable them.
  */
 void bt_i2s_driver_install(void);
 
 /**
  * @brief Uninstalls the I2S driver for the Bluetooth application.
  *
- * This function disables the continuous operation of the DAC and deletes the continuous channels.
+ * This function pauses the output. The continuous channels and their DMA memory are kept for the next connection.
  */
 void bt_i2s_driver_uninstall(void);
 
@@ -113,6 +119,15 @@ void bt_i2s_driver_uninstall(void);
  */
 void volume_set_by_controller(uint8_t volume);
 
+/**
+ * @brief Gets the current volume level.
+ *
+ * This function is called from the audio path for every packet, so it reads the volume without taking the lock.
+ *
+ * @return The current volume level, as a value between 0 and 127 (0x7f), inclusive.
+ */
+uint8_t volume_get_current(void);
+
 /**
  * @brief Sets the volume level as specified by the local host.
  *
@@ -139,6 +154,17 @@ void volume_set_by_local_host(uint8_t volume);
  */
 void bt_av_hdl_a2d_evt(uint16_t event, void *p_param);
 
+/**
+ * @brief Reports the current sink latency to the A2DP source.
+ *
+ * This function is dispatched from the audio data path whenever the jitter buffer target has moved by more than
+ * its hysteresis. It sends the stack's own delay value plus the latency of the jitter buffer target.
+ *
+ * @param event Not used.
+ * @param p_param Not used.
+ */
+void bt_av_hdl_delay_report(uint16_t event, void *p_param);
+
 /**
  * @brief Handles the AVRCP Controller events.
  *
@@ -176,6 +202,17 @@ void bt_av_hdl_avrc_tg_evt(uint16_t event, void *p_param);
  */
 void bt_app_a2d_cb(esp_a2d_cb_event_t event, esp_a2d_cb_param_t *param);
 
+/**
+ * @brief Callback function for A2DP sink audio data.
+ *
+ * This function is called by the Bluedroid task for every decoded audio packet. It hands the PCM data
+ * to the I2S ring buffer via write_ringbuf and records the time it took.
+ *
+ * @param data Pointer to the decoded PCM data.
+ * @param len The length of the PCM data in bytes.
+ */
+void bt_app_a2d_data_cb(const uint8_t *data, uint32_t len);
+
 /**
  * @brief Callback function for AVRCP Controller events.
  *
@@ -0,0 +1,74 @@
+#include <inttypes.h>
+
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "bt_app_boot.h"
+
+typedef struct
+{
+    int64_t begin_us; /* time since boot the phase started, -1 if not recorded */
+    int64_t end_us;   /* time since boot the phase ended, -1 if not recorded */
+    int8_t core;      /* core the phase ran on */
+} bt_app_boot_rec_t;
+
+static const char *s_boot_phase_str[BT_APP_BOOT_NUM] = {"app_main", "nvs", "peers", "output", "ctrl init", "ctrl enable",
+                                                       "bluedroid init", "bluedroid enable", "profiles", "discoverable",
+                                                       "deferred"};
+static bt_app_boot_rec_t s_boot_recs[BT_APP_BOOT_NUM] = {
+    [0 ... BT_APP_BOOT_NUM - 1] = {.begin_us = -1, .end_us = -1, .core = -1},
+};
+
+void bt_app_boot_begin(bt_app_boot_phase_t phase)
+{
+    s_boot_recs[phase].core = (int8_t)xPortGetCoreID();
+    s_boot_recs[phase].begin_us = esp_timer_get_time();
+}
+
+void bt_app_boot_end(bt_app_boot_phase_t phase)
+{
+    s_boot_recs[phase].end_us = esp_timer_get_time();
+}
+
+void bt_app_boot_mark(bt_app_boot_phase_t phase)
+{
+    bt_app_boot_begin(phase);
+    s_boot_recs[phase].end_us = s_boot_recs[phase].begin_us;
+}
+
+int64_t bt_app_boot_get_end_us(bt_app_boot_phase_t phase)
+{
+    return s_boot_recs[phase].end_us;
+}
+
+void bt_app_boot_report(void)
+{
+    bool done[BT_APP_BOOT_NUM] = {false};
+
+    /* phases on different tasks overlap, so they are listed by start time rather than by enum order */
+    for (int n = 0; n < BT_APP_BOOT_NUM; n++)
+    {
+        int next = -1;
+
+        for (int i = 0; i < BT_APP_BOOT_NUM; i++)
+        {
+            if (!done[i] && s_boot_recs[i].end_us >= 0 &&
+                (next < 0 || s_boot_recs[i].begin_us < s_boot_recs[next].begin_us))
+            {
+                next = i;
+            }
+        }
+        if (next < 0)
+        {
+            break;
+        }
+        done[next] = true;
+        ESP_LOGI(BT_APP_BOOT_TAG, "%-16s core %d at %7" PRId64 " us, took %7" PRId64 " us", s_boot_phase_str[next],
+                 s_boot_recs[next].core, s_boot_recs[next].begin_us, s_boot_recs[next].end_us - s_boot_recs[next].begin_us);
+    }
+    if (s_boot_recs[BT_APP_BOOT_DISCOVERABLE].end_us >= 0)
+    {
+        ESP_LOGI(BT_APP_BOOT_TAG, "time to discoverable: %" PRId64 " ms", s_boot_recs[BT_APP_BOOT_DISCOVERABLE].end_us / 1000);
+    }
+}
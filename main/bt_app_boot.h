@@ -0,0 +1,63 @@
+#ifndef __BT_APP_BOOT_H__
+#define __BT_APP_BOOT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BT_APP_BOOT_TAG "BT_APP_BOOT"
+
+/**
+ * @brief Phases of the bring-up. Milestones have no duration.
+ */
+typedef enum
+{
+    BT_APP_BOOT_APP_MAIN,         /*!< milestone: app_main entered, everything before is ROM and startup code */
+    BT_APP_BOOT_NVS,              /*!< NVS flash init, on the preparation task */
+    BT_APP_BOOT_PEERS,            /*!< remembered sources loaded, on the preparation task */
+    BT_APP_BOOT_OUTPUT,           /*!< output channels and DMA allocated, on the preparation task */
+    BT_APP_BOOT_CTRL_INIT,        /*!< controller memory release and init */
+    BT_APP_BOOT_CTRL_ENABLE,      /*!< controller enable, includes PHY calibration */
+    BT_APP_BOOT_BLUEDROID_INIT,   /*!< host stack init */
+    BT_APP_BOOT_BLUEDROID_ENABLE, /*!< host stack enable */
+    BT_APP_BOOT_PROFILES,         /*!< AVRCP and A2DP sink init */
+    BT_APP_BOOT_DISCOVERABLE,     /*!< milestone: connectable and discoverable */
+    BT_APP_BOOT_DEFERRED,         /*!< work moved after discoverable */
+    BT_APP_BOOT_NUM,
+} bt_app_boot_phase_t;
+
+/**
+ * @brief Records the start of a phase. Each phase must be recorded from a single task.
+ *
+ * @param phase The phase.
+ */
+void bt_app_boot_begin(bt_app_boot_phase_t phase);
+
+/**
+ * @brief Records the end of a phase.
+ *
+ * @param phase The phase.
+ */
+void bt_app_boot_end(bt_app_boot_phase_t phase);
+
+/**
+ * @brief Records a milestone, a phase that starts and ends at once.
+ *
+ * @param phase The phase.
+ */
+void bt_app_boot_mark(bt_app_boot_phase_t phase);
+
+/**
+ * @brief Gets the time since boot at which a phase ended.
+ *
+ * @param phase The phase.
+ * @return The time in microseconds, or -1 if the phase has not ended.
+ */
+int64_t bt_app_boot_get_end_us(bt_app_boot_phase_t phase);
+
+/**
+ * @brief Logs the boot timeline: start, duration and core of every recorded phase in order of start time,
+ * followed by the time to discoverable in a fixed format meant to be tracked across builds.
+ */
+void bt_app_boot_report(void);
+
+#endif /* __BT_APP_BOOT_H__ */
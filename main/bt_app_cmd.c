@@ -0,0 +1,324 @@
+#include <inttypes.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_avrc_api.h"
+
+#include "bt_app_core.h"
+#include "bt_app_cmd.h"
+
+/* a command, queued or in flight */
+typedef struct
+{
+    uint8_t type;          /* bt_app_cmd_type_t */
+    uint8_t arg;           /* attribute mask or event identifier, remaining attributes once in flight */
+    bool answered;         /* a response has arrived, in flight only */
+    uint32_t param;        /* parameter of a registration */
+    int64_t time_us;       /* earliest send time while queued, send time while in flight */
+} bt_app_cmd_t;
+
+static bt_app_cmd_t s_cmd_queue[BT_APP_CMD_QUEUE_LEN];        /* commands waiting, oldest first */
+static uint8_t s_cmd_queued = 0;                              /* number of commands waiting */
+static bt_app_cmd_t s_cmd_label[BT_APP_CMD_LABELS];           /* command in flight on each label */
+static uint16_t s_cmd_busy = 0;                               /* labels in use, one bit each */
+static uint8_t s_cmd_next_label = 0;                          /* label tried first, labels are used round robin */
+static uint32_t s_cmd_min_period_ms[BT_APP_CMD_EVT_IDS];      /* minimum period between registrations */
+static int64_t s_cmd_last_reg_us[BT_APP_CMD_EVT_IDS];         /* last registration of each notification */
+static esp_timer_handle_t s_cmd_timer = NULL;                 /* next timeout or throttled send */
+static bt_app_cmd_stats_t s_cmd_stats;                        /* counters */
+
+static const char *s_cmd_type_str[BT_APP_CMD_NUM] = {"caps", "metadata", "register"};
+
+static int bt_app_cmd_find_label(bt_app_cmd_type_t type, uint8_t arg)
+{
+    for (int tl = 0; tl < BT_APP_CMD_LABELS; tl++)
+    {
+        /* metadata responses name one attribute of the mask */
+        if ((s_cmd_busy & (1 << tl)) && s_cmd_label[tl].type == type &&
+            (type == BT_APP_CMD_GET_METADATA ? (s_cmd_label[tl].arg & arg) != 0 : s_cmd_label[tl].arg == arg))
+        {
+            return tl;
+        }
+    }
+    return -1;
+}
+
+static void bt_app_cmd_free_label(int tl)
+{
+    s_cmd_busy &= ~(1 << tl);
+}
+
+static esp_err_t bt_app_cmd_send(uint8_t tl, const bt_app_cmd_t *cmd)
+{
+    switch (cmd->type)
+    {
+    case BT_APP_CMD_GET_CAPS:
+        return esp_avrc_ct_send_get_rn_capabilities_cmd(tl);
+    case BT_APP_CMD_GET_METADATA:
+        return esp_avrc_ct_send_metadata_cmd(tl, cmd->arg);
+    case BT_APP_CMD_REGISTER_NOTIFICATION:
+        return esp_avrc_ct_send_register_notification_cmd(tl, cmd->arg, cmd->param);
+    default:
+        return ESP_ERR_INVALID_ARG;
+    }
+}
+
+static void bt_app_cmd_hdl_timer(uint16_t event, void *param);
+
+static void bt_app_cmd_timer_cb(void *arg)
+{
+    /* time out and send from the application task, where responses are handled */
+    if (!bt_app_work_dispatch(bt_app_cmd_hdl_timer, 0, NULL, 0, NULL))
+    {
+        /* nothing else would wake the scheduler, so the labels in flight would never time out */
+        esp_timer_start_once(s_cmd_timer, BT_APP_CMD_RETRY_MS * 1000);
+    }
+}
+
+static int64_t bt_app_cmd_deadline(const bt_app_cmd_t *cmd)
+{
+    int64_t timeout_ms = cmd->type == BT_APP_CMD_REGISTER_NOTIFICATION ? BT_APP_CMD_REG_TIMEOUT_MS : BT_APP_CMD_TIMEOUT_MS;
+
+    return cmd->time_us + timeout_ms * 1000;
+}
+
+static void bt_app_cmd_arm(int64_t wake_us)
+{
+    const esp_timer_create_args_t args = {
+        .callback = bt_app_cmd_timer_cb,
+        .name = "bt_app_cmd",
+    };
+    esp_err_t err = ESP_OK;
+
+    if (s_cmd_timer == NULL && (err = esp_timer_create(&args, &s_cmd_timer)) != ESP_OK)
+    {
+        ESP_LOGE(BT_APP_CMD_TAG, "%s timer create failed: %s", __func__, esp_err_to_name(err));
+        return;
+    }
+    esp_timer_stop(s_cmd_timer);
+    if (wake_us >= 0)
+    {
+        wake_us -= esp_timer_get_time();
+        esp_timer_start_once(s_cmd_timer, wake_us > 0 ? (uint64_t)wake_us : 1);
+    }
+}
+
+/* expires overdue commands, sends what may be sent and arms the timer for whatever comes next */
+static void bt_app_cmd_pump(void)
+{
+    int64_t now_us = esp_timer_get_time();
+    int64_t wake_us = -1;
+    uint32_t in_flight = 0;
+
+    for (int tl = 0; tl < BT_APP_CMD_LABELS; tl++)
+    {
+        bt_app_cmd_t *cmd = &s_cmd_label[tl];
+
+        if (!(s_cmd_busy & (1 << tl)) || now_us < bt_app_cmd_deadline(cmd))
+        {
+            continue;
+        }
+        if (cmd->type == BT_APP_CMD_REGISTER_NOTIFICATION)
+        {
+            /* the target may have dropped the registration, and if it has not, registering again replaces it */
+            if (s_cmd_queued < BT_APP_CMD_QUEUE_LEN)
+            {
+                s_cmd_queue[s_cmd_queued++] = (bt_app_cmd_t){
+                    .type = cmd->type,
+                    .arg = cmd->arg,
+                    .param = cmd->param,
+                };
+                s_cmd_stats.renewed++;
+            }
+            else
+            {
+                s_cmd_stats.refused++;
+            }
+            bt_app_cmd_free_label(tl);
+        }
+        else
+        {
+            /* targets leave out attributes they do not have, so an answered metadata command is done */
+            if (cmd->answered)
+            {
+                s_cmd_stats.partial++;
+            }
+            else
+            {
+                s_cmd_stats.timeouts++;
+                ESP_LOGW(BT_APP_CMD_TAG, "%s 0x%x on label %d timed out", s_cmd_type_str[cmd->type], cmd->arg, tl);
+            }
+            bt_app_cmd_free_label(tl);
+        }
+    }
+
+    for (uint8_t i = 0; i < s_cmd_queued;)
+    {
+        bt_app_cmd_t *cmd = &s_cmd_queue[i];
+        uint8_t tl = s_cmd_next_label;
+        esp_err_t err = ESP_OK;
+
+        in_flight = __builtin_popcount(s_cmd_busy);
+        if (in_flight >= BT_APP_CMD_MAX_IN_FLIGHT)
+        {
+            break;
+        }
+        if (cmd->time_us > now_us)
+        {
+            wake_us = wake_us < 0 || cmd->time_us < wake_us ? cmd->time_us : wake_us;
+            i++;
+            continue;
+        }
+        while (s_cmd_busy & (1 << tl))
+        {
+            tl = (tl + 1) % BT_APP_CMD_LABELS;
+        }
+        s_cmd_next_label = (tl + 1) % BT_APP_CMD_LABELS;
+
+        if ((err = bt_app_cmd_send(tl, cmd)) != ESP_OK)
+        {
+            ESP_LOGE(BT_APP_CMD_TAG, "%s %s 0x%x failed: %s", __func__, s_cmd_type_str[cmd->type], cmd->arg,
+                     esp_err_to_name(err));
+            s_cmd_stats.refused++;
+        }
+        else
+        {
+            if (cmd->type == BT_APP_CMD_REGISTER_NOTIFICATION)
+            {
+                s_cmd_last_reg_us[cmd->arg % BT_APP_CMD_EVT_IDS] = now_us;
+            }
+            s_cmd_label[tl] = *cmd;
+            s_cmd_label[tl].time_us = now_us;
+            s_cmd_label[tl].answered = false;
+            s_cmd_busy |= 1 << tl;
+            s_cmd_stats.sent++;
+            if (in_flight + 1 > s_cmd_stats.max_in_flight)
+            {
+                s_cmd_stats.max_in_flight = in_flight + 1;
+            }
+        }
+        memmove(cmd, cmd + 1, (--s_cmd_queued - i) * sizeof(bt_app_cmd_t));
+    }
+
+    for (int tl = 0; tl < BT_APP_CMD_LABELS; tl++)
+    {
+        if (s_cmd_busy & (1 << tl))
+        {
+            int64_t deadline_us = bt_app_cmd_deadline(&s_cmd_label[tl]);
+
+            wake_us = wake_us < 0 || deadline_us < wake_us ? deadline_us : wake_us;
+        }
+    }
+    bt_app_cmd_arm(wake_us);
+}
+
+static void bt_app_cmd_hdl_timer(uint16_t event, void *param)
+{
+    bt_app_cmd_pump();
+}
+
+bool bt_app_cmd_post(bt_app_cmd_type_t type, uint8_t arg, uint32_t param)
+{
+    int64_t not_before_us = 0;
+    uint8_t evt = arg % BT_APP_CMD_EVT_IDS;
+
+    for (uint8_t i = 0; i < s_cmd_queued; i++)
+    {
+        if (s_cmd_queue[i].type == type && s_cmd_queue[i].arg == arg)
+        {
+            s_cmd_queue[i].param = param;
+            s_cmd_stats.coalesced++;
+            return true;
+        }
+    }
+    if (type == BT_APP_CMD_REGISTER_NOTIFICATION)
+    {
+        if (bt_app_cmd_find_label(type, arg) >= 0)
+        {
+            s_cmd_stats.coalesced++;
+            return false;
+        }
+        if (s_cmd_min_period_ms[evt] > 0 && s_cmd_last_reg_us[evt] > 0)
+        {
+            not_before_us = s_cmd_last_reg_us[evt] + s_cmd_min_period_ms[evt] * 1000LL;
+            if (not_before_us > esp_timer_get_time())
+            {
+                s_cmd_stats.throttled++;
+            }
+        }
+    }
+    if (s_cmd_queued == BT_APP_CMD_QUEUE_LEN)
+    {
+        ESP_LOGE(BT_APP_CMD_TAG, "%s queue full, %s 0x%x dropped", __func__, s_cmd_type_str[type], arg);
+        s_cmd_stats.refused++;
+        return false;
+    }
+    s_cmd_queue[s_cmd_queued++] = (bt_app_cmd_t){
+        .type = type,
+        .arg = arg,
+        .param = param,
+        .time_us = not_before_us,
+    };
+    bt_app_cmd_pump();
+    return true;
+}
+
+void bt_app_cmd_on_response(bt_app_cmd_type_t type, uint8_t arg)
+{
+    int tl = bt_app_cmd_find_label(type, arg);
+    bt_app_cmd_t *cmd = NULL;
+    uint32_t rtt_us = 0;
+
+    if (tl < 0)
+    {
+        s_cmd_stats.unmatched++;
+        return;
+    }
+    cmd = &s_cmd_label[tl];
+    rtt_us = (uint32_t)(esp_timer_get_time() - cmd->time_us);
+    /* a change notification ends a registration that may have been waiting for minutes, it has no round trip */
+    if (!cmd->answered && type != BT_APP_CMD_REGISTER_NOTIFICATION)
+    {
+        BT_APP_STATS_RECORD(STATS_HIST_RC_RTT_US, rtt_us);
+    }
+    cmd->answered = true;
+    if (type == BT_APP_CMD_GET_METADATA)
+    {
+        cmd->arg &= ~arg;
+        if (cmd->arg != 0)
+        {
+            return;
+        }
+        BT_APP_STATS_RECORD(STATS_HIST_RC_META_US, rtt_us);
+    }
+    s_cmd_stats.completed++;
+    bt_app_cmd_free_label(tl);
+    bt_app_cmd_pump();
+}
+
+void bt_app_cmd_set_min_period(uint8_t event_id, uint32_t period_ms)
+{
+    s_cmd_min_period_ms[event_id % BT_APP_CMD_EVT_IDS] = period_ms;
+}
+
+void bt_app_cmd_reset(void)
+{
+    ESP_LOGI(BT_APP_CMD_TAG, "%" PRIu32 " sent, %" PRIu32 " completed, %" PRIu32 " partial, %" PRIu32 " timed out, "
+             "%" PRIu32 " renewed, %" PRIu32 " coalesced, %" PRIu32 " throttled, %" PRIu32 " refused, "
+             "%" PRIu32 " unmatched, %" PRIu32 " in flight at most", s_cmd_stats.sent, s_cmd_stats.completed,
+             s_cmd_stats.partial, s_cmd_stats.timeouts, s_cmd_stats.renewed, s_cmd_stats.coalesced,
+             s_cmd_stats.throttled, s_cmd_stats.refused, s_cmd_stats.unmatched, s_cmd_stats.max_in_flight);
+    s_cmd_queued = 0;
+    s_cmd_busy = 0;
+    memset(s_cmd_last_reg_us, 0, sizeof(s_cmd_last_reg_us));
+    if (s_cmd_timer)
+    {
+        esp_timer_stop(s_cmd_timer);
+    }
+}
+
+const bt_app_cmd_stats_t *bt_app_cmd_get_stats(void)
+{
+    return &s_cmd_stats;
+}
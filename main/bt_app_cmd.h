@@ -0,0 +1,105 @@
+#ifndef __BT_APP_CMD_H__
+#define __BT_APP_CMD_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BT_APP_CMD_TAG "BT_APP_CMD"
+
+/* AVRCP transaction labels are four bits wide */
+#define BT_APP_CMD_LABELS (16)
+/* commands waiting for a free label or for their throttle period */
+#define BT_APP_CMD_QUEUE_LEN (8)
+/* labels in use at once, registered notifications included */
+#define BT_APP_CMD_MAX_IN_FLIGHT (8)
+/* time a command may wait for its response before its label is reused */
+#define BT_APP_CMD_TIMEOUT_MS (2000)
+/* time a registration may wait for its change notification before its label is reclaimed and it is sent again */
+#define BT_APP_CMD_REG_TIMEOUT_MS (60000)
+/* delay before the timer tries again when the work queue refused its wake-up */
+#define BT_APP_CMD_RETRY_MS (10)
+/* notification event identifiers that can be throttled, AVRCP defines 0x01 to 0x0d */
+#define BT_APP_CMD_EVT_IDS (16)
+
+/**
+ * @brief AVRCP controller commands handled by the scheduler.
+ */
+typedef enum
+{
+    BT_APP_CMD_GET_CAPS,              /*!< get the notification capabilities of the target */
+    BT_APP_CMD_GET_METADATA,          /*!< get element attributes, the argument is the attribute mask */
+    BT_APP_CMD_REGISTER_NOTIFICATION, /*!< register a notification, the argument is the event identifier */
+    BT_APP_CMD_NUM,
+} bt_app_cmd_type_t;
+
+/**
+ * @brief Counters of the scheduler.
+ */
+typedef struct
+{
+    uint32_t sent;          /*!< commands handed to the stack */
+    uint32_t completed;     /*!< commands fully answered */
+    uint32_t partial;       /*!< metadata commands that timed out with some of the attributes answered */
+    uint32_t timeouts;      /*!< commands that got no response in time */
+    uint32_t renewed;       /*!< registrations sent again because no change arrived in time */
+    uint32_t coalesced;     /*!< commands dropped because the same one was queued or registered already */
+    uint32_t throttled;     /*!< registrations held back by their minimum period */
+    uint32_t refused;       /*!< commands dropped because the queue was full or the stack refused them */
+    uint32_t unmatched;     /*!< responses that matched no command in flight */
+    uint32_t max_in_flight; /*!< most labels in use at once */
+} bt_app_cmd_stats_t;
+
+/**
+ * @brief Queues an AVRCP controller command. Must be called on the application task.
+ *
+ * The command is sent right away on a free transaction label if fewer than BT_APP_CMD_MAX_IN_FLIGHT labels are in
+ * use and its throttle period allows, otherwise when that becomes true. A command that is already queued is only
+ * updated, and the registration of a notification that is still registered is dropped. A registration that gets no
+ * change notification within BT_APP_CMD_REG_TIMEOUT_MS gives up its label and is sent again, which refreshes it
+ * with the target.
+ *
+ * @param type The command.
+ * @param arg The attribute mask of BT_APP_CMD_GET_METADATA or the event identifier of BT_APP_CMD_REGISTER_NOTIFICATION.
+ * @param param The parameter of a registration, e.g. the playback interval in seconds of position notifications.
+ * @return true if the command was sent or queued, false if it was dropped.
+ */
+bool bt_app_cmd_post(bt_app_cmd_type_t type, uint8_t arg, uint32_t param);
+
+/**
+ * @brief Feeds a response to the scheduler. Must be called on the application task.
+ *
+ * The stack does not report transaction labels, so responses are matched by command and argument: a capabilities
+ * response, one attribute of a metadata response, or the change notification ending a registration. The first
+ * response of a command records its round-trip time in STATS_HIST_RC_RTT_US, the last attribute of a metadata
+ * command the time to all attributes in STATS_HIST_RC_META_US.
+ *
+ * @param type The command answered.
+ * @param arg The attribute identifier of a metadata response or the event identifier of a change notification.
+ */
+void bt_app_cmd_on_response(bt_app_cmd_type_t type, uint8_t arg);
+
+/**
+ * @brief Sets the shortest time between two registrations of a notification. Must be called on the application task.
+ *
+ * A registration posted earlier waits in the queue. This bounds the rate of chatty notifications, whose change
+ * ends the registration and triggers the next one.
+ *
+ * @param event_id The event identifier.
+ * @param period_ms The minimum period, 0 for none.
+ */
+void bt_app_cmd_set_min_period(uint8_t event_id, uint32_t period_ms);
+
+/**
+ * @brief Drops all queued commands and frees all labels, e.g. when the target disconnects. Must be called on the
+ * application task. The counters are logged first and kept, the minimum periods are kept too.
+ */
+void bt_app_cmd_reset(void);
+
+/**
+ * @brief Gets the counters of the scheduler.
+ *
+ * @return Pointer to the counters.
+ */
+const bt_app_cmd_stats_t *bt_app_cmd_get_stats(void);
+
+#endif /* __BT_APP_CMD_H__ */
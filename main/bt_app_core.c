@@ -1,183 +1,269 @@
+#include <stdatomic.h>
+
 #include "bt_app_core.h"
+#include "bt_app_av.h"
+#include "bt_app_mem.h"
+#include "bt_app_pcm.h"
 
-static QueueHandle_t s_bt_app_task_queue = NULL; /* handle of work queue */
-static TaskHandle_t s_bt_app_task_handle = NULL; /* handle of application task  */
 static TaskHandle_t s_bt_i2s_task_handle = NULL; /* handle of I2S task */
-static RingbufHandle_t s_ringbuf_i2s = NULL;     /* handle of ringbuffer for I2S */
+static audio_fifo_t s_i2s_fifo;                  /* lock-free FIFO between A2DP data callback and I2S task */
+static uint8_t *s_i2s_fifo_storage = NULL;       /* storage of the I2S FIFO */
 static SemaphoreHandle_t s_i2s_write_semaphore = NULL;
 static uint16_t s_ringbuffer_mode = PROCESSING;
+static jitter_buf_t s_jitter = {
+    .min_bytes = JITTER_BUF_MIN_BYTES,
+    .max_bytes = JITTER_BUF_MAX_BYTES,
+    .bytes_per_sec = 44100 * 2 * sizeof(int16_t),
+    .target_bytes = JITTER_BUF_MIN_BYTES,
+};                                               /* adaptive prefetch target, owned by the data path */
+static atomic_uint s_jitter_pending_rate = 0;    /* byte rate of a new stream format, 0 once applied by the data path */
+static atomic_uint s_jitter_delay_value = 0;     /* latency last reported to the source, in 1/10 ms */
+static atomic_uint s_i2s_underflow_cnt = 0;      /* underflows seen by the I2S task */
+static unsigned int s_i2s_underflow_seen = 0;    /* underflows already applied to the jitter buffer */
+static uint8_t s_i2s_ch_count = 2;              /* channels of the incoming stream */
+static uint32_t s_i2s_sample_rate = 44100;       /* sample rate of the incoming stream */
+static asrc_t s_asrc;                            /* drift compensation between source and DAC clocks */
+static plc_t s_plc;                              /* concealment of late or missing packets */
+static eq_t s_eq = EQ_INITIALIZER;               /* room and driver correction */
+static const eq_band_t s_eq_default_bands[] = {
+    {.type = EQ_HIGH_PASS, .freq_hz = 80, .gain_db10 = 0, .q100 = 71},
+};
+static bool s_eq_bands_set = false;              /* bands have been chosen, either default or by the application */
+static drc_t s_drc;                              /* volume, compression and limiting ahead of the output */
+static int16_t *s_pcm_buf = NULL;                /* resampled PCM of one chunk, MEM_BUF_I2S_PCM */
+static int32_t *s_out_buf = NULL;                /* one chunk in the format of the output backend, MEM_BUF_I2S_OUT */
+static int64_t s_i2s_last_packet_us = -1;         /* arrival time of the previous A2DP packet */
+static atomic_bool s_i2s_waiting = false;          /* the I2S task sleeps until new data arrives */
 
-extern dac_continuous_handle_t tx_chan;
-
-bool bt_app_send_msg(bt_app_msg_t *msg)
+static void bt_i2s_set_budgets(uint8_t ch_count, uint32_t sample_rate, size_t chunk_bytes)
 {
-    if (msg == NULL)
-    {
-        return false;
-    }
-
-    /* send the message to work queue */
-    if (xQueueSend(s_bt_app_task_queue, msg, 10 / portTICK_PERIOD_MS) != pdTRUE)
-    {
-        ESP_LOGE(BT_APP_CORE_TAG, "%s xQueue send failed", __func__);
-        return false;
-    }
-    return true;
-}
+    /* CPU cycles available in the real time of one chunk */
+    uint64_t chunk_cycles = (uint64_t)CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ * 1000000 *
+                            (chunk_bytes / (ch_count * sizeof(int16_t))) / sample_rate;
 
-void bt_app_work_dispatched(bt_app_msg_t *msg)
-{
-    if (msg->cb)
-    {
-        msg->cb(msg->event, msg->param);
-    }
+    bt_app_stats_set_budget(STATS_HIST_CYC_ASRC, (uint32_t)(chunk_cycles * BT_I2S_BUDGET_ASRC_PCT / 100));
+    bt_app_stats_set_budget(STATS_HIST_CYC_PLC, (uint32_t)(chunk_cycles * BT_I2S_BUDGET_PLC_PCT / 100));
+    bt_app_stats_set_budget(STATS_HIST_CYC_EQ, (uint32_t)(chunk_cycles * BT_I2S_BUDGET_EQ_PCT / 100));
+    bt_app_stats_set_budget(STATS_HIST_CYC_DRC, (uint32_t)(chunk_cycles * BT_I2S_BUDGET_DRC_PCT / 100));
+    bt_app_stats_set_budget(STATS_HIST_CYC_PCM, (uint32_t)(chunk_cycles * BT_I2S_BUDGET_PCM_PCT / 100));
+    /* deferred, printf is too deep for the stack of the I2S task; the record carries the core */
+    BT_APP_LOG(BLOG_I2S_BUDGETS, sample_rate, ch_count, (uint32_t)chunk_cycles, CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ);
 }
 
-void bt_app_task_handler(void *arg)
+/* converts one chunk of processed PCM to the format of the output backend and writes it */
+static void bt_i2s_write_output(const output_backend_t *backend, size_t samples, uint32_t *dither_seed)
 {
-    bt_app_msg_t msg;
+    const void *data = s_out_buf;
+    size_t len = 0;
+    uint32_t cycles = BT_APP_STATS_CYCLES();
 
-    for (;;)
+    switch (backend->format)
     {
-        /* receive message from work queue and handle it */
-        if (pdTRUE == xQueueReceive(s_bt_app_task_queue, &msg, (TickType_t)portMAX_DELAY))
-        {
-            ESP_LOGD(BT_APP_CORE_TAG, "%s, signal: 0x%x, event: 0x%x", __func__, msg.sig, msg.event);
-
-            switch (msg.sig)
-            {
-            case BT_APP_SIG_WORK_DISPATCH:
-                bt_app_work_dispatched(&msg);
-                break;
-            default:
-                ESP_LOGW(BT_APP_CORE_TAG, "%s, unhandled signal: %d", __func__, msg.sig);
-                break;
-            } /* switch (msg.sig) */
-
-            if (msg.param)
-            {
-                free(msg.param);
-            }
-        }
+    case OUTPUT_FMT_DAC:
+        /* each 16-bit sample becomes one DAC slot, the volume is already applied */
+        pcm_s16_to_dac(s_pcm_buf, (uint16_t *)s_out_buf, samples, PCM_VOLUME_MAX, dither_seed);
+        len = samples * sizeof(uint16_t);
+        break;
+    case OUTPUT_FMT_S16:
+        data = s_pcm_buf;
+        len = samples * sizeof(int16_t);
+        break;
+    case OUTPUT_FMT_S32:
+        pcm_s16_to_s32(s_pcm_buf, s_out_buf, samples);
+        len = samples * sizeof(int32_t);
+        break;
     }
+    BT_APP_STATS_RECORD(STATS_HIST_CYC_PCM, BT_APP_STATS_CYCLES() - cycles);
+    /* the time blocked here is the back-pressure of the output */
+    BT_APP_TRACE_BEGIN(TRACE_OUTPUT_WRITE, len);
+    output_write(data, len);
+    BT_APP_TRACE_END(TRACE_OUTPUT_WRITE, len);
 }
 
 void bt_i2s_task_handler(void *arg)
 {
-    uint8_t *data = NULL;
-    size_t item_size = 0;
-    /**
-     * The total length of DMA buffer of I2S is:
-     * `dma_frame_num * dma_desc_num * i2s_channel_num * i2s_data_bit_width / 8`.
-     * Transmit `dma_frame_num * dma_desc_num` bytes to DMA is trade-off.
-     */
-    const size_t item_size_upto = 240 * 6;
-    size_t bytes_written = 0;
+    const output_backend_t *backend = output_get_backend();
+    /* 8-bit codes need make-up gain to keep quiet listening off the bottom codes, finer converters do not */
+    float max_makeup_db = backend->bits <= 8 ? DRC_MAX_MAKEUP_DB : 0.0f;
+    size_t chunk_bytes = backend->chunk_samples * sizeof(int16_t);
+    audio_fifo_span_t spans[2];
+    size_t chunk_size = 0;
+    size_t frames = 0;
+    size_t frame_size = 0;
+    size_t frame_cap = 0;
+    uint32_t dither_seed = 1;
+    bool in_gap = false;
+    bool resumed = false;
+    uint32_t cycles = 0;
+    int64_t deadline_us = 0;
+    int64_t remaining_us = 0;
+    TickType_t wait_ticks = 0;
+
+    asrc_init(&s_asrc, s_i2s_ch_count);
+    plc_init(&s_plc, s_i2s_ch_count, s_i2s_sample_rate);
+    eq_init(&s_eq, s_i2s_ch_count, s_i2s_sample_rate);
+    drc_init(&s_drc, s_i2s_ch_count, s_i2s_sample_rate, max_makeup_db);
+    bt_i2s_set_budgets(s_i2s_ch_count, s_i2s_sample_rate, chunk_bytes);
 
     for (;;)
     {
         if (pdTRUE == xSemaphoreTake(s_i2s_write_semaphore, portMAX_DELAY))
         {
+            resumed = false;
             for (;;)
             {
-                item_size = 0;
-                /* receive data from ringbuffer and write it to I2S DMA transmit buffer */
-                data = (uint8_t *)xRingbufferReceiveUpTo(s_ringbuf_i2s, &item_size, (TickType_t)pdMS_TO_TICKS(20), item_size_upto);
-                if (item_size == 0)
+                /* follow a format change from codec reconfiguration */
+                if (s_asrc.channels != s_i2s_ch_count || s_plc.sample_rate != s_i2s_sample_rate)
                 {
-                    ESP_LOGI(BT_APP_CORE_TAG, "ringbuffer underflowed! mode changed: RINGBUFFER_MODE_PREFETCHING");
-                    s_ringbuffer_mode = PREFETCHING;
-                    break;
+                    asrc_init(&s_asrc, s_i2s_ch_count);
+                    plc_set_format(&s_plc, s_i2s_ch_count, s_i2s_sample_rate);
+                    eq_set_format(&s_eq, s_i2s_ch_count, s_i2s_sample_rate);
+                    drc_init(&s_drc, s_i2s_ch_count, s_i2s_sample_rate, max_makeup_db);
+                    bt_i2s_set_budgets(s_i2s_ch_count, s_i2s_sample_rate, chunk_bytes);
                 }
+                frame_size = s_asrc.channels * sizeof(int16_t);
+                frame_cap = I2S_RESAMPLED_MAX_SAMPLES / s_asrc.channels;
 
-                dac_continuous_write(tx_chan, data, item_size, &bytes_written, -1);
-                vRingbufferReturnItem(s_ringbuf_i2s, (void *)data);
-            }
-        }
-    }
-}
-
-bool bt_app_work_dispatch(bt_app_cb_t p_cback, uint16_t event, void *p_params, int param_len, bt_app_copy_cb_t p_copy_cback)
-{
-    ESP_LOGD(BT_APP_CORE_TAG, "%s event: 0x%x, param len: %d", __func__, event, param_len);
+                /* wait for the data callback to signal new data if the FIFO has run dry, but no longer
+                 * than the output can play from what it has queued, the flag is raised first so a packet
+                 * written between the check and the wait still wakes us */
+                atomic_store(&s_i2s_waiting, true);
+                if (audio_fifo_fill(&s_i2s_fifo) == 0 && !in_gap)
+                {
+                    deadline_us = esp_timer_get_time() + output_get_headroom_us();
+                    BT_APP_TRACE_BEGIN(TRACE_I2S_WAIT, 0);
+                    for (;;)
+                    {
+                        remaining_us = deadline_us - esp_timer_get_time();
+                        if (audio_fifo_fill(&s_i2s_fifo) != 0 || remaining_us <= 0 ||
+                            (wait_ticks = pdMS_TO_TICKS(remaining_us / 1000)) == 0)
+                        {
+                            break;
+                        }
+                        ulTaskNotifyTake(pdTRUE, wait_ticks);
+                        BT_APP_STATS_INC(STATS_CNT_WAKEUPS);
+                    }
+                    BT_APP_TRACE_END(TRACE_I2S_WAIT, 0);
+                }
+                atomic_store(&s_i2s_waiting, false);
 
-    bt_app_msg_t msg;
-    memset(&msg, 0, sizeof(bt_app_msg_t));
+                /* get up to one chunk from the FIFO, possibly split in two spans at the wrap point */
+                chunk_size = audio_fifo_read_spans(&s_i2s_fifo, spans, chunk_bytes);
+                BT_APP_TRACE_BEGIN(TRACE_I2S_CHUNK, chunk_size);
+                if (chunk_size == 0)
+                {
+                    /* keep playing through the gap with synthesized audio, the DMA buffer paces us */
+                    if (!in_gap)
+                    {
+                        in_gap = true;
+                        BT_APP_TRACE_INSTANT(TRACE_UNDERFLOW, 0);
+                        atomic_fetch_add(&s_i2s_underflow_cnt, 1);
+                        BT_APP_STATS_INC(STATS_CNT_UNDERFLOWS);
+                    }
+                    cycles = BT_APP_STATS_CYCLES();
+                    frames = plc_conceal(&s_plc, s_pcm_buf, chunk_bytes / frame_size);
+                    BT_APP_STATS_RECORD(STATS_HIST_CYC_PLC, BT_APP_STATS_CYCLES() - cycles);
+                    if (frames == 0)
+                    {
+                        BT_APP_STATS_INC(STATS_CNT_REBUFFERS);
+                        BT_APP_LOG(BLOG_FIFO_UNDERFLOW);
+                        BT_APP_TRACE_INSTANT(TRACE_UNDERFLOW, 1);
+                        BT_APP_TRACE_END(TRACE_I2S_CHUNK, 0);
+                        s_ringbuffer_mode = PREFETCHING;
+                        BT_APP_TRACE_INSTANT(TRACE_MODE, PREFETCHING);
+                        asrc_reset(&s_asrc);
+                        in_gap = false;
+                        /* nothing is left to play, stop the DMA until prefetching completes so the clock can drop */
+                        output_pause();
+                        break;
+                    }
+                }
+                else
+                {
+                    in_gap = false;
 
-    msg.sig = BT_APP_SIG_WORK_DISPATCH;
-    msg.event = event;
-    msg.cb = p_cback;
+                    /* steer the resampling ratio so that the FIFO stays centred on the jitter buffer target */
+                    cycles = BT_APP_STATS_CYCLES();
+                    asrc_steer(&s_asrc, audio_fifo_fill(&s_i2s_fifo), jitter_target_bytes(&s_jitter));
+                    frames = asrc_process(&s_asrc, (const int16_t *)spans[0].data, spans[0].len / frame_size,
+                                          s_pcm_buf, frame_cap);
+                    frames += asrc_process(&s_asrc, (const int16_t *)spans[1].data, spans[1].len / frame_size,
+                                           s_pcm_buf + frames * s_asrc.channels, frame_cap - frames);
+                    audio_fifo_consume(&s_i2s_fifo, chunk_size);
+                    BT_APP_STATS_RECORD(STATS_HIST_CYC_ASRC, BT_APP_STATS_CYCLES() - cycles);
 
-    if (param_len == 0)
-    {
-        return bt_app_send_msg(&msg);
-    }
-    else if (p_params && param_len > 0)
-    {
-        if ((msg.param = malloc(param_len)) != NULL)
-        {
-            memcpy(msg.param, p_params, param_len);
-            /* check if caller has provided a copy callback to do the deep copy */
-            if (p_copy_cback)
-            {
-                p_copy_cback(msg.param, p_params, param_len);
-            }
-            return bt_app_send_msg(&msg);
-        }
-    }
+                    /* record the audio for concealment, cross-fading out of a concealed gap if needed */
+                    cycles = BT_APP_STATS_CYCLES();
+                    plc_feed(&s_plc, s_pcm_buf, frames);
+                    BT_APP_STATS_RECORD(STATS_HIST_CYC_PLC, BT_APP_STATS_CYCLES() - cycles);
+                }
 
-    return false;
-}
+                /* room and driver correction, also applied to concealed audio */
+                cycles = BT_APP_STATS_CYCLES();
+                eq_process(&s_eq, s_pcm_buf, frames);
+                BT_APP_STATS_RECORD(STATS_HIST_CYC_EQ, BT_APP_STATS_CYCLES() - cycles);
 
-void bt_app_task_start_up(void)
-{
-    s_bt_app_task_queue = xQueueCreate(10, sizeof(bt_app_msg_t));
-    xTaskCreate(bt_app_task_handler, "BtAppTask", 3072, NULL, 10, &s_bt_app_task_handle);
-}
+                /* apply the volume ahead of quantization, lifting quiet listening into more DAC codes on 8-bit outputs */
+                cycles = BT_APP_STATS_CYCLES();
+                drc_process(&s_drc, s_pcm_buf, frames, volume_get_current());
+                BT_APP_STATS_RECORD(STATS_HIST_CYC_DRC, BT_APP_STATS_CYCLES() - cycles);
 
-void bt_app_task_shut_down(void)
-{
-    if (s_bt_app_task_handle)
-    {
-        vTaskDelete(s_bt_app_task_handle);
-        s_bt_app_task_handle = NULL;
-    }
-    if (s_bt_app_task_queue)
-    {
-        vQueueDelete(s_bt_app_task_queue);
-        s_bt_app_task_queue = NULL;
+                bt_i2s_write_output(backend, frames * s_asrc.channels, &dither_seed);
+                BT_APP_TRACE_END(TRACE_I2S_CHUNK, frames);
+                if (!resumed)
+                {
+                    resumed = true;
+                    bt_app_power_on_output_resumed();
+                }
+            }
+        }
     }
 }
 
 void bt_i2s_task_start_up(void)
 {
+    unsigned int bytes_per_sec = 0;
+
     ESP_LOGI(BT_APP_CORE_TAG, "ringbuffer data empty! mode changed: RINGBUFFER_MODE_PREFETCHING");
     s_ringbuffer_mode = PREFETCHING;
-    if ((s_i2s_write_semaphore = xSemaphoreCreateBinary()) == NULL)
+    /* one timeline per connection */
+    bt_app_trace_start();
+    /* the data path is not running yet, so a pending format is taken over right here */
+    bytes_per_sec = atomic_exchange(&s_jitter_pending_rate, 0);
+    jitter_init(&s_jitter, JITTER_BUF_MIN_BYTES, JITTER_BUF_MAX_BYTES, bytes_per_sec ? bytes_per_sec : s_jitter.bytes_per_sec);
+    atomic_store(&s_jitter_delay_value, jitter_target_us(&s_jitter) / 100);
+    s_i2s_write_semaphore = xSemaphoreCreateBinaryStatic(bt_app_mem_get(MEM_BUF_I2S_SEM_CB));
+    s_i2s_fifo_storage = bt_app_mem_get(MEM_BUF_I2S_FIFO);
+    s_pcm_buf = bt_app_mem_get(MEM_BUF_I2S_PCM);
+    s_out_buf = bt_app_mem_get(MEM_BUF_I2S_OUT);
+    audio_fifo_init(&s_i2s_fifo, s_i2s_fifo_storage, RINGBUF_MAX_BYTES_BUFFER);
+    if (!s_eq_bands_set)
     {
-        ESP_LOGE(BT_APP_CORE_TAG, "%s, Semaphore create failed", __func__);
-        return;
+        bt_i2s_set_eq(s_eq_default_bands, sizeof(s_eq_default_bands) / sizeof(s_eq_default_bands[0]));
     }
-    if ((s_ringbuf_i2s = xRingbufferCreate(RINGBUF_MAX_BYTES_BUFFER, RINGBUF_TYPE_BYTEBUF)) == NULL)
-    {
-        ESP_LOGE(BT_APP_CORE_TAG, "%s, ringbuffer create failed", __func__);
-        return;
-    }
-    xTaskCreate(bt_i2s_task_handler, "BtI2STask", 2048, NULL, configMAX_PRIORITIES - 3, &s_bt_i2s_task_handle);
+    s_i2s_last_packet_us = -1;
+    bt_app_stats_reset();
+    bt_app_stats_start(BT_APP_STATS_DUMP_PERIOD_MS);
+    s_bt_i2s_task_handle = bt_app_mem_task_create(MEM_TASK_I2S, bt_i2s_task_handler, configMAX_PRIORITIES - 3,
+                                                  BT_I2S_TASK_CORE);
 }
 
 void bt_i2s_task_shut_down(void)
 {
+    bt_app_stats_stop();
     if (s_bt_i2s_task_handle)
     {
-        vTaskDelete(s_bt_i2s_task_handle);
+        output_release_writer();
+        bt_app_mem_task_delete(MEM_TASK_I2S);
         s_bt_i2s_task_handle = NULL;
+
+        const plc_stats_t *plc_stats = plc_get_stats(&s_plc);
+        ESP_LOGI(BT_APP_CORE_TAG, "concealed %" PRIu32 " gaps (%" PRIu32 " frames, longest %" PRIu32 "), %" PRIu32 " ended in rebuffer",
+                 plc_stats->gaps, plc_stats->concealed_frames, plc_stats->longest_gap_frames, plc_stats->exhausted);
+        ESP_LOGI(BT_APP_CORE_TAG, "limiter set the gain of %" PRIu32 " blocks", s_drc.limited_blocks);
     }
-    if (s_ringbuf_i2s)
-    {
-        vRingbufferDelete(s_ringbuf_i2s);
-        s_ringbuf_i2s = NULL;
-    }
+    /* the data callback checks the storage to know whether a stream is set up */
+    s_i2s_fifo_storage = NULL;
     if (s_i2s_write_semaphore)
     {
         vSemaphoreDelete(s_i2s_write_semaphore);
@@ -185,44 +271,123 @@ void bt_i2s_task_shut_down(void)
     }
 }
 
+void bt_i2s_set_stream_format(int sample_rate, int ch_count)
+{
+    s_i2s_ch_count = (uint8_t)ch_count;
+    s_i2s_sample_rate = (uint32_t)sample_rate;
+    /* the jitter buffer belongs to the data path, which applies the new rate before its next packet */
+    atomic_store(&s_jitter_pending_rate, (unsigned int)(sample_rate * ch_count * sizeof(int16_t)));
+}
+
+bool bt_i2s_set_eq(const eq_band_t *bands, size_t num)
+{
+    s_eq_bands_set = true;
+    return eq_set_bands(&s_eq, bands, num);
+}
+
+const plc_stats_t *bt_i2s_get_plc_stats(void)
+{
+    return plc_get_stats(&s_plc);
+}
+
+uint16_t bt_i2s_get_delay_value(void)
+{
+    return (uint16_t)atomic_load(&s_jitter_delay_value);
+}
+
+audio_fifo_t *bt_i2s_get_fifo(void)
+{
+    return &s_i2s_fifo;
+}
+
 size_t write_ringbuf(const uint8_t *data, size_t size)
 {
-    size_t item_size = 0;
-    BaseType_t done = pdFALSE;
+    bool done = false;
+    unsigned int underflows = 0;
+    unsigned int bytes_per_sec = 0;
+    int64_t now_us = 0;
+
+    if (s_i2s_fifo_storage == NULL)
+    {
+        return 0;
+    }
+    BT_APP_TRACE_BEGIN(TRACE_WRITE_RINGBUF, size);
+
+    /* adapt the target depth to a new stream format, the arrival jitter and underflows of the I2S task */
+    if ((bytes_per_sec = atomic_exchange(&s_jitter_pending_rate, 0)) != 0)
+    {
+        jitter_set_rate(&s_jitter, bytes_per_sec);
+    }
+    underflows = atomic_load(&s_i2s_underflow_cnt);
+    if (underflows != s_i2s_underflow_seen)
+    {
+        s_i2s_underflow_seen = underflows;
+        jitter_on_underflow(&s_jitter);
+    }
+    now_us = esp_timer_get_time();
+    BT_APP_STATS_INC(STATS_CNT_PACKETS);
+    BT_APP_STATS_ADD(STATS_CNT_BYTES, size);
+    if (s_i2s_last_packet_us >= 0)
+    {
+        BT_APP_STATS_RECORD(STATS_HIST_ARRIVAL_US, (uint32_t)(now_us - s_i2s_last_packet_us));
+    }
+    s_i2s_last_packet_us = now_us;
+    if (jitter_on_packet(&s_jitter, now_us, size))
+    {
+        jitter_mark_reported(&s_jitter);
+        atomic_store(&s_jitter_delay_value, jitter_target_us(&s_jitter) / 100);
+        bt_app_work_dispatch_coalesced(bt_av_hdl_delay_report, 0, NULL, 0, BT_APP_COALESCE_KEY_DELAY_REPORT);
+    }
 
     if (s_ringbuffer_mode == DROPPING)
     {
-        ESP_LOGW(BT_APP_CORE_TAG, "ringbuffer is full, drop this packet!");
-        vRingbufferGetInfo(s_ringbuf_i2s, NULL, NULL, NULL, NULL, &item_size);
-        if (item_size <= RINGBUF_PREFETCH_START)
+        /* resume once this packet and the next one fit, draining down to the target would throw away most of the
+         * FIFO; the second packet of room keeps a source slightly faster than the output from overflowing again
+         * with every packet */
+        if (audio_fifo_fill(&s_i2s_fifo) + 2 * size > RINGBUF_MAX_BYTES_BUFFER)
         {
-            ESP_LOGI(BT_APP_CORE_TAG, "ringbuffer data decreased! mode changed: RINGBUFFER_MODE_PROCESSING");
-            s_ringbuffer_mode = PROCESSING;
+            /* counted rather than logged, an overflow storm would otherwise flood the log from the audio path */
+            BT_APP_STATS_INC(STATS_CNT_DROPS);
+            BT_APP_TRACE_END(TRACE_WRITE_RINGBUF, 0);
+            return 0;
         }
-        return 0;
+        BT_APP_LOG(BLOG_FIFO_DRAINED, audio_fifo_fill(&s_i2s_fifo));
+        s_ringbuffer_mode = PROCESSING;
+        BT_APP_TRACE_INSTANT(TRACE_MODE, PROCESSING);
     }
 
-    done = xRingbufferSend(s_ringbuf_i2s, (void *)data, size, (TickType_t)0);
-
-    if (!done)
+    /* copy the packet straight into the FIFO storage, no lock is taken */
+    done = audio_fifo_write(&s_i2s_fifo, data, size);
+    if (done && s_bt_i2s_task_handle && atomic_load(&s_i2s_waiting))
     {
-        ESP_LOGW(BT_APP_CORE_TAG, "ringbuffer overflowed, ready to decrease data! mode changed: RINGBUFFER_MODE_DROPPING");
+        xTaskNotifyGive(s_bt_i2s_task_handle);
+    }
+    else if (!done)
+    {
+        BT_APP_STATS_INC(STATS_CNT_DROPS);
+        BT_APP_STATS_INC(STATS_CNT_OVERFLOWS);
+        BT_APP_LOG(BLOG_FIFO_OVERFLOW, audio_fifo_fill(&s_i2s_fifo));
         s_ringbuffer_mode = DROPPING;
+        BT_APP_TRACE_INSTANT(TRACE_MODE, DROPPING);
     }
 
+    BT_APP_STATS_RECORD(STATS_HIST_FIFO_FILL, (uint32_t)audio_fifo_fill(&s_i2s_fifo));
+    BT_APP_TRACE_COUNTER(TRACE_FIFO_FILL, audio_fifo_fill(&s_i2s_fifo));
+
     if (s_ringbuffer_mode == PREFETCHING)
     {
-        vRingbufferGetInfo(s_ringbuf_i2s, NULL, NULL, NULL, NULL, &item_size);
-        if (item_size >= RINGBUF_PREFETCH_START)
+        if (audio_fifo_fill(&s_i2s_fifo) >= jitter_target_bytes(&s_jitter))
         {
-            ESP_LOGI(BT_APP_CORE_TAG, "ringbuffer data increased! mode changed: RINGBUFFER_MODE_PROCESSING");
+            BT_APP_LOG(BLOG_FIFO_PREFETCHED, audio_fifo_fill(&s_i2s_fifo));
             s_ringbuffer_mode = PROCESSING;
+            BT_APP_TRACE_INSTANT(TRACE_MODE, PROCESSING);
             if (pdFALSE == xSemaphoreGive(s_i2s_write_semaphore))
             {
-                ESP_LOGE(BT_APP_CORE_TAG, "semphore give failed");
+                BT_APP_LOG(BLOG_SEM_GIVE_FAILED);
             }
         }
     }
 
+    BT_APP_TRACE_END(TRACE_WRITE_RINGBUF, done ? size : 0);
     return done ? size : 0;
 }
\ No newline at end of file
@@ -4,29 +4,109 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stddef.h>
+#include <inttypes.h>
 #include <stdint.h>
 #include <string.h>
 #include <stdbool.h>
 
-#include "freertos/xtensa_api.h"
-#include "freertos/FreeRTOSConfig.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
 #include "freertos/semphr.h"
 #include "freertos/task.h"
-#include "freertos/ringbuf.h"
 
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_gap_bt_api.h"
 
-#include "driver/dac_continuous.h"
+#include "bt_app_output.h"
+#include "bt_app_pool.h"
+#include "bt_app_fifo.h"
+#include "bt_app_jitter.h"
+#include "bt_app_log.h"
+#include "bt_app_asrc.h"
+#include "bt_app_plc.h"
+#include "bt_app_eq.h"
+#include "bt_app_drc.h"
+#include "bt_app_peer.h"
+#include "bt_app_power.h"
+#include "bt_app_stats.h"
+#include "bt_app_trace.h"
 
-#define RINGBUF_MAX_BYTES_BUFFER (32 * 1024)
-#define RINGBUF_PREFETCH_START (20 * 1024)
+#define RINGBUF_MAX_BYTES_BUFFER (32 * 1024) /* must be a power of two */
+
+/* bounds of the adaptive prefetch target, about 23 ms and 139 ms at 44.1 kHz stereo */
+#define JITTER_BUF_MIN_BYTES (4 * 1024)
+#define JITTER_BUF_MAX_BYTES (24 * 1024)
+
+/**
+ * Largest chunk of 16-bit PCM read from the FIFO at once. The chunk actually used follows the
+ * chunk_samples of the output backend, e.g. one DMA descriptor of 16-bit slots for the internal DAC.
+ */
+#define I2S_WRITE_CHUNK_BYTES (OUTPUT_MAX_CHUNK_SAMPLES * sizeof(int16_t))
+/* the resampler may emit a few more frames than it consumes */
+#define I2S_RESAMPLED_MAX_SAMPLES (I2S_WRITE_CHUNK_BYTES / sizeof(int16_t) + 16)
 
 #define BT_APP_CORE_TAG "BT_APP_CORE"
 
+/* ingest and control stay on the core of the Bluetooth stack, DSP and DAC feeding run on the other one */
+#if CONFIG_FREERTOS_UNICORE
+#define BT_APP_TASK_CORE (0)
+#define BT_I2S_TASK_CORE (0)
+#else
+#define BT_APP_TASK_CORE (CONFIG_BT_BLUEDROID_PINNED_TO_CORE)
+#define BT_I2S_TASK_CORE (1 - CONFIG_BT_BLUEDROID_PINNED_TO_CORE)
+#endif
+/* stack sizes in bytes, their use is reported by bt_app_mem_report; the I2S task defers its own logs, but
+ * output_write still prints on a format change and the first sample, so it needs room for printf */
+#define BT_APP_TASK_STACK (3072)
+#define BT_I2S_TASK_STACK (3072)
+
+/* depth of the work queue of each priority */
+#define BT_APP_QUEUE_LEN_HIGH (8)
+#define BT_APP_QUEUE_LEN_NORMAL (10)
+#define BT_APP_QUEUE_LEN_LOW (6)
+#define BT_APP_QUEUE_LEN_TOTAL (BT_APP_QUEUE_LEN_HIGH + BT_APP_QUEUE_LEN_NORMAL + BT_APP_QUEUE_LEN_LOW)
+
+/* share of the real time of one chunk that each DSP stage may spend, in percent of the CPU clock */
+#define BT_I2S_BUDGET_ASRC_PCT (25)
+#define BT_I2S_BUDGET_PLC_PCT (10)
+#define BT_I2S_BUDGET_EQ_PCT (20)
+#define BT_I2S_BUDGET_DRC_PCT (15)
+#define BT_I2S_BUDGET_PCM_PCT (10)
+
 /* signal for `bt_app_work_dispatch` */
 #define BT_APP_SIG_WORK_DISPATCH (0x01)
+/* signal for `bt_app_work_dispatch_coalesced`, the event field holds the slot index */
+#define BT_APP_SIG_COALESCED (0x02)
+
+/* number of distinct keys that can be coalesced at the same time */
+#define BT_APP_COALESCE_SLOTS (4)
+
+/* coalescing keys, 0 is reserved */
+#define BT_APP_COALESCE_KEY_DELAY_REPORT (1)
+#define BT_APP_COALESCE_KEY_PLAY_POS (2)
+
+/* priorities of the work queues, lower value is handled first */
+typedef enum
+{
+    BT_APP_PRIO_HIGH,   /*!< connection and codec configuration events */
+    BT_APP_PRIO_NORMAL, /*!< everything else */
+    BT_APP_PRIO_LOW,    /*!< chatty notifications, usually coalesced */
+    BT_APP_PRIO_NUM,
+} bt_app_prio_t;
+
+/* statistics of one work queue */
+typedef struct
+{
+    uint32_t posted;           /*!< messages accepted by the queue */
+    uint32_t dropped;          /*!< messages dropped because the queue was full */
+    uint32_t coalesced;        /*!< messages merged into one already queued */
+    uint32_t max_depth;        /*!< highest number of messages waiting */
+    uint32_t handled;          /*!< messages dispatched by the task */
+    uint32_t max_latency_us;   /*!< longest time from post to dispatch */
+    uint64_t total_latency_us; /*!< sum of the time from post to dispatch */
+} bt_app_queue_stats_t;
 
 /**
  * @brief Typedef for a callback function used in the Bluetooth application.
@@ -45,7 +125,8 @@ typedef void (*bt_app_cb_t)(uint16_t event, void *param);
  *
  * This is a function pointer type that points to a function taking a destination pointer, a source pointer,
  * and a length, and returning void. This type is used to define the callback functions that handle copying
- * data in the application.
+ * data in the application. The destination is a pool block of BT_APP_POOL_BLOCK_SIZE bytes, so a deep copy
+ * may place referenced data in the bytes following the first `len`.
  *
  * @param p_dest Pointer to the destination where the data should be copied.
  * @param p_src Pointer to the source from where the data should be copied.
@@ -61,31 +142,39 @@ typedef enum
     DROPPING     /*!< ringbuffer is not buffering (dropping) incoming audio data, I2S is working */
 } Ringbuffer_mode;
 
+/* parameters up to this size travel inside the message itself */
+#define BT_APP_MSG_INLINE_SIZE (32)
+
 /* message to be sent */
 typedef struct
 {
-    uint16_t sig;   /*!< signal to bt_app_task */
-    uint16_t event; /*!< message event id */
-    bt_app_cb_t cb; /*!< context switch callback */
-    void *param;    /*!< parameter area needs to be last */
+    uint16_t sig;                         /*!< signal to bt_app_task */
+    uint16_t event;                       /*!< message event id */
+    bt_app_cb_t cb;                       /*!< context switch callback */
+    void *param;                          /*!< pool block holding the parameter, NULL if inline or none */
+    uint16_t param_len;                   /*!< length of the parameter, 0 if none */
+    uint32_t post_us;                     /*!< time the message was posted, for latency statistics */
+    uint8_t data[BT_APP_MSG_INLINE_SIZE]; /*!< inline parameter area needs to be last */
 } bt_app_msg_t;
 
 /**
  * @brief Sends a message to the Bluetooth application task queue.
  *
- * This function sends a message to the task queue of the Bluetooth application.
- * If the message is NULL or the queue is full, it logs an error and returns false.
+ * This function sends a message to the task queue of the given priority and wakes the Bluetooth application task.
+ * It never blocks, so it is safe to call from Bluedroid callbacks. If the message is NULL or the queue is full,
+ * it logs an error, counts the drop and returns false.
  *
  * @param msg Pointer to the message to be sent. This should point to a variable of type bt_app_msg_t.
+ * @param prio The priority of the queue to post to.
  * @return Returns true if the message was successfully sent to the queue, false otherwise.
  */
-bool bt_app_send_msg(bt_app_msg_t *msg);
+bool bt_app_send_msg(bt_app_msg_t *msg, bt_app_prio_t prio);
 
 /**
  * @brief Dispatches a message to its associated callback function.
  *
  * This function takes a message and, if the message has an associated callback function,
- * it calls that function with the event and parameter stored in the message.
+ * it calls that function with the event and parameter stored in the message, either inline or in a pool block.
  *
  * @param msg Pointer to the message to be dispatched. This should point to a variable of type bt_app_msg_t.
  */
@@ -94,9 +183,10 @@ void bt_app_work_dispatched(bt_app_msg_t *msg);
 /**
  * @brief Handles the Bluetooth application task.
  *
- * This function runs an infinite loop that continuously receives messages from the task queue
- * and dispatches them to their associated callback functions. If a message has an associated
- * parameter, it is freed after the message is handled.
+ * This function runs an infinite loop that waits for a notification and then drains the task queues,
+ * always taking the next message from the highest priority queue that is not empty, and dispatches the
+ * messages to their associated callback functions. Dispatch latency is recorded per priority. If a message carries its parameter
+ * in a pool block, the block is returned to the pool after the message is handled.
  *
  * @param arg Pointer to the argument for the task. This is not used in the function and can be NULL.
  */
@@ -106,9 +196,12 @@ void bt_app_task_handler(void *arg);
  * @brief Handles the I2S task.
  *
  * This function runs an infinite loop that continuously checks if a semaphore is available.
- * If the semaphore is available, it receives data from a ring buffer and writes it to the I2S DMA transmit buffer.
- * If the ring buffer underflows, it changes the ring buffer mode to PREFETCHING and breaks the loop.
- * After writing the data, it returns the item back to the ring buffer.
+ * If the semaphore is available, it reads up to one chunk of the output backend from the FIFO as one or two spans,
+ * resamples them with a ratio steered by the FIFO fill level to compensate clock drift between source and output,
+ * converts the result into the sample format of the backend and writes it to the output. When the FIFO is empty it waits
+ * for a notification from write_ringbuf, but no longer than output_get_headroom_us; if nothing arrives, it conceals the gap with
+ * synthesized audio for up to PLC_MAX_CONCEAL_MS. Only if the gap lasts longer does it change the ring buffer
+ * mode to PREFETCHING and break the loop.
  *
  * @param arg Pointer to the argument for the task. This is not used in the function and can be NULL.
  */
@@ -118,8 +211,10 @@ void bt_i2s_task_handler(void *arg);
  * @brief Dispatches a work event to the Bluetooth application task.
  *
  * This function creates a message with the given event and callback function, and optionally a parameter.
- * If a parameter is provided and a copy callback function is also provided, the copy callback function
- * is used to copy the parameter data. The message is then sent to the Bluetooth application task queue.
+ * Parameters of up to BT_APP_MSG_INLINE_SIZE bytes are copied into the message itself. Larger parameters, and
+ * any parameter with a copy callback function, are copied into a block of the static slab pool, and the copy
+ * callback function is then used to do the deep copy. The heap is never used. The message is then sent to the
+ * Bluetooth application task queue.
  *
  * @param p_cback The callback function to be associated with the event.
  * @param event The event to be dispatched.
@@ -130,19 +225,68 @@ void bt_i2s_task_handler(void *arg);
  */
 bool bt_app_work_dispatch(bt_app_cb_t p_cback, uint16_t event, void *p_params, int param_len, bt_app_copy_cb_t p_copy_cback);
 
+/**
+ * @brief Dispatches a work event to the Bluetooth application task with a given priority.
+ *
+ * This function behaves like bt_app_work_dispatch, but posts to the queue of the given priority.
+ *
+ * @param p_cback The callback function to be associated with the event.
+ * @param event The event to be dispatched.
+ * @param p_params Pointer to the parameter data to be associated with the event. This can be NULL if no parameter data is needed.
+ * @param param_len The length of the parameter data in bytes. This should be 0 if no parameter data is provided.
+ * @param p_copy_cback The copy callback function to be used to copy the parameter data. This can be NULL if no deep copy is needed.
+ * @param prio The priority of the event.
+ * @return Returns true if the message was successfully sent to the queue, false otherwise.
+ */
+bool bt_app_work_dispatch_prio(bt_app_cb_t p_cback, uint16_t event, void *p_params, int param_len, bt_app_copy_cb_t p_copy_cback,
+                               bt_app_prio_t prio);
+
+/**
+ * @brief Dispatches a low priority work event that replaces any queued event with the same key.
+ *
+ * If an event with the same key is still waiting, only its callback, event and parameter are refreshed, so the
+ * task handles the latest value once. Otherwise the event is stored in a coalescing slot and a marker is posted
+ * to the low priority queue. The parameter must fit inline and cannot be deep-copied.
+ *
+ * @param p_cback The callback function to be associated with the event.
+ * @param event The event to be dispatched.
+ * @param p_params Pointer to the parameter data. This can be NULL if no parameter data is needed.
+ * @param param_len The length of the parameter data in bytes, at most BT_APP_MSG_INLINE_SIZE.
+ * @param key The coalescing key, one of BT_APP_COALESCE_KEY_*.
+ * @return Returns true if the event was queued or merged, false otherwise.
+ */
+bool bt_app_work_dispatch_coalesced(bt_app_cb_t p_cback, uint16_t event, void *p_params, int param_len, uint32_t key);
+
+/**
+ * @brief Copies the statistics of one work queue.
+ *
+ * @param prio The priority of the queue.
+ * @param stats Pointer to the structure that receives the statistics.
+ */
+void bt_app_work_get_stats(bt_app_prio_t prio, bt_app_queue_stats_t *stats);
+
+/**
+ * @brief Logs the statistics of the work queues.
+ *
+ * For every priority it logs the number of posted, dropped and coalesced messages, the maximum queue depth,
+ * and the average and maximum latency from post to dispatch.
+ */
+void bt_app_work_report_stats(void);
+
 /**
  * @brief Starts up the Bluetooth application task.
  *
- * This function creates a queue for Bluetooth application messages and starts the Bluetooth application task.
- * The task runs the bt_app_task_handler function in a new task named "BtAppTask".
+ * This function creates one queue per priority for Bluetooth application messages and starts the Bluetooth application task.
+ * The task runs the bt_app_task_handler function in a new task named "BtAppTask", pinned to BT_APP_TASK_CORE. The queues
+ * and the task live in the static memory of bt_app_mem.
  */
 void bt_app_task_start_up(void);
 
 /**
  * @brief Shuts down the Bluetooth application task.
  *
- * This function deletes the Bluetooth application task and its associated queue if they exist.
- * After deletion, the task handle and queue handle are set to NULL.
+ * This function deletes the Bluetooth application task and its associated queues if they exist.
+ * After deletion, the task handle and queue handles are set to NULL.
  */
 void bt_app_task_shut_down(void);
 
@@ -150,28 +294,83 @@ void bt_app_task_shut_down(void);
  * @brief Starts up the I2S task.
  *
  * This function sets the ring buffer mode to PREFETCHING, creates a binary semaphore for I2S writing,
- * creates a ring buffer for I2S data, and starts the I2S task. The task runs the bt_i2s_task_handler
- * function in a new task named "BtI2STask". If the semaphore or ring buffer creation fails, it logs an error and returns.
+ * empties the lock-free I2S FIFO, and starts the I2S task. The task runs the bt_i2s_task_handler
+ * function in a new task named "BtI2STask", pinned to BT_I2S_TASK_CORE so the FIFO hands data over from the
+ * Bluetooth core and the cycle counts of its stages come from one core. The semaphore, the FIFO and the task live in
+ * the static memory of bt_app_mem, so nothing is taken from the heap on a reconnection.
  */
 void bt_i2s_task_start_up(void);
 
 /**
  * @brief Shuts down the task.
  *
- * This function deletes the I2S task, its associated ring buffer, and semaphore if they exist.
- * After deletion, the task handle, ring buffer, and semaphore are set to NULL.
+ * This function deletes the I2S task, detaches the FIFO storage, and deletes the semaphore if they exist.
+ * After deletion, the task handle, FIFO storage, and semaphore are set to NULL. Their static memory is reused by the
+ * next bt_i2s_task_start_up.
  */
 void bt_i2s_task_shut_down(void);
 
 /**
- * @brief Writes data to the ring buffer.
+ * @brief Sets the PCM format of the incoming stream.
+ *
+ * This function is called when the audio codec is configured. It updates the channel count of the resampler and
+ * hands the byte rate, used by the adaptive jitter buffer to convert between buffered bytes and latency, to the data
+ * path through an atomic, since the jitter buffer is only updated by write_ringbuf while a stream runs. The A2DP sink always delivers
+ * 16-bit samples.
+ *
+ * @param sample_rate The sample rate in Hz.
+ * @param ch_count The number of channels.
+ */
+void bt_i2s_set_stream_format(int sample_rate, int ch_count);
+
+/**
+ * @brief Sets the bands of the output equalizer. Safe to call from any task.
+ *
+ * The new bands are designed by the I2S task and cross-faded in over one chunk. They are redesigned
+ * automatically when the sample rate changes. By default a high-pass at 80 Hz protects small drivers.
+ *
+ * @param bands The bands, NULL or empty for a flat response.
+ * @param num The number of bands, at most EQ_MAX_BANDS.
+ * @return Returns true if the bands were accepted.
+ */
+bool bt_i2s_set_eq(const eq_band_t *bands, size_t num);
+
+/**
+ * @brief Gets the counters of the packet-loss concealment stage.
+ *
+ * @return Pointer to the counters of the current connection.
+ */
+const plc_stats_t *bt_i2s_get_plc_stats(void);
+
+/**
+ * @brief Gets the latency added by the jitter buffer.
+ *
+ * @return The latency of the prefetch target last reported by the data path, in 1/10 ms as used by A2DP delay reporting.
+ */
+uint16_t bt_i2s_get_delay_value(void);
+
+/**
+ * @brief Gets the FIFO between the A2DP data callback and the I2S task.
+ *
+ * The I2S task is its only reader, any other task may only look at its fill; a test harness that reads it in place
+ * of the I2S task has to stop that task first.
+ *
+ * @return The FIFO, valid between bt_i2s_task_start_up and bt_i2s_task_shut_down.
+ */
+audio_fifo_t *bt_i2s_get_fifo(void);
+
+/**
+ * @brief Writes data to the I2S FIFO.
  *
- * This function writes a given amount of data to the ring buffer. If the ring buffer is in DROPPING mode,
- * it drops the packet and checks if the ring buffer data has decreased enough to switch back to PROCESSING mode.
- * If the ring buffer is in PREFETCHING mode, it checks if the ring buffer data has increased enough to switch to PROCESSING mode.
- * If the ring buffer overflows, it switches to DROPPING mode.
+ * This function writes a given amount of data to the lock-free FIFO. The packet is copied exactly once, straight
+ * into the FIFO storage, and the I2S task is notified. Every packet arrival also updates the adaptive jitter buffer,
+ * whose target depth replaces a fixed prefetch threshold; when the target moves far enough, the new latency is
+ * reported to the source. If the ring buffer is in DROPPING mode, it drops packets until the FIFO has room for two of
+ * them, then switches back to PROCESSING mode and writes the packet. If the ring buffer is in PREFETCHING mode, it
+ * checks if the data has reached the target to switch to PROCESSING mode. If the ring buffer overflows, it switches
+ * to DROPPING mode.
  *
- * @param data Pointer to the data to be written to the ring buffer.
+ * @param data Pointer to the data to be written to the FIFO.
  * @param size The size of the data in bytes.
  * @return Returns the size of the data written if the write was successful, 0 otherwise.
  */
@@ -192,11 +391,11 @@ void bt_app_gap_cb(esp_bt_gap_cb_event_t event, esp_bt_gap_cb_param_t *param);
 /**
  * @brief Handles the Bluetooth stack events.
  *
- * This function is called when a Bluetooth stack event occurs. It handles various events such as stack initialization.
- * For the stack initialization event, it sets the device name, registers callbacks for GAP, AVRCP Controller, AVRCP Target,
- * and A2DP, initializes AVRCP Controller and Target, sets the event capabilities for AVRCP Target, initializes A2DP sink,
- * gets the default delay value for A2DP sink, and sets the device to be discoverable and connectable. If an invalid event
- * is received, it logs an error message.
+ * This function is called when a Bluetooth stack event occurs. The stack up event does only what is needed to be
+ * found: it sets the device name, registers callbacks for GAP, AVRCP Controller, AVRCP Target and A2DP, initializes
+ * AVRCP Controller and Target and the A2DP sink, and sets the device to be discoverable and connectable. It then posts
+ * the deferred event on the LOW queue, which sets the event capabilities for AVRCP Target, gets the default delay value
+ * for A2DP sink and starts paging the remembered sources. If an invalid event is received, it logs an error message.
  *
  * @param event The Bluetooth stack event type.
  * @param p_param The event parameter, which is not used in this function.
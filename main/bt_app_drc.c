@@ -0,0 +1,124 @@
+#include <math.h>
+#include <string.h>
+
+#include "bt_app_drc.h"
+
+/* same linear volume curve as the 8-bit conversion, 127 maps to unity */
+#define DRC_VOLUME_SCALE (258.0f / 32768.0f)
+
+void drc_init(drc_t *drc, uint8_t channels, uint32_t sample_rate, float max_makeup_db)
+{
+    memset(drc, 0, sizeof(*drc));
+    drc->channels = channels;
+    drc->max_makeup_db = max_makeup_db;
+    drc->release_coef = 1.0f - expf(-(float)DRC_BLOCK_FRAMES * 1000.0f / ((float)sample_rate * DRC_RELEASE_MS));
+}
+
+float drc_compute_gain(int32_t peak, uint8_t volume, float max_makeup_db, bool *limited)
+{
+    float vol = volume * DRC_VOLUME_SCALE;
+    float makeup_db = 0;
+    float level_db = 0;
+    float gain_db = 0;
+    float over_db = 0;
+
+    if (limited)
+    {
+        *limited = false;
+    }
+    if (volume == 0)
+    {
+        return 0.0f;
+    }
+
+    /* the quieter the volume, the more the signal is lifted towards full scale */
+    makeup_db = -20.0f * log10f(vol) * DRC_MAKEUP_PER_DB;
+    if (makeup_db > max_makeup_db)
+    {
+        makeup_db = max_makeup_db;
+    }
+    else if (makeup_db < 0)
+    {
+        makeup_db = 0;
+    }
+    if (peak == 0)
+    {
+        return vol * powf(10.0f, makeup_db / 20.0f);
+    }
+
+    /* compress what the make-up gain pushed above the threshold, but never below the plain volume */
+    level_db = 20.0f * log10f((float)peak / 32768.0f * vol);
+    gain_db = makeup_db;
+    over_db = level_db + makeup_db - DRC_THRESHOLD_DB;
+    if (over_db > 0)
+    {
+        gain_db -= fminf(over_db * (1.0f - 1.0f / DRC_RATIO), makeup_db);
+    }
+
+    /* hard limit of the peak */
+    if (level_db + gain_db > DRC_CEILING_DB)
+    {
+        gain_db = DRC_CEILING_DB - level_db;
+        if (limited)
+        {
+            *limited = true;
+        }
+    }
+    return vol * powf(10.0f, gain_db / 20.0f);
+}
+
+static inline int32_t drc_to_q(float gain)
+{
+    return (int32_t)(gain * (float)(1 << DRC_GAIN_SHIFT));
+}
+
+void drc_process(drc_t *drc, int16_t *pcm, size_t frames, uint8_t volume)
+{
+    uint8_t ch = drc->channels;
+
+    for (size_t f = 0; f < frames; f++)
+    {
+        int16_t *frame = pcm + f * ch;
+        int16_t *slot = drc->delay + drc->delay_pos * ch;
+
+        for (uint8_t c = 0; c < ch; c++)
+        {
+            int32_t x = frame[c];
+            int32_t ax = x < 0 ? -x : x;
+            int64_t y = ((int64_t)slot[c] * drc->gain_q + (1 << (DRC_GAIN_SHIFT - 1))) >> DRC_GAIN_SHIFT;
+
+            if (ax > drc->block_peak)
+            {
+                drc->block_peak = ax;
+            }
+            slot[c] = (int16_t)x;
+            frame[c] = (int16_t)(y > INT16_MAX ? INT16_MAX : (y < INT16_MIN ? INT16_MIN : y));
+        }
+        drc->gain_q += drc->gain_step;
+        if (++drc->delay_pos == DRC_DELAY_FRAMES)
+        {
+            drc->delay_pos = 0;
+        }
+
+        if (++drc->block_pos == DRC_BLOCK_FRAMES)
+        {
+            /* the next ramp scales the block before the one just collected, so its target covers both */
+            int32_t peak = drc->block_peak > drc->prev_peak ? drc->block_peak : drc->prev_peak;
+            bool limited = false;
+            float target = drc_compute_gain(peak, volume, drc->max_makeup_db, &limited);
+
+            /* reductions are taken at once, the look-ahead hides them, recoveries are smoothed */
+            if (target > drc->gain)
+            {
+                target = drc->gain + (target - drc->gain) * drc->release_coef;
+            }
+            drc->gain_q = drc_to_q(drc->gain);
+            drc->gain_step = (drc_to_q(target) - drc->gain_q) / DRC_BLOCK_FRAMES;
+            drc->gain = target;
+            drc->limited_blocks += limited;
+            drc->prev_peak = drc->block_peak;
+            drc->block_peak = 0;
+            drc->block_pos = 0;
+        }
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef __BT_APP_DRC_H__
+#define __BT_APP_DRC_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define DRC_MAX_CHANNELS (2)
+/* frames between two gain updates, the gain is ramped linearly in between */
+#define DRC_BLOCK_FRAMES (32)
+/* look-ahead delay, two blocks so that both ends of every gain ramp already cover the samples it scales */
+#define DRC_DELAY_FRAMES (2 * DRC_BLOCK_FRAMES)
+/* compressor threshold and ratio, applied to the level after volume and make-up gain */
+#define DRC_THRESHOLD_DB (-18.0f)
+#define DRC_RATIO (3.0f)
+/* make-up gain added per dB of volume attenuation, and its limit for 8-bit outputs */
+#define DRC_MAKEUP_PER_DB (0.5f)
+#define DRC_MAX_MAKEUP_DB (18.0f)
+/* limiter ceiling, no output sample goes above it */
+#define DRC_CEILING_DB (-0.5f)
+/* time for the gain to recover towards its target after a reduction */
+#define DRC_RELEASE_MS (150)
+/* gains are Q16 */
+#define DRC_GAIN_SHIFT (16)
+
+/**
+ * @brief Look-ahead compressor and limiter that also applies the volume.
+ *
+ * The AVRCP volume is folded into the gain before the conversion to the output format. On 8-bit outputs, as the
+ * volume goes down, make-up gain lifts the signal and the compressor squeezes its dynamics, so quiet listening
+ * still uses a useful part of the DAC codes instead of the bottom few; finer outputs get the plain volume. A peak
+ * limiter on the same gain keeps the result below DRC_CEILING_DB. The gain is computed once per DRC_BLOCK_FRAMES
+ * from the peak of the coming audio and ramped per sample, and the audio is delayed by DRC_DELAY_FRAMES so a
+ * reduction is in place before the peak that caused it.
+ */
+typedef struct
+{
+    uint8_t channels;                                      /*!< number of interleaved channels */
+    float release_coef;                                    /*!< share of the distance to the target recovered per block */
+    float max_makeup_db;                                   /*!< limit of the make-up gain, 0 to apply the plain volume */
+    int16_t delay[DRC_DELAY_FRAMES * DRC_MAX_CHANNELS];    /*!< look-ahead delay line */
+    uint32_t delay_pos;                                    /*!< next frame of the delay line */
+    uint32_t block_pos;                                    /*!< frames into the current block */
+    int32_t block_peak;                                    /*!< peak of the block being collected */
+    int32_t prev_peak;                                     /*!< peak of the previous block */
+    float gain;                                            /*!< gain reached at the end of the current ramp */
+    int32_t gain_q;                                        /*!< gain applied to the next sample, Q16 */
+    int32_t gain_step;                                     /*!< per-frame change of gain_q */
+    uint32_t limited_blocks;                               /*!< blocks where the limiter set the gain */
+} drc_t;
+
+/**
+ * @brief Initializes the stage with silence in the delay line.
+ *
+ * @param drc Pointer to the stage.
+ * @param channels The number of interleaved channels, 1 or 2.
+ * @param sample_rate The sample rate in Hz.
+ * @param max_makeup_db The limit of the make-up gain, DRC_MAX_MAKEUP_DB for 8-bit outputs and 0 for finer ones.
+ */
+void drc_init(drc_t *drc, uint8_t channels, uint32_t sample_rate, float max_makeup_db);
+
+/**
+ * @brief Computes the gain for one block, before smoothing.
+ *
+ * @param peak The peak absolute sample value the gain has to cover.
+ * @param volume The volume level, between 0 and 127.
+ * @param max_makeup_db The limit of the make-up gain.
+ * @param limited Set to true if the limiter, not the compressor, decided the gain. May be NULL.
+ * @return The linear gain to apply to the 16-bit samples, volume included.
+ */
+float drc_compute_gain(int32_t peak, uint8_t volume, float max_makeup_db, bool *limited);
+
+/**
+ * @brief Applies volume, compression and limiting to a block of interleaved frames in place.
+ *
+ * The output lags the input by DRC_DELAY_FRAMES.
+ *
+ * @param drc Pointer to the stage.
+ * @param pcm Pointer to the frames.
+ * @param frames The number of frames.
+ * @param volume The volume level, between 0 and 127.
+ */
+void drc_process(drc_t *drc, int16_t *pcm, size_t frames, uint8_t volume);
+
+#endif /* __BT_APP_DRC_H__ */
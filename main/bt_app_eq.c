@@ -0,0 +1,233 @@
+#include <math.h>
+#include <string.h>
+
+#include "bt_app_eq.h"
+
+static bool eq_to_fixed(double v, int32_t *out)
+{
+    double scaled = v * (double)(1 << EQ_COEF_SHIFT);
+
+    if (scaled >= (double)INT32_MAX || scaled <= (double)INT32_MIN)
+    {
+        return false;
+    }
+    *out = (int32_t)lrint(scaled);
+    return true;
+}
+
+bool eq_design(const eq_band_t *band, uint32_t sample_rate, eq_biquad_t *biquad)
+{
+    int gain_db10 = band->gain_db10;
+    double a = 0, w0 = 0, cs = 0, alpha = 0, sq = 0, q = 0;
+    double b0 = 0, b1 = 0, b2 = 0, a0 = 0, a1 = 0, a2 = 0;
+
+    if (band->freq_hz == 0 || band->q100 == 0 || band->freq_hz * 2 >= sample_rate)
+    {
+        return false;
+    }
+    if (gain_db10 > EQ_MAX_GAIN_DB10)
+    {
+        gain_db10 = EQ_MAX_GAIN_DB10;
+    }
+    else if (gain_db10 < -EQ_MAX_GAIN_DB10)
+    {
+        gain_db10 = -EQ_MAX_GAIN_DB10;
+    }
+
+    a = pow(10.0, gain_db10 / 400.0);
+    w0 = 2.0 * M_PI * band->freq_hz / sample_rate;
+    cs = cos(w0);
+    q = band->q100 / 100.0;
+    alpha = sin(w0) / (2.0 * q);
+
+    switch (band->type)
+    {
+    case EQ_PEAKING:
+        b0 = 1.0 + alpha * a;
+        b1 = -2.0 * cs;
+        b2 = 1.0 - alpha * a;
+        a0 = 1.0 + alpha / a;
+        a1 = -2.0 * cs;
+        a2 = 1.0 - alpha / a;
+        break;
+    case EQ_LOW_SHELF:
+        /* for the shelves q100 is the slope S, alpha is derived from it */
+        alpha = sin(w0) / 2.0 * sqrt((a + 1.0 / a) * (1.0 / q - 1.0) + 2.0);
+        sq = 2.0 * sqrt(a) * alpha;
+        b0 = a * ((a + 1.0) - (a - 1.0) * cs + sq);
+        b1 = 2.0 * a * ((a - 1.0) - (a + 1.0) * cs);
+        b2 = a * ((a + 1.0) - (a - 1.0) * cs - sq);
+        a0 = (a + 1.0) + (a - 1.0) * cs + sq;
+        a1 = -2.0 * ((a - 1.0) + (a + 1.0) * cs);
+        a2 = (a + 1.0) + (a - 1.0) * cs - sq;
+        break;
+    case EQ_HIGH_SHELF:
+        alpha = sin(w0) / 2.0 * sqrt((a + 1.0 / a) * (1.0 / q - 1.0) + 2.0);
+        sq = 2.0 * sqrt(a) * alpha;
+        b0 = a * ((a + 1.0) + (a - 1.0) * cs + sq);
+        b1 = -2.0 * a * ((a - 1.0) + (a + 1.0) * cs);
+        b2 = a * ((a + 1.0) + (a - 1.0) * cs - sq);
+        a0 = (a + 1.0) - (a - 1.0) * cs + sq;
+        a1 = 2.0 * ((a - 1.0) - (a + 1.0) * cs);
+        a2 = (a + 1.0) - (a - 1.0) * cs - sq;
+        break;
+    case EQ_LOW_PASS:
+        b0 = (1.0 - cs) / 2.0;
+        b1 = 1.0 - cs;
+        b2 = (1.0 - cs) / 2.0;
+        a0 = 1.0 + alpha;
+        a1 = -2.0 * cs;
+        a2 = 1.0 - alpha;
+        break;
+    case EQ_HIGH_PASS:
+        b0 = (1.0 + cs) / 2.0;
+        b1 = -(1.0 + cs);
+        b2 = (1.0 + cs) / 2.0;
+        a0 = 1.0 + alpha;
+        a1 = -2.0 * cs;
+        a2 = 1.0 - alpha;
+        break;
+    default:
+        return false;
+    }
+
+    return eq_to_fixed(b0 / a0, &biquad->b0) && eq_to_fixed(b1 / a0, &biquad->b1) && eq_to_fixed(b2 / a0, &biquad->b2) &&
+           eq_to_fixed(a1 / a0, &biquad->a1) && eq_to_fixed(a2 / a0, &biquad->a2);
+}
+
+/* designs the requested bands into coefficient set `set`, bands that cannot be realized are skipped */
+static void eq_load(eq_t *eq, uint8_t set)
+{
+    eq_band_t bands[EQ_MAX_BANDS];
+    uint8_t num = 0;
+    uint8_t stages = 0;
+
+    portENTER_CRITICAL_SAFE(&eq->lock);
+    num = eq->num_bands;
+    memcpy(bands, eq->bands, num * sizeof(eq_band_t));
+    eq->applied_seq = atomic_load(&eq->seq);
+    portEXIT_CRITICAL_SAFE(&eq->lock);
+
+    for (uint8_t i = 0; i < num; i++)
+    {
+        if (eq_design(&bands[i], eq->sample_rate, &eq->coefs[set][stages]))
+        {
+            stages++;
+        }
+    }
+    eq->num_stages[set] = stages;
+}
+
+void eq_init(eq_t *eq, uint8_t channels, uint32_t sample_rate)
+{
+    eq->active = 0;
+    eq_set_format(eq, channels, sample_rate);
+}
+
+void eq_set_format(eq_t *eq, uint8_t channels, uint32_t sample_rate)
+{
+    eq->channels = channels;
+    eq->sample_rate = sample_rate;
+    memset(eq->state, 0, sizeof(eq->state));
+    eq_load(eq, eq->active);
+}
+
+bool eq_set_bands(eq_t *eq, const eq_band_t *bands, size_t num)
+{
+    if (num > EQ_MAX_BANDS)
+    {
+        return false;
+    }
+
+    portENTER_CRITICAL_SAFE(&eq->lock);
+    if (num > 0)
+    {
+        memcpy(eq->bands, bands, num * sizeof(eq_band_t));
+    }
+    eq->num_bands = (uint8_t)num;
+    atomic_fetch_add(&eq->seq, 1);
+    portEXIT_CRITICAL_SAFE(&eq->lock);
+    return true;
+}
+
+static inline int32_t eq_biquad_run(const eq_biquad_t *c, eq_state_t *st, int32_t x)
+{
+    int64_t acc = (int64_t)c->b0 * x + (int64_t)c->b1 * st->x1 + (int64_t)c->b2 * st->x2 -
+                  (int64_t)c->a1 * st->y1 - (int64_t)c->a2 * st->y2;
+    int32_t y = (int32_t)((acc + (1 << (EQ_COEF_SHIFT - 1))) >> EQ_COEF_SHIFT);
+
+    st->x2 = st->x1;
+    st->x1 = x;
+    st->y2 = st->y1;
+    st->y1 = y;
+    return y;
+}
+
+static inline int32_t eq_cascade_run(eq_t *eq, uint8_t set, uint8_t ch, int32_t x)
+{
+    for (uint8_t s = 0; s < eq->num_stages[set]; s++)
+    {
+        x = eq_biquad_run(&eq->coefs[set][s], &eq->state[set][s][ch], x);
+    }
+    return x;
+}
+
+static inline int16_t eq_to_s16(int32_t v)
+{
+    v = (v + (1 << (EQ_SIGNAL_SHIFT - 1))) >> EQ_SIGNAL_SHIFT;
+    if (v > INT16_MAX)
+    {
+        return INT16_MAX;
+    }
+    if (v < INT16_MIN)
+    {
+        return INT16_MIN;
+    }
+    return (int16_t)v;
+}
+
+void eq_process(eq_t *eq, int16_t *pcm, size_t frames)
+{
+    uint8_t cur = eq->active;
+    uint8_t next = cur ^ 1;
+    uint8_t ch = eq->channels;
+
+    if (frames == 0)
+    {
+        return;
+    }
+
+    if (atomic_load(&eq->seq) == eq->applied_seq)
+    {
+        if (eq->num_stages[cur] == 0)
+        {
+            return;
+        }
+        for (size_t i = 0; i < frames * ch; i += ch)
+        {
+            for (uint8_t c = 0; c < ch; c++)
+            {
+                pcm[i + c] = eq_to_s16(eq_cascade_run(eq, cur, c, (int32_t)pcm[i + c] * (1 << EQ_SIGNAL_SHIFT)));
+            }
+        }
+        return;
+    }
+
+    /* new bands: start the new cascade from the state of the old one and cross-fade over this block */
+    eq_load(eq, next);
+    memcpy(eq->state[next], eq->state[cur], sizeof(eq->state[next]));
+    for (size_t f = 0; f < frames; f++)
+    {
+        int64_t w = ((int64_t)f << 15) / frames;
+
+        for (uint8_t c = 0; c < ch; c++)
+        {
+            int32_t x = (int32_t)pcm[f * ch + c] * (1 << EQ_SIGNAL_SHIFT);
+            int32_t y_old = eq_cascade_run(eq, cur, c, x);
+            int32_t y_new = eq_cascade_run(eq, next, c, x);
+
+            pcm[f * ch + c] = eq_to_s16((int32_t)((y_old * ((1 << 15) - w) + y_new * w) >> 15));
+        }
+    }
+    eq->active = next;
+}
@@ -0,0 +1,144 @@
+#ifndef __BT_APP_EQ_H__
+#define __BT_APP_EQ_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#include "freertos/FreeRTOS.h"
+
+#define EQ_MAX_CHANNELS (2)
+#define EQ_MAX_BANDS (6)
+/* coefficients are Q28 so that boosts of up to EQ_MAX_GAIN_DB10 fit */
+#define EQ_COEF_SHIFT (28)
+/* the signal runs through the cascade as Q23, 8 more fractional bits than the 16-bit samples */
+#define EQ_SIGNAL_SHIFT (8)
+/* limit of the band gain, in 0.1 dB */
+#define EQ_MAX_GAIN_DB10 (180)
+
+/* static initializer of an equalizer, the bands can be set before eq_init */
+#define EQ_INITIALIZER {.lock = portMUX_INITIALIZER_UNLOCKED}
+
+/**
+ * @brief Filter shapes, after the RBJ audio EQ cookbook.
+ */
+typedef enum
+{
+    EQ_PEAKING,
+    EQ_LOW_SHELF,
+    EQ_HIGH_SHELF,
+    EQ_LOW_PASS,
+    EQ_HIGH_PASS,
+} eq_type_t;
+
+/**
+ * @brief One band of the equalizer.
+ */
+typedef struct
+{
+    eq_type_t type;    /*!< filter shape */
+    uint32_t freq_hz;  /*!< centre or corner frequency */
+    int16_t gain_db10; /*!< gain in 0.1 dB, ignored by the pass filters */
+    uint16_t q100;     /*!< quality factor times 100, or the shelf slope times 100 */
+} eq_band_t;
+
+/**
+ * @brief Coefficients of one biquad, normalized by a0, in Q(EQ_COEF_SHIFT).
+ */
+typedef struct
+{
+    int32_t b0;
+    int32_t b1;
+    int32_t b2;
+    int32_t a1;
+    int32_t a2;
+} eq_biquad_t;
+
+/**
+ * @brief Direct form I state of one biquad and channel, in Q(15 + EQ_SIGNAL_SHIFT).
+ */
+typedef struct
+{
+    int32_t x1;
+    int32_t x2;
+    int32_t y1;
+    int32_t y2;
+} eq_state_t;
+
+/**
+ * @brief Cascade of biquads applied in place to interleaved 16-bit PCM.
+ *
+ * The bands are set from any task and published with a sequence number. The audio task picks a new set up at
+ * the start of the next block, designs it into the idle half of a double buffer and cross-fades from the old
+ * cascade to the new one over that block, so a change never clicks and never races the filter.
+ */
+typedef struct
+{
+    eq_biquad_t coefs[2][EQ_MAX_BANDS];                   /*!< double-buffered coefficients, owned by the audio task */
+    eq_state_t state[2][EQ_MAX_BANDS][EQ_MAX_CHANNELS];   /*!< filter state per coefficient set */
+    uint8_t num_stages[2];                                /*!< number of biquads per coefficient set */
+    uint8_t active;                                       /*!< coefficient set in use */
+    uint8_t channels;                                     /*!< number of interleaved channels */
+    uint32_t sample_rate;                                 /*!< sample rate the coefficients were designed for */
+    uint32_t applied_seq;                                 /*!< sequence number of the bands in use */
+    portMUX_TYPE lock;                                    /*!< protects the requested bands */
+    eq_band_t bands[EQ_MAX_BANDS];                        /*!< requested bands */
+    uint8_t num_bands;                                    /*!< number of requested bands */
+    atomic_uint seq;                                      /*!< bumped on every request */
+} eq_t;
+
+/**
+ * @brief Prepares the audio side of the equalizer and designs the requested bands for the given format.
+ *
+ * The requested bands are kept. Must not race with eq_process.
+ *
+ * @param eq Pointer to the equalizer, set up with EQ_INITIALIZER.
+ * @param channels The number of interleaved channels, 1 or 2.
+ * @param sample_rate The sample rate in Hz.
+ */
+void eq_init(eq_t *eq, uint8_t channels, uint32_t sample_rate);
+
+/**
+ * @brief Redesigns the cascade for a new stream format. The filter state is cleared.
+ *
+ * Called by the audio task after a codec reconfiguration, so there is nothing to cross-fade from.
+ *
+ * @param eq Pointer to the equalizer.
+ * @param channels The number of interleaved channels, 1 or 2.
+ * @param sample_rate The sample rate in Hz.
+ */
+void eq_set_format(eq_t *eq, uint8_t channels, uint32_t sample_rate);
+
+/**
+ * @brief Requests a new set of bands. Safe to call from any task.
+ *
+ * @param eq Pointer to the equalizer.
+ * @param bands The bands, NULL or empty for a flat response.
+ * @param num The number of bands, at most EQ_MAX_BANDS.
+ * @return Returns true if the request was accepted, false if there are too many bands.
+ */
+bool eq_set_bands(eq_t *eq, const eq_band_t *bands, size_t num);
+
+/**
+ * @brief Designs one biquad for a sample rate.
+ *
+ * Floating point is used here only; the filter itself runs in integer arithmetic.
+ *
+ * @param band The band.
+ * @param sample_rate The sample rate in Hz.
+ * @param biquad Pointer to the coefficients to fill.
+ * @return Returns true on success, false if the band cannot be realized at this rate.
+ */
+bool eq_design(const eq_band_t *band, uint32_t sample_rate, eq_biquad_t *biquad);
+
+/**
+ * @brief Filters a block of interleaved frames in place. Audio task only.
+ *
+ * @param eq Pointer to the equalizer.
+ * @param pcm Pointer to the frames.
+ * @param frames The number of frames.
+ */
+void eq_process(eq_t *eq, int16_t *pcm, size_t frames);
+
+#endif /* __BT_APP_EQ_H__ */
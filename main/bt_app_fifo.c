@@ -0,0 +1,92 @@
+#include <string.h>
+
+#include "bt_app_fifo.h"
+
+bool audio_fifo_init(audio_fifo_t *fifo, uint8_t *storage, size_t size)
+{
+    if (storage == NULL || size == 0 || (size & (size - 1)) != 0)
+    {
+        return false;
+    }
+
+    fifo->buf = storage;
+    fifo->size = size;
+    audio_fifo_reset(fifo);
+    return true;
+}
+
+void audio_fifo_reset(audio_fifo_t *fifo)
+{
+    atomic_store_explicit(&fifo->head, 0, memory_order_relaxed);
+    atomic_store_explicit(&fifo->tail, 0, memory_order_release);
+}
+
+size_t audio_fifo_fill(audio_fifo_t *fifo)
+{
+    size_t tail = atomic_load_explicit(&fifo->tail, memory_order_acquire);
+    size_t head = atomic_load_explicit(&fifo->head, memory_order_acquire);
+
+    return head - tail;
+}
+
+size_t audio_fifo_space(audio_fifo_t *fifo)
+{
+    return fifo->size - audio_fifo_fill(fifo);
+}
+
+bool audio_fifo_write(audio_fifo_t *fifo, const void *data, size_t len)
+{
+    size_t head = atomic_load_explicit(&fifo->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&fifo->tail, memory_order_acquire);
+    size_t offset = head & (fifo->size - 1);
+    size_t first = 0;
+
+    if (len > fifo->size - (head - tail))
+    {
+        return false;
+    }
+
+    first = fifo->size - offset;
+    if (first > len)
+    {
+        first = len;
+    }
+    memcpy(fifo->buf + offset, data, first);
+    memcpy(fifo->buf, (const uint8_t *)data + first, len - first);
+
+    /* publish the data before the new head becomes visible to the consumer */
+    atomic_store_explicit(&fifo->head, head + len, memory_order_release);
+    return true;
+}
+
+size_t audio_fifo_read_spans(audio_fifo_t *fifo, audio_fifo_span_t spans[2], size_t max_len)
+{
+    size_t tail = atomic_load_explicit(&fifo->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&fifo->head, memory_order_acquire);
+    size_t offset = tail & (fifo->size - 1);
+    size_t avail = head - tail;
+
+    if (avail > max_len)
+    {
+        avail = max_len;
+    }
+
+    spans[0].data = fifo->buf + offset;
+    spans[0].len = fifo->size - offset;
+    if (spans[0].len > avail)
+    {
+        spans[0].len = avail;
+    }
+    spans[1].data = fifo->buf;
+    spans[1].len = avail - spans[0].len;
+
+    return avail;
+}
+
+void audio_fifo_consume(audio_fifo_t *fifo, size_t len)
+{
+    size_t tail = atomic_load_explicit(&fifo->tail, memory_order_relaxed);
+
+    /* release the slots only after the consumer is done reading them */
+    atomic_store_explicit(&fifo->tail, tail + len, memory_order_release);
+}
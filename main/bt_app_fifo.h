@@ -0,0 +1,101 @@
+#ifndef __BT_APP_FIFO_H__
+#define __BT_APP_FIFO_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+/* head and tail live on separate cache lines so the two cores do not share a line */
+#define AUDIO_FIFO_ALIGN (32)
+
+/**
+ * @brief Contiguous region of a FIFO, used for both the free and the filled part.
+ */
+typedef struct
+{
+    uint8_t *data; /*!< start of the region */
+    size_t len;    /*!< length of the region in bytes */
+} audio_fifo_span_t;
+
+/**
+ * @brief Lock-free single-producer/single-consumer byte FIFO.
+ *
+ * `head` is only written by the producer and `tail` only by the consumer. Both are free-running
+ * counters, so the fill level is `head - tail` and the storage size must be a power of two.
+ */
+typedef struct
+{
+    _Alignas(AUDIO_FIFO_ALIGN) atomic_size_t head; /*!< total bytes written, owned by the producer */
+    _Alignas(AUDIO_FIFO_ALIGN) atomic_size_t tail; /*!< total bytes read, owned by the consumer */
+    _Alignas(AUDIO_FIFO_ALIGN) uint8_t *buf;       /*!< storage area */
+    size_t size;                                   /*!< size of the storage area in bytes, a power of two */
+} audio_fifo_t;
+
+/**
+ * @brief Initializes a FIFO on top of caller-provided storage.
+ *
+ * @param fifo Pointer to the FIFO to initialize.
+ * @param storage Pointer to the storage area.
+ * @param size The size of the storage area in bytes. It must be a power of two.
+ * @return Returns true if the FIFO was initialized, false if the size is not a power of two.
+ */
+bool audio_fifo_init(audio_fifo_t *fifo, uint8_t *storage, size_t size);
+
+/**
+ * @brief Empties the FIFO. Must only be called while neither side is running.
+ *
+ * @param fifo Pointer to the FIFO.
+ */
+void audio_fifo_reset(audio_fifo_t *fifo);
+
+/**
+ * @brief Returns the number of bytes currently held in the FIFO. O(1), callable from either side.
+ *
+ * @param fifo Pointer to the FIFO.
+ * @return The fill level in bytes.
+ */
+size_t audio_fifo_fill(audio_fifo_t *fifo);
+
+/**
+ * @brief Returns the free space of the FIFO in bytes. O(1), callable from either side.
+ *
+ * @param fifo Pointer to the FIFO.
+ * @return The free space in bytes.
+ */
+size_t audio_fifo_space(audio_fifo_t *fifo);
+
+/**
+ * @brief Copies a block into the FIFO. Producer side only.
+ *
+ * The block is written entirely or not at all, so a packet is never split by an overflow.
+ *
+ * @param fifo Pointer to the FIFO.
+ * @param data Pointer to the data to be written.
+ * @param len The length of the data in bytes.
+ * @return Returns true if the block was written, false if there was not enough free space.
+ */
+bool audio_fifo_write(audio_fifo_t *fifo, const void *data, size_t len);
+
+/**
+ * @brief Gets the filled part of the FIFO as up to two contiguous spans. Consumer side only.
+ *
+ * The second span is non-empty only when the filled part wraps around the end of the storage.
+ * The data stays valid and writable by the consumer until it is released with audio_fifo_consume.
+ *
+ * @param fifo Pointer to the FIFO.
+ * @param spans Array of two spans that receives the readable regions.
+ * @param max_len The maximum number of bytes to expose across both spans.
+ * @return The total number of bytes in both spans.
+ */
+size_t audio_fifo_read_spans(audio_fifo_t *fifo, audio_fifo_span_t spans[2], size_t max_len);
+
+/**
+ * @brief Releases bytes previously obtained with audio_fifo_read_spans. Consumer side only.
+ *
+ * @param fifo Pointer to the FIFO.
+ * @param len The number of bytes to release.
+ */
+void audio_fifo_consume(audio_fifo_t *fifo, size_t len);
+
+#endif /* __BT_APP_FIFO_H__ */
@@ -0,0 +1,127 @@
+#include "bt_app_jitter.h"
+
+static uint32_t jitter_us_to_bytes(const jitter_buf_t *jb, uint32_t us)
+{
+    /* keep whole 16-bit stereo frames */
+    return (uint32_t)(((uint64_t)us * jb->bytes_per_sec / 1000000) & ~(uint64_t)0x3);
+}
+
+static void jitter_update_target(jitter_buf_t *jb)
+{
+    /* four times the mean deviation covers ordinary jitter, the peak covers the radio's bursts */
+    uint32_t depth_us = jb->jitter_us * 4;
+    uint32_t target = 0;
+
+    if (depth_us < jb->peak_us)
+    {
+        depth_us = jb->peak_us;
+    }
+    target = jitter_us_to_bytes(jb, depth_us + jb->boost_us);
+
+    if (target < jb->min_bytes)
+    {
+        target = jb->min_bytes;
+    }
+    else if (target > jb->max_bytes)
+    {
+        target = jb->max_bytes;
+    }
+    jb->target_bytes = target;
+}
+
+void jitter_init(jitter_buf_t *jb, uint32_t min_bytes, uint32_t max_bytes, uint32_t bytes_per_sec)
+{
+    jb->min_bytes = min_bytes;
+    jb->max_bytes = max_bytes;
+    jb->bytes_per_sec = bytes_per_sec;
+    jb->jitter_us = 0;
+    jb->peak_us = 0;
+    jb->boost_us = 0;
+    jb->target_bytes = min_bytes;
+    jb->reported_bytes = 0;
+    jitter_reset(jb);
+}
+
+void jitter_reset(jitter_buf_t *jb)
+{
+    jb->last_arrival_us = 0;
+    jb->last_len = 0;
+}
+
+void jitter_set_rate(jitter_buf_t *jb, uint32_t bytes_per_sec)
+{
+    if (bytes_per_sec == 0 || bytes_per_sec == jb->bytes_per_sec)
+    {
+        return;
+    }
+    jb->bytes_per_sec = bytes_per_sec;
+    jitter_reset(jb);
+    jitter_update_target(jb);
+}
+
+bool jitter_on_packet(jitter_buf_t *jb, int64_t now_us, size_t len)
+{
+    uint32_t diff_us = 0;
+    uint32_t delta_us = 0;
+
+    if (jb->last_arrival_us != 0 && jb->bytes_per_sec != 0 && now_us - jb->last_arrival_us < JITTER_GAP_RESET_US)
+    {
+        /* deviation between the arrival gap and the play-out duration of the previous packet */
+        int64_t gap_us = now_us - jb->last_arrival_us;
+        int64_t play_us = (int64_t)jb->last_len * 1000000 / jb->bytes_per_sec;
+        int64_t d = gap_us - play_us;
+
+        diff_us = (uint32_t)(d < 0 ? -d : d);
+
+        /* J += (|D| - J) / 16, as in RFC 3550 */
+        jb->jitter_us = (uint32_t)((int32_t)jb->jitter_us + ((int32_t)diff_us - (int32_t)jb->jitter_us) / 16);
+
+        /* the peak and the underflow boost decay by about 1/256 per packet */
+        jb->peak_us -= jb->peak_us >> 8;
+        if (diff_us > jb->peak_us)
+        {
+            jb->peak_us = diff_us;
+        }
+        jb->boost_us -= jb->boost_us >> 8;
+
+        jitter_update_target(jb);
+    }
+    jb->last_arrival_us = now_us;
+    jb->last_len = (uint32_t)len;
+
+    delta_us = jitter_target_us(jb);
+    if (jb->bytes_per_sec != 0)
+    {
+        uint32_t reported_us = (uint32_t)((uint64_t)jb->reported_bytes * 1000000 / jb->bytes_per_sec);
+        delta_us = delta_us > reported_us ? delta_us - reported_us : reported_us - delta_us;
+    }
+    return delta_us >= JITTER_REPORT_HYSTERESIS_US;
+}
+
+void jitter_on_underflow(jitter_buf_t *jb)
+{
+    if (jb->boost_us < JITTER_UNDERFLOW_BOOST_US * 8)
+    {
+        jb->boost_us += JITTER_UNDERFLOW_BOOST_US;
+    }
+    jitter_update_target(jb);
+}
+
+void jitter_mark_reported(jitter_buf_t *jb)
+{
+    jb->reported_bytes = jb->target_bytes;
+}
+
+uint32_t jitter_target_bytes(const jitter_buf_t *jb)
+{
+    return jb->target_bytes;
+}
+
+uint32_t jitter_target_us(const jitter_buf_t *jb)
+{
+    if (jb->bytes_per_sec == 0)
+    {
+        return 0;
+    }
+    return (uint32_t)((uint64_t)jb->target_bytes * 1000000 / jb->bytes_per_sec);
+}
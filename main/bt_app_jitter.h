@@ -0,0 +1,102 @@
+#ifndef __BT_APP_JITTER_H__
+#define __BT_APP_JITTER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* minimum change of the target depth, in microseconds, before a new latency is reported */
+#define JITTER_REPORT_HYSTERESIS_US (10 * 1000)
+/* arrival gaps longer than this, in microseconds, are a stream restart rather than jitter */
+#define JITTER_GAP_RESET_US (500 * 1000)
+/* extra depth added after every underflow, in microseconds; it decays while playback is stable */
+#define JITTER_UNDERFLOW_BOOST_US (20 * 1000)
+
+/**
+ * @brief Adaptive jitter buffer state.
+ *
+ * The buffer measures how much the arrival time of every packet deviates from the play-out duration of
+ * the previous one (the RFC 3550 inter-arrival jitter), keeps a smoothed mean and a slowly decaying peak
+ * of that deviation, and derives from them the depth the FIFO should hold before play-out starts.
+ * All times are in microseconds and all depths in bytes; the caller supplies the clock.
+ */
+typedef struct
+{
+    uint32_t min_bytes;       /*!< lower bound of the target depth */
+    uint32_t max_bytes;       /*!< upper bound of the target depth */
+    uint32_t bytes_per_sec;   /*!< PCM byte rate of the stream */
+    int64_t last_arrival_us;  /*!< arrival time of the previous packet, 0 if none */
+    uint32_t last_len;        /*!< length of the previous packet */
+    uint32_t jitter_us;       /*!< smoothed inter-arrival jitter */
+    uint32_t peak_us;         /*!< decaying peak of the inter-arrival deviation */
+    uint32_t boost_us;        /*!< decaying extra depth added by underflows */
+    uint32_t target_bytes;    /*!< current target depth */
+    uint32_t reported_bytes;  /*!< target depth at the last latency report */
+} jitter_buf_t;
+
+/**
+ * @brief Initializes the jitter buffer with its bounds and byte rate. The target starts at the lower bound.
+ *
+ * @param jb Pointer to the jitter buffer.
+ * @param min_bytes Lower bound of the target depth in bytes.
+ * @param max_bytes Upper bound of the target depth in bytes.
+ * @param bytes_per_sec PCM byte rate of the stream.
+ */
+void jitter_init(jitter_buf_t *jb, uint32_t min_bytes, uint32_t max_bytes, uint32_t bytes_per_sec);
+
+/**
+ * @brief Forgets the arrival history, e.g. when a new stream starts. Bounds, byte rate and target are kept.
+ *
+ * @param jb Pointer to the jitter buffer.
+ */
+void jitter_reset(jitter_buf_t *jb);
+
+/**
+ * @brief Changes the PCM byte rate after a codec reconfiguration.
+ *
+ * @param jb Pointer to the jitter buffer.
+ * @param bytes_per_sec PCM byte rate of the stream.
+ */
+void jitter_set_rate(jitter_buf_t *jb, uint32_t bytes_per_sec);
+
+/**
+ * @brief Feeds the arrival of one packet and updates the target depth.
+ *
+ * @param jb Pointer to the jitter buffer.
+ * @param now_us Arrival time of the packet.
+ * @param len Length of the packet in bytes.
+ * @return Returns true if the target moved by more than JITTER_REPORT_HYSTERESIS_US since the last report.
+ */
+bool jitter_on_packet(jitter_buf_t *jb, int64_t now_us, size_t len);
+
+/**
+ * @brief Records an underflow of the play-out side, which deepens the target.
+ *
+ * @param jb Pointer to the jitter buffer.
+ */
+void jitter_on_underflow(jitter_buf_t *jb);
+
+/**
+ * @brief Marks the current target as reported to the source.
+ *
+ * @param jb Pointer to the jitter buffer.
+ */
+void jitter_mark_reported(jitter_buf_t *jb);
+
+/**
+ * @brief Returns the current target depth in bytes.
+ *
+ * @param jb Pointer to the jitter buffer.
+ * @return The target depth in bytes, between the configured bounds.
+ */
+uint32_t jitter_target_bytes(const jitter_buf_t *jb);
+
+/**
+ * @brief Returns the latency of the current target depth in microseconds.
+ *
+ * @param jb Pointer to the jitter buffer.
+ * @return The latency in microseconds.
+ */
+uint32_t jitter_target_us(const jitter_buf_t *jb);
+
+#endif /* __BT_APP_JITTER_H__ */
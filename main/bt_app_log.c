@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <inttypes.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "bt_app_fifo.h"
+#include "bt_app_log.h"
+#include "bt_app_mem.h"
+
+#if !BT_APP_LOG_BINARY
+/* format of one deferred record */
+typedef struct
+{
+    esp_log_level_t level; /* esp_log level */
+    char letter;           /* level letter of the line prefix */
+    const char *tag;       /* tag */
+    const char *fmt;       /* printf format */
+} bt_app_log_fmt_t;
+
+#define BT_APP_LOG_FMT(id, lvl, t, f) [id] = {.level = ESP_LOG_##lvl, .letter = #lvl[0], .tag = t, .fmt = f},
+static const bt_app_log_fmt_t s_log_fmts[BLOG_NUM] = {BT_APP_LOG_FORMATS(BT_APP_LOG_FMT)};
+#undef BT_APP_LOG_FMT
+#endif
+
+static audio_fifo_t s_log_fifo[portNUM_PROCESSORS];                        /* records of each core */
+static atomic_uint s_log_drops[portNUM_PROCESSORS];                        /* records dropped on each core */
+static unsigned int s_log_drops_seen[portNUM_PROCESSORS];                  /* drops already reported */
+static atomic_bool s_log_started = false;                                  /* the FIFOs are ready */
+
+void bt_app_log_record(bt_app_log_id_t id, size_t nargs, const uint32_t *args)
+{
+    uint8_t rec[sizeof(bt_app_log_hdr_t) + BT_APP_LOG_MAX_ARGS * sizeof(uint32_t)];
+    bt_app_log_hdr_t *hdr = (bt_app_log_hdr_t *)rec;
+    UBaseType_t mask = 0;
+    int core = 0;
+
+    if (!atomic_load(&s_log_started))
+    {
+        return;
+    }
+    nargs = nargs > BT_APP_LOG_MAX_ARGS ? BT_APP_LOG_MAX_ARGS : nargs;
+    hdr->sync = BT_APP_LOG_SYNC;
+    hdr->id = (uint16_t)id;
+    hdr->time_us = (uint32_t)esp_timer_get_time();
+    memcpy(rec + sizeof(*hdr), args, nargs * sizeof(uint32_t));
+
+    /* no task switch or interrupt on this core until the record is in, so the FIFO keeps a single producer */
+    mask = portSET_INTERRUPT_MASK_FROM_ISR();
+    core = xPortGetCoreID();
+    hdr->info = (uint8_t)(nargs << 4 | core);
+    if (!audio_fifo_write(&s_log_fifo[core], rec, sizeof(*hdr) + nargs * sizeof(uint32_t)))
+    {
+        atomic_fetch_add(&s_log_drops[core], 1);
+    }
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+}
+
+static void bt_app_log_emit(const bt_app_log_hdr_t *hdr, const uint32_t *args)
+{
+#if BT_APP_LOG_BINARY
+    fwrite(hdr, 1, sizeof(*hdr), stdout);
+    fwrite(args, sizeof(uint32_t), hdr->info >> 4, stdout);
+#else
+    const bt_app_log_fmt_t *fmt = &s_log_fmts[hdr->id];
+
+    /* the prefix carries the time of the record, not of its output */
+    esp_log_write(fmt->level, fmt->tag, "%c (%" PRIu32 ") %s: ", fmt->letter, hdr->time_us / 1000, fmt->tag);
+    esp_log_write(fmt->level, fmt->tag, fmt->fmt, (unsigned int)args[0], (unsigned int)args[1], (unsigned int)args[2],
+                  (unsigned int)args[3]);
+    esp_log_write(fmt->level, fmt->tag, "\n");
+#endif
+}
+
+static void bt_app_log_drain(int core)
+{
+    bt_app_log_hdr_t hdr;
+    uint32_t args[BT_APP_LOG_MAX_ARGS] = {0};
+    audio_fifo_span_t spans[2];
+    uint8_t rec[sizeof(hdr) + sizeof(args)];
+    size_t len = 0;
+
+    while (audio_fifo_fill(&s_log_fifo[core]) >= sizeof(hdr))
+    {
+        /* records are written whole, so a header is always followed by its arguments */
+        len = audio_fifo_read_spans(&s_log_fifo[core], spans, sizeof(hdr));
+        memcpy(rec, spans[0].data, spans[0].len);
+        memcpy(rec + spans[0].len, spans[1].data, spans[1].len);
+        memcpy(&hdr, rec, sizeof(hdr));
+        len = sizeof(hdr) + (hdr.info >> 4) * sizeof(uint32_t);
+        audio_fifo_read_spans(&s_log_fifo[core], spans, len);
+        memcpy(rec, spans[0].data, spans[0].len);
+        memcpy(rec + spans[0].len, spans[1].data, spans[1].len);
+        audio_fifo_consume(&s_log_fifo[core], len);
+
+        memset(args, 0, sizeof(args));
+        memcpy(args, rec + sizeof(hdr), len - sizeof(hdr));
+        if (hdr.id < BLOG_NUM)
+        {
+            bt_app_log_emit(&hdr, args);
+        }
+    }
+}
+
+static void bt_app_log_task_handler(void *arg)
+{
+    for (;;)
+    {
+        vTaskDelay(pdMS_TO_TICKS(BT_APP_LOG_PERIOD_MS));
+        for (int core = 0; core < portNUM_PROCESSORS; core++)
+        {
+            unsigned int drops = atomic_load(&s_log_drops[core]);
+
+            bt_app_log_drain(core);
+            if (drops != s_log_drops_seen[core])
+            {
+                const bt_app_log_hdr_t hdr = {
+                    .sync = BT_APP_LOG_SYNC,
+                    .info = 2 << 4 | core,
+                    .id = BLOG_DROPPED,
+                    .time_us = (uint32_t)esp_timer_get_time(),
+                };
+                const uint32_t args[BT_APP_LOG_MAX_ARGS] = {drops - s_log_drops_seen[core], core};
+
+                s_log_drops_seen[core] = drops;
+                bt_app_log_emit(&hdr, args);
+            }
+        }
+#if BT_APP_LOG_BINARY
+        fflush(stdout);
+#endif
+    }
+}
+
+esp_err_t bt_app_log_start(void)
+{
+    if (atomic_load(&s_log_started))
+    {
+        return ESP_OK;
+    }
+    uint8_t *storage = bt_app_mem_get(MEM_BUF_LOG_FIFOS);
+
+    for (int core = 0; core < portNUM_PROCESSORS; core++)
+    {
+        audio_fifo_init(&s_log_fifo[core], storage + core * BT_APP_LOG_BUF_BYTES, BT_APP_LOG_BUF_BYTES);
+    }
+    /* just above idle, formatting and UART output only use time nothing else wants */
+    if (bt_app_mem_task_create(MEM_TASK_LOG, bt_app_log_task_handler, tskIDLE_PRIORITY + 1, tskNO_AFFINITY) == NULL)
+    {
+        ESP_LOGE(BT_APP_LOG_TAG, "%s task creation failed", __func__);
+        return ESP_FAIL;
+    }
+    atomic_store(&s_log_started, true);
+    return ESP_OK;
+}
+
+uint32_t bt_app_log_get_drops(void)
+{
+    uint32_t drops = 0;
+
+    for (int core = 0; core < portNUM_PROCESSORS; core++)
+    {
+        drops += atomic_load(&s_log_drops[core]);
+    }
+    return drops;
+}
@@ -0,0 +1,106 @@
+#ifndef __BT_APP_LOG_H__
+#define __BT_APP_LOG_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+#define BT_APP_LOG_TAG "BT_APP_LOG"
+
+/* emit the raw records on stdout for tools/bt_app_log_decode.py instead of formatting them on target */
+#ifndef BT_APP_LOG_BINARY
+#define BT_APP_LOG_BINARY (0)
+#endif
+/* record buffer of each core, a power of two */
+#define BT_APP_LOG_BUF_BYTES (2048)
+/* arguments of a record, each one 32 bits */
+#define BT_APP_LOG_MAX_ARGS (4)
+/* first byte of every record, lets the decoder find records among the text logs */
+#define BT_APP_LOG_SYNC (0xa5)
+/* period at which the logger task drains the buffers */
+#define BT_APP_LOG_PERIOD_MS (100)
+#define BT_APP_LOG_TASK_STACK (2560)
+
+/*
+ * Formats of the deferred records: identifier, esp_log level, tag and printf format. The arguments are unsigned
+ * 32-bit values, so only %u, %d, %x and %c conversions apply. Identifiers are the position in this list, which
+ * tools/bt_app_log_decode.py parses, so entries must keep this one-line shape and new ones go at the end.
+ */
+#define BT_APP_LOG_FORMATS(X) \
+    X(BLOG_DROPPED, WARN, "BT_APP_LOG", "%u records dropped on core %u") \
+    X(BLOG_FIFO_UNDERFLOW, INFO, "BT_APP_CORE", "ringbuffer underflowed! mode changed: RINGBUFFER_MODE_PREFETCHING") \
+    X(BLOG_FIFO_DRAINED, INFO, "BT_APP_CORE", "ringbuffer data decreased to %u bytes! mode changed: RINGBUFFER_MODE_PROCESSING") \
+    X(BLOG_FIFO_OVERFLOW, WARN, "BT_APP_CORE", "ringbuffer overflowed at %u bytes, ready to decrease data! mode changed: RINGBUFFER_MODE_DROPPING") \
+    X(BLOG_FIFO_PREFETCHED, INFO, "BT_APP_CORE", "ringbuffer data increased to %u bytes! mode changed: RINGBUFFER_MODE_PROCESSING") \
+    X(BLOG_SEM_GIVE_FAILED, ERROR, "BT_APP_CORE", "semphore give failed") \
+    X(BLOG_QUEUE_SEND_FAILED, ERROR, "BT_APP_CORE", "bt_app_send_msg xQueue send failed, priority %u") \
+    X(BLOG_POOL_EXHAUSTED, ERROR, "BT_APP_CORE", "bt_app_work_dispatch_prio pool exhausted, event 0x%x dropped") \
+    X(BLOG_I2S_BUDGETS, INFO, "BT_APP_CORE", "%u Hz/%u ch, %u cycles per chunk at %u MHz")
+
+/**
+ * @brief Identifiers of the deferred record formats.
+ */
+typedef enum
+{
+#define BT_APP_LOG_ID(id, level, tag, fmt) id,
+    BT_APP_LOG_FORMATS(BT_APP_LOG_ID)
+#undef BT_APP_LOG_ID
+    BLOG_NUM,
+} bt_app_log_id_t;
+
+/**
+ * @brief Header of a record, followed by its arguments. Packed and little endian, as emitted in binary mode.
+ */
+typedef struct __attribute__((packed))
+{
+    uint8_t sync;    /*!< BT_APP_LOG_SYNC */
+    uint8_t info;    /*!< number of arguments in the high nibble, core in the low nibble */
+    uint16_t id;     /*!< bt_app_log_id_t */
+    uint32_t time_us; /*!< time of the record, low 32 bits of esp_timer_get_time */
+} bt_app_log_hdr_t;
+
+/**
+ * @brief Records a deferred log line from a time-critical path.
+ *
+ * Only the identifier and the raw arguments are copied into the buffer of the calling core; the logger task
+ * formats them later. Never blocks: if the buffer is full the record is dropped and counted.
+ *
+ * @param id The format.
+ * @param ... Up to BT_APP_LOG_MAX_ARGS integer arguments.
+ */
+#define BT_APP_LOG(id, ...)                                                                     \
+    do                                                                                          \
+    {                                                                                           \
+        const uint32_t _bt_app_log_args[] = {0, ##__VA_ARGS__};                                 \
+        bt_app_log_record((id), sizeof(_bt_app_log_args) / sizeof(uint32_t) - 1, _bt_app_log_args + 1); \
+    } while (0)
+
+/**
+ * @brief Copies a record into the buffer of the calling core. Use BT_APP_LOG instead.
+ *
+ * The buffer of each core is a single-producer FIFO; producers on the same core are serialized by masking
+ * interrupts on that core for the copy, so no lock is shared between cores.
+ *
+ * @param id The format.
+ * @param nargs The number of arguments, extra ones are ignored.
+ * @param args The arguments.
+ */
+void bt_app_log_record(bt_app_log_id_t id, size_t nargs, const uint32_t *args);
+
+/**
+ * @brief Starts the low-priority logger task. Records made before are dropped.
+ *
+ * @return ESP_OK on success, ESP_FAIL if the task could not be created.
+ */
+esp_err_t bt_app_log_start(void);
+
+/**
+ * @brief Gets the number of records dropped because a buffer was full.
+ *
+ * @return The number of records dropped on all cores.
+ */
+uint32_t bt_app_log_get_drops(void);
+
+#endif /* __BT_APP_LOG_H__ */
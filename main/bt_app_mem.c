@@ -0,0 +1,159 @@
+#include <inttypes.h>
+#include <stdatomic.h>
+
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+#include "bt_app_mem.h"
+
+#if !CONFIG_FREERTOS_TLSP_DELETION_CALLBACKS
+#error "bt_app_mem needs CONFIG_FREERTOS_TLSP_DELETION_CALLBACKS to know when a deleted task has been cleaned up"
+#endif
+_Static_assert(BT_APP_MEM_TLS_INDEX < configNUM_THREAD_LOCAL_STORAGE_POINTERS, "no task local storage slot left");
+
+/* stacks and control blocks of the tasks */
+#define BT_APP_MEM_STACK(id, name, bytes) static StackType_t s_mem_stack_##id[(bytes) / sizeof(StackType_t)];
+BT_APP_MEM_TASKS(BT_APP_MEM_STACK)
+#undef BT_APP_MEM_STACK
+static StaticTask_t s_mem_tcb[MEM_TASK_NUM];
+
+/* buffers */
+#define BT_APP_MEM_BUF(id, name, bytes) static uint8_t s_mem_buf_##id[bytes] __attribute__((aligned(8)));
+BT_APP_MEM_BUFFERS(BT_APP_MEM_BUF)
+#undef BT_APP_MEM_BUF
+
+typedef struct
+{
+    const char *name;   /* task name */
+    StackType_t *stack; /* static stack */
+    uint32_t bytes;     /* stack size */
+} bt_app_mem_task_desc_t;
+
+typedef struct
+{
+    const char *name; /* buffer name */
+    void *buf;        /* static storage */
+    uint32_t bytes;   /* buffer size */
+} bt_app_mem_buf_desc_t;
+
+#define BT_APP_MEM_TASK_DESC(id, n, b) [id] = {.name = n, .stack = s_mem_stack_##id, .bytes = (b)},
+static const bt_app_mem_task_desc_t s_mem_tasks[MEM_TASK_NUM] = {BT_APP_MEM_TASKS(BT_APP_MEM_TASK_DESC)};
+#undef BT_APP_MEM_TASK_DESC
+
+#define BT_APP_MEM_BUF_DESC(id, n, b) [id] = {.name = n, .buf = s_mem_buf_##id, .bytes = (b)},
+static const bt_app_mem_buf_desc_t s_mem_bufs[MEM_BUF_NUM] = {BT_APP_MEM_BUFFERS(BT_APP_MEM_BUF_DESC)};
+#undef BT_APP_MEM_BUF_DESC
+
+#define BT_APP_MEM_MOD_DESC(id, n, b) [id] = {.name = n, .buf = NULL, .bytes = (b)},
+static const bt_app_mem_buf_desc_t s_mem_mods[MEM_MOD_NUM] = {BT_APP_MEM_MODULES(BT_APP_MEM_MOD_DESC)};
+#undef BT_APP_MEM_MOD_DESC
+
+static TaskHandle_t s_mem_handle[MEM_TASK_NUM];     /* running tasks, NULL if not created */
+static uint32_t s_mem_min_free[MEM_TASK_NUM];       /* lowest free stack of the deleted instances, 0 if none */
+static atomic_bool s_mem_in_use[MEM_TASK_NUM];      /* control block and stack still known to the kernel */
+
+void *bt_app_mem_get(bt_app_mem_buf_t id)
+{
+    return s_mem_bufs[id].buf;
+}
+
+/* called by the kernel once a deleted task is off all its lists, from then on its memory is ours again */
+static void bt_app_mem_task_cleaned(int index, void *arg)
+{
+    atomic_store((atomic_bool *)arg, false);
+}
+
+TaskHandle_t bt_app_mem_task_create(bt_app_mem_task_t id, TaskFunction_t fn, UBaseType_t prio, BaseType_t core)
+{
+    const bt_app_mem_task_desc_t *task = &s_mem_tasks[id];
+
+    if (s_mem_handle[id] != NULL)
+    {
+        ESP_LOGE(BT_APP_MEM_TAG, "%s %s is already running", __func__, task->name);
+        return s_mem_handle[id];
+    }
+    /*
+     * A task deleted while it ran on the other core stays on the termination list until the idle task of that core
+     * cleans it up. Creating it again before would link the same control block into two lists.
+     */
+    while (atomic_load(&s_mem_in_use[id]))
+    {
+        vTaskDelay(1);
+    }
+    atomic_store(&s_mem_in_use[id], true);
+    /* in ESP-IDF the stack depth is in bytes */
+    s_mem_handle[id] = xTaskCreateStaticPinnedToCore(fn, task->name, task->bytes, NULL, prio, task->stack,
+                                                     &s_mem_tcb[id], core);
+    if (s_mem_handle[id] == NULL)
+    {
+        atomic_store(&s_mem_in_use[id], false);
+        return NULL;
+    }
+    vTaskSetThreadLocalStoragePointerAndDelCallback(s_mem_handle[id], BT_APP_MEM_TLS_INDEX, &s_mem_in_use[id],
+                                                    bt_app_mem_task_cleaned);
+    return s_mem_handle[id];
+}
+
+static uint32_t bt_app_mem_min_free(bt_app_mem_task_t id)
+{
+    uint32_t min_free = s_mem_min_free[id];
+
+    if (s_mem_handle[id] != NULL)
+    {
+        uint32_t free_now = uxTaskGetStackHighWaterMark(s_mem_handle[id]);
+
+        if (min_free == 0 || free_now < min_free)
+        {
+            min_free = free_now;
+        }
+    }
+    return min_free;
+}
+
+void bt_app_mem_task_delete(bt_app_mem_task_t id)
+{
+    if (s_mem_handle[id] == NULL)
+    {
+        return;
+    }
+    /* the mark is lost with the task, keep it */
+    s_mem_min_free[id] = bt_app_mem_min_free(id);
+    vTaskDelete(s_mem_handle[id]);
+    s_mem_handle[id] = NULL;
+}
+
+void bt_app_mem_report(void)
+{
+    for (int i = 0; i < MEM_BUF_NUM; i++)
+    {
+        ESP_LOGI(BT_APP_MEM_TAG, "%-22s %6" PRIu32 " bytes", s_mem_bufs[i].name, s_mem_bufs[i].bytes);
+    }
+    for (int i = 0; i < MEM_MOD_NUM; i++)
+    {
+        ESP_LOGI(BT_APP_MEM_TAG, "%-22s %6" PRIu32 " bytes, in its module", s_mem_mods[i].name, s_mem_mods[i].bytes);
+    }
+    for (int i = 0; i < MEM_TASK_NUM; i++)
+    {
+        uint32_t min_free = bt_app_mem_min_free(i);
+
+        if (min_free == 0)
+        {
+            ESP_LOGI(BT_APP_MEM_TAG, "%-22s %6" PRIu32 " bytes stack, never run", s_mem_tasks[i].name, s_mem_tasks[i].bytes);
+        }
+        else if (min_free < BT_APP_MEM_STACK_MARGIN_BYTES)
+        {
+            ESP_LOGW(BT_APP_MEM_TAG, "%-22s %6" PRIu32 " bytes stack, %" PRIu32 " never used, below the margin",
+                     s_mem_tasks[i].name, s_mem_tasks[i].bytes, min_free);
+        }
+        else
+        {
+            ESP_LOGI(BT_APP_MEM_TAG, "%-22s %6" PRIu32 " bytes stack, %" PRIu32 " never used",
+                     s_mem_tasks[i].name, s_mem_tasks[i].bytes, min_free);
+        }
+    }
+    ESP_LOGI(BT_APP_MEM_TAG, "static %u of %u bytes budget, task control blocks %u bytes each",
+             (unsigned int)BT_APP_MEM_TOTAL_BYTES, (unsigned int)BT_APP_MEM_BUDGET_BYTES, (unsigned int)sizeof(StaticTask_t));
+    ESP_LOGI(BT_APP_MEM_TAG, "heap: %u free, largest block %u",
+             (unsigned int)heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT),
+             (unsigned int)heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+}
@@ -0,0 +1,144 @@
+#ifndef __BT_APP_MEM_H__
+#define __BT_APP_MEM_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+#include "bt_app_core.h"
+#include "bt_app_meta.h"
+
+#define BT_APP_MEM_TAG "BT_APP_MEM"
+
+/* RAM the tables below may take in total, checked at compile time, the buffer of a tracing build comes on top */
+#define BT_APP_MEM_BUDGET_BYTES (80 * 1024 + BT_APP_MEM_TRACE_BYTES)
+/* task local storage slot whose deletion callback tells that a deleted task has been cleaned up, free because the
+ * pipeline tasks never call pthread_setspecific */
+#define BT_APP_MEM_TLS_INDEX (0)
+/* a stack whose free space drops below this is reported as a warning */
+#define BT_APP_MEM_STACK_MARGIN_BYTES (256)
+
+/*
+ * Tasks of the pipeline: identifier, name and stack size in bytes. The stack and the task control block of each
+ * one are static, so a task deleted on disconnect is created again in the very same memory.
+ */
+#define BT_APP_MEM_TASKS(X) \
+    X(MEM_TASK_APP, "BtAppTask", BT_APP_TASK_STACK) \
+    X(MEM_TASK_I2S, "BtI2STask", BT_I2S_TASK_STACK) \
+    X(MEM_TASK_LOG, "BtLogTask", BT_APP_LOG_TASK_STACK)
+
+/*
+ * Buffers of the pipeline: identifier, name and size in bytes. Each one is 8-byte aligned, so it can hold kernel
+ * control blocks as well as samples.
+ */
+#define BT_APP_MEM_BUFFERS(X) \
+    X(MEM_BUF_APP_QUEUES, "work queues", BT_APP_QUEUE_LEN_TOTAL * sizeof(bt_app_msg_t)) \
+    X(MEM_BUF_APP_QUEUE_CBS, "work queue control", BT_APP_PRIO_NUM * sizeof(StaticQueue_t)) \
+    X(MEM_BUF_I2S_SEM_CB, "I2S semaphore control", sizeof(StaticSemaphore_t)) \
+    X(MEM_BUF_I2S_FIFO, "I2S FIFO", RINGBUF_MAX_BYTES_BUFFER) \
+    X(MEM_BUF_I2S_PCM, "PCM chunk", I2S_RESAMPLED_MAX_SAMPLES * sizeof(int16_t)) \
+    X(MEM_BUF_I2S_OUT, "output chunk", I2S_RESAMPLED_MAX_SAMPLES * sizeof(int32_t)) \
+    X(MEM_BUF_LOG_FIFOS, "log FIFOs", portNUM_PROCESSORS * BT_APP_LOG_BUF_BYTES)
+
+/*
+ * Static buffers owned by their modules: identifier, name and size in bytes. They stay in the modules, which are
+ * built and tested on the host without this table, and are only listed here to be counted against the budget and
+ * reported. Kernel objects of the boot preparation, which are freed before the first connection, and the heap of
+ * Bluedroid and the drivers are not pipeline memory and are left out.
+ */
+#define BT_APP_MEM_TRACE_BYTES (BT_APP_TRACE_ENABLED ? BT_APP_TRACE_EVENTS * sizeof(bt_app_trace_event_t) : 0)
+#define BT_APP_MEM_MODULES(X) \
+    X(MEM_MOD_POOL, "parameter pool", BT_APP_POOL_BLOCKS * BT_APP_POOL_BLOCK_SIZE) \
+    X(MEM_MOD_META, "metadata arena", BT_APP_META_ARENA_BYTES) \
+    X(MEM_MOD_ASRC, "ASRC state", sizeof(asrc_t)) \
+    X(MEM_MOD_PLC, "PLC history", sizeof(plc_t)) \
+    X(MEM_MOD_EQ, "EQ state", sizeof(eq_t)) \
+    X(MEM_MOD_DRC, "DRC delay lines", sizeof(drc_t)) \
+    X(MEM_MOD_DAC_QUEUE, "DAC queue and silence", OUTPUT_EVENT_DRIVEN ? OUTPUT_QUEUE_BYTES + OUTPUT_DMA_BUF_SIZE : 0) \
+    X(MEM_MOD_TRACE, "trace buffer", BT_APP_MEM_TRACE_BYTES)
+
+/**
+ * @brief Identifiers of the pipeline tasks.
+ */
+typedef enum
+{
+#define BT_APP_MEM_TASK_ID(id, name, bytes) id,
+    BT_APP_MEM_TASKS(BT_APP_MEM_TASK_ID)
+#undef BT_APP_MEM_TASK_ID
+    MEM_TASK_NUM,
+} bt_app_mem_task_t;
+
+/**
+ * @brief Identifiers of the pipeline buffers.
+ */
+typedef enum
+{
+#define BT_APP_MEM_BUF_ID(id, name, bytes) id,
+    BT_APP_MEM_BUFFERS(BT_APP_MEM_BUF_ID)
+#undef BT_APP_MEM_BUF_ID
+    MEM_BUF_NUM,
+} bt_app_mem_buf_t;
+
+/**
+ * @brief Identifiers of the module buffers.
+ */
+typedef enum
+{
+#define BT_APP_MEM_MOD_ID(id, name, bytes) id,
+    BT_APP_MEM_MODULES(BT_APP_MEM_MOD_ID)
+#undef BT_APP_MEM_MOD_ID
+    MEM_MOD_NUM,
+} bt_app_mem_mod_t;
+
+/* everything declared above, stacks and task control blocks included */
+#define BT_APP_MEM_TASK_BYTES(id, name, bytes) + (bytes) + sizeof(StaticTask_t)
+#define BT_APP_MEM_BUF_BYTES(id, name, bytes) + (bytes)
+#define BT_APP_MEM_TOTAL_BYTES \
+    (0 BT_APP_MEM_TASKS(BT_APP_MEM_TASK_BYTES) BT_APP_MEM_BUFFERS(BT_APP_MEM_BUF_BYTES) \
+     BT_APP_MEM_MODULES(BT_APP_MEM_BUF_BYTES))
+
+_Static_assert(BT_APP_MEM_TOTAL_BYTES <= BT_APP_MEM_BUDGET_BYTES, "pipeline memory exceeds BT_APP_MEM_BUDGET_BYTES");
+
+/**
+ * @brief Gets a buffer of the table.
+ *
+ * @param id The buffer.
+ * @return Pointer to the buffer, valid for the whole run time.
+ */
+void *bt_app_mem_get(bt_app_mem_buf_t id);
+
+/**
+ * @brief Creates a task of the table in its static stack and control block.
+ *
+ * The task must not be running, i.e. it was never created or was deleted with bt_app_mem_task_delete. If the kernel
+ * has not cleaned up the deleted instance yet, this waits for it before the control block is used again.
+ *
+ * @param id The task, which gives the name and the stack size.
+ * @param fn The task function.
+ * @param prio The priority.
+ * @param core The core to pin the task to, or tskNO_AFFINITY.
+ * @return The handle of the task.
+ */
+TaskHandle_t bt_app_mem_task_create(bt_app_mem_task_t id, TaskFunction_t fn, UBaseType_t prio, BaseType_t core);
+
+/**
+ * @brief Deletes a task of the table, keeping its stack high-water mark for bt_app_mem_report.
+ *
+ * @param id The task. Nothing is done if it is not running.
+ */
+void bt_app_mem_task_delete(bt_app_mem_task_t id);
+
+/**
+ * @brief Logs the tables, their total against the budget, the stack high-water mark of each task and the
+ * largest free block of the heap.
+ *
+ * The high-water mark of a task is the lowest free stack seen since boot, over all the times it was created.
+ */
+void bt_app_mem_report(void);
+
+#endif /* __BT_APP_MEM_H__ */
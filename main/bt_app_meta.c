@@ -0,0 +1,254 @@
+#include <string.h>
+
+#include "esp_avrc_api.h"
+
+#include "bt_app_meta.h"
+
+#include "sys/lock.h"
+
+/* index of no string */
+#define META_STR_NONE (0xff)
+
+/* a string of the arena */
+typedef struct
+{
+    uint16_t off;  /* offset in the arena */
+    uint16_t len;  /* length without the terminating 0 */
+    uint32_t hash; /* FNV-1a of the text, checked before comparing */
+    uint8_t refs;  /* attributes using the string, 0 if the entry is free */
+} bt_app_meta_str_t;
+
+/* the attributes of one track */
+typedef struct
+{
+    uint64_t uid;                 /* AVRCP UID of the track */
+    uint8_t str[META_ATTR_NUM];   /* string of each attribute, META_STR_NONE if unknown */
+} bt_app_meta_track_t;
+
+static _lock_t s_meta_lock;                                  /* guards everything below against readers */
+static char s_meta_arena[BT_APP_META_ARENA_BYTES];           /* texts, each terminated with 0 */
+static bt_app_meta_str_t s_meta_strs[BT_APP_META_STRINGS];   /* strings of the arena */
+static bt_app_meta_track_t s_meta_tracks[BT_APP_META_TRACKS] = {
+    [0 ... BT_APP_META_TRACKS - 1] = {.uid = BT_APP_META_UID_NONE, .str = {[0 ... META_ATTR_NUM - 1] = META_STR_NONE}},
+}; /* current track first */
+static bt_app_meta_stats_t s_meta_stats;                     /* counters */
+
+static uint32_t bt_app_meta_hash(const char *text, size_t len)
+{
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        hash = (hash ^ (uint8_t)text[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static void bt_app_meta_release(uint8_t str)
+{
+    if (str != META_STR_NONE)
+    {
+        s_meta_strs[str].refs--;
+    }
+}
+
+/* moves the live strings to the front of the arena in order of their offsets, which keeps them from overlapping */
+static void bt_app_meta_compact(void)
+{
+    uint16_t used = 0;
+
+    for (;;)
+    {
+        int next = -1;
+
+        for (int i = 0; i < BT_APP_META_STRINGS; i++)
+        {
+            if (s_meta_strs[i].refs > 0 && s_meta_strs[i].off >= used &&
+                (next < 0 || s_meta_strs[i].off < s_meta_strs[next].off))
+            {
+                next = i;
+            }
+        }
+        if (next < 0)
+        {
+            break;
+        }
+        memmove(&s_meta_arena[used], &s_meta_arena[s_meta_strs[next].off], s_meta_strs[next].len + 1);
+        s_meta_strs[next].off = used;
+        used += s_meta_strs[next].len + 1;
+    }
+    s_meta_stats.arena_used = used;
+    s_meta_stats.compactions++;
+}
+
+static uint8_t bt_app_meta_intern(const char *text, size_t len)
+{
+    uint32_t hash = 0;
+    int free_str = -1;
+
+    if (len > BT_APP_META_MAX_TEXT - 1)
+    {
+        len = BT_APP_META_MAX_TEXT - 1;
+        s_meta_stats.truncated++;
+    }
+    hash = bt_app_meta_hash(text, len);
+    for (int i = 0; i < BT_APP_META_STRINGS; i++)
+    {
+        if (s_meta_strs[i].refs == 0)
+        {
+            free_str = free_str < 0 ? i : free_str;
+        }
+        else if (s_meta_strs[i].hash == hash && s_meta_strs[i].len == len &&
+                 memcmp(&s_meta_arena[s_meta_strs[i].off], text, len) == 0)
+        {
+            s_meta_strs[i].refs++;
+            s_meta_stats.deduped++;
+            return (uint8_t)i;
+        }
+    }
+    /* the caller released the string it replaces, so an entry is always free */
+    if (free_str < 0)
+    {
+        return META_STR_NONE;
+    }
+    if (s_meta_stats.arena_used + len + 1 > BT_APP_META_ARENA_BYTES)
+    {
+        bt_app_meta_compact();
+    }
+    memcpy(&s_meta_arena[s_meta_stats.arena_used], text, len);
+    s_meta_arena[s_meta_stats.arena_used + len] = 0;
+    s_meta_strs[free_str].off = (uint16_t)s_meta_stats.arena_used;
+    s_meta_strs[free_str].len = (uint16_t)len;
+    s_meta_strs[free_str].hash = hash;
+    s_meta_strs[free_str].refs = 1;
+    s_meta_stats.arena_used += len + 1;
+    s_meta_stats.stored++;
+    return (uint8_t)free_str;
+}
+
+bt_app_meta_attr_t bt_app_meta_attr_from_id(uint8_t attr_id)
+{
+    switch (attr_id)
+    {
+    case ESP_AVRC_MD_ATTR_TITLE:
+        return META_ATTR_TITLE;
+    case ESP_AVRC_MD_ATTR_ARTIST:
+        return META_ATTR_ARTIST;
+    case ESP_AVRC_MD_ATTR_ALBUM:
+        return META_ATTR_ALBUM;
+    case ESP_AVRC_MD_ATTR_GENRE:
+        return META_ATTR_GENRE;
+    default:
+        return META_ATTR_NUM;
+    }
+}
+
+uint64_t bt_app_meta_uid_from_elm(const uint8_t *elm_id)
+{
+    uint64_t uid = 0;
+
+    for (int i = 0; i < 8; i++)
+    {
+        uid = (uid << 8) | elm_id[i];
+    }
+    return uid;
+}
+
+bool bt_app_meta_begin_track(uint64_t uid)
+{
+    bt_app_meta_track_t *cur = &s_meta_tracks[0];
+    bool known = false;
+
+    /* without identifiers every notification may be another track */
+    if (uid == cur->uid && uid != BT_APP_META_UID_UNKNOWN)
+    {
+        for (int a = 0; a < META_ATTR_NUM; a++)
+        {
+            known |= cur->str[a] != META_STR_NONE;
+        }
+        if (known || uid == BT_APP_META_UID_NONE)
+        {
+            s_meta_stats.skipped++;
+            return false;
+        }
+    }
+
+    _lock_acquire(&s_meta_lock);
+    for (int a = 0; a < META_ATTR_NUM; a++)
+    {
+        bt_app_meta_release(s_meta_tracks[BT_APP_META_TRACKS - 1].str[a]);
+    }
+    memmove(&s_meta_tracks[1], &s_meta_tracks[0], (BT_APP_META_TRACKS - 1) * sizeof(bt_app_meta_track_t));
+    cur->uid = uid;
+    memset(cur->str, META_STR_NONE, sizeof(cur->str));
+    _lock_release(&s_meta_lock);
+    return uid != BT_APP_META_UID_NONE;
+}
+
+void bt_app_meta_set(bt_app_meta_attr_t attr, const char *text, size_t len)
+{
+    uint8_t *str = &s_meta_tracks[0].str[attr];
+
+    _lock_acquire(&s_meta_lock);
+    bt_app_meta_release(*str);
+    *str = bt_app_meta_intern(text, len);
+    _lock_release(&s_meta_lock);
+}
+
+bool bt_app_meta_get(uint8_t track, bt_app_meta_attr_t attr, char *buf, size_t size)
+{
+    bool found = false;
+
+    if (size == 0)
+    {
+        return false;
+    }
+    buf[0] = 0;
+    if (track >= BT_APP_META_TRACKS || attr >= META_ATTR_NUM)
+    {
+        return false;
+    }
+    _lock_acquire(&s_meta_lock);
+    uint8_t str = s_meta_tracks[track].str[attr];
+    if (str != META_STR_NONE)
+    {
+        size_t len = s_meta_strs[str].len < size - 1 ? s_meta_strs[str].len : size - 1;
+
+        memcpy(buf, &s_meta_arena[s_meta_strs[str].off], len);
+        buf[len] = 0;
+        found = true;
+    }
+    _lock_release(&s_meta_lock);
+    return found;
+}
+
+uint64_t bt_app_meta_get_uid(uint8_t track)
+{
+    uint64_t uid = BT_APP_META_UID_NONE;
+
+    if (track < BT_APP_META_TRACKS)
+    {
+        _lock_acquire(&s_meta_lock);
+        uid = s_meta_tracks[track].uid;
+        _lock_release(&s_meta_lock);
+    }
+    return uid;
+}
+
+void bt_app_meta_clear(void)
+{
+    _lock_acquire(&s_meta_lock);
+    for (int t = 0; t < BT_APP_META_TRACKS; t++)
+    {
+        s_meta_tracks[t].uid = BT_APP_META_UID_NONE;
+        memset(s_meta_tracks[t].str, META_STR_NONE, sizeof(s_meta_tracks[t].str));
+    }
+    memset(s_meta_strs, 0, sizeof(s_meta_strs));
+    s_meta_stats.arena_used = 0;
+    _lock_release(&s_meta_lock);
+}
+
+const bt_app_meta_stats_t *bt_app_meta_get_stats(void)
+{
+    return &s_meta_stats;
+}
@@ -0,0 +1,116 @@
+#ifndef __BT_APP_META_H__
+#define __BT_APP_META_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define BT_APP_META_TAG "BT_APP_META"
+
+/* tracks kept: the current one and the previous one */
+#define BT_APP_META_TRACKS (2)
+/* longest text kept per attribute, including the terminating 0, longer texts are truncated */
+#define BT_APP_META_MAX_TEXT (128)
+/* distinct strings alive at once, enough for every attribute of every track */
+#define BT_APP_META_STRINGS (BT_APP_META_TRACKS * META_ATTR_NUM)
+/* size of the string arena, every live string always fits after compaction */
+#define BT_APP_META_ARENA_BYTES (BT_APP_META_STRINGS * BT_APP_META_MAX_TEXT)
+/* AVRCP track identifiers with a special meaning */
+#define BT_APP_META_UID_NONE (0xffffffffffffffffULL) /* no track selected */
+#define BT_APP_META_UID_UNKNOWN (0)                  /* a track is selected but the player has no identifiers */
+
+/**
+ * @brief Metadata attributes kept per track.
+ */
+typedef enum
+{
+    META_ATTR_TITLE,
+    META_ATTR_ARTIST,
+    META_ATTR_ALBUM,
+    META_ATTR_GENRE,
+    META_ATTR_NUM,
+} bt_app_meta_attr_t;
+
+/**
+ * @brief Counters of the cache.
+ */
+typedef struct
+{
+    uint32_t stored;      /*!< texts copied into the arena */
+    uint32_t deduped;     /*!< texts that were already in the arena, e.g. the artist of consecutive tracks */
+    uint32_t truncated;   /*!< texts cut to BT_APP_META_MAX_TEXT */
+    uint32_t compactions; /*!< times the arena was compacted to make room */
+    uint32_t skipped;     /*!< track changes whose metadata was not requested again */
+    uint32_t arena_used;  /*!< bytes of the arena in use, including dead strings not yet compacted */
+} bt_app_meta_stats_t;
+
+/**
+ * @brief Maps an AVRCP metadata attribute bit to the attribute kept by the cache.
+ *
+ * @param attr_id The ESP_AVRC_MD_ATTR_* bit of a metadata response.
+ * @return The attribute, or META_ATTR_NUM if it is not kept.
+ */
+bt_app_meta_attr_t bt_app_meta_attr_from_id(uint8_t attr_id);
+
+/**
+ * @brief Converts the element identifier of an AVRCP track change notification to a track UID.
+ *
+ * @param elm_id The 8-byte identifier, most significant byte first.
+ * @return The UID.
+ */
+uint64_t bt_app_meta_uid_from_elm(const uint8_t *elm_id);
+
+/**
+ * @brief Starts a new track. Must be called on the application task.
+ *
+ * If the UID is that of the current track and known, nothing changes. Otherwise the current track becomes
+ * the previous one, whose strings are released, and the new track starts without attributes.
+ *
+ * @param uid The UID of the track.
+ * @return true if the metadata of the track must be requested, false if the cache already holds it.
+ */
+bool bt_app_meta_begin_track(uint64_t uid);
+
+/**
+ * @brief Sets an attribute of the current track. Must be called on the application task.
+ *
+ * The text is interned: if the same text is already held, e.g. the album of the previous track, it is shared.
+ *
+ * @param attr The attribute.
+ * @param text The text, not necessarily terminated.
+ * @param len The length of the text.
+ */
+void bt_app_meta_set(bt_app_meta_attr_t attr, const char *text, size_t len);
+
+/**
+ * @brief Copies an attribute of a track. Safe to call from any task.
+ *
+ * @param track 0 for the current track, 1 for the previous one.
+ * @param attr The attribute.
+ * @param buf The buffer that receives the text, always terminated.
+ * @param size The size of the buffer.
+ * @return true if the attribute is known, false otherwise, in which case buf holds an empty string.
+ */
+bool bt_app_meta_get(uint8_t track, bt_app_meta_attr_t attr, char *buf, size_t size);
+
+/**
+ * @brief Gets the UID of a track. Safe to call from any task.
+ *
+ * @param track 0 for the current track, 1 for the previous one.
+ * @return The UID, BT_APP_META_UID_NONE if there is no such track.
+ */
+uint64_t bt_app_meta_get_uid(uint8_t track);
+
+/**
+ * @brief Forgets both tracks, e.g. when the controller disconnects. Must be called on the application task.
+ */
+void bt_app_meta_clear(void);
+
+/**
+ * @brief Gets the counters of the cache.
+ *
+ * @return Pointer to the counters.
+ */
+const bt_app_meta_stats_t *bt_app_meta_get_stats(void);
+
+#endif /* __BT_APP_META_H__ */
@@ -0,0 +1,142 @@
+#include <stdatomic.h>
+#include <inttypes.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "bt_app_output.h"
+#include "bt_app_stats.h"
+
+static const output_backend_t *s_backend = &OUTPUT_BACKEND_DEFAULT; /* selected backend */
+static bool s_opened = false;                    /* the backend has been opened once */
+static uint32_t s_sample_rate = 44100;           /* active sample rate */
+static uint8_t s_ch_count = 2;                   /* active channel count */
+static atomic_uint s_pending_cfg = 0;            /* requested configuration waiting for the writer, 0 if none */
+static atomic_llong s_cfg_time_us = -1;          /* time of the last configuration request, -1 once measured */
+static int64_t s_cfg_to_first_sample_us = -1;    /* last measured time from request to first sample */
+static int64_t s_boot_to_first_sample_us = -1;   /* time from boot to the first sample ever written */
+
+/* a requested rate and channel count travel in one word, so the writer never pairs the rate of one request
+ * with the channel count of another */
+#define OUTPUT_CFG_PACK(rate, ch) (((unsigned int)(rate) << 8) | (ch))
+#define OUTPUT_CFG_RATE(cfg) ((uint32_t)((cfg) >> 8))
+#define OUTPUT_CFG_CH(cfg) ((uint8_t)((cfg) & 0xff))
+
+esp_err_t output_select(const output_backend_t *backend)
+{
+    if (s_opened)
+    {
+        ESP_LOGE(BT_OUTPUT_TAG, "%s %s already in use", __func__, s_backend->name);
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_backend = backend;
+    return ESP_OK;
+}
+
+const output_backend_t *output_get_backend(void)
+{
+    return s_backend;
+}
+
+esp_err_t output_init(void)
+{
+    unsigned int cfg = 0;
+    esp_err_t err = ESP_OK;
+
+    /* a configuration requested before the first open is used right away instead of retuning later */
+    if (!s_opened && (cfg = atomic_exchange(&s_pending_cfg, 0)) != 0)
+    {
+        s_sample_rate = OUTPUT_CFG_RATE(cfg);
+        s_ch_count = OUTPUT_CFG_CH(cfg);
+    }
+    err = s_backend->open(s_sample_rate, s_ch_count);
+
+    if (err == ESP_OK && !s_opened)
+    {
+        s_opened = true;
+        ESP_LOGI(BT_OUTPUT_TAG, "backend %s, %u bit, %u samples per chunk", s_backend->name, s_backend->bits,
+                 (unsigned)s_backend->chunk_samples);
+    }
+    return err;
+}
+
+void output_configure(uint32_t sample_rate, uint8_t ch_count)
+{
+    atomic_store(&s_cfg_time_us, esp_timer_get_time());
+    if (sample_rate == s_sample_rate && ch_count == s_ch_count && atomic_load(&s_pending_cfg) == 0)
+    {
+        ESP_LOGI(BT_OUTPUT_TAG, "configuration unchanged, keep channels");
+        return;
+    }
+    atomic_store(&s_pending_cfg, OUTPUT_CFG_PACK(sample_rate, ch_count));
+}
+
+esp_err_t output_write(const void *data, size_t len)
+{
+    long long cfg_time_us = 0;
+    int64_t write_start_us = 0;
+    unsigned int cfg = 0;
+    esp_err_t err = ESP_OK;
+
+    if (!s_opened)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if ((cfg = atomic_exchange(&s_pending_cfg, 0)) != 0)
+    {
+        if ((err = s_backend->reconfigure(OUTPUT_CFG_RATE(cfg), OUTPUT_CFG_CH(cfg))) != ESP_OK)
+        {
+            return err;
+        }
+        s_sample_rate = OUTPUT_CFG_RATE(cfg);
+        s_ch_count = OUTPUT_CFG_CH(cfg);
+    }
+
+    write_start_us = esp_timer_get_time();
+    err = s_backend->write(data, len);
+    BT_APP_STATS_RECORD(STATS_HIST_OUTPUT_WRITE_US, (uint32_t)(esp_timer_get_time() - write_start_us));
+
+    cfg_time_us = atomic_exchange(&s_cfg_time_us, -1);
+    if (cfg_time_us >= 0)
+    {
+        s_cfg_to_first_sample_us = esp_timer_get_time() - cfg_time_us;
+        ESP_LOGI(BT_OUTPUT_TAG, "config to first sample: %" PRId64 " us", s_cfg_to_first_sample_us);
+    }
+    if (s_boot_to_first_sample_us < 0 && err == ESP_OK)
+    {
+        s_boot_to_first_sample_us = esp_timer_get_time();
+        ESP_LOGI(BT_OUTPUT_TAG, "boot to first sample: %" PRId64 " ms", s_boot_to_first_sample_us / 1000);
+    }
+    return err;
+}
+
+void output_pause(void)
+{
+    if (s_opened)
+    {
+        s_backend->pause();
+    }
+}
+
+void output_release_writer(void)
+{
+    if (s_backend->release_writer)
+    {
+        s_backend->release_writer();
+    }
+}
+
+uint32_t output_get_headroom_us(void)
+{
+    return s_backend->get_headroom_us();
+}
+
+int64_t output_get_cfg_to_first_sample_us(void)
+{
+    return s_cfg_to_first_sample_us;
+}
+
+int64_t output_get_boot_to_first_sample_us(void)
+{
+    return s_boot_to_first_sample_us;
+}
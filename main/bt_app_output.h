@@ -0,0 +1,185 @@
+#ifndef __BT_APP_OUTPUT_H__
+#define __BT_APP_OUTPUT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+#define BT_OUTPUT_TAG "BT_OUTPUT"
+
+/* largest chunk any backend may ask for, in samples */
+#define OUTPUT_MAX_CHUNK_SAMPLES (2048)
+/* how long the writer may wait for input when the backend cannot tell how much it has queued */
+#define OUTPUT_BLOCKING_HEADROOM_US (20000)
+
+/* backend used unless another one is selected before output_init */
+#ifndef OUTPUT_BACKEND_DEFAULT
+#define OUTPUT_BACKEND_DEFAULT output_backend_dac
+#endif
+
+/* internal DAC: DMA layout of the output channels, allocated once for the life of the process */
+#define OUTPUT_DMA_DESC_NUM (8)
+#define OUTPUT_DMA_BUF_SIZE (2048)
+/* internal DAC: the DMA reads one 16-bit slot per sample, so a descriptor holds half as many samples as bytes */
+#define OUTPUT_DAC_SLOT_BYTES (2)
+#define OUTPUT_DMA_BUF_SAMPLES (OUTPUT_DMA_BUF_SIZE / OUTPUT_DAC_SLOT_BYTES)
+
+/* internal DAC: refill DMA descriptors from the convert-done callback instead of blocking in dac_continuous_write */
+#ifndef OUTPUT_EVENT_DRIVEN
+#define OUTPUT_EVENT_DRIVEN (1)
+#endif
+/* internal DAC: codes queued ahead of the callback in event-driven mode, a power of two and whole descriptors */
+#define OUTPUT_QUEUE_BYTES (OUTPUT_DMA_BUF_SIZE * 2)
+/* internal DAC: longest sleep of the writer waiting for a descriptor before the output is considered stalled */
+#define OUTPUT_WRITE_TIMEOUT_MS (500)
+/* internal DAC: samples between the writer and the DAC pins */
+#if OUTPUT_EVENT_DRIVEN
+#define OUTPUT_LATENCY_SAMPLES \
+    ((OUTPUT_DMA_DESC_NUM * OUTPUT_DMA_BUF_SIZE + OUTPUT_QUEUE_BYTES) / OUTPUT_DAC_SLOT_BYTES)
+#else
+#define OUTPUT_LATENCY_SAMPLES (OUTPUT_DMA_DESC_NUM * OUTPUT_DMA_BUF_SAMPLES)
+#endif
+
+/* external I2S DAC such as PCM5102: pins, slot width (16, 24 or 32) and DMA layout */
+#ifndef OUTPUT_I2S_BCK_IO
+#define OUTPUT_I2S_BCK_IO (26)
+#endif
+#ifndef OUTPUT_I2S_WS_IO
+#define OUTPUT_I2S_WS_IO (25)
+#endif
+#ifndef OUTPUT_I2S_DOUT_IO
+#define OUTPUT_I2S_DOUT_IO (22)
+#endif
+#ifndef OUTPUT_I2S_BITS
+#define OUTPUT_I2S_BITS (16)
+#endif
+#define OUTPUT_I2S_DMA_DESC_NUM (6)
+#define OUTPUT_I2S_DMA_FRAME_NUM (240)
+
+/* file sink: path of the WAV file, started over at boot and on every format change */
+#ifndef OUTPUT_FILE_PATH
+#define OUTPUT_FILE_PATH "/tmp/bt_sink.wav"
+#endif
+
+/**
+ * @brief Sample formats a backend can take.
+ */
+typedef enum
+{
+    OUTPUT_FMT_DAC, /*!< unsigned 8-bit codes centred on 128, in the high byte of 16-bit slots */
+    OUTPUT_FMT_S16, /*!< signed 16-bit, native endian */
+    OUTPUT_FMT_S32, /*!< signed 32-bit, left-justified */
+} output_format_t;
+
+/**
+ * @brief Operations and properties of an output backend.
+ *
+ * All operations except configure-time bookkeeping run on the writer task; output_pause may also be
+ * called from the control task while the writer is not running.
+ */
+typedef struct
+{
+    const char *name;             /*!< name used in logs */
+    output_format_t format;       /*!< sample format taken by write */
+    uint8_t bits;                 /*!< resolution of the converter, decides how much quiet audio is lifted */
+    size_t chunk_samples;         /*!< preferred number of samples per write, at most OUTPUT_MAX_CHUNK_SAMPLES */
+    esp_err_t (*open)(uint32_t sample_rate, uint8_t ch_count);        /*!< allocate once, then (re-)enable */
+    esp_err_t (*reconfigure)(uint32_t sample_rate, uint8_t ch_count); /*!< change format before the next write */
+    esp_err_t (*write)(const void *data, size_t len);                 /*!< queue samples, may block */
+    void (*pause)(void);                                              /*!< stop without releasing resources */
+    void (*release_writer)(void);                                     /*!< forget the writer task, may be NULL */
+    uint32_t (*get_headroom_us)(void);                                /*!< playable time queued outside DMA */
+} output_backend_t;
+
+extern const output_backend_t output_backend_dac;
+extern const output_backend_t output_backend_i2s;
+extern const output_backend_t output_backend_file;
+
+/**
+ * @brief Chooses the backend. Must be called before output_init, later calls are refused.
+ *
+ * @param backend The backend.
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if the output is already initialized.
+ */
+esp_err_t output_select(const output_backend_t *backend);
+
+/**
+ * @brief Gets the selected backend.
+ *
+ * @return The backend, never NULL.
+ */
+const output_backend_t *output_get_backend(void);
+
+/**
+ * @brief Allocates and enables the output, with the configuration requested so far or 44.1 kHz stereo.
+ *
+ * The resources of the backend are kept for the life of the process; calling this function
+ * again after the first successful call only re-enables the output if it was paused.
+ *
+ * @return ESP_OK on success, or the error returned by the backend.
+ */
+esp_err_t output_init(void);
+
+/**
+ * @brief Requests a new sample rate and channel mode.
+ *
+ * If the configuration matches the active one, nothing is torn down. Otherwise the change is applied by the
+ * writer right before its next block, which may be mid-stream. The internal DAC first plays out the samples it
+ * has queued and waits until its DMA outputs only silence, then rebuilds its channels. In both cases the time from
+ * this call to the first sample written afterwards is measured.
+ *
+ * @param sample_rate The sample rate in Hz.
+ * @param ch_count The number of channels, 1 or 2.
+ */
+void output_configure(uint32_t sample_rate, uint8_t ch_count);
+
+/**
+ * @brief Writes a block of samples in the backend format to the output, blocking until it is queued.
+ *
+ * A pending configuration is applied and a paused output is re-enabled first. Must only be called
+ * from the single writer task. In event-driven mode the internal DAC queues the block for its DMA callback,
+ * and the writer sleeps on its task notification until there is room, so it must not rely on task
+ * notifications for anything that cannot tolerate a spurious wake-up.
+ *
+ * @param data Pointer to the samples.
+ * @param len The number of bytes to write.
+ * @return ESP_OK on success, or the error returned by the backend.
+ */
+esp_err_t output_write(const void *data, size_t len);
+
+/**
+ * @brief Stops the output without releasing its resources. Must not race with output_write.
+ */
+void output_pause(void);
+
+/**
+ * @brief Stops waking the writer task from the backend. Must be called before the writer task is deleted.
+ */
+void output_release_writer(void);
+
+/**
+ * @brief Gets how long the output can keep playing from samples queued by the writer but not yet in DMA.
+ *
+ * The writer uses this as the longest time it may wait for input before it has to produce audio anyway.
+ *
+ * @return The time in microseconds. OUTPUT_BLOCKING_HEADROOM_US for backends that block in write.
+ */
+uint32_t output_get_headroom_us(void);
+
+/**
+ * @brief Gets the time from the last configuration request to the first sample written after it.
+ *
+ * @return The time in microseconds, or -1 if nothing has been measured yet.
+ */
+int64_t output_get_cfg_to_first_sample_us(void);
+
+/**
+ * @brief Gets the time from boot to the first sample written to the output.
+ *
+ * @return The time in microseconds, or -1 if nothing has been written since boot.
+ */
+int64_t output_get_boot_to_first_sample_us(void);
+
+#endif /* __BT_APP_OUTPUT_H__ */
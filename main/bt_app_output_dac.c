@@ -0,0 +1,319 @@
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+#include "driver/dac_continuous.h"
+
+#include "bt_app_output.h"
+#include "bt_app_fifo.h"
+#include "bt_app_stats.h"
+
+_Static_assert((OUTPUT_QUEUE_BYTES & (OUTPUT_QUEUE_BYTES - 1)) == 0, "output queue size must be a power of two");
+_Static_assert(OUTPUT_QUEUE_BYTES % OUTPUT_DMA_BUF_SIZE == 0, "output queue must hold whole descriptors");
+_Static_assert(OUTPUT_DMA_BUF_SAMPLES <= OUTPUT_MAX_CHUNK_SAMPLES, "DAC descriptors must fit a chunk");
+
+static dac_continuous_handle_t s_tx_chan = NULL; /* handle of the DAC channels, rebuilt on a format change */
+static bool s_enabled = false;                   /* DAC channels are enabled */
+static uint32_t s_sample_rate = 0;               /* active sample rate */
+static uint8_t s_ch_count = 0;                   /* active channel count */
+#if OUTPUT_EVENT_DRIVEN
+static audio_fifo_t s_out_queue;                 /* DAC slots waiting for a free descriptor */
+static uint8_t s_out_queue_storage[OUTPUT_QUEUE_BYTES];
+static uint16_t s_out_silence[OUTPUT_DMA_BUF_SIZE / sizeof(uint16_t)]; /* mid-scale, played when the queue runs dry */
+static TaskHandle_t s_writer_task = NULL;        /* task woken when a descriptor has been refilled */
+static portMUX_TYPE s_writer_lock = portMUX_INITIALIZER_UNLOCKED;
+static atomic_uint s_silent_descs;               /* descriptors loaded with silence in a row */
+static atomic_bool s_draining;                   /* silence is wanted, not an underrun */
+
+/* runs from flash: the FIFO and stats helpers it calls are not in IRAM, so CONFIG_DAC_ISR_IRAM_SAFE stays off and
+ * the callback is held off while the flash cache is disabled, e.g. during an NVS write */
+static bool dac_on_convert_done(dac_continuous_handle_t handle, const dac_event_data_t *event, void *user_data)
+{
+    BaseType_t need_yield = pdFALSE;
+    audio_fifo_span_t spans[2];
+    size_t loaded = 0;
+
+    /* the queue only ever drains whole descriptors from aligned offsets, so a full block never wraps */
+    if (audio_fifo_read_spans(&s_out_queue, spans, event->buf_size) == event->buf_size)
+    {
+        dac_continuous_write_asynchronously(handle, event->buf, event->buf_size, spans[0].data, spans[0].len, &loaded);
+        audio_fifo_consume(&s_out_queue, event->buf_size);
+        atomic_store_explicit(&s_silent_descs, 0, memory_order_relaxed);
+    }
+    else
+    {
+        dac_continuous_write_asynchronously(handle, event->buf, event->buf_size, (const uint8_t *)s_out_silence,
+                                            event->buf_size, &loaded);
+        atomic_fetch_add_explicit(&s_silent_descs, 1, memory_order_relaxed);
+        if (!atomic_load_explicit(&s_draining, memory_order_relaxed))
+        {
+            BT_APP_STATS_INC(STATS_CNT_OUTPUT_UNDERRUNS);
+        }
+    }
+
+    portENTER_CRITICAL_ISR(&s_writer_lock);
+    if (s_writer_task)
+    {
+        vTaskNotifyGiveFromISR(s_writer_task, &need_yield);
+    }
+    portEXIT_CRITICAL_ISR(&s_writer_lock);
+    return need_yield == pdTRUE;
+}
+#endif
+
+static esp_err_t dac_open_channels(uint32_t sample_rate, uint8_t ch_count)
+{
+    dac_continuous_config_t cont_cfg = {
+        .chan_mask = DAC_CHANNEL_MASK_ALL,
+        .desc_num = OUTPUT_DMA_DESC_NUM,
+        .buf_size = OUTPUT_DMA_BUF_SIZE,
+        .freq_hz = sample_rate,
+        .offset = 0, /* the codes are already centred on 128 */
+        .clk_src = DAC_DIGI_CLK_SRC_DEFAULT, // Using APLL as clock source to get a wider frequency range
+        .chan_mode = (ch_count == 1) ? DAC_CHANNEL_MODE_SIMUL : DAC_CHANNEL_MODE_ALTER,
+    };
+    esp_err_t err = ESP_OK;
+
+    /* Allocate continuous channels */
+    if ((err = dac_continuous_new_channels(&cont_cfg, &s_tx_chan)) != ESP_OK)
+    {
+        ESP_LOGE(BT_OUTPUT_TAG, "%s new channels failed: %s", __func__, esp_err_to_name(err));
+        s_tx_chan = NULL;
+        return err;
+    }
+#if OUTPUT_EVENT_DRIVEN
+    /* the callback has to be registered while the channels are still disabled */
+    dac_event_callbacks_t cbs = {
+        .on_convert_done = dac_on_convert_done,
+    };
+    if ((err = dac_continuous_register_event_callback(s_tx_chan, &cbs, NULL)) != ESP_OK)
+    {
+        ESP_LOGE(BT_OUTPUT_TAG, "%s register callback failed: %s", __func__, esp_err_to_name(err));
+        dac_continuous_del_channels(s_tx_chan);
+        s_tx_chan = NULL;
+        return err;
+    }
+#endif
+    s_sample_rate = sample_rate;
+    s_ch_count = ch_count;
+    ESP_LOGI(BT_OUTPUT_TAG, "%s mode, latency %" PRIu32 " us", OUTPUT_EVENT_DRIVEN ? "event-driven" : "blocking",
+             (uint32_t)((uint64_t)OUTPUT_LATENCY_SAMPLES * 1000000 / (sample_rate * ch_count)));
+    return ESP_OK;
+}
+
+static esp_err_t dac_enable(void)
+{
+    esp_err_t err = ESP_OK;
+
+    if (!s_enabled)
+    {
+        /* Enable the continuous channels */
+        if ((err = dac_continuous_enable(s_tx_chan)) != ESP_OK)
+        {
+            ESP_LOGE(BT_OUTPUT_TAG, "%s enable failed: %s", __func__, esp_err_to_name(err));
+            return err;
+        }
+#if OUTPUT_EVENT_DRIVEN
+        if ((err = dac_continuous_start_async_writing(s_tx_chan)) != ESP_OK)
+        {
+            ESP_LOGE(BT_OUTPUT_TAG, "%s start async writing failed: %s", __func__, esp_err_to_name(err));
+            dac_continuous_disable(s_tx_chan);
+            return err;
+        }
+#endif
+        s_enabled = true;
+    }
+    return ESP_OK;
+}
+
+static void dac_disable(void)
+{
+    if (s_enabled)
+    {
+#if OUTPUT_EVENT_DRIVEN
+        dac_continuous_stop_async_writing(s_tx_chan);
+#endif
+        dac_continuous_disable(s_tx_chan);
+        s_enabled = false;
+    }
+}
+
+#if OUTPUT_EVENT_DRIVEN
+/* plays out the queued descriptors and waits until the callback has loaded silence into every DMA descriptor */
+static void dac_drain(void)
+{
+    if (!s_enabled)
+    {
+        return;
+    }
+    if (s_writer_task == NULL)
+    {
+        portENTER_CRITICAL(&s_writer_lock);
+        s_writer_task = xTaskGetCurrentTaskHandle();
+        portEXIT_CRITICAL(&s_writer_lock);
+    }
+    atomic_store(&s_draining, true);
+    atomic_store(&s_silent_descs, 0);
+    while (atomic_load(&s_silent_descs) < OUTPUT_DMA_DESC_NUM)
+    {
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(OUTPUT_WRITE_TIMEOUT_MS)) == 0)
+        {
+            ESP_LOGW(BT_OUTPUT_TAG, "%s timed out", __func__);
+            break;
+        }
+    }
+    atomic_store(&s_draining, false);
+}
+#endif
+
+static esp_err_t dac_reconfigure(uint32_t sample_rate, uint8_t ch_count)
+{
+    esp_err_t err = ESP_OK;
+
+    if (sample_rate == s_sample_rate && ch_count == s_ch_count)
+    {
+        return ESP_OK;
+    }
+
+    /* the DAC driver has no way to change the rate of live channels, so they are rebuilt. This runs on the writer
+     * before its next block, possibly mid-stream. In event-driven mode the codes already queued are played at the
+     * old rate and the channels stop once the DMA outputs only mid-scale, so the waveform is not cut */
+    ESP_LOGI(BT_OUTPUT_TAG, "retune %" PRIu32 " Hz/%u ch -> %" PRIu32 " Hz/%u ch",
+             s_sample_rate, s_ch_count, sample_rate, ch_count);
+#if OUTPUT_EVENT_DRIVEN
+    dac_drain();
+#endif
+    dac_disable();
+#if OUTPUT_EVENT_DRIVEN
+    /* the callback is stopped, a partial descriptor left in the queue belongs to the old format */
+    audio_fifo_reset(&s_out_queue);
+#endif
+    dac_continuous_del_channels(s_tx_chan);
+    s_tx_chan = NULL;
+    if ((err = dac_open_channels(sample_rate, ch_count)) != ESP_OK)
+    {
+        return err;
+    }
+    return dac_enable();
+}
+
+static esp_err_t dac_open(uint32_t sample_rate, uint8_t ch_count)
+{
+    esp_err_t err = ESP_OK;
+
+#if OUTPUT_EVENT_DRIVEN
+    if (s_out_queue.buf == NULL)
+    {
+        audio_fifo_init(&s_out_queue, s_out_queue_storage, sizeof(s_out_queue_storage));
+        for (size_t i = 0; i < sizeof(s_out_silence) / sizeof(s_out_silence[0]); i++)
+        {
+            s_out_silence[i] = 128 << 8;
+        }
+    }
+#endif
+
+    if (s_tx_chan == NULL && (err = dac_open_channels(sample_rate, ch_count)) != ESP_OK)
+    {
+        return err;
+    }
+    return dac_enable();
+}
+
+static esp_err_t dac_write(const void *data, size_t len)
+{
+    const uint8_t *slots = data;
+    size_t bytes_written = 0;
+    esp_err_t err = ESP_OK;
+
+    if ((err = dac_enable()) != ESP_OK)
+    {
+        return err;
+    }
+
+#if OUTPUT_EVENT_DRIVEN
+    /* queue the block for the DMA callback, sleeping until it frees a descriptor's worth of space */
+    if (s_writer_task == NULL)
+    {
+        portENTER_CRITICAL(&s_writer_lock);
+        s_writer_task = xTaskGetCurrentTaskHandle();
+        portEXIT_CRITICAL(&s_writer_lock);
+    }
+    while (len > 0)
+    {
+        bytes_written = audio_fifo_space(&s_out_queue);
+        if (bytes_written > len)
+        {
+            bytes_written = len;
+        }
+        if (bytes_written > 0)
+        {
+            audio_fifo_write(&s_out_queue, slots, bytes_written);
+            slots += bytes_written;
+            len -= bytes_written;
+            continue;
+        }
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(OUTPUT_WRITE_TIMEOUT_MS)) == 0)
+        {
+            err = ESP_ERR_TIMEOUT;
+            break;
+        }
+        BT_APP_STATS_INC(STATS_CNT_WAKEUPS);
+    }
+#else
+    err = dac_continuous_write(s_tx_chan, (uint8_t *)slots, len, &bytes_written, -1);
+    BT_APP_STATS_INC(STATS_CNT_WAKEUPS);
+#endif
+    return err;
+}
+
+static void dac_pause(void)
+{
+    if (s_tx_chan)
+    {
+        dac_disable();
+    }
+#if OUTPUT_EVENT_DRIVEN
+    /* the callback is stopped, so stale samples can be dropped without racing it */
+    audio_fifo_reset(&s_out_queue);
+#endif
+}
+
+static void dac_release_writer(void)
+{
+#if OUTPUT_EVENT_DRIVEN
+    portENTER_CRITICAL(&s_writer_lock);
+    s_writer_task = NULL;
+    portEXIT_CRITICAL(&s_writer_lock);
+#endif
+}
+
+static uint32_t dac_get_headroom_us(void)
+{
+#if OUTPUT_EVENT_DRIVEN
+    if (s_sample_rate == 0)
+    {
+        return 0;
+    }
+    return (uint32_t)((uint64_t)audio_fifo_fill(&s_out_queue) / OUTPUT_DAC_SLOT_BYTES * 1000000 /
+                      (s_sample_rate * s_ch_count));
+#else
+    return OUTPUT_BLOCKING_HEADROOM_US;
+#endif
+}
+
+const output_backend_t output_backend_dac = {
+    .name = "dac",
+    .format = OUTPUT_FMT_DAC,
+    .bits = 8,
+    .chunk_samples = OUTPUT_DMA_BUF_SAMPLES,
+    .open = dac_open,
+    .reconfigure = dac_reconfigure,
+    .write = dac_write,
+    .pause = dac_pause,
+    .release_writer = dac_release_writer,
+    .get_headroom_us = dac_get_headroom_us,
+};
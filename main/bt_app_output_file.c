@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <inttypes.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "bt_app_output.h"
+#include "bt_app_stats.h"
+
+/* samples per write, the sink has no DMA to match */
+#define OUTPUT_FILE_CHUNK_SAMPLES (1024)
+/* size of the canonical PCM WAV header */
+#define OUTPUT_FILE_HEADER_BYTES (44)
+
+static FILE *s_file = NULL;        /* open WAV file, NULL until the first open */
+static uint32_t s_sample_rate = 0; /* sample rate of the file */
+static uint8_t s_ch_count = 0;     /* channel count of the file */
+static uint32_t s_data_bytes = 0;  /* bytes of samples written so far */
+static int64_t s_start_us = 0;     /* time the first sample would have played on a real device */
+static uint64_t s_paced_bytes = 0; /* bytes written since s_start_us */
+
+static void file_put_le(uint8_t *p, uint32_t v, size_t bytes)
+{
+    for (size_t i = 0; i < bytes; i++)
+    {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static bool file_write_header(void)
+{
+    uint8_t hdr[OUTPUT_FILE_HEADER_BYTES];
+    uint32_t block_align = s_ch_count * sizeof(int16_t);
+
+    memcpy(hdr, "RIFF", 4);
+    file_put_le(hdr + 4, OUTPUT_FILE_HEADER_BYTES - 8 + s_data_bytes, 4);
+    memcpy(hdr + 8, "WAVEfmt ", 8);
+    file_put_le(hdr + 16, 16, 4);
+    file_put_le(hdr + 20, 1, 2);
+    file_put_le(hdr + 22, s_ch_count, 2);
+    file_put_le(hdr + 24, s_sample_rate, 4);
+    file_put_le(hdr + 28, s_sample_rate * block_align, 4);
+    file_put_le(hdr + 32, block_align, 2);
+    file_put_le(hdr + 34, 16, 2);
+    memcpy(hdr + 36, "data", 4);
+    file_put_le(hdr + 40, s_data_bytes, 4);
+
+    return fseek(s_file, 0, SEEK_SET) == 0 && fwrite(hdr, 1, sizeof(hdr), s_file) == sizeof(hdr);
+}
+
+/* patches the sizes into the header and closes the file, used when the format changes */
+static void file_close(void)
+{
+    if (s_file == NULL)
+    {
+        return;
+    }
+    if (!file_write_header())
+    {
+        ESP_LOGE(BT_OUTPUT_TAG, "%s header update failed", __func__);
+    }
+    fclose(s_file);
+    s_file = NULL;
+    ESP_LOGI(BT_OUTPUT_TAG, "%s: %" PRIu32 " bytes of audio", OUTPUT_FILE_PATH, s_data_bytes);
+}
+
+/* patches the sizes into the header so that the file is valid after every pause, but keeps appending to it */
+static void file_pause(void)
+{
+    if (s_file == NULL)
+    {
+        return;
+    }
+    if (!file_write_header() || fflush(s_file) != 0 || fseek(s_file, 0, SEEK_END) != 0)
+    {
+        ESP_LOGE(BT_OUTPUT_TAG, "%s header update failed", __func__);
+    }
+    ESP_LOGI(BT_OUTPUT_TAG, "%s: %" PRIu32 " bytes of audio so far", OUTPUT_FILE_PATH, s_data_bytes);
+}
+
+static esp_err_t file_open(uint32_t sample_rate, uint8_t ch_count)
+{
+    if (s_file)
+    {
+        return ESP_OK;
+    }
+    if ((s_file = fopen(OUTPUT_FILE_PATH, "wb")) == NULL)
+    {
+        ESP_LOGE(BT_OUTPUT_TAG, "%s cannot open %s", __func__, OUTPUT_FILE_PATH);
+        return ESP_FAIL;
+    }
+    s_sample_rate = sample_rate;
+    s_ch_count = ch_count;
+    s_data_bytes = 0;
+    s_paced_bytes = 0;
+    s_start_us = esp_timer_get_time();
+    /* placeholder sizes, patched on every pause */
+    if (!file_write_header())
+    {
+        ESP_LOGE(BT_OUTPUT_TAG, "%s header write failed", __func__);
+        fclose(s_file);
+        s_file = NULL;
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t file_reconfigure(uint32_t sample_rate, uint8_t ch_count)
+{
+    if (s_file && sample_rate == s_sample_rate && ch_count == s_ch_count)
+    {
+        return ESP_OK;
+    }
+    /* a WAV file has a single format, so a new one is started */
+    file_close();
+    return file_open(sample_rate, ch_count);
+}
+
+/* time the samples written so far would take to play, ahead of now */
+static int64_t file_ahead_us(void)
+{
+    if (s_sample_rate == 0)
+    {
+        return 0;
+    }
+    return s_start_us + (int64_t)(s_paced_bytes * 1000000 / (s_sample_rate * s_ch_count * sizeof(int16_t))) -
+           esp_timer_get_time();
+}
+
+static esp_err_t file_write(const void *data, size_t len)
+{
+    esp_err_t err = ESP_OK;
+    int64_t ahead_us = 0;
+
+    if (s_file == NULL && (err = file_open(s_sample_rate, s_ch_count)) != ESP_OK)
+    {
+        return err;
+    }
+    if (fwrite(data, 1, len, s_file) != len)
+    {
+        ESP_LOGE(BT_OUTPUT_TAG, "%s failed", __func__);
+        return ESP_FAIL;
+    }
+    s_data_bytes += len;
+    s_paced_bytes += len;
+
+    /* drain at the sample rate like a real output would, so the jitter buffer and the ASRC see a clock */
+    ahead_us = file_ahead_us();
+    if (ahead_us < 0)
+    {
+        /* the writer stalled, restart the clock instead of bursting to catch up */
+        s_start_us = esp_timer_get_time();
+        s_paced_bytes = len;
+    }
+    else if (ahead_us > OUTPUT_BLOCKING_HEADROOM_US)
+    {
+        vTaskDelay(pdMS_TO_TICKS((ahead_us - OUTPUT_BLOCKING_HEADROOM_US) / 1000));
+    }
+    BT_APP_STATS_INC(STATS_CNT_WAKEUPS);
+    return ESP_OK;
+}
+
+static uint32_t file_get_headroom_us(void)
+{
+    int64_t ahead_us = file_ahead_us();
+
+    return ahead_us > 0 ? (uint32_t)ahead_us : 0;
+}
+
+const output_backend_t output_backend_file = {
+    .name = "file",
+    .format = OUTPUT_FMT_S16,
+    .bits = 16,
+    .chunk_samples = OUTPUT_FILE_CHUNK_SAMPLES,
+    .open = file_open,
+    .reconfigure = file_reconfigure,
+    .write = file_write,
+    .pause = file_pause,
+    .release_writer = NULL,
+    .get_headroom_us = file_get_headroom_us,
+};
@@ -0,0 +1,165 @@
+#include <inttypes.h>
+
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+
+#include "driver/i2s_std.h"
+
+#include "bt_app_output.h"
+#include "bt_app_stats.h"
+
+_Static_assert(OUTPUT_I2S_BITS == 16 || OUTPUT_I2S_BITS == 24 || OUTPUT_I2S_BITS == 32, "unsupported I2S slot width");
+
+/* 24-bit converters are fed left-justified samples in 32-bit slots */
+#if OUTPUT_I2S_BITS == 16
+#define OUTPUT_I2S_DATA_WIDTH I2S_DATA_BIT_WIDTH_16BIT
+#else
+#define OUTPUT_I2S_DATA_WIDTH I2S_DATA_BIT_WIDTH_32BIT
+#endif
+
+static i2s_chan_handle_t s_tx_chan = NULL; /* handle of the I2S TX channel, never deleted */
+static bool s_enabled = false;             /* I2S channel is enabled */
+static uint32_t s_sample_rate = 0;         /* active sample rate */
+static uint8_t s_ch_count = 0;             /* active channel count */
+
+static esp_err_t i2s_out_enable(void)
+{
+    esp_err_t err = ESP_OK;
+
+    if (!s_enabled)
+    {
+        if ((err = i2s_channel_enable(s_tx_chan)) != ESP_OK)
+        {
+            ESP_LOGE(BT_OUTPUT_TAG, "%s enable failed: %s", __func__, esp_err_to_name(err));
+            return err;
+        }
+        s_enabled = true;
+    }
+    return ESP_OK;
+}
+
+static void i2s_out_disable(void)
+{
+    if (s_enabled)
+    {
+        i2s_channel_disable(s_tx_chan);
+        s_enabled = false;
+    }
+}
+
+static esp_err_t i2s_out_open(uint32_t sample_rate, uint8_t ch_count)
+{
+    i2s_chan_config_t chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM_AUTO, I2S_ROLE_MASTER);
+    i2s_std_config_t std_cfg = {
+        .clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(sample_rate),
+        .slot_cfg = I2S_STD_PHILIPS_SLOT_DEFAULT_CONFIG(OUTPUT_I2S_DATA_WIDTH,
+                                                        ch_count == 1 ? I2S_SLOT_MODE_MONO : I2S_SLOT_MODE_STEREO),
+        .gpio_cfg = {
+            .mclk = I2S_GPIO_UNUSED,
+            .bclk = OUTPUT_I2S_BCK_IO,
+            .ws = OUTPUT_I2S_WS_IO,
+            .dout = OUTPUT_I2S_DOUT_IO,
+            .din = I2S_GPIO_UNUSED,
+        },
+    };
+    esp_err_t err = ESP_OK;
+
+    if (s_tx_chan)
+    {
+        return i2s_out_enable();
+    }
+
+    chan_cfg.dma_desc_num = OUTPUT_I2S_DMA_DESC_NUM;
+    chan_cfg.dma_frame_num = OUTPUT_I2S_DMA_FRAME_NUM;
+    /* play silence instead of repeating the last descriptor when the writer falls behind */
+    chan_cfg.auto_clear = true;
+    if ((err = i2s_new_channel(&chan_cfg, &s_tx_chan, NULL)) != ESP_OK)
+    {
+        ESP_LOGE(BT_OUTPUT_TAG, "%s new channel failed: %s", __func__, esp_err_to_name(err));
+        s_tx_chan = NULL;
+        return err;
+    }
+    if ((err = i2s_channel_init_std_mode(s_tx_chan, &std_cfg)) != ESP_OK)
+    {
+        ESP_LOGE(BT_OUTPUT_TAG, "%s init std mode failed: %s", __func__, esp_err_to_name(err));
+        i2s_del_channel(s_tx_chan);
+        s_tx_chan = NULL;
+        return err;
+    }
+    s_sample_rate = sample_rate;
+    s_ch_count = ch_count;
+    ESP_LOGI(BT_OUTPUT_TAG, "i2s %d bit, bck %d ws %d dout %d", OUTPUT_I2S_BITS, OUTPUT_I2S_BCK_IO, OUTPUT_I2S_WS_IO,
+             OUTPUT_I2S_DOUT_IO);
+    return i2s_out_enable();
+}
+
+static esp_err_t i2s_out_reconfigure(uint32_t sample_rate, uint8_t ch_count)
+{
+    i2s_std_clk_config_t clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(sample_rate);
+    i2s_std_slot_config_t slot_cfg = I2S_STD_PHILIPS_SLOT_DEFAULT_CONFIG(OUTPUT_I2S_DATA_WIDTH,
+                                                                         ch_count == 1 ? I2S_SLOT_MODE_MONO : I2S_SLOT_MODE_STEREO);
+    esp_err_t err = ESP_OK;
+
+    if (sample_rate == s_sample_rate && ch_count == s_ch_count)
+    {
+        return ESP_OK;
+    }
+
+    /* unlike the internal DAC, the I2S clock and slots can be changed on the disabled channel */
+    ESP_LOGI(BT_OUTPUT_TAG, "retune %" PRIu32 " Hz/%u ch -> %" PRIu32 " Hz/%u ch",
+             s_sample_rate, s_ch_count, sample_rate, ch_count);
+    i2s_out_disable();
+    if ((err = i2s_channel_reconfig_std_clock(s_tx_chan, &clk_cfg)) != ESP_OK ||
+        (err = i2s_channel_reconfig_std_slot(s_tx_chan, &slot_cfg)) != ESP_OK)
+    {
+        ESP_LOGE(BT_OUTPUT_TAG, "%s failed: %s", __func__, esp_err_to_name(err));
+        return err;
+    }
+    s_sample_rate = sample_rate;
+    s_ch_count = ch_count;
+    return i2s_out_enable();
+}
+
+static esp_err_t i2s_out_write(const void *data, size_t len)
+{
+    size_t bytes_written = 0;
+    esp_err_t err = ESP_OK;
+
+    if ((err = i2s_out_enable()) != ESP_OK)
+    {
+        return err;
+    }
+    err = i2s_channel_write(s_tx_chan, data, len, &bytes_written, portMAX_DELAY);
+    BT_APP_STATS_INC(STATS_CNT_WAKEUPS);
+    return err;
+}
+
+static void i2s_out_pause(void)
+{
+    if (s_tx_chan)
+    {
+        i2s_out_disable();
+    }
+}
+
+static uint32_t i2s_out_get_headroom_us(void)
+{
+    return OUTPUT_BLOCKING_HEADROOM_US;
+}
+
+const output_backend_t output_backend_i2s = {
+    .name = "i2s",
+#if OUTPUT_I2S_BITS == 16
+    .format = OUTPUT_FMT_S16,
+#else
+    .format = OUTPUT_FMT_S32,
+#endif
+    .bits = OUTPUT_I2S_BITS,
+    .chunk_samples = OUTPUT_I2S_DMA_FRAME_NUM * 4,
+    .open = i2s_out_open,
+    .reconfigure = i2s_out_reconfigure,
+    .write = i2s_out_write,
+    .pause = i2s_out_pause,
+    .release_writer = NULL,
+    .get_headroom_us = i2s_out_get_headroom_us,
+};
@@ -0,0 +1,75 @@
+#include <string.h>
+
+#include "bt_app_pcm.h"
+
+/* linear congruential generator used for dither, one step per output sample */
+#define PCM_LCG_MUL (1664525u)
+#define PCM_LCG_ADD (1013904223u)
+
+static inline int32_t pcm_volume_to_gain(uint8_t volume)
+{
+    if (volume > PCM_VOLUME_MAX)
+    {
+        volume = PCM_VOLUME_MAX;
+    }
+    /* Q15 gain, 127 * 258 = 32766 is unity */
+    return (int32_t)volume * 258;
+}
+
+static inline uint8_t pcm_sample_to_u8(int32_t sample, int32_t gain, uint32_t rnd)
+{
+    /* TPDF dither: difference of two uniform 8-bit values spans +/-1 LSB of the 8-bit output */
+    int32_t dither = (int32_t)(rnd & 0xff) - (int32_t)((rnd >> 8) & 0xff);
+    int32_t v = ((sample * gain) >> 15) + dither + 128;
+
+    if (v > INT16_MAX)
+    {
+        v = INT16_MAX;
+    }
+    else if (v < INT16_MIN)
+    {
+        v = INT16_MIN;
+    }
+    return (uint8_t)((v >> 8) + 128);
+}
+
+void pcm_s16_to_dac(const int16_t *src, uint16_t *dst, size_t samples, uint8_t volume, uint32_t *seed)
+{
+    const int32_t gain = pcm_volume_to_gain(volume);
+    uint32_t rnd = *seed;
+    size_t i = 0;
+
+    if (((uintptr_t)dst & 0x3) == 0)
+    {
+        for (; i + 2 <= samples; i += 2)
+        {
+            /* load both inputs first so that an in-place conversion never overwrites an unread sample */
+            int32_t s0 = src[i];
+            int32_t s1 = src[i + 1];
+            uint32_t word;
+
+            rnd = rnd * PCM_LCG_MUL + PCM_LCG_ADD;
+            word = (uint32_t)pcm_sample_to_u8(s0, gain, rnd >> 16) << 8;
+            rnd = rnd * PCM_LCG_MUL + PCM_LCG_ADD;
+            word |= (uint32_t)pcm_sample_to_u8(s1, gain, rnd >> 16) << 24;
+            /* the DMA reads the slots in memory order, the packed store is little-endian */
+            memcpy(&dst[i], &word, sizeof(word));
+        }
+    }
+
+    for (; i < samples; i++)
+    {
+        rnd = rnd * PCM_LCG_MUL + PCM_LCG_ADD;
+        dst[i] = (uint16_t)(pcm_sample_to_u8(src[i], gain, rnd >> 16) << 8);
+    }
+
+    *seed = rnd;
+}
+
+void pcm_s16_to_s32(const int16_t *src, int32_t *dst, size_t samples)
+{
+    for (size_t i = 0; i < samples; i++)
+    {
+        dst[i] = (int32_t)src[i] * (1 << 16);
+    }
+}
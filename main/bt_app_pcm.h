@@ -0,0 +1,37 @@
+#ifndef __BT_APP_PCM_H__
+#define __BT_APP_PCM_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* maximum volume value used by AVRCP absolute volume */
+#define PCM_VOLUME_MAX (0x7f)
+
+/**
+ * @brief Converts signed 16-bit PCM to 16-bit DAC DMA slots with volume and dither in one pass.
+ *
+ * Every input sample is scaled by the volume, has TPDF dither of +/-1 output LSB added, is rounded and
+ * saturated to an unsigned 8-bit code centred on 128. The ESP32 DAC DMA reads one 16-bit slot per sample and
+ * converts its high byte, so the code is stored as code << 8. Two slots are packed into one 32-bit store per
+ * iteration when the destination is word aligned; the remaining samples use the scalar path.
+ * The conversion may be done in place (dst == (uint16_t *)src), since every output slot lands on the input
+ * sample it was computed from.
+ *
+ * @param src Pointer to the signed 16-bit input samples (interleaved channels are treated alike).
+ * @param dst Pointer to the 16-bit output slots. It must hold at least `samples` values.
+ * @param samples The number of samples (not frames) to convert.
+ * @param volume The volume level, as a value between 0 and 127 (0x7f), inclusive.
+ * @param seed Pointer to the dither generator state. It is updated on return and must not be NULL.
+ */
+void pcm_s16_to_dac(const int16_t *src, uint16_t *dst, size_t samples, uint8_t volume, uint32_t *seed);
+
+/**
+ * @brief Converts signed 16-bit PCM to left-justified signed 32-bit samples for wide I2S slots.
+ *
+ * @param src Pointer to the signed 16-bit input samples.
+ * @param dst Pointer to the 32-bit output buffer. It must hold at least `samples` values.
+ * @param samples The number of samples (not frames) to convert.
+ */
+void pcm_s16_to_s32(const int16_t *src, int32_t *dst, size_t samples);
+
+#endif /* __BT_APP_PCM_H__ */
@@ -0,0 +1,250 @@
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "esp_a2dp_api.h"
+#include "esp_gap_bt_api.h"
+
+#include "bt_app_core.h"
+#include "bt_app_peer.h"
+
+/* layout of the NVS record */
+typedef struct __attribute__((packed))
+{
+    uint8_t version;                       /* BT_APP_PEER_NVS_VERSION */
+    uint8_t count;                         /* valid entries */
+    bt_app_peer_t peers[BT_APP_PEER_MAX];  /* most recent first */
+} bt_app_peer_record_t;
+
+static bt_app_peer_record_t s_peer_rec = {.version = BT_APP_PEER_NVS_VERSION}; /* list of remembered sources */
+static esp_timer_handle_t s_peer_timer = NULL; /* timer of the next page attempt */
+static bool s_peer_paging = false;             /* page attempts are in progress */
+static uint8_t s_peer_next = 0;                /* entry paged next */
+static uint8_t s_peer_rounds = 0;              /* completed rounds over the list */
+static uint32_t s_peer_delay_ms = 0;           /* delay before the next round */
+
+static int bt_app_peer_index(const esp_bd_addr_t bda)
+{
+    for (int i = 0; i < s_peer_rec.count; i++)
+    {
+        if (memcmp(s_peer_rec.peers[i].bda, bda, ESP_BD_ADDR_LEN) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void bt_app_peer_save(void)
+{
+    nvs_handle_t handle = 0;
+    esp_err_t err = ESP_OK;
+
+    if ((err = nvs_open(BT_APP_PEER_NVS_NAMESPACE, NVS_READWRITE, &handle)) != ESP_OK)
+    {
+        ESP_LOGE(BT_APP_PEER_TAG, "%s open failed: %s", __func__, esp_err_to_name(err));
+        return;
+    }
+    if ((err = nvs_set_blob(handle, BT_APP_PEER_NVS_KEY, &s_peer_rec, sizeof(s_peer_rec))) != ESP_OK ||
+        (err = nvs_commit(handle)) != ESP_OK)
+    {
+        ESP_LOGE(BT_APP_PEER_TAG, "%s write failed: %s", __func__, esp_err_to_name(err));
+    }
+    nvs_close(handle);
+}
+
+size_t bt_app_peer_load(void)
+{
+    bt_app_peer_record_t rec;
+    size_t len = sizeof(rec);
+    nvs_handle_t handle = 0;
+    esp_err_t err = ESP_OK;
+
+    s_peer_rec.count = 0;
+    if ((err = nvs_open(BT_APP_PEER_NVS_NAMESPACE, NVS_READONLY, &handle)) != ESP_OK)
+    {
+        /* nothing saved yet */
+        return 0;
+    }
+    err = nvs_get_blob(handle, BT_APP_PEER_NVS_KEY, &rec, &len);
+    nvs_close(handle);
+    if (err != ESP_OK || len != sizeof(rec) || rec.version != BT_APP_PEER_NVS_VERSION || rec.count > BT_APP_PEER_MAX)
+    {
+        return 0;
+    }
+    s_peer_rec = rec;
+    ESP_LOGI(BT_APP_PEER_TAG, "%u remembered sources", s_peer_rec.count);
+    return s_peer_rec.count;
+}
+
+bool bt_app_peer_find(const esp_bd_addr_t bda, bt_app_peer_t *peer)
+{
+    int i = bt_app_peer_index(bda);
+
+    if (i < 0)
+    {
+        return false;
+    }
+    if (peer)
+    {
+        *peer = s_peer_rec.peers[i];
+    }
+    return true;
+}
+
+bool bt_app_peer_get_recent(bt_app_peer_t *peer)
+{
+    if (s_peer_rec.count == 0)
+    {
+        return false;
+    }
+    *peer = s_peer_rec.peers[0];
+    return true;
+}
+
+void bt_app_peer_remember(const esp_bd_addr_t bda, uint8_t codec_type, const uint8_t *cie)
+{
+    bt_app_peer_t entry;
+    int i = bt_app_peer_index(bda);
+
+    memcpy(entry.bda, bda, ESP_BD_ADDR_LEN);
+    entry.codec_type = codec_type;
+    memcpy(entry.cie, cie, sizeof(entry.cie));
+
+    /* spare the flash when the same source reconnects with the same configuration */
+    if (i == 0 && memcmp(&s_peer_rec.peers[0], &entry, sizeof(entry)) == 0)
+    {
+        return;
+    }
+    if (i < 0)
+    {
+        i = s_peer_rec.count < BT_APP_PEER_MAX ? s_peer_rec.count++ : BT_APP_PEER_MAX - 1;
+    }
+    memmove(&s_peer_rec.peers[1], &s_peer_rec.peers[0], i * sizeof(bt_app_peer_t));
+    s_peer_rec.peers[0] = entry;
+    bt_app_peer_save();
+}
+
+/* drops the entries whose bond was removed, they could not be reconnected without pairing anyway */
+static void bt_app_peer_prune(void)
+{
+    esp_bd_addr_t bonded[BT_APP_PEER_MAX * 2];
+    int num = sizeof(bonded) / sizeof(bonded[0]);
+    uint8_t kept = 0;
+
+    if (esp_bt_gap_get_bond_device_list(&num, bonded) != ESP_OK)
+    {
+        return;
+    }
+    for (uint8_t i = 0; i < s_peer_rec.count; i++)
+    {
+        for (int b = 0; b < num; b++)
+        {
+            if (memcmp(bonded[b], s_peer_rec.peers[i].bda, ESP_BD_ADDR_LEN) == 0)
+            {
+                s_peer_rec.peers[kept++] = s_peer_rec.peers[i];
+                break;
+            }
+        }
+    }
+    if (kept != s_peer_rec.count)
+    {
+        ESP_LOGI(BT_APP_PEER_TAG, "%u sources no longer bonded", s_peer_rec.count - kept);
+        s_peer_rec.count = kept;
+        bt_app_peer_save();
+    }
+}
+
+static void bt_app_peer_page(void)
+{
+    uint8_t *bda = s_peer_rec.peers[s_peer_next].bda;
+    esp_err_t err = ESP_OK;
+
+    ESP_LOGI(BT_APP_PEER_TAG, "paging [%02x:%02x:%02x:%02x:%02x:%02x], round %u",
+             bda[0], bda[1], bda[2], bda[3], bda[4], bda[5], s_peer_rounds + 1);
+    if ((err = esp_a2d_sink_connect(bda)) != ESP_OK)
+    {
+        /* no connection state event follows a refused request, so move on right away */
+        ESP_LOGE(BT_APP_PEER_TAG, "%s connect failed: %s", __func__, esp_err_to_name(err));
+        bt_app_peer_on_connection(bda, false);
+    }
+}
+
+static void bt_app_peer_hdl_retry(uint16_t event, void *param)
+{
+    if (s_peer_paging)
+    {
+        bt_app_peer_page();
+    }
+}
+
+static void bt_app_peer_timer_cb(void *arg)
+{
+    /* page from the application task, where all other profile calls are made */
+    bt_app_work_dispatch(bt_app_peer_hdl_retry, 0, NULL, 0, NULL);
+}
+
+esp_err_t bt_app_peer_reconnect_start(void)
+{
+    const esp_timer_create_args_t args = {
+        .callback = bt_app_peer_timer_cb,
+        .name = "bt_app_peer",
+    };
+    esp_err_t err = ESP_OK;
+
+    bt_app_peer_prune();
+    if (s_peer_rec.count == 0)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (s_peer_timer == NULL && (err = esp_timer_create(&args, &s_peer_timer)) != ESP_OK)
+    {
+        ESP_LOGE(BT_APP_PEER_TAG, "%s timer create failed: %s", __func__, esp_err_to_name(err));
+        return err;
+    }
+    s_peer_paging = true;
+    s_peer_next = 0;
+    s_peer_rounds = 0;
+    s_peer_delay_ms = BT_APP_PEER_RETRY_MIN_MS;
+    bt_app_peer_page();
+    return ESP_OK;
+}
+
+void bt_app_peer_on_connection(const esp_bd_addr_t bda, bool connected)
+{
+    uint32_t delay_ms = 0;
+
+    if (!s_peer_paging)
+    {
+        return;
+    }
+    if (connected)
+    {
+        /* whoever connected, the speaker is in use now */
+        s_peer_paging = false;
+        esp_timer_stop(s_peer_timer);
+        return;
+    }
+    if (memcmp(bda, s_peer_rec.peers[s_peer_next].bda, ESP_BD_ADDR_LEN) != 0)
+    {
+        return;
+    }
+
+    /* the paged source did not answer, try the next one shortly and back off after a full round */
+    delay_ms = BT_APP_PEER_RETRY_MIN_MS;
+    if (++s_peer_next == s_peer_rec.count)
+    {
+        s_peer_next = 0;
+        if (++s_peer_rounds == BT_APP_PEER_RETRY_ROUNDS)
+        {
+            ESP_LOGI(BT_APP_PEER_TAG, "no source answered, waiting to be connected");
+            s_peer_paging = false;
+            return;
+        }
+        delay_ms = s_peer_delay_ms;
+        s_peer_delay_ms = s_peer_delay_ms * 2 > BT_APP_PEER_RETRY_MAX_MS ? BT_APP_PEER_RETRY_MAX_MS : s_peer_delay_ms * 2;
+    }
+    esp_timer_stop(s_peer_timer);
+    esp_timer_start_once(s_peer_timer, (uint64_t)delay_ms * 1000);
+}
@@ -0,0 +1,91 @@
+#ifndef __BT_APP_PEER_H__
+#define __BT_APP_PEER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+#include "esp_bt_defs.h"
+
+#define BT_APP_PEER_TAG "BT_APP_PEER"
+
+/* number of sources remembered, most recent first */
+#define BT_APP_PEER_MAX (4)
+/* NVS location of the list */
+#define BT_APP_PEER_NVS_NAMESPACE "bt_app"
+#define BT_APP_PEER_NVS_KEY "peers"
+#define BT_APP_PEER_NVS_VERSION (1)
+/* delay before the next page attempt, doubled after every round over the list up to the maximum */
+#define BT_APP_PEER_RETRY_MIN_MS (1000)
+#define BT_APP_PEER_RETRY_MAX_MS (30000)
+/* rounds over the list before giving up and waiting to be connected */
+#define BT_APP_PEER_RETRY_ROUNDS (4)
+
+/**
+ * @brief A remembered A2DP source and the codec configuration it negotiated last.
+ */
+typedef struct __attribute__((packed))
+{
+    esp_bd_addr_t bda;  /*!< address of the source */
+    uint8_t codec_type; /*!< esp_a2d_mct_t of the last stream */
+    uint8_t cie[4];     /*!< codec information element of the last stream */
+} bt_app_peer_t;
+
+/**
+ * @brief Loads the list of sources from NVS. Must be called after nvs_flash_init.
+ *
+ * A missing or outdated record leaves the list empty.
+ *
+ * @return The number of sources loaded.
+ */
+size_t bt_app_peer_load(void);
+
+/**
+ * @brief Looks up a source in the list.
+ *
+ * @param bda The address of the source.
+ * @param peer Filled with the entry if found. May be NULL.
+ * @return true if the source is in the list.
+ */
+bool bt_app_peer_find(const esp_bd_addr_t bda, bt_app_peer_t *peer);
+
+/**
+ * @brief Gets the most recently connected source.
+ *
+ * @param peer Filled with the entry if the list is not empty.
+ * @return true if a source is remembered.
+ */
+bool bt_app_peer_get_recent(bt_app_peer_t *peer);
+
+/**
+ * @brief Moves a source to the front of the list with its codec configuration and saves the list.
+ *
+ * NVS is only written if the list actually changed.
+ *
+ * @param bda The address of the source.
+ * @param codec_type The codec of the stream.
+ * @param cie The codec information element, 4 bytes.
+ */
+void bt_app_peer_remember(const esp_bd_addr_t bda, uint8_t codec_type, const uint8_t *cie);
+
+/**
+ * @brief Starts paging the remembered sources, most recent first. Must be called on the application task.
+ *
+ * Sources that are no longer bonded are dropped first. Each failed attempt moves to the next source; after
+ * each round over the list the delay doubles, from BT_APP_PEER_RETRY_MIN_MS up to BT_APP_PEER_RETRY_MAX_MS.
+ * Paging stops when any source connects or after BT_APP_PEER_RETRY_ROUNDS rounds.
+ *
+ * @return ESP_OK if paging started, ESP_ERR_NOT_FOUND if no source is remembered.
+ */
+esp_err_t bt_app_peer_reconnect_start(void);
+
+/**
+ * @brief Feeds an A2DP connection state change to the reconnection logic. Must be called on the application task.
+ *
+ * @param bda The address of the source.
+ * @param connected true for the connected state, false for the disconnected state.
+ */
+void bt_app_peer_on_connection(const esp_bd_addr_t bda, bool connected);
+
+#endif /* __BT_APP_PEER_H__ */
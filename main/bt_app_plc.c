@@ -0,0 +1,183 @@
+#include <string.h>
+
+#include "bt_app_plc.h"
+
+/* frame index `back` frames before the newest one */
+static inline uint32_t plc_hist_index(const plc_t *plc, uint32_t back)
+{
+    return (plc->hist_pos + PLC_HIST_FRAMES - 1 - back) % PLC_HIST_FRAMES;
+}
+
+static inline float plc_mono(const plc_t *plc, uint32_t back)
+{
+    const int16_t *f = &plc->hist[plc_hist_index(plc, back) * plc->channels];
+
+    return (plc->channels == 1) ? f[0] : 0.5f * ((float)f[0] + (float)f[1]);
+}
+
+/* pick the lag with the highest normalized correlation between the newest window and the one before it */
+static uint32_t plc_find_period(const plc_t *plc)
+{
+    uint32_t min_lag = plc->sample_rate / 400;   /* 2.5 ms */
+    uint32_t max_lag = plc->sample_rate / 66;    /* 15 ms */
+    uint32_t best_lag = 0;
+    float best_score = 0.0f;
+
+    if (max_lag + PLC_SEARCH_WINDOW > plc->hist_fill)
+    {
+        max_lag = plc->hist_fill - PLC_SEARCH_WINDOW;
+    }
+
+    /* coarse search on every second lag and sample is enough for waveform repetition */
+    for (uint32_t lag = min_lag; lag <= max_lag; lag += 2)
+    {
+        float corr = 0.0f;
+        float energy = 0.0f;
+
+        for (uint32_t n = 0; n < PLC_SEARCH_WINDOW; n += 2)
+        {
+            float a = plc_mono(plc, n);
+            float b = plc_mono(plc, n + lag);
+
+            corr += a * b;
+            energy += b * b;
+        }
+        if (corr > 0.0f && energy > 0.0f && corr * corr / energy > best_score)
+        {
+            best_score = corr * corr / energy;
+            best_lag = lag;
+        }
+    }
+
+    /* no periodicity found (noise or silence), repeat the longest period to avoid a buzzing loop */
+    return best_lag ? best_lag : max_lag;
+}
+
+/* synthetic frame `g` of the current gap, with fade-out over the second half of the gap */
+static void plc_synth_frame(const plc_t *plc, uint32_t g, uint32_t max_frames, int16_t *out)
+{
+    uint32_t back = plc->period - 1 - (g % plc->period);
+    const int16_t *src = &plc->hist[plc_hist_index(plc, back) * plc->channels];
+    int32_t gain = 32768;
+
+    if (g >= max_frames)
+    {
+        gain = 0;
+    }
+    else if (g > max_frames / 2)
+    {
+        gain = (int32_t)((uint64_t)(max_frames - g) * 32768 / (max_frames - max_frames / 2));
+    }
+
+    for (uint8_t c = 0; c < plc->channels; c++)
+    {
+        out[c] = (int16_t)((src[c] * gain) >> 15);
+    }
+}
+
+static uint32_t plc_max_frames(const plc_t *plc)
+{
+    return plc->sample_rate * PLC_MAX_CONCEAL_MS / 1000;
+}
+
+static void plc_end_gap(plc_t *plc)
+{
+    plc->stats.gaps++;
+    plc->stats.concealed_frames += plc->gap_frames;
+    if (plc->gap_frames > plc->stats.longest_gap_frames)
+    {
+        plc->stats.longest_gap_frames = plc->gap_frames;
+    }
+    plc->concealing = false;
+}
+
+void plc_init(plc_t *plc, uint8_t channels, uint32_t sample_rate)
+{
+    memset(&plc->stats, 0, sizeof(plc->stats));
+    plc_set_format(plc, channels, sample_rate);
+}
+
+void plc_set_format(plc_t *plc, uint8_t channels, uint32_t sample_rate)
+{
+    plc->channels = (channels == 1) ? 1 : PLC_MAX_CHANNELS;
+    plc->sample_rate = sample_rate;
+    plc_reset(plc);
+}
+
+void plc_reset(plc_t *plc)
+{
+    plc->hist_pos = 0;
+    plc->hist_fill = 0;
+    plc->concealing = false;
+    plc->period = 0;
+    plc->gap_frames = 0;
+}
+
+void plc_feed(plc_t *plc, int16_t *pcm, size_t frames)
+{
+    const uint8_t ch = plc->channels;
+
+    if (plc->concealing)
+    {
+        /* overlap-add: continue the synthetic signal and fade it into the real one */
+        uint32_t max_frames = plc_max_frames(plc);
+        size_t fade = frames < PLC_FADE_FRAMES ? frames : PLC_FADE_FRAMES;
+        int16_t synth[PLC_MAX_CHANNELS];
+
+        for (size_t i = 0; i < fade; i++)
+        {
+            int32_t w = (int32_t)((i + 1) * 32768 / (fade + 1));
+
+            plc_synth_frame(plc, plc->gap_frames + i, max_frames, synth);
+            for (uint8_t c = 0; c < ch; c++)
+            {
+                pcm[i * ch + c] = (int16_t)((pcm[i * ch + c] * w + synth[c] * (32768 - w)) >> 15);
+            }
+        }
+        plc_end_gap(plc);
+    }
+
+    for (size_t i = 0; i < frames; i++)
+    {
+        memcpy(&plc->hist[plc->hist_pos * ch], &pcm[i * ch], ch * sizeof(int16_t));
+        plc->hist_pos = (plc->hist_pos + 1) % PLC_HIST_FRAMES;
+    }
+    plc->hist_fill = (plc->hist_fill + frames > PLC_HIST_FRAMES) ? PLC_HIST_FRAMES : plc->hist_fill + frames;
+}
+
+size_t plc_conceal(plc_t *plc, int16_t *out, size_t frames)
+{
+    uint32_t max_frames = plc_max_frames(plc);
+
+    if (!plc->concealing)
+    {
+        if (plc->hist_fill < PLC_HIST_FRAMES)
+        {
+            return 0;
+        }
+        plc->period = plc_find_period(plc);
+        plc->gap_frames = 0;
+        plc->concealing = true;
+    }
+
+    if (plc->gap_frames >= max_frames)
+    {
+        /* give up, the caller rebuffers; the history is stale now */
+        plc->stats.exhausted++;
+        plc_end_gap(plc);
+        plc->hist_fill = 0;
+        return 0;
+    }
+
+    for (size_t i = 0; i < frames; i++)
+    {
+        plc_synth_frame(plc, plc->gap_frames + i, max_frames, &out[i * plc->channels]);
+    }
+    plc->gap_frames += frames;
+    return frames;
+}
+
+const plc_stats_t *plc_get_stats(const plc_t *plc)
+{
+    return &plc->stats;
+}
@@ -0,0 +1,105 @@
+#ifndef __BT_APP_PLC_H__
+#define __BT_APP_PLC_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define PLC_MAX_CHANNELS (2)
+/* history kept for the pitch search, must cover the longest period plus the search window */
+#define PLC_HIST_FRAMES (1024)
+/* length of the correlation window used by the pitch search */
+#define PLC_SEARCH_WINDOW (256)
+/* length of the overlap-add cross-fade back into real audio */
+#define PLC_FADE_FRAMES (64)
+/* longest gap that is concealed, the second half of it fades out to silence */
+#define PLC_MAX_CONCEAL_MS (80)
+
+/**
+ * @brief Counters of the packet-loss concealment stage.
+ */
+typedef struct
+{
+    uint32_t gaps;               /*!< number of concealed gaps */
+    uint32_t exhausted;          /*!< gaps that outlasted PLC_MAX_CONCEAL_MS and ended in a rebuffer */
+    uint32_t concealed_frames;   /*!< total number of synthesized frames */
+    uint32_t longest_gap_frames; /*!< length of the longest gap */
+} plc_stats_t;
+
+/**
+ * @brief Packet-loss concealment state.
+ *
+ * The stage keeps the most recent output in a history ring. When the FIFO runs dry, it estimates the pitch
+ * period of the history and repeats the last period, fading it out over the second half of
+ * PLC_MAX_CONCEAL_MS. When real audio returns, the synthetic signal is cross-faded into it.
+ */
+typedef struct
+{
+    uint8_t channels;                                   /*!< number of interleaved channels */
+    uint32_t sample_rate;                               /*!< sample rate in Hz */
+    int16_t hist[PLC_HIST_FRAMES * PLC_MAX_CHANNELS];   /*!< ring of the last output frames */
+    uint32_t hist_pos;                                  /*!< next write position in the ring */
+    uint32_t hist_fill;                                 /*!< valid frames in the ring */
+    bool concealing;                                    /*!< a gap is being concealed */
+    uint32_t period;                                    /*!< repetition period of the current gap */
+    uint32_t gap_frames;                                /*!< frames synthesized in the current gap */
+    plc_stats_t stats;                                  /*!< counters */
+} plc_t;
+
+/**
+ * @brief Initializes the stage and clears its history and counters.
+ *
+ * @param plc Pointer to the stage.
+ * @param channels The number of interleaved channels, 1 or 2.
+ * @param sample_rate The sample rate in Hz.
+ */
+void plc_init(plc_t *plc, uint8_t channels, uint32_t sample_rate);
+
+/**
+ * @brief Changes the stream format after a codec reconfiguration. The history is cleared, counters are kept.
+ *
+ * @param plc Pointer to the stage.
+ * @param channels The number of interleaved channels, 1 or 2.
+ * @param sample_rate The sample rate in Hz.
+ */
+void plc_set_format(plc_t *plc, uint8_t channels, uint32_t sample_rate);
+
+/**
+ * @brief Clears the history and ends any gap without counting it. Counters are kept.
+ *
+ * @param plc Pointer to the stage.
+ */
+void plc_reset(plc_t *plc);
+
+/**
+ * @brief Passes real audio through the stage.
+ *
+ * The frames are appended to the history. If a gap was being concealed, the start of the block is
+ * cross-faded in place from the synthetic signal and the gap is counted.
+ *
+ * @param plc Pointer to the stage.
+ * @param pcm Pointer to the interleaved frames, modified in place.
+ * @param frames The number of frames.
+ */
+void plc_feed(plc_t *plc, int16_t *pcm, size_t frames);
+
+/**
+ * @brief Synthesizes frames for a gap.
+ *
+ * @param plc Pointer to the stage.
+ * @param out Pointer to the output buffer.
+ * @param frames The number of frames requested.
+ * @return The number of frames synthesized, 0 once the gap is longer than PLC_MAX_CONCEAL_MS or if there
+ *         is not enough history.
+ */
+size_t plc_conceal(plc_t *plc, int16_t *out, size_t frames);
+
+/**
+ * @brief Returns the counters of the stage.
+ *
+ * @param plc Pointer to the stage.
+ * @return Pointer to the counters.
+ */
+const plc_stats_t *plc_get_stats(const plc_t *plc);
+
+#endif /* __BT_APP_PLC_H__ */
@@ -0,0 +1,76 @@
+#include <inttypes.h>
+
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_system.h"
+
+#include "bt_app_pool.h"
+
+_Static_assert(BT_APP_POOL_BLOCKS <= 32, "pool bitmap is a single word");
+
+static uint8_t s_pool_blocks[BT_APP_POOL_BLOCKS][BT_APP_POOL_BLOCK_SIZE] __attribute__((aligned(4)));
+static uint32_t s_pool_free_mask = (BT_APP_POOL_BLOCKS == 32) ? UINT32_MAX : ((1u << BT_APP_POOL_BLOCKS) - 1);
+static bt_app_pool_stats_t s_pool_stats;
+static portMUX_TYPE s_pool_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void *bt_app_pool_alloc(void)
+{
+    void *block = NULL;
+
+    portENTER_CRITICAL_SAFE(&s_pool_lock);
+    if (s_pool_free_mask)
+    {
+        int idx = __builtin_ctz(s_pool_free_mask);
+
+        s_pool_free_mask &= ~(1u << idx);
+        block = s_pool_blocks[idx];
+        s_pool_stats.allocs++;
+        if (++s_pool_stats.in_use > s_pool_stats.high_water)
+        {
+            s_pool_stats.high_water = s_pool_stats.in_use;
+        }
+    }
+    else
+    {
+        s_pool_stats.failures++;
+    }
+    portEXIT_CRITICAL_SAFE(&s_pool_lock);
+
+    return block;
+}
+
+void bt_app_pool_free(void *block)
+{
+    size_t idx = 0;
+
+    if (block == NULL)
+    {
+        return;
+    }
+
+    idx = ((uint8_t *)block - &s_pool_blocks[0][0]) / BT_APP_POOL_BLOCK_SIZE;
+    assert(idx < BT_APP_POOL_BLOCKS && block == s_pool_blocks[idx]);
+
+    portENTER_CRITICAL_SAFE(&s_pool_lock);
+    s_pool_free_mask |= 1u << idx;
+    s_pool_stats.in_use--;
+    portEXIT_CRITICAL_SAFE(&s_pool_lock);
+}
+
+void bt_app_pool_get_stats(bt_app_pool_stats_t *stats)
+{
+    portENTER_CRITICAL_SAFE(&s_pool_lock);
+    *stats = s_pool_stats;
+    portEXIT_CRITICAL_SAFE(&s_pool_lock);
+}
+
+void bt_app_pool_report(void)
+{
+    bt_app_pool_stats_t stats;
+
+    bt_app_pool_get_stats(&stats);
+    ESP_LOGI(BT_APP_POOL_TAG, "pool: %" PRIu32 "/%d in use, high water %" PRIu32 ", %" PRIu32 " allocs, %" PRIu32 " failures",
+             stats.in_use, BT_APP_POOL_BLOCKS, stats.high_water, stats.allocs, stats.failures);
+    ESP_LOGI(BT_APP_POOL_TAG, "heap: %" PRIu32 " free, %" PRIu32 " minimum free",
+             esp_get_free_heap_size(), esp_get_minimum_free_heap_size());
+}
@@ -0,0 +1,55 @@
+#ifndef __BT_APP_POOL_H__
+#define __BT_APP_POOL_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define BT_APP_POOL_TAG "BT_APP_POOL"
+
+/* number of blocks: only metadata responses are pool-backed and they are posted to the NORMAL queue, so the pool
+ * covers a full NORMAL queue, the message being handled and the one being copied by the Bluedroid task */
+#define BT_APP_POOL_BLOCKS (12)
+/* size of a block: the largest callback parameter plus a metadata string */
+#define BT_APP_POOL_BLOCK_SIZE (320)
+
+/**
+ * @brief Counters of the slab pool.
+ */
+typedef struct
+{
+    uint32_t in_use;      /*!< blocks currently allocated */
+    uint32_t high_water;  /*!< most blocks ever allocated at once */
+    uint32_t allocs;      /*!< successful allocations */
+    uint32_t failures;    /*!< allocations refused because the pool was empty */
+} bt_app_pool_stats_t;
+
+/**
+ * @brief Takes one block of BT_APP_POOL_BLOCK_SIZE bytes from the pool.
+ *
+ * The pool is a static array, so this never touches the heap. Safe to call from any task.
+ *
+ * @return Pointer to the block, or NULL if all blocks are in use.
+ */
+void *bt_app_pool_alloc(void);
+
+/**
+ * @brief Returns a block to the pool.
+ *
+ * @param block Pointer obtained from bt_app_pool_alloc. NULL is ignored.
+ */
+void bt_app_pool_free(void *block);
+
+/**
+ * @brief Copies the counters of the pool.
+ *
+ * @param stats Pointer to the structure that receives the counters.
+ */
+void bt_app_pool_get_stats(bt_app_pool_stats_t *stats);
+
+/**
+ * @brief Logs the pool counters together with the current and minimum free heap.
+ */
+void bt_app_pool_report(void);
+
+#endif /* __BT_APP_POOL_H__ */
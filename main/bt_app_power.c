@@ -0,0 +1,119 @@
+#include <stdatomic.h>
+#include <inttypes.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_pm.h"
+
+#include "bt_app_power.h"
+
+static const char *s_power_state_str[BT_APP_POWER_NUM] = {"idle", "connected", "streaming"};
+#if CONFIG_PM_ENABLE
+static esp_pm_lock_handle_t s_power_lock = NULL;  /* maximum CPU frequency while streaming */
+#endif
+static bt_app_power_state_t s_power_state = BT_APP_POWER_IDLE; /* current state */
+static int64_t s_power_enter_us = 0;              /* time the current state was entered */
+static int64_t s_power_residency_us[BT_APP_POWER_NUM]; /* time spent in each state before the current visit */
+static atomic_llong s_power_resume_us = -1;       /* time streaming started, -1 once the output resumed */
+static uint32_t s_power_resumes = 0;              /* completed resume measurements */
+static int64_t s_power_resume_last_us = -1;       /* last time from stream start to first sample */
+static int64_t s_power_resume_max_us = 0;         /* longest time from stream start to first sample */
+
+esp_err_t bt_app_power_init(void)
+{
+#if CONFIG_PM_ENABLE
+    const esp_pm_config_t pm_cfg = {
+        .max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+        .min_freq_mhz = BT_APP_POWER_MIN_FREQ_MHZ,
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+        .light_sleep_enable = true,
+#else
+        .light_sleep_enable = false,
+#endif
+    };
+    esp_err_t err = ESP_OK;
+
+    if ((err = esp_pm_configure(&pm_cfg)) != ESP_OK)
+    {
+        ESP_LOGE(BT_APP_POWER_TAG, "%s configure failed: %s", __func__, esp_err_to_name(err));
+        return err;
+    }
+    if ((err = esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "bt_audio", &s_power_lock)) != ESP_OK)
+    {
+        ESP_LOGE(BT_APP_POWER_TAG, "%s lock create failed: %s", __func__, esp_err_to_name(err));
+        return err;
+    }
+    ESP_LOGI(BT_APP_POWER_TAG, "cpu %d-%d MHz, light sleep %s", BT_APP_POWER_MIN_FREQ_MHZ, CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+             pm_cfg.light_sleep_enable ? "on" : "off");
+#else
+    ESP_LOGI(BT_APP_POWER_TAG, "power management disabled, cpu fixed at %d MHz", CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ);
+#endif
+    s_power_enter_us = esp_timer_get_time();
+    return ESP_OK;
+}
+
+void bt_app_power_set_state(bt_app_power_state_t state)
+{
+    int64_t now_us = esp_timer_get_time();
+
+    if (state == s_power_state)
+    {
+        return;
+    }
+    s_power_residency_us[s_power_state] += now_us - s_power_enter_us;
+#if CONFIG_PM_ENABLE
+    /* the lock is taken before the first packet is decoded and dropped only once the stream ended */
+    if (s_power_lock && state == BT_APP_POWER_STREAMING)
+    {
+        esp_pm_lock_acquire(s_power_lock);
+    }
+    else if (s_power_lock && s_power_state == BT_APP_POWER_STREAMING)
+    {
+        esp_pm_lock_release(s_power_lock);
+    }
+#endif
+    atomic_store(&s_power_resume_us, state == BT_APP_POWER_STREAMING ? now_us : -1);
+    ESP_LOGI(BT_APP_POWER_TAG, "%s -> %s at %" PRId64 " ms", s_power_state_str[s_power_state], s_power_state_str[state],
+             now_us / 1000);
+    s_power_state = state;
+    s_power_enter_us = now_us;
+}
+
+void bt_app_power_on_output_resumed(void)
+{
+    long long resume_us = atomic_exchange(&s_power_resume_us, -1);
+
+    if (resume_us < 0)
+    {
+        return;
+    }
+    s_power_resume_last_us = esp_timer_get_time() - resume_us;
+    if (s_power_resume_last_us > s_power_resume_max_us)
+    {
+        s_power_resume_max_us = s_power_resume_last_us;
+    }
+    s_power_resumes++;
+}
+
+void bt_app_power_report(void)
+{
+    int64_t now_us = esp_timer_get_time();
+    int64_t total_us = 0;
+    int64_t residency_us[BT_APP_POWER_NUM];
+
+    for (int i = 0; i < BT_APP_POWER_NUM; i++)
+    {
+        residency_us[i] = s_power_residency_us[i] + (i == (int)s_power_state ? now_us - s_power_enter_us : 0);
+        total_us += residency_us[i];
+    }
+    for (int i = 0; i < BT_APP_POWER_NUM; i++)
+    {
+        ESP_LOGI(BT_APP_POWER_TAG, "%-9s %8" PRId64 " ms (%3d%%)", s_power_state_str[i], residency_us[i] / 1000,
+                 total_us > 0 ? (int)(residency_us[i] * 100 / total_us) : 0);
+    }
+    if (s_power_resumes > 0)
+    {
+        ESP_LOGI(BT_APP_POWER_TAG, "resume to first sample: last %" PRId64 " ms, max %" PRId64 " ms over %" PRIu32 " starts",
+                 s_power_resume_last_us / 1000, s_power_resume_max_us / 1000, s_power_resumes);
+    }
+}
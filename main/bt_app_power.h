@@ -0,0 +1,59 @@
+#ifndef __BT_APP_POWER_H__
+#define __BT_APP_POWER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#define BT_APP_POWER_TAG "BT_APP_POWER"
+
+/* lowest CPU clock while nothing is streamed, the crystal frequency */
+#define BT_APP_POWER_MIN_FREQ_MHZ (40)
+
+/**
+ * @brief Power states of the speaker.
+ */
+typedef enum
+{
+    BT_APP_POWER_IDLE,      /*!< no source connected */
+    BT_APP_POWER_CONNECTED, /*!< a source is connected but its stream is suspended or stopped */
+    BT_APP_POWER_STREAMING, /*!< audio is streamed, the CPU runs at full speed */
+    BT_APP_POWER_NUM,
+} bt_app_power_state_t;
+
+/**
+ * @brief Enables dynamic frequency scaling and light sleep and creates the lock held while streaming.
+ *
+ * Without CONFIG_PM_ENABLE the clock stays fixed and only the state residency is tracked. The Bluetooth
+ * controller holds its own locks while it needs its clocks, so how low the system actually goes while idle
+ * also depends on the controller's sleep configuration.
+ *
+ * @return ESP_OK on success, or the error returned by esp_pm.
+ */
+esp_err_t bt_app_power_init(void);
+
+/**
+ * @brief Moves to a power state. Must be called on the application task.
+ *
+ * Entering BT_APP_POWER_STREAMING takes the maximum-frequency lock and starts timing the resume, leaving it
+ * releases the lock. Every transition is logged with its time, so a current trace can be lined up with it.
+ *
+ * @param state The new state.
+ */
+void bt_app_power_set_state(bt_app_power_state_t state);
+
+/**
+ * @brief Notes that the output has played its first block after prefetching. Called by the writer task.
+ *
+ * The first call after entering BT_APP_POWER_STREAMING completes the time-to-resume measurement.
+ */
+void bt_app_power_on_output_resumed(void);
+
+/**
+ * @brief Logs the time spent in each state and the time from stream start to the first sample.
+ */
+void bt_app_power_report(void);
+
+#endif /* __BT_APP_POWER_H__ */
@@ -0,0 +1,223 @@
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "bt_app_stats.h"
+
+typedef struct
+{
+    atomic_uint count;
+    atomic_uint max;
+    atomic_uint sum;
+    atomic_uint budget;
+    atomic_uint over_budget;
+    atomic_uint buckets[BT_APP_STATS_BUCKETS];
+} stats_hist_t;
+
+static atomic_uint s_stats_cnt[STATS_CNT_NUM];    /* monotonic counters */
+static stats_hist_t s_stats_hist[STATS_HIST_NUM]; /* histograms since the last snapshot with reset */
+static int64_t s_stats_hist_start_us = 0;         /* time the histograms were last reset */
+static esp_timer_handle_t s_stats_timer = NULL;   /* timer of the periodic dump */
+
+static const char *s_stats_cnt_str[STATS_CNT_NUM] = {"packets", "bytes", "drops", "overflows", "underflows",
+                                                     "rebuffers", "wakeups", "output underruns"};
+static const char *s_stats_hist_str[STATS_HIST_NUM] = {"arrival us", "fifo fill", "output write us", "asrc cyc",
+                                                       "plc cyc", "eq cyc", "drc cyc", "pcm cyc", "ingest cyc",
+                                                       "rc rtt us", "rc meta us"};
+
+void bt_app_stats_add(bt_app_stats_cnt_t cnt, uint32_t n)
+{
+    atomic_fetch_add_explicit(&s_stats_cnt[cnt], n, memory_order_relaxed);
+}
+
+uint32_t bt_app_stats_bucket(uint32_t value)
+{
+    uint32_t bucket = 0;
+
+    if (value == 0)
+    {
+        return 0;
+    }
+    bucket = 32 - __builtin_clz(value);
+    return bucket < BT_APP_STATS_BUCKETS ? bucket : BT_APP_STATS_BUCKETS - 1;
+}
+
+void bt_app_stats_record(bt_app_stats_hist_t hist, uint32_t value)
+{
+    stats_hist_t *h = &s_stats_hist[hist];
+    unsigned int max = atomic_load_explicit(&h->max, memory_order_relaxed);
+    unsigned int budget = 0;
+
+    atomic_fetch_add_explicit(&h->buckets[bt_app_stats_bucket(value)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->sum, value, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->count, 1, memory_order_relaxed);
+    budget = atomic_load_explicit(&h->budget, memory_order_relaxed);
+    if (budget && value > budget)
+    {
+        atomic_fetch_add_explicit(&h->over_budget, 1, memory_order_relaxed);
+    }
+    while (value > max &&
+           !atomic_compare_exchange_weak_explicit(&h->max, &max, value, memory_order_relaxed, memory_order_relaxed))
+    {
+    }
+}
+
+void bt_app_stats_set_budget(bt_app_stats_hist_t hist, uint32_t budget)
+{
+    atomic_store(&s_stats_hist[hist].budget, budget);
+}
+
+static uint32_t stats_read(atomic_uint *v, bool reset)
+{
+    return reset ? atomic_exchange_explicit(v, 0, memory_order_relaxed) : atomic_load_explicit(v, memory_order_relaxed);
+}
+
+void bt_app_stats_take_snapshot(bt_app_stats_snapshot_t *snap, bool reset_hist)
+{
+    int64_t now_us = esp_timer_get_time();
+
+    memset(snap, 0, sizeof(*snap));
+    snap->magic = BT_APP_STATS_SNAPSHOT_MAGIC;
+    snap->version = BT_APP_STATS_SNAPSHOT_VERSION;
+    snap->cnt_num = STATS_CNT_NUM;
+    snap->hist_num = STATS_HIST_NUM;
+    snap->time_ms = (uint32_t)(now_us / 1000);
+    snap->interval_ms = (uint32_t)((now_us - s_stats_hist_start_us) / 1000);
+
+    for (int i = 0; i < STATS_CNT_NUM; i++)
+    {
+        snap->counters[i] = stats_read(&s_stats_cnt[i], false);
+    }
+    for (int i = 0; i < STATS_HIST_NUM; i++)
+    {
+        stats_hist_t *h = &s_stats_hist[i];
+
+        snap->hist[i].count = stats_read(&h->count, reset_hist);
+        snap->hist[i].max = stats_read(&h->max, reset_hist);
+        snap->hist[i].sum = stats_read(&h->sum, reset_hist);
+        snap->hist[i].budget = stats_read(&h->budget, false);
+        snap->hist[i].over_budget = stats_read(&h->over_budget, reset_hist);
+        for (int b = 0; b < BT_APP_STATS_BUCKETS; b++)
+        {
+            snap->hist[i].buckets[b] = stats_read(&h->buckets[b], reset_hist);
+        }
+    }
+    if (reset_hist)
+    {
+        s_stats_hist_start_us = now_us;
+    }
+}
+
+void bt_app_stats_log(const bt_app_stats_snapshot_t *snap)
+{
+    char line[160];
+    int pos = 0;
+
+    for (int i = 0; i < STATS_CNT_NUM && pos < (int)sizeof(line); i++)
+    {
+        pos += snprintf(line + pos, sizeof(line) - pos, "%s%s %" PRIu32, i ? ", " : "", s_stats_cnt_str[i], snap->counters[i]);
+    }
+    ESP_LOGI(BT_APP_STATS_TAG, "%s", line);
+
+    for (int i = 0; i < STATS_HIST_NUM; i++)
+    {
+        const bt_app_stats_hist_snap_t *h = &snap->hist[i];
+        uint32_t p50 = 0;
+        uint32_t p99 = 0;
+        uint32_t seen = 0;
+
+        if (h->count == 0)
+        {
+            continue;
+        }
+        /* upper bound of the buckets holding the median and the 99th percentile */
+        for (int b = 0; b < BT_APP_STATS_BUCKETS; b++)
+        {
+            seen += h->buckets[b];
+            if (p50 == 0 && seen * 2 >= h->count)
+            {
+                p50 = 1u << b;
+            }
+            if (seen * 100 >= h->count * 99)
+            {
+                p99 = 1u << b;
+                break;
+            }
+        }
+        ESP_LOGI(BT_APP_STATS_TAG, "%s: n %" PRIu32 ", mean %" PRIu32 ", p50 <%" PRIu32 ", p99 <%" PRIu32 ", max %" PRIu32 " over %" PRIu32 " ms",
+                 s_stats_hist_str[i], h->count, h->sum / h->count, p50, p99, h->max, snap->interval_ms);
+        if (h->budget)
+        {
+            ESP_LOGI(BT_APP_STATS_TAG, "%s: budget %" PRIu32 ", mean at %" PRIu32 "%%, max at %" PRIu32 "%%, %" PRIu32 " over budget",
+                     s_stats_hist_str[i], h->budget, (uint32_t)((uint64_t)h->sum / h->count * 100 / h->budget),
+                     (uint32_t)((uint64_t)h->max * 100 / h->budget), h->over_budget);
+        }
+    }
+}
+
+void bt_app_stats_reset(void)
+{
+    for (int i = 0; i < STATS_CNT_NUM; i++)
+    {
+        atomic_store(&s_stats_cnt[i], 0);
+    }
+    for (int i = 0; i < STATS_HIST_NUM; i++)
+    {
+        atomic_store(&s_stats_hist[i].count, 0);
+        atomic_store(&s_stats_hist[i].max, 0);
+        atomic_store(&s_stats_hist[i].sum, 0);
+        atomic_store(&s_stats_hist[i].over_budget, 0);
+        for (int b = 0; b < BT_APP_STATS_BUCKETS; b++)
+        {
+            atomic_store(&s_stats_hist[i].buckets[b], 0);
+        }
+    }
+    s_stats_hist_start_us = esp_timer_get_time();
+}
+
+#if BT_APP_STATS_ENABLED
+static void bt_app_stats_dump(void *arg)
+{
+    static bt_app_stats_snapshot_t snap;
+
+    bt_app_stats_take_snapshot(&snap, true);
+    bt_app_stats_log(&snap);
+}
+#endif
+
+esp_err_t bt_app_stats_start(uint32_t period_ms)
+{
+#if BT_APP_STATS_ENABLED
+    esp_err_t err = ESP_OK;
+    const esp_timer_create_args_t args = {
+        .callback = bt_app_stats_dump,
+        .name = "bt_app_stats",
+    };
+
+    if (s_stats_timer == NULL && (err = esp_timer_create(&args, &s_stats_timer)) != ESP_OK)
+    {
+        ESP_LOGE(BT_APP_STATS_TAG, "%s timer create failed: %s", __func__, esp_err_to_name(err));
+        return err;
+    }
+    if (period_ms < BT_APP_STATS_DUMP_MIN_MS)
+    {
+        period_ms = BT_APP_STATS_DUMP_MIN_MS;
+    }
+    esp_timer_stop(s_stats_timer);
+    return esp_timer_start_periodic(s_stats_timer, (uint64_t)period_ms * 1000);
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+void bt_app_stats_stop(void)
+{
+    if (s_stats_timer)
+    {
+        esp_timer_stop(s_stats_timer);
+    }
+}
@@ -0,0 +1,189 @@
+#ifndef __BT_APP_STATS_H__
+#define __BT_APP_STATS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#if CONFIG_IDF_TARGET_LINUX
+#include "esp_timer.h"
+#else
+#include "esp_cpu.h"
+#endif
+
+#define BT_APP_STATS_TAG "BT_APP_STATS"
+
+/* set to 0 to compile all instrumentation of the audio path to no-ops */
+#ifndef BT_APP_STATS_ENABLED
+#define BT_APP_STATS_ENABLED (1)
+#endif
+
+/* number of histogram buckets, bucket n holds values in [2^(n-1), 2^n), the last one everything above */
+#define BT_APP_STATS_BUCKETS (16)
+/* period of the log dump, and the lowest period accepted */
+#define BT_APP_STATS_DUMP_PERIOD_MS (10000)
+#define BT_APP_STATS_DUMP_MIN_MS (1000)
+
+/* header of the binary snapshot */
+#define BT_APP_STATS_SNAPSHOT_MAGIC (0x54534142) /* "BAST" in little endian */
+#define BT_APP_STATS_SNAPSHOT_VERSION (3)
+
+/* monotonic event counters */
+typedef enum
+{
+    STATS_CNT_PACKETS,          /*!< A2DP packets received */
+    STATS_CNT_BYTES,            /*!< PCM bytes received */
+    STATS_CNT_DROPS,            /*!< packets dropped because the FIFO was full or draining */
+    STATS_CNT_OVERFLOWS,        /*!< transitions into the dropping mode */
+    STATS_CNT_UNDERFLOWS,       /*!< gaps where the FIFO ran dry */
+    STATS_CNT_REBUFFERS,        /*!< gaps that outlasted concealment and went back to prefetching */
+    STATS_CNT_WAKEUPS,          /*!< wake-ups of the writer task to feed the output */
+    STATS_CNT_OUTPUT_UNDERRUNS, /*!< DMA descriptors filled with silence because the output queue was short */
+    STATS_CNT_NUM,
+} bt_app_stats_cnt_t;
+
+/* distributions, reset by every snapshot taken with reset */
+typedef enum
+{
+    STATS_HIST_ARRIVAL_US,      /*!< time between two A2DP packets */
+    STATS_HIST_FIFO_FILL,       /*!< FIFO fill in bytes after a packet was written */
+    STATS_HIST_OUTPUT_WRITE_US, /*!< time blocked in the output backend write */
+    STATS_HIST_CYC_ASRC,        /*!< CPU cycles of resampling one chunk */
+    STATS_HIST_CYC_PLC,         /*!< CPU cycles of concealment or history feed of one chunk */
+    STATS_HIST_CYC_EQ,          /*!< CPU cycles of equalizing one chunk */
+    STATS_HIST_CYC_DRC,         /*!< CPU cycles of volume, compression and limiting of one chunk */
+    STATS_HIST_CYC_PCM,         /*!< CPU cycles of conversion of one chunk to the output format */
+    STATS_HIST_CYC_INGEST,      /*!< CPU cycles of taking one A2DP packet into the FIFO */
+    STATS_HIST_RC_RTT_US,       /*!< time from an AVRCP command to its first response */
+    STATS_HIST_RC_META_US,      /*!< time from an AVRCP metadata command to its last attribute */
+    STATS_HIST_NUM,
+} bt_app_stats_hist_t;
+
+/**
+ * @brief Snapshot of one histogram.
+ */
+typedef struct __attribute__((packed))
+{
+    uint32_t count;                         /*!< number of values recorded */
+    uint32_t max;                           /*!< largest value recorded */
+    uint32_t sum;                           /*!< sum of the values, wraps around */
+    uint32_t budget;                        /*!< largest value within budget, 0 if the histogram has none */
+    uint32_t over_budget;                   /*!< number of values above the budget */
+    uint32_t buckets[BT_APP_STATS_BUCKETS]; /*!< number of values per log2 bucket */
+} bt_app_stats_hist_snap_t;
+
+/**
+ * @brief Binary snapshot of all statistics.
+ *
+ * The layout is packed and little endian, so the structure can be sent or stored as is and decoded off target.
+ */
+typedef struct __attribute__((packed))
+{
+    uint32_t magic;                                  /*!< BT_APP_STATS_SNAPSHOT_MAGIC */
+    uint16_t version;                                /*!< BT_APP_STATS_SNAPSHOT_VERSION */
+    uint8_t cnt_num;                                 /*!< STATS_CNT_NUM */
+    uint8_t hist_num;                                /*!< STATS_HIST_NUM */
+    uint32_t time_ms;                                /*!< time the snapshot was taken */
+    uint32_t interval_ms;                            /*!< time covered by the histograms */
+    uint32_t counters[STATS_CNT_NUM];                /*!< counters since the last reset */
+    bt_app_stats_hist_snap_t hist[STATS_HIST_NUM];   /*!< histograms since the last snapshot with reset */
+} bt_app_stats_snapshot_t;
+
+#if BT_APP_STATS_ENABLED
+#define BT_APP_STATS_ADD(cnt, n) bt_app_stats_add((cnt), (n))
+#define BT_APP_STATS_INC(cnt) bt_app_stats_add((cnt), 1)
+#define BT_APP_STATS_RECORD(hist, value) bt_app_stats_record((hist), (value))
+#if CONFIG_IDF_TARGET_LINUX
+/* the host has no cycle counter, stage costs are recorded in microseconds instead */
+#define BT_APP_STATS_CYCLES() ((uint32_t)esp_timer_get_time())
+#else
+#define BT_APP_STATS_CYCLES() ((uint32_t)esp_cpu_get_cycle_count())
+#endif
+#else
+#define BT_APP_STATS_ADD(cnt, n) ((void)(n))
+#define BT_APP_STATS_INC(cnt) ((void)0)
+#define BT_APP_STATS_RECORD(hist, value) ((void)(value))
+#define BT_APP_STATS_CYCLES() ((uint32_t)0)
+#endif
+
+/**
+ * @brief Adds to a counter.
+ *
+ * Lock-free and safe to call from any task. Use BT_APP_STATS_ADD so the call is compiled out when disabled.
+ *
+ * @param cnt The counter.
+ * @param n The amount to add.
+ */
+void bt_app_stats_add(bt_app_stats_cnt_t cnt, uint32_t n);
+
+/**
+ * @brief Records a value into a histogram.
+ *
+ * Lock-free and safe to call from any task. Use BT_APP_STATS_RECORD so the call is compiled out when disabled.
+ *
+ * @param hist The histogram.
+ * @param value The value to record.
+ */
+void bt_app_stats_record(bt_app_stats_hist_t hist, uint32_t value);
+
+/**
+ * @brief Sets the budget of a histogram, values above it are counted as over budget.
+ *
+ * The budget survives snapshots and resets, only the over-budget count starts over.
+ *
+ * @param hist The histogram.
+ * @param budget The largest value within budget, 0 to disable the check.
+ */
+void bt_app_stats_set_budget(bt_app_stats_hist_t hist, uint32_t budget);
+
+/**
+ * @brief Maps a value to its histogram bucket.
+ *
+ * @param value The value.
+ * @return The bucket index, 0 for 0 and BT_APP_STATS_BUCKETS - 1 for everything too large.
+ */
+uint32_t bt_app_stats_bucket(uint32_t value);
+
+/**
+ * @brief Takes a snapshot of all statistics.
+ *
+ * Every field is read atomically, but the snapshot as a whole is not, so a value recorded meanwhile may show
+ * in the count of a histogram but not yet in its buckets.
+ *
+ * @param snap Pointer to the structure that receives the snapshot.
+ * @param reset_hist If true, the histograms start over after being read.
+ */
+void bt_app_stats_take_snapshot(bt_app_stats_snapshot_t *snap, bool reset_hist);
+
+/**
+ * @brief Logs a snapshot, one line per counter group and histogram.
+ *
+ * @param snap The snapshot.
+ */
+void bt_app_stats_log(const bt_app_stats_snapshot_t *snap);
+
+/**
+ * @brief Clears all counters and histograms.
+ */
+void bt_app_stats_reset(void);
+
+/**
+ * @brief Starts the periodic dump of the statistics.
+ *
+ * The dump runs from the esp_timer task, so nothing is logged from the audio path.
+ *
+ * @param period_ms The period of the dump, raised to BT_APP_STATS_DUMP_MIN_MS if lower.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_NOT_SUPPORTED if the statistics are compiled out
+ *      - an esp_timer error otherwise
+ */
+esp_err_t bt_app_stats_start(uint32_t period_ms);
+
+/**
+ * @brief Stops the periodic dump of the statistics.
+ */
+void bt_app_stats_stop(void);
+
+#endif /* __BT_APP_STATS_H__ */
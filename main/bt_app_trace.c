@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <stdatomic.h>
+#include <inttypes.h>
+
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "bt_app_trace.h"
+
+_Static_assert((BT_APP_TRACE_EVENTS & (BT_APP_TRACE_EVENTS - 1)) == 0, "trace buffer size must be a power of two");
+
+#if BT_APP_TRACE_ENABLED
+static bt_app_trace_event_t s_trace_buf[BT_APP_TRACE_EVENTS]; /* circular buffer of events */
+#endif
+static atomic_uint s_trace_head = 0;          /* events ever claimed, the next one goes at head % size */
+static atomic_bool s_trace_on = true;         /* recording */
+
+void bt_app_trace_record(bt_app_trace_ph_t ph, bt_app_trace_id_t id, uint32_t arg)
+{
+#if BT_APP_TRACE_ENABLED
+    bt_app_trace_event_t *ev = NULL;
+
+    if (!atomic_load_explicit(&s_trace_on, memory_order_relaxed))
+    {
+        return;
+    }
+    ev = &s_trace_buf[atomic_fetch_add_explicit(&s_trace_head, 1, memory_order_relaxed) & (BT_APP_TRACE_EVENTS - 1)];
+    ev->time_us = (uint32_t)esp_timer_get_time();
+    ev->ph = (uint8_t)ph;
+    ev->core = (uint8_t)xPortGetCoreID();
+    ev->id = (uint16_t)id;
+    ev->arg = arg;
+#if BT_APP_TRACE_STOP_ON_REBUFFER
+    if (id == TRACE_UNDERFLOW && arg != 0)
+    {
+        atomic_store(&s_trace_on, false);
+    }
+#endif
+#endif
+}
+
+void bt_app_trace_stop(void)
+{
+    atomic_store(&s_trace_on, false);
+}
+
+void bt_app_trace_start(void)
+{
+    atomic_store(&s_trace_head, 0);
+    atomic_store(&s_trace_on, true);
+}
+
+void bt_app_trace_dump(void)
+{
+#if BT_APP_TRACE_ENABLED
+    char line[BT_APP_TRACE_DUMP_EVENTS_PER_LINE * sizeof(bt_app_trace_event_t) * 2 + 1];
+    unsigned int head = 0;
+    unsigned int first = 0;
+    size_t pos = 0;
+
+    bt_app_trace_stop();
+    head = atomic_load(&s_trace_head);
+    first = head > BT_APP_TRACE_EVENTS ? head - BT_APP_TRACE_EVENTS : 0;
+    ESP_LOGI(BT_APP_TRACE_TAG, "TRACE BEGIN %u events, %u overwritten", head - first, first);
+    for (unsigned int i = first; i < head; i++)
+    {
+        const uint8_t *bytes = (const uint8_t *)&s_trace_buf[i & (BT_APP_TRACE_EVENTS - 1)];
+
+        for (size_t b = 0; b < sizeof(bt_app_trace_event_t); b++)
+        {
+            pos += sprintf(&line[pos], "%02x", bytes[b]);
+        }
+        if ((i - first + 1) % BT_APP_TRACE_DUMP_EVENTS_PER_LINE == 0 || i + 1 == head)
+        {
+            ESP_LOGI(BT_APP_TRACE_TAG, "TRACE %s", line);
+            pos = 0;
+        }
+    }
+    ESP_LOGI(BT_APP_TRACE_TAG, "TRACE END");
+#endif
+}
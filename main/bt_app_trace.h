@@ -0,0 +1,111 @@
+#ifndef __BT_APP_TRACE_H__
+#define __BT_APP_TRACE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define BT_APP_TRACE_TAG "BT_APP_TRACE"
+
+/* set to 1 to record the timeline, it costs BT_APP_TRACE_EVENTS * 12 bytes of RAM */
+#ifndef BT_APP_TRACE_ENABLED
+#define BT_APP_TRACE_ENABLED (0)
+#endif
+/* events kept, the oldest ones are overwritten, a power of two */
+#define BT_APP_TRACE_EVENTS (1024)
+/* stop recording at the first rebuffer, so the buffer holds what led up to it rather than what followed */
+#define BT_APP_TRACE_STOP_ON_REBUFFER (1)
+/* events per line of a dump */
+#define BT_APP_TRACE_DUMP_EVENTS_PER_LINE (16)
+
+/*
+ * Trace points: identifier, name and track. Tracks are the timelines shown by the viewer, one per context the point
+ * runs in. Identifiers are the position in this list, which tools/bt_app_trace_to_json.py parses, so entries must
+ * keep this one-line shape.
+ */
+#define BT_APP_TRACE_POINTS(X) \
+    X(TRACE_POST, "post", "callers") \
+    X(TRACE_APP_HANDLE, "handle", "BtAppTask") \
+    X(TRACE_WRITE_RINGBUF, "write_ringbuf", "Bluedroid") \
+    X(TRACE_FIFO_FILL, "fifo fill", "Bluedroid") \
+    X(TRACE_I2S_WAIT, "wait", "BtI2STask") \
+    X(TRACE_I2S_CHUNK, "chunk", "BtI2STask") \
+    X(TRACE_OUTPUT_WRITE, "output_write", "BtI2STask") \
+    X(TRACE_UNDERFLOW, "underflow", "BtI2STask") \
+    X(TRACE_MODE, "ringbuffer mode", "mode")
+
+/**
+ * @brief Identifiers of the trace points.
+ */
+typedef enum
+{
+#define BT_APP_TRACE_ID(id, name, track) id,
+    BT_APP_TRACE_POINTS(BT_APP_TRACE_ID)
+#undef BT_APP_TRACE_ID
+    TRACE_NUM,
+} bt_app_trace_id_t;
+
+/**
+ * @brief Kinds of trace events, the letters are the phases of the Chrome trace format.
+ */
+typedef enum
+{
+    TRACE_PH_BEGIN = 'B',   /*!< start of a span */
+    TRACE_PH_END = 'E',     /*!< end of a span */
+    TRACE_PH_INSTANT = 'i', /*!< point in time */
+    TRACE_PH_COUNTER = 'C', /*!< value of a counter */
+} bt_app_trace_ph_t;
+
+/**
+ * @brief One trace event, packed and little endian as dumped.
+ */
+typedef struct __attribute__((packed))
+{
+    uint32_t time_us; /*!< low 32 bits of esp_timer_get_time */
+    uint8_t ph;       /*!< bt_app_trace_ph_t */
+    uint8_t core;     /*!< core the event was recorded on */
+    uint16_t id;      /*!< bt_app_trace_id_t */
+    uint32_t arg;     /*!< event, size, mode or counter value */
+} bt_app_trace_event_t;
+
+#if BT_APP_TRACE_ENABLED
+#define BT_APP_TRACE_BEGIN(id, arg) bt_app_trace_record(TRACE_PH_BEGIN, (id), (arg))
+#define BT_APP_TRACE_END(id, arg) bt_app_trace_record(TRACE_PH_END, (id), (arg))
+#define BT_APP_TRACE_INSTANT(id, arg) bt_app_trace_record(TRACE_PH_INSTANT, (id), (arg))
+#define BT_APP_TRACE_COUNTER(id, value) bt_app_trace_record(TRACE_PH_COUNTER, (id), (value))
+#else
+#define BT_APP_TRACE_BEGIN(id, arg) ((void)(arg))
+#define BT_APP_TRACE_END(id, arg) ((void)(arg))
+#define BT_APP_TRACE_INSTANT(id, arg) ((void)(arg))
+#define BT_APP_TRACE_COUNTER(id, value) ((void)(value))
+#endif
+
+/**
+ * @brief Records an event. Use the BT_APP_TRACE_* macros so the call is compiled out when disabled.
+ *
+ * Lock-free and safe to call from any task on either core: each event claims its slot with one atomic increment.
+ *
+ * @param ph The kind of event.
+ * @param id The trace point.
+ * @param arg The argument of the event.
+ */
+void bt_app_trace_record(bt_app_trace_ph_t ph, bt_app_trace_id_t id, uint32_t arg);
+
+/**
+ * @brief Stops recording, e.g. right after the event of interest.
+ */
+void bt_app_trace_stop(void);
+
+/**
+ * @brief Empties the buffer and starts recording.
+ */
+void bt_app_trace_start(void);
+
+/**
+ * @brief Logs the buffer, oldest event first, as hex lines for tools/bt_app_trace_to_json.py. Recording is stopped.
+ *
+ * The lines are framed by "TRACE BEGIN" and "TRACE END" so the tool finds them in a monitor capture.
+ */
+void bt_app_trace_dump(void);
+
+#endif /* __BT_APP_TRACE_H__ */
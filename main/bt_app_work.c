@@ -0,0 +1,322 @@
+#include "bt_app_core.h"
+#include "bt_app_mem.h"
+
+_Static_assert(BT_APP_POOL_BLOCKS >= BT_APP_QUEUE_LEN_NORMAL + 2, "pool must cover a full NORMAL queue");
+
+static QueueHandle_t s_bt_app_task_queue[BT_APP_PRIO_NUM] = {NULL}; /* handles of work queues, one per priority */
+static const UBaseType_t s_bt_app_queue_len[BT_APP_PRIO_NUM] = {BT_APP_QUEUE_LEN_HIGH, BT_APP_QUEUE_LEN_NORMAL,
+                                                                 BT_APP_QUEUE_LEN_LOW};
+static bt_app_queue_stats_t s_bt_app_queue_stats[BT_APP_PRIO_NUM]; /* statistics of work queues */
+static bt_app_msg_t s_bt_app_coalesce_slot[BT_APP_COALESCE_SLOTS]; /* latest message per coalescing key */
+static uint32_t s_bt_app_coalesce_key[BT_APP_COALESCE_SLOTS];     /* key of each slot, 0 if free */
+static portMUX_TYPE s_bt_app_queue_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t s_bt_app_task_handle = NULL; /* handle of application task  */
+
+bool bt_app_send_msg(bt_app_msg_t *msg, bt_app_prio_t prio)
+{
+    bt_app_queue_stats_t *stats = NULL;
+    UBaseType_t depth = 0;
+    bool sent = false;
+
+    if (msg == NULL || prio >= BT_APP_PRIO_NUM || s_bt_app_task_queue[prio] == NULL)
+    {
+        return false;
+    }
+    BT_APP_TRACE_INSTANT(TRACE_POST, (uint32_t)prio << 16 | msg->event);
+    stats = &s_bt_app_queue_stats[prio];
+    msg->post_us = (uint32_t)esp_timer_get_time();
+
+    /* never block the caller, it is usually a Bluedroid callback */
+    sent = (xQueueSend(s_bt_app_task_queue[prio], msg, 0) == pdTRUE);
+    depth = uxQueueMessagesWaiting(s_bt_app_task_queue[prio]);
+
+    portENTER_CRITICAL_SAFE(&s_bt_app_queue_lock);
+    if (sent)
+    {
+        stats->posted++;
+        if (depth > stats->max_depth)
+        {
+            stats->max_depth = depth;
+        }
+    }
+    else
+    {
+        stats->dropped++;
+    }
+    portEXIT_CRITICAL_SAFE(&s_bt_app_queue_lock);
+
+    if (!sent)
+    {
+        BT_APP_LOG(BLOG_QUEUE_SEND_FAILED, prio);
+        return false;
+    }
+    if (s_bt_app_task_handle)
+    {
+        xTaskNotifyGive(s_bt_app_task_handle);
+    }
+    return true;
+}
+
+void bt_app_work_dispatched(bt_app_msg_t *msg)
+{
+    void *param = msg->param;
+
+    if (param == NULL && msg->param_len > 0)
+    {
+        param = msg->data;
+    }
+    if (msg->cb)
+    {
+        msg->cb(msg->event, param);
+    }
+}
+
+/* take the next message, always from the highest priority queue that is not empty */
+static bool bt_app_receive_msg(bt_app_msg_t *msg, bt_app_prio_t *prio)
+{
+    for (int i = 0; i < BT_APP_PRIO_NUM; i++)
+    {
+        if (pdTRUE == xQueueReceive(s_bt_app_task_queue[i], msg, 0))
+        {
+            *prio = (bt_app_prio_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* replace a coalescing marker with the latest message stored in its slot */
+static void bt_app_take_coalesced(bt_app_msg_t *msg)
+{
+    uint16_t slot = msg->event;
+
+    portENTER_CRITICAL_SAFE(&s_bt_app_queue_lock);
+    *msg = s_bt_app_coalesce_slot[slot];
+    s_bt_app_coalesce_key[slot] = 0;
+    portEXIT_CRITICAL_SAFE(&s_bt_app_queue_lock);
+}
+
+void bt_app_task_handler(void *arg)
+{
+    bt_app_msg_t msg;
+    bt_app_prio_t prio;
+    uint32_t latency_us = 0;
+
+    for (;;)
+    {
+        /* wait until something was posted, then drain all queues in priority order */
+        ulTaskNotifyTake(pdTRUE, (TickType_t)portMAX_DELAY);
+        while (bt_app_receive_msg(&msg, &prio))
+        {
+            if (msg.sig == BT_APP_SIG_COALESCED)
+            {
+                bt_app_take_coalesced(&msg);
+            }
+            ESP_LOGD(BT_APP_CORE_TAG, "%s, signal: 0x%x, event: 0x%x", __func__, msg.sig, msg.event);
+
+            latency_us = (uint32_t)esp_timer_get_time() - msg.post_us;
+            s_bt_app_queue_stats[prio].handled++;
+            s_bt_app_queue_stats[prio].total_latency_us += latency_us;
+            if (latency_us > s_bt_app_queue_stats[prio].max_latency_us)
+            {
+                s_bt_app_queue_stats[prio].max_latency_us = latency_us;
+            }
+
+            switch (msg.sig)
+            {
+            case BT_APP_SIG_WORK_DISPATCH:
+                BT_APP_TRACE_BEGIN(TRACE_APP_HANDLE, msg.event);
+                bt_app_work_dispatched(&msg);
+                BT_APP_TRACE_END(TRACE_APP_HANDLE, msg.event);
+                break;
+            default:
+                ESP_LOGW(BT_APP_CORE_TAG, "%s, unhandled signal: %d", __func__, msg.sig);
+                break;
+            } /* switch (msg.sig) */
+
+            bt_app_pool_free(msg.param);
+        }
+    }
+}
+
+bool bt_app_work_dispatch(bt_app_cb_t p_cback, uint16_t event, void *p_params, int param_len, bt_app_copy_cb_t p_copy_cback)
+{
+    return bt_app_work_dispatch_prio(p_cback, event, p_params, param_len, p_copy_cback, BT_APP_PRIO_NORMAL);
+}
+
+bool bt_app_work_dispatch_prio(bt_app_cb_t p_cback, uint16_t event, void *p_params, int param_len, bt_app_copy_cb_t p_copy_cback,
+                               bt_app_prio_t prio)
+{
+    ESP_LOGD(BT_APP_CORE_TAG, "%s event: 0x%x, param len: %d", __func__, event, param_len);
+
+    bt_app_msg_t msg;
+    memset(&msg, 0, offsetof(bt_app_msg_t, data));
+
+    msg.sig = BT_APP_SIG_WORK_DISPATCH;
+    msg.event = event;
+    msg.cb = p_cback;
+
+    if (param_len == 0)
+    {
+        return bt_app_send_msg(&msg, prio);
+    }
+    else if (p_params && param_len > 0 && param_len <= BT_APP_MSG_INLINE_SIZE && p_copy_cback == NULL)
+    {
+        /* small parameter without references, carry it inside the message */
+        memcpy(msg.data, p_params, param_len);
+        msg.param_len = param_len;
+        return bt_app_send_msg(&msg, prio);
+    }
+    else if (p_params && param_len > 0 && param_len <= BT_APP_POOL_BLOCK_SIZE)
+    {
+        if ((msg.param = bt_app_pool_alloc()) != NULL)
+        {
+            memcpy(msg.param, p_params, param_len);
+            msg.param_len = param_len;
+            /* check if caller has provided a copy callback to do the deep copy */
+            if (p_copy_cback)
+            {
+                p_copy_cback(msg.param, p_params, param_len);
+            }
+            if (bt_app_send_msg(&msg, prio))
+            {
+                return true;
+            }
+            bt_app_pool_free(msg.param);
+        }
+        else
+        {
+            BT_APP_LOG(BLOG_POOL_EXHAUSTED, event);
+        }
+    }
+
+    return false;
+}
+
+bool bt_app_work_dispatch_coalesced(bt_app_cb_t p_cback, uint16_t event, void *p_params, int param_len, uint32_t key)
+{
+    bt_app_msg_t marker;
+    int slot = -1;
+    bool queued = false;
+
+    if (key == 0 || param_len < 0 || param_len > BT_APP_MSG_INLINE_SIZE || (param_len > 0 && p_params == NULL))
+    {
+        return false;
+    }
+
+    portENTER_CRITICAL_SAFE(&s_bt_app_queue_lock);
+    for (int i = 0; i < BT_APP_COALESCE_SLOTS; i++)
+    {
+        if (s_bt_app_coalesce_key[i] == key)
+        {
+            /* a message with this key is already queued, only its payload is refreshed */
+            slot = i;
+            queued = true;
+            break;
+        }
+        if (slot < 0 && s_bt_app_coalesce_key[i] == 0)
+        {
+            slot = i;
+        }
+    }
+    if (slot >= 0)
+    {
+        bt_app_msg_t *msg = &s_bt_app_coalesce_slot[slot];
+
+        if (!queued)
+        {
+            memset(msg, 0, offsetof(bt_app_msg_t, data));
+            msg->sig = BT_APP_SIG_WORK_DISPATCH;
+            msg->post_us = (uint32_t)esp_timer_get_time();
+            s_bt_app_coalesce_key[slot] = key;
+        }
+        msg->event = event;
+        msg->cb = p_cback;
+        msg->param_len = param_len;
+        if (param_len > 0)
+        {
+            memcpy(msg->data, p_params, param_len);
+        }
+        if (queued)
+        {
+            s_bt_app_queue_stats[BT_APP_PRIO_LOW].coalesced++;
+        }
+    }
+    portEXIT_CRITICAL_SAFE(&s_bt_app_queue_lock);
+
+    if (slot < 0)
+    {
+        /* all slots are busy, fall back to a plain low priority message */
+        return bt_app_work_dispatch_prio(p_cback, event, p_params, param_len, NULL, BT_APP_PRIO_LOW);
+    }
+    if (queued)
+    {
+        return true;
+    }
+
+    memset(&marker, 0, offsetof(bt_app_msg_t, data));
+    marker.sig = BT_APP_SIG_COALESCED;
+    marker.event = (uint16_t)slot;
+    if (!bt_app_send_msg(&marker, BT_APP_PRIO_LOW))
+    {
+        portENTER_CRITICAL_SAFE(&s_bt_app_queue_lock);
+        s_bt_app_coalesce_key[slot] = 0;
+        portEXIT_CRITICAL_SAFE(&s_bt_app_queue_lock);
+        return false;
+    }
+    return true;
+}
+
+void bt_app_work_get_stats(bt_app_prio_t prio, bt_app_queue_stats_t *stats)
+{
+    portENTER_CRITICAL_SAFE(&s_bt_app_queue_lock);
+    *stats = s_bt_app_queue_stats[prio];
+    portEXIT_CRITICAL_SAFE(&s_bt_app_queue_lock);
+}
+
+void bt_app_work_report_stats(void)
+{
+    static const char *prio_str[BT_APP_PRIO_NUM] = {"high", "normal", "low"};
+    bt_app_queue_stats_t stats;
+
+    for (int i = 0; i < BT_APP_PRIO_NUM; i++)
+    {
+        bt_app_work_get_stats((bt_app_prio_t)i, &stats);
+
+        ESP_LOGI(BT_APP_CORE_TAG, "queue %s: %" PRIu32 " posted, %" PRIu32 " dropped, %" PRIu32 " coalesced, max depth %" PRIu32
+                 ", latency avg %" PRIu32 " us max %" PRIu32 " us",
+                 prio_str[i], stats.posted, stats.dropped, stats.coalesced, stats.max_depth,
+                 stats.handled ? (uint32_t)(stats.total_latency_us / stats.handled) : 0, stats.max_latency_us);
+    }
+}
+
+void bt_app_task_start_up(void)
+{
+    uint8_t *storage = bt_app_mem_get(MEM_BUF_APP_QUEUES);
+    StaticQueue_t *cbs = bt_app_mem_get(MEM_BUF_APP_QUEUE_CBS);
+
+    /* the queues share one buffer, one after the other */
+    for (int i = 0; i < BT_APP_PRIO_NUM; i++)
+    {
+        s_bt_app_task_queue[i] = xQueueCreateStatic(s_bt_app_queue_len[i], sizeof(bt_app_msg_t), storage, &cbs[i]);
+        storage += s_bt_app_queue_len[i] * sizeof(bt_app_msg_t);
+    }
+    s_bt_app_task_handle = bt_app_mem_task_create(MEM_TASK_APP, bt_app_task_handler, 10, BT_APP_TASK_CORE);
+}
+
+void bt_app_task_shut_down(void)
+{
+    if (s_bt_app_task_handle)
+    {
+        bt_app_mem_task_delete(MEM_TASK_APP);
+        s_bt_app_task_handle = NULL;
+    }
+    for (int i = 0; i < BT_APP_PRIO_NUM; i++)
+    {
+        if (s_bt_app_task_queue[i])
+        {
+            vQueueDelete(s_bt_app_task_queue[i]);
+            s_bt_app_task_queue[i] = NULL;
+        }
+    }
+}
@@ -5,6 +5,7 @@
 #include <inttypes.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/event_groups.h"
 #include "nvs.h"
 #include "nvs_flash.h"
 #include "esp_system.h"
@@ -13,6 +14,8 @@
 #include "esp_bt.h"
 #include "bt_app_core.h"
 #include "bt_app_av.h"
+#include "bt_app_boot.h"
+#include "bt_app_mem.h"
 #include "esp_bt_main.h"
 #include "esp_bt_device.h"
 #include "esp_gap_bt_api.h"
@@ -22,12 +25,21 @@
 /* device name */
 #define LOCAL_DEVICE_NAME "ESP_SPEAKER"
 
-/* event for stack up */
+/* events for stack up */
 enum
 {
     BT_APP_EVT_STACK_UP = 0,
+    BT_APP_EVT_STACK_DEFERRED,
 };
 
+/* bits of s_boot_events, set by the preparation task */
+#define BOOT_NVS_READY (1 << 0)
+#define BOOT_OUTPUT_READY (1 << 1)
+/* the preparation task runs on the audio core while the controller comes up on the other one */
+#define BOOT_PREP_TASK_STACK (3072)
+
+static EventGroupHandle_t s_boot_events = NULL; /* progress of the preparation task */
+
 void bt_app_gap_cb(esp_bt_gap_cb_event_t event, esp_bt_gap_cb_param_t *param)
 {
     uint8_t *bda = NULL;
@@ -83,26 +95,44 @@ void bt_av_hdl_stack_evt(uint16_t event, void *p_param)
     /* when do the stack up, this event comes */
     case BT_APP_EVT_STACK_UP:
     {
+        bt_app_boot_begin(BT_APP_BOOT_PROFILES);
         esp_bt_dev_set_device_name(LOCAL_DEVICE_NAME);
         esp_bt_gap_register_callback(bt_app_gap_cb);
 
+        /* AVRCP has to be initialized before A2DP, so only its notification capabilities wait */
         assert(esp_avrc_ct_init() == ESP_OK);
         esp_avrc_ct_register_callback(bt_app_rc_ct_cb);
         assert(esp_avrc_tg_init() == ESP_OK);
         esp_avrc_tg_register_callback(bt_app_rc_tg_cb);
 
+        assert(esp_a2d_sink_init() == ESP_OK);
+        esp_a2d_register_callback(&bt_app_a2d_cb);
+        esp_a2d_sink_register_data_callback(bt_app_a2d_data_cb);
+        bt_app_boot_end(BT_APP_BOOT_PROFILES);
+
+        /* set discoverable and connectable mode */
+        esp_bt_gap_set_scan_mode(ESP_BT_CONNECTABLE, ESP_BT_GENERAL_DISCOVERABLE);
+        bt_app_boot_mark(BT_APP_BOOT_DISCOVERABLE);
+
+        /* everything else is not needed to be found, let pending stack events go first */
+        bt_app_work_dispatch_prio(bt_av_hdl_stack_evt, BT_APP_EVT_STACK_DEFERRED, NULL, 0, NULL, BT_APP_PRIO_LOW);
+        break;
+    }
+    case BT_APP_EVT_STACK_DEFERRED:
+    {
+        bt_app_boot_begin(BT_APP_BOOT_DEFERRED);
         esp_avrc_rn_evt_cap_mask_t evt_set = {0};
         esp_avrc_rn_evt_bit_mask_operation(ESP_AVRC_BIT_MASK_OP_SET, &evt_set, ESP_AVRC_RN_VOLUME_CHANGE);
         assert(esp_avrc_tg_set_rn_evt_cap(&evt_set) == ESP_OK);
 
-        assert(esp_a2d_sink_init() == ESP_OK);
-        esp_a2d_register_callback(&bt_app_a2d_cb);
-
         /* Get the default value of the delay value */
         esp_a2d_sink_get_delay_value();
 
-        /* set discoverable and connectable mode, wait to be connected */
-        esp_bt_gap_set_scan_mode(ESP_BT_CONNECTABLE, ESP_BT_GENERAL_DISCOVERABLE);
+        /* page the last sources instead of only waiting to be connected */
+        bt_app_peer_reconnect_start();
+        bt_app_boot_end(BT_APP_BOOT_DEFERRED);
+        bt_app_boot_report();
+        bt_app_mem_report();
         break;
     }
     /* others */
@@ -112,9 +142,13 @@ void bt_av_hdl_stack_evt(uint16_t event, void *p_param)
     }
 }
 
-void app_main(void)
+/* brings up what does not depend on the controller, in parallel with it */
+static void bt_app_boot_prep_task(void *arg)
 {
-    /* initialize NVS — it is used to store PHY calibration data */
+    bt_app_peer_t peer;
+
+    /* initialize NVS — it is used to store PHY calibration data and the remembered sources */
+    bt_app_boot_begin(BT_APP_BOOT_NVS);
     esp_err_t err = nvs_flash_init();
     if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND)
     {
@@ -122,11 +156,59 @@ void app_main(void)
         err = nvs_flash_init();
     }
     ESP_ERROR_CHECK(err);
+    bt_app_boot_end(BT_APP_BOOT_NVS);
+
+    bt_app_boot_begin(BT_APP_BOOT_PEERS);
+    bt_app_peer_load();
+    bt_app_boot_end(BT_APP_BOOT_PEERS);
+    xEventGroupSetBits(s_boot_events, BOOT_NVS_READY);
+
+    /* allocate the channels and DMA now, in the format of the last source, so the first connection only enables them */
+    bt_app_boot_begin(BT_APP_BOOT_OUTPUT);
+    if (bt_app_peer_get_recent(&peer) && peer.codec_type == ESP_A2D_MCT_SBC)
+    {
+        int sample_rate = 0;
+        int ch_count = 0;
+
+        bt_av_sbc_format(peer.cie, &sample_rate, &ch_count);
+        output_configure(sample_rate, ch_count);
+    }
+    if ((err = output_init()) == ESP_OK)
+    {
+        output_pause();
+    }
+    else
+    {
+        /* not fatal, the output is opened again on the first connection */
+        ESP_LOGE(BT_AV_TAG, "%s output preallocation failed: %s", __func__, esp_err_to_name(err));
+    }
+    bt_app_boot_end(BT_APP_BOOT_OUTPUT);
+    xEventGroupSetBits(s_boot_events, BOOT_OUTPUT_READY);
+
+    vTaskDelete(NULL);
+}
+
+void app_main(void)
+{
+    esp_err_t err = ESP_OK;
+
+    bt_app_boot_mark(BT_APP_BOOT_APP_MAIN);
+    bt_app_log_start();
+    bt_app_power_init();
+    s_boot_events = xEventGroupCreate();
+    assert(s_boot_events != NULL);
+    if (xTaskCreatePinnedToCore(bt_app_boot_prep_task, "BtBootPrep", BOOT_PREP_TASK_STACK, NULL, configMAX_PRIORITIES - 3,
+                                NULL, BT_I2S_TASK_CORE) != pdPASS)
+    {
+        ESP_LOGE(BT_AV_TAG, "%s boot preparation task creation failed", __func__);
+        return;
+    }
 
     /*
      * This example only uses the functions of Classical Bluetooth.
      * So release the controller memory for Bluetooth Low Energy.
      */
+    bt_app_boot_begin(BT_APP_BOOT_CTRL_INIT);
     ESP_ERROR_CHECK(esp_bt_controller_mem_release(ESP_BT_MODE_BLE));
 
     esp_bt_controller_config_t bt_cfg = BT_CONTROLLER_INIT_CONFIG_DEFAULT();
@@ -135,21 +217,33 @@ void app_main(void)
         ESP_LOGE(BT_AV_TAG, "%s initialize controller failed: %s\n", __func__, esp_err_to_name(err));
         return;
     }
+    bt_app_boot_end(BT_APP_BOOT_CTRL_INIT);
+
+    /* enabling the controller reads the PHY calibration data from NVS */
+    xEventGroupWaitBits(s_boot_events, BOOT_NVS_READY, pdFALSE, pdTRUE, portMAX_DELAY);
+    bt_app_boot_begin(BT_APP_BOOT_CTRL_ENABLE);
     if ((err = esp_bt_controller_enable(ESP_BT_MODE_CLASSIC_BT)) != ESP_OK)
     {
         ESP_LOGE(BT_AV_TAG, "%s enable controller failed: %s\n", __func__, esp_err_to_name(err));
         return;
     }
+    bt_app_boot_end(BT_APP_BOOT_CTRL_ENABLE);
+
+    bt_app_boot_begin(BT_APP_BOOT_BLUEDROID_INIT);
     if ((err = esp_bluedroid_init()) != ESP_OK)
     {
         ESP_LOGE(BT_AV_TAG, "%s initialize bluedroid failed: %s\n", __func__, esp_err_to_name(err));
         return;
     }
+    bt_app_boot_end(BT_APP_BOOT_BLUEDROID_INIT);
+
+    bt_app_boot_begin(BT_APP_BOOT_BLUEDROID_ENABLE);
     if ((err = esp_bluedroid_enable()) != ESP_OK)
     {
         ESP_LOGE(BT_AV_TAG, "%s enable bluedroid failed: %s\n", __func__, esp_err_to_name(err));
         return;
     }
+    bt_app_boot_end(BT_APP_BOOT_BLUEDROID_ENABLE);
 
     /* set default parameters for Legacy Pairing (use fixed pin code 1234) */
     esp_bt_pin_type_t pin_type = ESP_BT_PIN_TYPE_FIXED;
@@ -161,6 +255,11 @@ void app_main(void)
     esp_bt_gap_set_pin(pin_type, 4, pin_code);
 
     bt_app_task_start_up();
+    /* a connection must not find the output half allocated */
+    xEventGroupWaitBits(s_boot_events, BOOT_OUTPUT_READY, pdFALSE, pdTRUE, portMAX_DELAY);
+    /* the preparation task sets no bit after this one */
+    vEventGroupDelete(s_boot_events);
+    s_boot_events = NULL;
     /* bluetooth device name, connection mode and profile set up */
     bt_app_work_dispatch(bt_av_hdl_stack_evt, BT_APP_EVT_STACK_UP, NULL, 0, NULL);
 }
@@ -0,0 +1,92 @@
+#!/usr/bin/env python3
+"""Decodes the binary records of the deferred logger (BT_APP_LOG_BINARY) back into log lines.
+
+The formats are read from main/bt_app_log.h, so the decoder always matches the firmware built from the same tree.
+Text printed by the regular logger between the records is passed through unchanged.
+
+    idf.py monitor | tee capture.bin        # or any raw capture of the UART
+    tools/bt_app_log_decode.py capture.bin
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+SYNC = 0xA5
+HDR = struct.Struct("<BBHI")
+FORMAT_RE = re.compile(r'X\((\w+),\s*(\w+),\s*"([^"]*)",\s*"((?:[^"\\]|\\.)*)"\)')
+CONVERSION_RE = re.compile(r"%[-+ #0]*\d*(?:\.\d+)?[diuxXc]")
+
+
+def load_formats(header):
+    with open(header, encoding="utf-8") as f:
+        text = f.read()
+    block = text[text.index("#define BT_APP_LOG_FORMATS(X)"):]
+    block = block[:block.index("\n\n")]
+    formats = []
+    for name, level, tag, fmt in FORMAT_RE.findall(block):
+        fmt = fmt.encode().decode("unicode_escape")
+        formats.append((name, level[0], tag, fmt, len(CONVERSION_RE.findall(fmt))))
+    return formats
+
+
+def to_signed(value, conversion):
+    return value - (1 << 32) if conversion == "d" and value & 0x80000000 else value
+
+
+def format_record(fmt, args):
+    values = []
+    for conversion, value in zip(CONVERSION_RE.findall(fmt), args):
+        values.append(to_signed(value, conversion[-1]))
+    return fmt.replace("%u", "%d") % tuple(values)
+
+
+def decode(data, formats, out):
+    pos = 0
+    text_start = 0
+    epoch = 0
+    last_us = 0
+    while pos + HDR.size <= len(data):
+        if data[pos] != SYNC:
+            pos += 1
+            continue
+        _, info, rec_id, time_us = HDR.unpack_from(data, pos)
+        nargs, core = info >> 4, info & 0x0F
+        end = pos + HDR.size + 4 * nargs
+        # a sync byte inside text or arguments is told apart by the identifier and argument count
+        if rec_id >= len(formats) or nargs != formats[rec_id][4] or end > len(data):
+            pos += 1
+            continue
+        out.write(data[text_start:pos].decode("utf-8", errors="replace"))
+        args = struct.unpack_from("<%dI" % nargs, data, pos + HDR.size)
+        # the timestamp is the low 32 bits of the microsecond clock, it wraps every 71 minutes
+        if time_us < last_us and last_us - time_us > 1 << 31:
+            epoch += 1 << 32
+        last_us = time_us
+        name, letter, tag, fmt, _ = formats[rec_id]
+        out.write("%s (%d) %s: [core %d] %s\n" % (letter, (epoch + time_us) // 1000, tag, core, format_record(fmt, args)))
+        pos = end
+        text_start = pos
+    out.write(data[text_start:].decode("utf-8", errors="replace"))
+
+
+def main():
+    root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("capture", nargs="?", help="raw capture, standard input if omitted")
+    parser.add_argument("--header", default=os.path.join(root, "main", "bt_app_log.h"), help="header with the formats")
+    args = parser.parse_args()
+
+    formats = load_formats(args.header)
+    if args.capture:
+        with open(args.capture, "rb") as f:
+            data = f.read()
+    else:
+        data = sys.stdin.buffer.read()
+    decode(data, formats, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
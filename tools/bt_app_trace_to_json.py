@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+"""Converts a timeline dumped by bt_app_trace_dump (BT_APP_TRACE_ENABLED) to the Chrome trace event format.
+
+The trace points are read from main/bt_app_trace.h, so the converter always matches the firmware built from the same
+tree. The output opens in Perfetto (ui.perfetto.dev) or chrome://tracing, with one track per context.
+
+    idf.py monitor | tee capture.txt
+    tools/bt_app_trace_to_json.py capture.txt > trace.json
+"""
+
+import argparse
+import json
+import os
+import re
+import struct
+import sys
+
+EVENT = struct.Struct("<IBBHI")
+POINT_RE = re.compile(r'X\((\w+),\s*"([^"]*)",\s*"([^"]*)"\)')
+LINE_RE = re.compile(r"TRACE ([0-9a-f]+)\s*$")
+# ESP_LOG colour codes around the lines of a monitor capture
+ANSI_RE = re.compile(r"\x1b\[[0-9;]*m")
+
+
+def load_points(header):
+    with open(header, encoding="utf-8") as f:
+        text = f.read()
+    block = text[text.index("#define BT_APP_TRACE_POINTS(X)"):]
+    block = block[:block.index("\n\n")]
+    return POINT_RE.findall(block)
+
+
+def read_dumps(lines):
+    """Yields the raw events of every dump in the capture."""
+    data = None
+    for line in lines:
+        line = ANSI_RE.sub("", line)
+        if "TRACE BEGIN" in line:
+            data = bytearray()
+        elif "TRACE END" in line:
+            if data is not None:
+                yield bytes(data)
+            data = None
+        elif data is not None:
+            match = LINE_RE.search(line)
+            if match:
+                data += bytes.fromhex(match.group(1))
+
+
+def convert(data, points, pid):
+    tracks = []
+    for _, _, track in points:
+        if track not in tracks:
+            tracks.append(track)
+    events = [{"ph": "M", "pid": pid, "name": "process_name", "args": {"name": "dump %d" % pid}}]
+    for tid, track in enumerate(tracks):
+        events.append({"ph": "M", "pid": pid, "tid": tid, "name": "thread_name", "args": {"name": track}})
+        events.append({"ph": "M", "pid": pid, "tid": tid, "name": "thread_sort_index", "args": {"sort_index": tid}})
+
+    epoch = 0
+    last_us = None
+    start_us = None
+    for offset in range(0, len(data) - EVENT.size + 1, EVENT.size):
+        time_us, ph, core, point, arg = EVENT.unpack_from(data, offset)
+        if point >= len(points):
+            continue
+        # the timestamp is the low 32 bits of the microsecond clock, it wraps every 71 minutes
+        if last_us is not None and time_us < last_us and last_us - time_us > 1 << 31:
+            epoch += 1 << 32
+        last_us = time_us
+        ts = epoch + time_us
+        if start_us is None:
+            start_us = ts
+        _, name, track = points[point]
+        event = {"name": name, "ph": chr(ph), "ts": ts - start_us, "pid": pid, "tid": tracks.index(track)}
+        if chr(ph) == "C":
+            event["args"] = {name: arg}
+        else:
+            event["args"] = {"arg": arg, "core": core}
+        if chr(ph) == "i":
+            event["s"] = "t"
+        events.append(event)
+    return events
+
+
+def main():
+    root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("capture", nargs="?", help="monitor capture, standard input if omitted")
+    parser.add_argument("--header", default=os.path.join(root, "main", "bt_app_trace.h"), help="header with the points")
+    args = parser.parse_args()
+
+    points = load_points(args.header)
+    if args.capture:
+        with open(args.capture, encoding="utf-8", errors="replace") as f:
+            lines = f.readlines()
+    else:
+        lines = sys.stdin.readlines()
+    events = []
+    # every dump goes to its own process so that the timelines of several connections do not overlap
+    for pid, data in enumerate(read_dumps(lines), 1):
+        events += convert(data, points, pid)
+    if not events:
+        sys.exit("no trace dump found")
+    json.dump({"traceEvents": events, "displayTimeUnit": "ms"}, sys.stdout)
+    sys.stdout.write("\n")
+
+
+if __name__ == "__main__":
+    main()